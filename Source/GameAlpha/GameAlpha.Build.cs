@@ -1,7 +1,10 @@
 // Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
 
 using UnrealBuildTool;
+using System;
+using System.Diagnostics;
 using System.IO;
+using Microsoft.Win32;
 public class GameAlpha : ModuleRules
 {
     private string ModulePath
@@ -9,6 +12,118 @@ public class GameAlpha : ModuleRules
         get { return Path.GetDirectoryName(RulesCompiler.GetModuleFilename(this.GetType().Name)); }
     }
 
+    // Finds MSBuild.exe: the latest Visual Studio 2017 or later through vswhere, otherwise the MSBuild 14.0 that
+    // Visual Studio 2015 registers. platformToolset is the toolset to build with instead of the project's v140, or
+    // null to keep it. Returns null when no MSBuild is installed.
+    private static string FindMSBuild(out string platformToolset)
+    {
+        platformToolset = null;
+        string vswhere = Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.ProgramFilesX86), "Microsoft Visual Studio\\Installer\\vswhere.exe");
+        if (File.Exists(vswhere))
+        {
+            string installationPath = RunVsWhere(vswhere, "installationPath");
+            if (!string.IsNullOrEmpty(installationPath))
+            {
+                foreach (string binDirectory in new string[] { "MSBuild\\Current\\Bin", "MSBuild\\15.0\\Bin" })
+                {
+                    string msbuild = Path.Combine(installationPath, binDirectory, "MSBuild.exe");
+                    if (File.Exists(msbuild))
+                    {
+                        platformToolset = GetPlatformToolset(RunVsWhere(vswhere, "installationVersion"));
+                        return msbuild;
+                    }
+                }
+            }
+        }
+
+        foreach (string key in new string[] { "HKEY_LOCAL_MACHINE\\SOFTWARE\\Microsoft\\MSBuild\\ToolsVersions\\14.0", "HKEY_LOCAL_MACHINE\\SOFTWARE\\Wow6432Node\\Microsoft\\MSBuild\\ToolsVersions\\14.0" })
+        {
+            string toolsPath = Registry.GetValue(key, "MSBuildToolsPath", null) as string;
+            if (!string.IsNullOrEmpty(toolsPath) && File.Exists(Path.Combine(toolsPath, "MSBuild.exe")))
+                return Path.Combine(toolsPath, "MSBuild.exe");
+        }
+        return null;
+    }
+
+    // Returns one property of the latest Visual Studio installation that has MSBuild, or null.
+    private static string RunVsWhere(string vswhere, string property)
+    {
+        ProcessStartInfo startInfo = new ProcessStartInfo(vswhere, "-latest -products * -requires Microsoft.Component.MSBuild -property " + property);
+        startInfo.UseShellExecute = false;
+        startInfo.RedirectStandardOutput = true;
+        startInfo.CreateNoWindow = true;
+        using (Process process = Process.Start(startInfo))
+        {
+            string output = process.StandardOutput.ReadToEnd();
+            process.WaitForExit();
+            if (process.ExitCode != 0)
+                return null;
+            string[] lines = output.Split(new char[] { '\r', '\n' }, StringSplitOptions.RemoveEmptyEntries);
+            return lines.Length > 0 ? lines[0].Trim() : null;
+        }
+    }
+
+    // Maps a Visual Studio version such as "16.11.34" to the toolset it installs by default.
+    private static string GetPlatformToolset(string installationVersion)
+    {
+        int majorVersion;
+        if (string.IsNullOrEmpty(installationVersion) || !int.TryParse(installationVersion.Split('.')[0], out majorVersion))
+            return null;
+        switch (majorVersion)
+        {
+            case 15: return "v141";
+            case 16: return "v142";
+            case 17: return "v143";
+            default: return null;
+        }
+    }
+
+    // Builds voxelcore.vcxproj, which also contains the libnoise sources, before GameAlpha links against it, and
+    // returns the library to link. MSBuild is incremental, so this is a no-op when the library is up to date.
+    // Debug and DebugGame use the project's Debug configuration (lib\voxelcored.lib, unoptimized, asserts on),
+    // everything else its Release configuration (lib\voxelcore.lib). When MSBuild is missing or the build fails,
+    // an existing library is linked with a warning so that machines without the C++ build tools can still build.
+    private string BuildVoxelCore(TargetInfo Target)
+    {
+        bool bDebug = Target.Configuration == UnrealTargetConfiguration.Debug || Target.Configuration == UnrealTargetConfiguration.DebugGame;
+        string project = Path.GetFullPath(Path.Combine(ModulePath, "..\\ThirdParty\\VoxelCore\\voxelcore.vcxproj"));
+        string library = Path.GetFullPath(Path.Combine(ModulePath, bDebug ? "..\\ThirdParty\\VoxelCore\\lib\\voxelcored.lib" : "..\\ThirdParty\\VoxelCore\\lib\\voxelcore.lib"));
+
+        string error = null;
+        string platformToolset;
+        string msbuild = FindMSBuild(out platformToolset);
+        if (msbuild == null)
+        {
+            error = "MSBuild (Visual Studio 2015 or later) was not found";
+        }
+        else
+        {
+            string arguments = "\"" + project + "\" /p:Configuration=" + (bDebug ? "Debug" : "Release") + " /p:Platform=x64 /nologo /verbosity:minimal";
+            if (platformToolset != null)
+                arguments += " /p:PlatformToolset=" + platformToolset;
+            // The project targets the Windows 8.1 SDK, which Visual Studio 2019 and later no longer install; 10.0 picks
+            // the latest installed Windows 10 SDK with those toolsets
+            if (platformToolset == "v142" || platformToolset == "v143")
+                arguments += " /p:WindowsTargetPlatformVersion=10.0";
+            ProcessStartInfo startInfo = new ProcessStartInfo(msbuild, arguments);
+            startInfo.UseShellExecute = false;
+            using (Process process = Process.Start(startInfo))
+            {
+                process.WaitForExit();
+                if (process.ExitCode != 0)
+                    error = string.Format("{0} failed to build {1} (exit code {2})", msbuild, project, process.ExitCode);
+            }
+        }
+
+        if (error != null)
+        {
+            if (!File.Exists(library))
+                throw new BuildException("{0}, and there is no {1} to link instead", error, library);
+            Log.TraceWarning("{0}; linking the existing {1}, which may be out of date", error, library);
+        }
+        return library;
+    }
+
 	public GameAlpha(TargetInfo Target)
 	{
         PublicDependencyModuleNames.AddRange(
@@ -23,6 +138,10 @@ public class GameAlpha : ModuleRules
             }
         );
         PublicIncludePaths.Add("ThirdParty\\LibNoise\\src");
-        PublicAdditionalLibraries.Add(Path.Combine(ModulePath, "..\\ThirdParty\\LibNoise\\lib\\libnoise.lib"));
+        PublicIncludePaths.Add("ThirdParty\\VoxelCore\\src");
+        if (Target.Platform == UnrealTargetPlatform.Win64)
+            PublicAdditionalLibraries.Add(BuildVoxelCore(Target));
+        else
+            PublicAdditionalLibraries.Add(Path.Combine(ModulePath, "..\\ThirdParty\\VoxelCore\\lib\\voxelcore.lib"));
     }
 }
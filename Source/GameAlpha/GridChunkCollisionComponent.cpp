@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameAlpha.h"
+#include "GridChunkCollisionComponent.h"
+#include "GridChunkMgrComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+
+UGridChunkCollisionComponent::UGridChunkCollisionComponent() :
+	Mgr(NULL), BodySetup(NULL)
+{
+	SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	bHiddenInGame = true;
+	CastShadow = false;
+}
+
+void UGridChunkCollisionComponent::SetBoxes(const FInt3& coord, const std::vector<voxel::CollisionBox>& boxes)
+{
+	this->Coordinate = coord;
+	SetRelativeLocation(coord.ToFloat());
+
+	//换一个新的BodySetup，物理线程上可能还在使用旧的
+	UBodySetup* bodySetup = NewObject<UBodySetup>(this, NAME_None, RF_Transient);
+	bodySetup->BodySetupGuid = FGuid::NewGuid();
+	bodySetup->bGenerateMirroredCollision = false;
+	bodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
+	bodySetup->AggGeom.BoxElems.Reserve(boxes.size());
+	for (const voxel::CollisionBox& box : boxes)
+	{
+		FVector size = (FInt3(box.Max) - FInt3(box.Min)).ToFloat();
+		FKBoxElem elem(size.X, size.Y, size.Z);
+		elem.Center = FInt3(box.Min).ToFloat() + size * 0.5f;
+		bodySetup->AggGeom.BoxElems.Add(elem);
+	}
+	bodySetup->CreatePhysicsMeshes();
+	BodySetup = bodySetup;
+	RecreatePhysicsState();
+	UpdateBounds();
+}
+
+UBodySetup* UGridChunkCollisionComponent::GetBodySetup()
+{
+	return BodySetup;
+}
+
+FBoxSphereBounds UGridChunkCollisionComponent::CalcBounds(const FTransform & LocalToWorld) const
+{
+	FBoxSphereBounds NewBounds;
+	NewBounds.Origin = NewBounds.BoxExtent = this->Mgr->GridParameters.GridPerChunk.ToFloat() / 2.0f;
+	NewBounds.SphereRadius = NewBounds.BoxExtent.Size();
+	return NewBounds.TransformBy(LocalToWorld);
+}
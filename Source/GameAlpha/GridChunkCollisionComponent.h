@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/PrimitiveComponent.h"
+#include "GridChunkMgrComponent.h"
+#include "GridChunkCollisionComponent.generated.h"
+
+/**
+ * 一个块的碰撞，由体素核心在后台合并好的长方体组成，不参与渲染
+ */
+UCLASS()
+class GAMEALPHA_API UGridChunkCollisionComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGridChunkCollisionComponent();
+
+	//绑定到一个块并换上新的碰撞盒，块的数据改动后也用它替换
+	void SetBoxes(const FInt3& coord, const std::vector<voxel::CollisionBox>& boxes);
+
+	virtual UBodySetup* GetBodySetup() override;
+
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+
+	class UGridChunkMgrComponent* Mgr;
+
+	//以这个块的左上角为坐标，而不是中心
+	FInt3 Coordinate;
+
+protected:
+	//只有简单碰撞，复杂碰撞的查询也使用它，不需要烘焙三角形网格
+	UPROPERTY(Transient)
+		class UBodySetup* BodySetup;
+};
@@ -3,47 +3,43 @@
 #include "GameAlpha.h"
 #include "GridChunkMgrComponent.h"
 #include "GridChunkRenderComponent.h"
+#include "GridChunkCollisionComponent.h"
 
-FChunkGridData::FChunkGridData(const FInt3& coord, const FGridParam& param)
-{
-	noise::module::Perlin myModule;
-	utils::NoiseMapBuilderPlane heightMapBuilder;
-	heightMapBuilder.SetSourceModule(myModule);
-	heightMapBuilder.SetDestNoiseMap(m_HeightMap);
-	FInt3 bound = param.GridPerChunk + FInt3::Scalar(1);
-	heightMapBuilder.SetDestSize(bound.X, bound.Y);
-	heightMapBuilder.SetBounds(coord.X, coord.X + bound.X, coord.Y, coord.Y + bound.Y);
-	heightMapBuilder.Build();
-	for (int32 i = 0; i < param.GridPerChunk.X + 1; ++i)
-	{
-		for (int32 j = 0; j < param.GridPerChunk.Y + 1; ++j)
-		{
-			FInt3 gridPos = coord + FInt3(i, j, 0);
-			float fNoise = m_HeightMap.GetValue(gridPos.X, gridPos.Y);
-			fNoise = fmin(fNoise, 1.0f);
-			fNoise = fmax(fNoise, -1.0f);
-			int32 height = int32((fNoise + 1.0f) * 0.5 * param.MaxHeight);
-			for (int32 k = 0; k < param.GridPerChunk.Z + 1; ++k)
-			{
-				int32 curGridHeight = coord.Z + k;
-				if (curGridHeight < height)
-					GridMaterialIndex.Add(1);
-				else
-					GridMaterialIndex.Add(0);
-			}
-
-		}
-	}
+voxel::GridParam FGridParam::ToVoxelParam() const
+{
+	voxel::GridParam param;
+	param.GridPerChunk = GridPerChunk.ToVoxel();
+	param.MinCoordinate = MinCoordinate.ToVoxel();
+	param.MaxCoordinate = MaxCoordinate.ToVoxel();
+	param.MaxHeight = MaxHeight;
+	param.MaxRenderDistance = MaxRenderDistance;
+	param.MaxCollisionDistance = MaxCollisionDistance;
+	param.StreamingHysteresis = StreamingHysteresis;
+	param.MaxGenerationTasks = MaxGenerationTasks;
+	param.NoiseFrequency = NoiseFrequency;
+	for (int32 i = 0; i < FMath::Min(LodDistances.Num(), voxel::MaxChunkLod); ++i)
+		param.LodDistances[i] = LodDistances[i];
+	param.LodHysteresis = LodHysteresis;
+	return param;
 }
 
-
 // Sets default values for this component's properties
 UGridChunkMgrComponent::UGridChunkMgrComponent()
 {
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
 	bWantsBeginPlay = true;
-	PrimaryComponentTick.bCanEverTick = false;
+	//每帧把后台生成完的块数据取回游戏线程
+	PrimaryComponentTick.bCanEverTick = true;
+	MaxPooledRenderComponents = 256;
+	PrewarmRenderComponents = 0;
+	GenerationHandOffBudgetMs = 1.0f;
+	ComponentCreationBudgetMs = 2.0f;
+	ProxyRebuildBudgetMs = 2.0f;
+	StreamingViewOrigin = FVector::ZeroVector;
+	StreamingViewDirection = FVector::ForwardVector;
+	StreamingViewHalfFov = PI;
+	bHasStreamingView = false;
 
 	// ...
 }
@@ -54,77 +50,438 @@ void UGridChunkMgrComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// ...
-	
+	for (int32 i = FreeRenderComponents.Num(); i < PrewarmRenderComponents; ++i)
+		ReleaseRenderComponent(AcquireRenderComponent());
 }
 
-void UGridChunkMgrComponent::Update(const FVector& WorldViewPosition)
+void UGridChunkMgrComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	//FVector localViewPosition = GetComponentTransform().InverseTransformPosition(WorldViewPosition);
-	FVector localViewPosition = FVector(0, 0, 0);
-	FInt3 minCoordinate = FInt3::Max(GridParameters.MinCoordinate, FInt3::Floor(localViewPosition - FVector(GridParameters.MaxRenderDistance)));
-	FInt3 maxCoordinate = FInt3::Min(GridParameters.MaxCoordinate, FInt3::Ceil(localViewPosition + FVector(GridParameters.MaxRenderDistance)));
-	if (minCoordinate.X < 0)
-		minCoordinate.X -= GridParameters.GridPerChunk.X;
-	if (minCoordinate.Y < 0)
-		minCoordinate.Y -= GridParameters.GridPerChunk.Y;
-	if (minCoordinate.Z < 0)
-		minCoordinate.Z -= GridParameters.GridPerChunk.Z;
-	if (maxCoordinate.X < 0)
-		maxCoordinate.X -= GridParameters.GridPerChunk.X;
-	if (maxCoordinate.Y < 0)
-		maxCoordinate.Y -= GridParameters.GridPerChunk.Y;
-	if (maxCoordinate.Z < 0)
-		maxCoordinate.Z -= GridParameters.GridPerChunk.Z;
-	FInt3 minChunkIndex = minCoordinate / GridParameters.GridPerChunk;
-	FInt3 maxChunkIndex = maxCoordinate / GridParameters.GridPerChunk;
-
-
-	//ɾӾĿ
-	for (auto chunkIt = Coord2ChunkRenderComponent.CreateIterator(); chunkIt; ++chunkIt)
+	if (VoxelWorld.IsValid())
 	{
-		FInt3 coord = chunkIt.Key();
-		FInt3 center = coord + GridParameters.GridPerChunk / FInt3::Scalar(2);
-		if (center.X * center.X + center.Y * center.Y >= GridParameters.MaxRenderDistance * GridParameters.MaxRenderDistance)
-		{
-			UGridChunkRenderComponent* comp = chunkIt.Value();
-			comp->DetachFromParent();
+		VoxelWorld->CancelAllGenerationTasks();
+		//存档在VoxelWorld销毁时等待后台写完
+		VoxelWorld->SaveDirtyChunks();
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void UGridChunkMgrComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!VoxelWorld.IsValid())
+		return;
+	//AddViewer、SetViewerLocation等的改动一帧处理一次，多个观察者同时移动时共享的块只增减计数
+	std::vector<voxel::Int3> enteredChunks;
+	std::vector<voxel::Int3> leftChunks;
+	VoxelWorld->UpdateViewers(enteredChunks, leftChunks);
+	ApplyStreamingChanges(enteredChunks, leftChunks);
+	//新到的数据可能让自身或相邻的块满足创建渲染组件的条件
+	std::vector<voxel::Int3> readyChunks;
+	VoxelWorld->ProcessCompletedTasks(readyChunks, GenerationHandOffBudgetMs * 1e-3);
+	for (const voxel::Int3& readyChunk : readyChunks)
+	{
+		FInt3 coord(readyChunk);
+		if (!Coord2ChunkRenderComponent.Contains(coord))
+			PendingCreateChunks.Add(coord);
+	}
+	//只重建数据或材质有改动的块，其余块的场景代理保持不变
+	std::vector<voxel::Int3> dirtyChunks;
+	VoxelWorld->PopDirtyMeshes(dirtyChunks);
+	for (const voxel::Int3& dirtyChunk : dirtyChunks)
+	{
+		if (Coord2ChunkRenderComponent.Contains(FInt3(dirtyChunk)))
+			PendingRebuildChunks.Add(FInt3(dirtyChunk));
+	}
+	VoxelWorld->DispatchGenerationTasks();
+	ApplyCollisionChanges();
+
+	//瞬移或视距变大时一次会有大量的块就绪，按预算分摊到多帧，近处以及视野内的块先显示
+	UpdateStreamingView();
+	DrainPendingChunks(PendingCreateChunks, ComponentCreationBudgetMs, [this](const FInt3& coord) {
+		if (!Coord2ChunkRenderComponent.Contains(coord))
+			TryCreateRenderComponent(coord);
+	});
+	//每个块同时只有一个重建任务，连续修改时完成的网格总是比正在显示的新
+	DrainPendingChunks(PendingRebuildChunks, ProxyRebuildBudgetMs, [this](const FInt3& coord) {
+		if (MeshQueue->IsRequested(coord.ToVoxel()))
+			PendingRebuildChunks.Add(coord);
+		else if (Coord2ChunkRenderComponent.Contains(coord))
+			RequestChunkMesh(coord);
+	});
+	ApplyBuiltMeshes();
+}
+
+void UGridChunkMgrComponent::RequestChunkMesh(const FInt3& coord)
+{
+	const voxel::ChunkWorld& world = GetVoxelWorld();
+	voxel::MeshSettings meshSettings;
+	GetVoxelMaterialTypes(meshSettings.MaterialTypes);
+	meshSettings.GreedyMeshing = GridParameters.bGreedyMeshing;
+	meshSettings.AmbientOcclusion = GridParameters.bAmbientOcclusion;
+	voxel::ChunkNeighbourhood neighbourhood;
+	world.GetNeighbourhood(coord.ToVoxel(), neighbourhood);
+	FInt3 minCoordinate = FInt3::Max(GridParameters.MinCoordinate, coord);
+	FInt3 maxCoordinate = FInt3::Min(GridParameters.MaxCoordinate, coord + GridParameters.GridPerChunk);
+	MeshQueue->Request(neighbourhood, minCoordinate.ToVoxel(), maxCoordinate.ToVoxel(), world.GetChunkLod(coord.ToVoxel()),
+		world.GetSkirtFaceMask(coord.ToVoxel()), meshSettings);
+}
+
+void UGridChunkMgrComponent::ApplyBuiltMeshes()
+{
+	std::vector<voxel::BuiltChunkMeshPtr> builtMeshes;
+	MeshQueue->PopCompleted(builtMeshes);
+	for (const voxel::BuiltChunkMeshPtr& builtMesh : builtMeshes)
+	{
+		UGridChunkRenderComponent* comp = Coord2ChunkRenderComponent.FindRef(FInt3(builtMesh->Coordinate));
+		if (comp)
+			comp->SetBuiltMesh(builtMesh);
+	}
+}
+
+void UGridChunkMgrComponent::ApplyCollisionChanges()
+{
+	std::vector<voxel::ChunkCollisionPtr> builtCollisions;
+	std::vector<voxel::Int3> removedChunks;
+	VoxelWorld->PopCollisionChanges(builtCollisions, removedChunks);
+	for (const voxel::Int3& removedChunk : removedChunks)
+	{
+		UGridChunkCollisionComponent* comp = NULL;
+		if (Coord2ChunkCollisionComponent.RemoveAndCopyValue(FInt3(removedChunk), comp))
 			comp->DestroyComponent();
-			chunkIt.RemoveCurrent();
-		}
 	}
-	//½ӾĿӽ
-	for (int x = minChunkIndex.X; x <= maxChunkIndex.X; ++x)
+	for (const voxel::ChunkCollisionPtr& collision : builtCollisions)
 	{
-		for (int y = minChunkIndex.Y ; y <= maxChunkIndex.Y; ++y)
+		FInt3 coord(collision->Coordinate);
+		UGridChunkCollisionComponent* comp = Coord2ChunkCollisionComponent.FindRef(coord);
+		//整个块都是空白的块不需要碰撞组件
+		if (collision->Boxes.empty())
 		{
-			FInt3 coord = FInt3(x, y, 0) * GridParameters.GridPerChunk;
-			FInt3 center = coord + GridParameters.GridPerChunk / FInt3::Scalar(2);
-			if (center.X * center.X + center.Y * center.Y >= GridParameters.MaxRenderDistance * GridParameters.MaxRenderDistance)
-				continue;
-			FChunkGridData* data = this->Coord2ChunkData.Find(coord);
-			if (!data)
+			if (comp)
 			{
-				this->Coord2ChunkData.Add(coord, FChunkGridData(coord, this->GridParameters));
+				Coord2ChunkCollisionComponent.Remove(coord);
+				comp->DestroyComponent();
 			}
+			continue;
+		}
+		if (!comp)
+		{
+			comp = NewObject<UGridChunkCollisionComponent>(GetOwner());
+			comp->Mgr = this;
+			comp->AttachTo(this);
+			comp->RegisterComponent();
+			Coord2ChunkCollisionComponent.Add(coord, comp);
+		}
+		comp->SetBoxes(coord, collision->Boxes);
+	}
+}
 
-			UGridChunkRenderComponent* comp = Coord2ChunkRenderComponent.FindRef(coord);
-			if (!comp)
-			{
-				comp = NewObject<UGridChunkRenderComponent>(GetOwner());
-				comp->Mgr = this;
-				comp->Init(coord);
-				comp->SetRelativeLocation(coord.ToFloat());
-				comp->AttachTo(this);
-				comp->RegisterComponent();
-				Coord2ChunkRenderComponent.Add(coord, comp);
+bool UGridChunkMgrComponent::SweepVoxelBox(const FVector& Start, const FVector& End, const FVector& HalfExtent, FVector& OutLocation, FVector& OutNormal)
+{
+	//组件空间以格子为单位
+	const FTransform& componentToWorld = GetComponentTransform();
+	FVector localStart = componentToWorld.InverseTransformPosition(Start);
+	FVector localDelta = componentToWorld.InverseTransformPosition(End) - localStart;
+	FVector localHalfExtent = HalfExtent / componentToWorld.GetScale3D();
+	double boxMin[3] = { localStart.X - localHalfExtent.X, localStart.Y - localHalfExtent.Y, localStart.Z - localHalfExtent.Z };
+	double boxMax[3] = { localStart.X + localHalfExtent.X, localStart.Y + localHalfExtent.Y, localStart.Z + localHalfExtent.Z };
+	double delta[3] = { localDelta.X, localDelta.Y, localDelta.Z };
+	voxel::SweepHit hit;
+	if (!GetVoxelWorld().SweepBox(boxMin, boxMax, delta, hit))
+	{
+		OutLocation = End;
+		OutNormal = FVector::ZeroVector;
+		return false;
+	}
+	OutLocation = FMath::Lerp(Start, End, float(hit.Time));
+	OutNormal = hit.FaceIndex >= 0 ? componentToWorld.TransformVector(FInt3(voxel::GetFaceNormal(uint8(hit.FaceIndex))).ToFloat()).GetSafeNormal() : FVector::ZeroVector;
+	return true;
+}
 
-			}
+bool UGridChunkMgrComponent::VoxelLineTrace(const FVector& Start, const FVector& End, FInt3& OutGridCoord, FVector& OutLocation, FVector& OutNormal)
+{
+	const FTransform& componentToWorld = GetComponentTransform();
+	FVector localStart = componentToWorld.InverseTransformPosition(Start);
+	FVector localDelta = componentToWorld.InverseTransformPosition(End) - localStart;
+	voxel::VoxelRay ray = { { localStart.X, localStart.Y, localStart.Z }, { localDelta.X, localDelta.Y, localDelta.Z }, localDelta.Size() };
+	voxel::RaycastHit hit;
+	if (ray.MaxDistance == 0 || !voxel::VoxelQuery(GetVoxelWorld()).Raycast(ray, hit))
+	{
+		OutLocation = End;
+		OutNormal = FVector::ZeroVector;
+		return false;
+	}
+	OutGridCoord = FInt3(hit.GridCoord);
+	OutLocation = FMath::Lerp(Start, End, float(hit.Distance / ray.MaxDistance));
+	OutNormal = hit.FaceIndex >= 0 ? componentToWorld.TransformVector(FInt3(voxel::GetFaceNormal(uint8(hit.FaceIndex))).ToFloat()).GetSafeNormal() : FVector::ZeroVector;
+	return true;
+}
+
+bool UGridChunkMgrComponent::VoxelOverlapSphere(const FVector& Center, float Radius, TArray<FInt3>& OutGridCoords)
+{
+	const FTransform& componentToWorld = GetComponentTransform();
+	FVector localCenter = componentToWorld.InverseTransformPosition(Center);
+	double center[3] = { localCenter.X, localCenter.Y, localCenter.Z };
+	std::vector<voxel::Int3> grids;
+	voxel::VoxelQuery(GetVoxelWorld()).OverlapSphere(center, Radius / componentToWorld.GetMaximumAxisScale(), &grids);
+	OutGridCoords.Reset(grids.size());
+	for (size_t i = 0; i < grids.size(); ++ i)
+		OutGridCoords.Add(FInt3(grids[i]));
+	return OutGridCoords.Num() > 0;
+}
+
+bool UGridChunkMgrComponent::VoxelOverlapBox(const FVector& Center, const FVector& HalfExtent, TArray<FInt3>& OutGridCoords)
+{
+	const FTransform& componentToWorld = GetComponentTransform();
+	FVector localCenter = componentToWorld.InverseTransformPosition(Center);
+	FVector localHalfExtent = HalfExtent / componentToWorld.GetScale3D();
+	double boxMin[3] = { localCenter.X - localHalfExtent.X, localCenter.Y - localHalfExtent.Y, localCenter.Z - localHalfExtent.Z };
+	double boxMax[3] = { localCenter.X + localHalfExtent.X, localCenter.Y + localHalfExtent.Y, localCenter.Z + localHalfExtent.Z };
+	std::vector<voxel::Int3> grids;
+	voxel::VoxelQuery(GetVoxelWorld()).OverlapBox(boxMin, boxMax, &grids);
+	OutGridCoords.Reset(grids.size());
+	for (size_t i = 0; i < grids.size(); ++ i)
+		OutGridCoords.Add(FInt3(grids[i]));
+	return OutGridCoords.Num() > 0;
+}
+
+int32 UGridChunkMgrComponent::SetVoxels(const TArray<FGridVoxelEdit>& Edits)
+{
+	std::vector<voxel::VoxelEdit> edits;
+	edits.reserve(Edits.Num());
+	for (const FGridVoxelEdit& edit : Edits)
+		edits.push_back(voxel::VoxelEdit(edit.GridCoord.ToVoxel(), edit.MaterialIndex));
+	return int32(GetVoxelWorld().SetVoxels(edits));
+}
+
+int32 UGridChunkMgrComponent::FillVoxelBox(const FInt3& MinGridCoord, const FInt3& MaxGridCoord, uint8 MaterialIndex)
+{
+	return int32(GetVoxelWorld().FillBox(MinGridCoord.ToVoxel(), MaxGridCoord.ToVoxel(), MaterialIndex));
+}
+
+int32 UGridChunkMgrComponent::FillVoxelSphere(const FVector& Center, float Radius, uint8 MaterialIndex)
+{
+	const FTransform& componentToWorld = GetComponentTransform();
+	FVector localCenter = componentToWorld.InverseTransformPosition(Center);
+	double center[3] = { localCenter.X, localCenter.Y, localCenter.Z };
+	return int32(GetVoxelWorld().FillSphere(center, Radius / componentToWorld.GetMaximumAxisScale(), MaterialIndex));
+}
+
+void UGridChunkMgrComponent::GetVoxelMaterialTypes(std::vector<voxel::MaterialType>& outMaterialTypes) const
+{
+	outMaterialTypes.clear();
+	for (int16 index = 0; index < GridParameters.GridMaterials.Num(); ++ index)
+	{
+		if (index == GridParameters.EmptyMaterialIndex)
+			outMaterialTypes.push_back(voxel::MT_Empty);
+		else
+		{
+			if (GridParameters.GridMaterials[index].SurfaceMaterial->GetBlendMode() == BLEND_Translucent)
+				outMaterialTypes.push_back(voxel::MT_Translucent);
 			else
-			{
-				comp->MarkRenderStateDirty();
-			}
+				outMaterialTypes.push_back(voxel::MT_Opaque);
+		}
+	}
+}
+
+void UGridChunkMgrComponent::UpdateStreamingView()
+{
+	APlayerController* controller = GetWorld() ? GetWorld()->GetFirstPlayerController() : NULL;
+	bHasStreamingView = controller && controller->PlayerCameraManager;
+	if (!bHasStreamingView)
+		return;
+	APlayerCameraManager* cameraManager = controller->PlayerCameraManager;
+	const FTransform& componentToWorld = GetComponentTransform();
+	StreamingViewOrigin = componentToWorld.InverseTransformPosition(cameraManager->GetCameraLocation());
+	StreamingViewDirection = componentToWorld.InverseTransformVector(cameraManager->GetCameraRotation().Vector()).GetSafeNormal();
+	StreamingViewHalfFov = FMath::DegreesToRadians(cameraManager->GetFOVAngle() * 0.5f);
+}
+
+float UGridChunkMgrComponent::GetStreamingPriority(const FInt3& coord) const
+{
+	FVector halfChunk = GridParameters.GridPerChunk.ToFloat() * 0.5f;
+	FVector toChunk = coord.ToFloat() + halfChunk - StreamingViewOrigin;
+	float distance = toChunk.Size();
+	if (!bHasStreamingView)
+		return distance;
+	//块的包围球与视野圆锥相交时算作在视野内
+	float radius = halfChunk.Size();
+	bool bInView = distance <= radius ||
+		FMath::Acos(FMath::Clamp(FVector::DotProduct(toChunk / distance, StreamingViewDirection), -1.0f, 1.0f)) <= StreamingViewHalfFov + FMath::Asin(radius / distance);
+	//视野外的块排在所有视野内的块之后
+	return bInView ? distance : distance + WORLD_MAX;
+}
+
+void UGridChunkMgrComponent::DrainPendingChunks(TSet<FInt3>& pendingChunks, float budgetMs, TFunctionRef<void(const FInt3&)> process)
+{
+	if (pendingChunks.Num() == 0)
+		return;
+	struct FPendingChunk
+	{
+		FInt3 Coordinate;
+		float Priority;
+
+		bool operator<(const FPendingChunk& other) const
+		{
+			return Priority < other.Priority;
+		}
+	};
+	TArray<FPendingChunk> sortedChunks;
+	sortedChunks.Reserve(pendingChunks.Num());
+	for (const FInt3& coord : pendingChunks)
+		sortedChunks.Add(FPendingChunk{ coord, GetStreamingPriority(coord) });
+	sortedChunks.Sort();
+
+	double endTime = FPlatformTime::Seconds() + budgetMs * 1e-3;
+	for (int32 i = 0; i < sortedChunks.Num(); ++i)
+	{
+		if (i > 0 && FPlatformTime::Seconds() >= endTime)
+			break;
+		pendingChunks.Remove(sortedChunks[i].Coordinate);
+		process(sortedChunks[i].Coordinate);
+	}
+}
 
+voxel::ChunkWorld& UGridChunkMgrComponent::GetVoxelWorld()
+{
+	if (!VoxelWorld.IsValid())
+	{
+		//顶点坐标用8位存储，块的尺寸超出范围时发布版本的网格会错乱，创建前限制到合法范围
+		FInt3 gridPerChunk = FInt3::Clamp(GridParameters.GridPerChunk, FInt3::Scalar(1), FInt3::Scalar(voxel::MaxMeshChunkSize));
+		if (!(gridPerChunk == GridParameters.GridPerChunk))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("GridPerChunk (%d, %d, %d) is out of range [1, %d], clamped to (%d, %d, %d)"),
+				GridParameters.GridPerChunk.X, GridParameters.GridPerChunk.Y, GridParameters.GridPerChunk.Z, voxel::MaxMeshChunkSize,
+				gridPerChunk.X, gridPerChunk.Y, gridPerChunk.Z);
+			GridParameters.GridPerChunk = gridPerChunk;
 		}
+		//块数据在TaskGraph的后台线程上生成
+		voxel::TaskDispatcher dispatcher = [](const std::function<void()>& job) {
+			FFunctionGraphTask::CreateAndDispatchWhenReady([job]() { job(); }, TStatId(), NULL);
+		};
+		VoxelWorld = MakeShareable(new voxel::ChunkWorld(GridParameters.ToVoxelParam(), dispatcher));
+		MeshQueue = MakeShareable(new voxel::ChunkMeshQueue(dispatcher));
+		if (!ChunkStoreName.IsEmpty())
+		{
+			//缺少的块先在后台从存档读取，存档中没有时再生成
+			FString directory = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("Chunks") / ChunkStoreName);
+			IFileManager::Get().MakeDirectory(*directory, true);
+			VoxelWorld->SetChunkStore(std::make_shared<voxel::RegionStore>(std::string(TCHAR_TO_UTF8(*directory)), GridParameters.GridPerChunk.ToVoxel()));
+		}
+		std::vector<voxel::MaterialType> materialTypes;
+		GetVoxelMaterialTypes(materialTypes);
+		VoxelWorld->SetCollisionMaterialTypes(materialTypes);
+	}
+	return *VoxelWorld;
+}
+
+void UGridChunkMgrComponent::NotifyGridMaterialsChanged()
+{
+	if (!VoxelWorld.IsValid())
+		return;
+	VoxelWorld->MarkAllMeshesDirty(voxel::CMDF_Material);
+	//空白材质可能变了，碰撞也要重建
+	std::vector<voxel::MaterialType> materialTypes;
+	GetVoxelMaterialTypes(materialTypes);
+	VoxelWorld->SetCollisionMaterialTypes(materialTypes);
+}
+
+void UGridChunkMgrComponent::SaveChunks()
+{
+	if (VoxelWorld.IsValid())
+		VoxelWorld->SaveDirtyChunks();
+}
+
+voxel::Int3 UGridChunkMgrComponent::ToGridPosition(const FVector& WorldLocation) const
+{
+	return FInt3::Floor(GetComponentTransform().InverseTransformPosition(WorldLocation)).ToVoxel();
+}
+
+void UGridChunkMgrComponent::Update(const FVector& WorldViewPosition)
+{
+	voxel::ChunkWorld& world = GetVoxelWorld();
+	//运行中修改的距离、细节层级和后台任务数每次Update都传给体素世界
+	world.SetParam(GridParameters.ToVoxelParam());
+	std::vector<voxel::Int3> enteredChunks;
+	std::vector<voxel::Int3> leftChunks;
+	world.Update(ToGridPosition(WorldViewPosition), enteredChunks, leftChunks);
+	if (!bHasStreamingView)
+		StreamingViewOrigin = GetComponentTransform().InverseTransformPosition(WorldViewPosition);
+	ApplyStreamingChanges(enteredChunks, leftChunks);
+}
+
+int32 UGridChunkMgrComponent::AddViewer(const FVector& WorldLocation, int32 RenderDistance, int32 CollisionDistance)
+{
+	voxel::ChunkViewer viewer;
+	viewer.Position = ToGridPosition(WorldLocation);
+	viewer.RenderDistance = FMath::Max(RenderDistance, 0);
+	viewer.CollisionDistance = FMath::Max(CollisionDistance, 0);
+	return GetVoxelWorld().AddViewer(viewer);
+}
+
+void UGridChunkMgrComponent::SetViewerLocation(int32 ViewerId, const FVector& WorldLocation)
+{
+	GetVoxelWorld().SetViewerPosition(ViewerId, ToGridPosition(WorldLocation));
+}
+
+void UGridChunkMgrComponent::RemoveViewer(int32 ViewerId)
+{
+	GetVoxelWorld().RemoveViewer(ViewerId);
+}
+
+void UGridChunkMgrComponent::ApplyStreamingChanges(const std::vector<voxel::Int3>& enteredChunks, const std::vector<voxel::Int3>& leftChunks)
+{
+	//删除超出视距的块，只处理这次离开的块，不遍历所有显示的块
+	for (const voxel::Int3& leftChunk : leftChunks)
+	{
+		FInt3 coord(leftChunk);
+		UGridChunkRenderComponent* comp = NULL;
+		if (Coord2ChunkRenderComponent.RemoveAndCopyValue(coord, comp))
+			ReleaseRenderComponent(comp);
+		PendingCreateChunks.Remove(coord);
+		PendingRebuildChunks.Remove(coord);
+		MeshQueue->Cancel(leftChunk);
+	}
+
+	//新进入视距的块在之后的帧按预算加进场景
+	for (const voxel::Int3& enteredChunk : enteredChunks)
+	{
+		FInt3 coord(enteredChunk);
+		if (!Coord2ChunkRenderComponent.Contains(coord))
+			PendingCreateChunks.Add(coord);
+	}
+}
+
+void UGridChunkMgrComponent::TryCreateRenderComponent(const FInt3& coord)
+{
+	//数据就绪时ProcessCompletedTasks会再次报告这个块
+	if (!GetVoxelWorld().IsChunkDataReady(coord.ToVoxel()))
+		return;
+	UGridChunkRenderComponent* comp = AcquireRenderComponent();
+	comp->Init(coord);
+	Coord2ChunkRenderComponent.Add(coord, comp);
+}
+
+UGridChunkRenderComponent* UGridChunkMgrComponent::AcquireRenderComponent()
+{
+	if (FreeRenderComponents.Num() > 0)
+		return FreeRenderComponents.Pop(false);
+	UGridChunkRenderComponent* comp = NewObject<UGridChunkRenderComponent>(GetOwner());
+	comp->Mgr = this;
+	comp->AttachTo(this);
+	comp->RegisterComponent();
+	return comp;
+}
+
+void UGridChunkMgrComponent::ReleaseRenderComponent(UGridChunkRenderComponent* comp)
+{
+	//超出上限的组件真正销毁，池随视距内块数的减少而收缩
+	if (FreeRenderComponents.Num() >= MaxPooledRenderComponents)
+	{
+		comp->DetachFromParent();
+		comp->DestroyComponent();
+		return;
 	}
+	comp->Recycle();
+	FreeRenderComponents.Add(comp);
 }
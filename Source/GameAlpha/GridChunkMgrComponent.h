@@ -3,7 +3,7 @@
 #pragma once
 
 #include "Components/SceneComponent.h"
-#include "noiseutils.h"
+#include "voxelcore.h"
 #include "GridChunkMgrComponent.generated.h"
 
 /** Shifts a number right with sign extension. */
@@ -38,6 +38,7 @@ struct FInt3
 
 	FInt3() {}
 	FInt3(int32 InX, int32 InY, int32 InZ) : X(InX), Y(InY), Z(InZ) {}
+	explicit FInt3(const voxel::Int3& V) : X(V.X), Y(V.Y), Z(V.Z) {}
 
 	static FInt3 Scalar(int32 I)
 	{
@@ -47,10 +48,12 @@ struct FInt3
 	operator FIntVector() const { return FIntVector(X, Y, Z); }
 	FVector ToFloat() const { return FVector(X, Y, Z); }
 	int32 SumComponents() const { return X + Y + Z; }
+	voxel::Int3 ToVoxel() const { return voxel::Int3(X, Y, Z); }
 
+	//与体素核心的ChunkMap使用同样的整数混合，比对12个字节做CRC快得多
 	friend uint32 GetTypeHash(const FInt3& Coordinates)
 	{
-		return FCrc::MemCrc32(&Coordinates, sizeof(Coordinates));
+		return uint32(voxel::MixInt3(Coordinates.ToVoxel()));
 	}
 #define DEFINE_VECTOR_OPERATOR(symbol) \
 		friend FInt3 operator symbol(const FInt3& A, const FInt3& B) \
@@ -129,6 +132,25 @@ struct FGridMaterial
 	{}
 };
 
+//修改一个格子，GridCoord为组件空间的格子坐标
+USTRUCT(BlueprintType, Atomic)
+struct FGridVoxelEdit
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		FInt3 GridCoord;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		uint8 MaterialIndex;
+
+	FGridVoxelEdit() :
+		MaterialIndex(0)
+	{}
+};
+
+//距离、细节层级和后台任务数可以在运行中修改，下次Update时生效；GridPerChunk、MinCoordinate、MaxCoordinate、MaxHeight和NoiseFrequency
+//决定已有块的坐标和内容，只在第一次Update创建体素世界时生效
 USTRUCT(BlueprintType, Atomic)
 struct FGridParam
 {
@@ -140,12 +162,19 @@ struct FGridParam
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Material)
 		int32 EmptyMaterialIndex;
 
+	//加载半径，块中心到观察点所在块的中心的水平距离，格子坐标
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
 		int MaxRenderDistance;
 
+	//卸载半径比加载半径大出的距离，观察点在视距边界附近来回移动时块不会反复加载和卸载
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		int32 StreamingHysteresis;
+
+	//Update的观察者需要碰撞的半径，格子坐标，范围内的块在后台合并碰撞盒后创建碰撞组件
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
 		int MaxCollisionDistance;
 
+	//顶点坐标用8位存储，每个方向1到255个格子，超出范围时在创建体素世界时限制并输出警告
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
 		FInt3 GridPerChunk;
 
@@ -158,30 +187,47 @@ struct FGridParam
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
 		int32 MaxHeight;
 
-};
+	//同时在后台线程生成的块数据的最大数量
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		int32 MaxGenerationTasks;
 
-USTRUCT(BlueprintType)
-struct FChunkGridData
-{
-	GENERATED_USTRUCT_BODY()
+	//合并同一平面上材质相同的面，减少顶点和三角形数量
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		bool bGreedyMeshing;
 
-	UPROPERTY()
-		FInt3 Coordinate;
+	//构建网格时计算顶点的环境光遮蔽，材质中从顶点颜色的A通道读取，1为不遮蔽
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Material)
+		bool bAmbientOcclusion;
+
+	//逐个视图剔除块中背向观察点的面，大约减少一半提交的三角形，代价是块改为动态绘制。只对不投射动态阴影的块生效
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		bool bCullFaceBatches;
 
-	UPROPERTY()
-		TArray<uint8> GridMaterialIndex;
+	//高度噪声的频率，1.0时每个格子恰好落在噪声的整数格点上
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		float NoiseFrequency;
 
-	FChunkGridData() {};
+	//细节层级的分界距离，递增排列，最多3级。距离超过第i个值的块每2^(i+1)个格子合并为一个构建网格
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		TArray<int32> LodDistances;
 
-	FChunkGridData(const FInt3& coord, const FGridParam& param);
+	//细节层级切换的滞后距离，观察点在分界附近来回移动时块不会反复重建网格
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Param)
+		int32 LodHysteresis;
 
-	noise::utils::NoiseMap m_HeightMap;
+	FGridParam() :
+		EmptyMaterialIndex(0), MaxRenderDistance(0), StreamingHysteresis(16), MaxCollisionDistance(0),
+		GridPerChunk(0, 0, 0), MinCoordinate(0, 0, 0), MaxCoordinate(0, 0, 0), MaxHeight(0),
+		MaxGenerationTasks(4), bGreedyMeshing(false), bAmbientOcclusion(true), bCullFaceBatches(false), NoiseFrequency(1.0f), LodHysteresis(0)
+	{}
 
+	//转换为体素核心使用的参数
+	voxel::GridParam ToVoxelParam() const;
 };
 
-//ComponentǰλԼӾЩҪʾ ÿҪʾ3D
+//根据Component当前所在位置以及视距来决定哪些块需要显示， 每个块里管理着所有要显示的3D格子
 
-//еĿĹ
+//管理所有的块的管理器
 UCLASS(hidecategories = (Object, LOD, Physics), Blueprintable, editinlinenew, ClassGroup=(Rendering), meta=(BlueprintSpawnableComponent) )
 class GAMEALPHA_API UGridChunkMgrComponent : public USceneComponent
 {
@@ -193,16 +239,154 @@ public:
 
 	// Called when the game starts
 	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	
+	//单个本地观察者的简便接口，按GridParameters的MaxRenderDistance、MaxCollisionDistance加载
 	UFUNCTION(BlueprintCallable, Category = Chunk)
 		void Update(const FVector& WorldViewPosition);
 
+	//加入流式加载的观察者，返回编号。服务器上的远程玩家RenderDistance为0，只加载数据不创建渲染组件。
+	//多个观察者需要的块共享一份数据，改动在下一次Tick时生效
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		int32 AddViewer(const FVector& WorldLocation, int32 RenderDistance, int32 CollisionDistance);
+
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		void SetViewerLocation(int32 ViewerId, const FVector& WorldLocation);
+
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		void RemoveViewer(int32 ViewerId);
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = GridParam)
 		FGridParam GridParameters;
 
+	//存档放在Saved/Chunks下的这个目录里，为空时不存档，每次都重新生成
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = GridParam)
+		FString ChunkStoreName;
+
+	//组件池中最多保留的空闲渲染组件，超出的销毁
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = GridParam)
+		int32 MaxPooledRenderComponents;
+
+	//BeginPlay时预先创建并注册的空闲渲染组件
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = GridParam)
+		int32 PrewarmRenderComponents;
+
+	//每帧取回后台生成的块数据并检查相邻块是否就绪的时间预算，毫秒
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = GridParam)
+		float GenerationHandOffBudgetMs;
+
+	//每帧为新就绪的块创建渲染组件的时间预算，毫秒，超出的按优先级留到之后的帧
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = GridParam)
+		float ComponentCreationBudgetMs;
+
+	//每帧为网格过期的块请求后台重建的时间预算，毫秒。旧的场景代理一直显示到新的网格构建完
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = GridParam)
+		float ProxyRebuildBudgetMs;
+
+	//修改GridParameters中的材质后调用，下一帧重建所有显示块的网格
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		void NotifyGridMaterialsChanged();
+
+	//把新生成以及改动过的块交给后台写入存档，EndPlay时也会调用
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		void SaveChunks();
+
+	//直接在格子上扫掠长方体，供角色移动使用，不依赖碰撞组件是否已经创建。Start、End为长方体中心的世界坐标，
+	//返回是否碰到格子，OutLocation为接触时的中心，OutNormal为碰撞的法线
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		bool SweepVoxelBox(const FVector& Start, const FVector& End, const FVector& HalfExtent, FVector& OutLocation, FVector& OutNormal);
+
+	//直接在格子上做射线检测，返回碰到的格子在组件空间的坐标以及进入格子的世界坐标和法线，起点在格子内时法线为零
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		bool VoxelLineTrace(const FVector& Start, const FVector& End, FInt3& OutGridCoord, FVector& OutLocation, FVector& OutNormal);
+
+	//与球体重叠的参与碰撞的格子，组件缩放需要各轴一致
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		bool VoxelOverlapSphere(const FVector& Center, float Radius, TArray<FInt3>& OutGridCoords);
+
+	//与轴对齐长方体重叠的参与碰撞的格子，Center、HalfExtent为世界空间，组件不能旋转
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		bool VoxelOverlapBox(const FVector& Center, const FVector& HalfExtent, TArray<FInt3>& OutGridCoords);
+
+	//批量修改格子，返回材质真正改变的格子数。一帧中的多次修改在下一帧每个块只重建一次网格和碰撞，网格在后台构建
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		int32 SetVoxels(const TArray<FGridVoxelEdit>& Edits);
+
+	//把组件空间中[MinGridCoord, MaxGridCoord]的格子设为MaterialIndex，EmptyMaterialIndex即挖掉
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		int32 FillVoxelBox(const FInt3& MinGridCoord, const FInt3& MaxGridCoord, uint8 MaterialIndex);
+
+	//中心在球内的格子设为MaterialIndex，Center为世界坐标，组件缩放需要各轴一致
+	UFUNCTION(BlueprintCallable, Category = Chunk)
+		int32 FillVoxelSphere(const FVector& Center, float Radius, uint8 MaterialIndex);
+
 	TMap<FInt3, class UGridChunkRenderComponent*> Coord2ChunkRenderComponent;
 
-	TMap<FInt3, FChunkGridData> Coord2ChunkData;
+	TMap<FInt3, class UGridChunkCollisionComponent*> Coord2ChunkCollisionComponent;
+
+	//每种材质下标的透明程度，构建网格以及碰撞时使用
+	void GetVoxelMaterialTypes(std::vector<voxel::MaterialType>& outMaterialTypes) const;
+
+	//体素核心，块数据的生成、存储以及网格构建都由它完成，第一次使用时按GridParameters创建
+	voxel::ChunkWorld& GetVoxelWorld();
+
+protected:
+	void TryCreateRenderComponent(const FInt3& coord);
+
+	//释放离开显示范围的块的渲染组件，新进入的块在之后的帧按预算创建
+	void ApplyStreamingChanges(const std::vector<voxel::Int3>& enteredChunks, const std::vector<voxel::Int3>& leftChunks);
+
+	//组件空间以格子为单位
+	voxel::Int3 ToGridPosition(const FVector& WorldLocation) const;
+
+	//记录玩家相机的位置、朝向以及视野，用于排列流式加载的顺序
+	void UpdateStreamingView();
+
+	//越小越先处理：在视野内的块排在视野外的块前面，再按到观察点的距离排列
+	float GetStreamingPriority(const FInt3& coord) const;
+
+	//按优先级从pendingChunks中取出块交给process处理，用完budgetMs毫秒后停止，每帧至少处理一个
+	void DrainPendingChunks(TSet<FInt3>& pendingChunks, float budgetMs, TFunctionRef<void(const FInt3&)> process);
+
+	//替换后台构建完的碰撞，删除离开碰撞范围的块的碰撞组件
+	void ApplyCollisionChanges();
+
+	//收集相邻块数据的快照，在后台重建显示块的网格
+	void RequestChunkMesh(const FInt3& coord);
+
+	//把后台构建完的网格交给渲染组件替换场景代理
+	void ApplyBuiltMeshes();
+
+	//优先从组件池中取出，池为空时才创建新的组件
+	class UGridChunkRenderComponent* AcquireRenderComponent();
+
+	void ReleaseRenderComponent(class UGridChunkRenderComponent* comp);
+
+	//已注册但没有绑定块的渲染组件，移动时离开视距的组件直接给新进入视距的块使用
+	UPROPERTY(Transient)
+		TArray<class UGridChunkRenderComponent*> FreeRenderComponents;
+
+	TSharedPtr<voxel::ChunkWorld> VoxelWorld;
+
+	//与VoxelWorld一起创建，使用同一个TaskDispatcher
+	TSharedPtr<voxel::ChunkMeshQueue> MeshQueue;
+
+	//等待创建渲染组件的显示块
+	TSet<FInt3> PendingCreateChunks;
+
+	//等待请求重建网格的块，上一次请求还没完成的块也留在这里
+	TSet<FInt3> PendingRebuildChunks;
+
+	//组件空间中的观察点与观察方向，没有玩家相机时使用Update传入的观察点，所有块都当作在视野内
+	FVector StreamingViewOrigin;
+
+	FVector StreamingViewDirection;
+
+	float StreamingViewHalfFov;
 
+	bool bHasStreamingView;
 
 };
@@ -7,79 +7,8 @@
 #include "CoreUObject.h"
 #include "Engine.h"
 
-enum EGridMaterialType
-{
-	EGMT_Empty,
-	EGMT_Translucent,
-	EGMT_Opaque,
-	EGMT_Count,
-};
-
-//ȡӸƫ
-FInt3 GetGridCornerOffset(uint8 cornerIndex)
-{
-	return (FInt3::Scalar(cornerIndex) >> FInt3(2, 1, 0)) & FInt3::Scalar(1);
-}
-
-//ȡڵĸӵƫ
-FInt3 GetVertexAdjGridOffset(uint8 gridIndex)
-{
-	return ((FInt3::Scalar(gridIndex) >> FInt3(2, 1, 0)) & FInt3::Scalar(1)) + FInt3::Scalar(-1);
-}
-
-//ȡĳĳƫ
-uint8 GetFaceCornerIndex(uint8 faceIndex, uint8 cornerIndex)
-{
-	//TODO
-	static uint8 faceCornerIndex[6][4] = {
-		{4, 5, 7, 6},	//+x
-		{0, 2, 3, 1},	//-x	
-		{2, 6, 7, 3},	//+y
-		{0, 1, 5, 4},	//-y
-		{1, 3, 7, 5},	//+z
-		{0, 4, 6, 2},	//-z
-	};
-	return faceCornerIndex[faceIndex][cornerIndex];
-}
-
-//ȡڵĸӵƫ
-FInt3 GetGridAdjGridOffset(uint8 faceIndex)
-{
-	static FInt3 gridOffset[6] = {
-		FInt3(1, 0, 0),		//+x
-		FInt3(-1, 0, 0),	//-x
-		FInt3(0, 1, 0),		//+y
-		FInt3(0, -1, 0),	//-y
-		FInt3(0, 0, 1),		//+z
-		FInt3(0, 0, -1),	//-z
-	};
-	return gridOffset[faceIndex];
-}
-
-FInt3 GetFaceNormal(uint8 faceIndex)
-{
-	static FInt3 FaceNormal[6] = {
-		FInt3(1, 0, 0),	//+x
-		FInt3(-1, 0, 0),	//-x
-		FInt3(0, 1, 0),	//+y
-		FInt3(0, -1, 0),	//-y
-		FInt3(0, 0, 1),	//+z
-		FInt3(0, 0, -1)	//-z
-	};
-	return FaceNormal[faceIndex];
-}
-
-struct FGridVertex
-{
-	uint8 X;
-	uint8 Y;
-	uint8 Z;
-	uint8 AmbientOcclusionFactor;
-	FGridVertex(const FInt3& coordinate) :
-		X(coordinate.X), Y(coordinate.Y), Z(coordinate.Z)
-	{}
-};
-
+//顶点格式与体素核心构建出的网格一致，直接拷贝
+typedef voxel::GridVertex FGridVertex;
 
 class FGridVertexBuffer : public FVertexBuffer
 {
@@ -100,20 +29,56 @@ public:
 	}
 };
 
+//顶点不超过65536个时使用16位索引，否则使用32位索引，块的尺寸不受16位索引的限制
 class FGridIndexBuffer : public FIndexBuffer
 {
 public:
-	TArray<uint16> Indices;
-	
+	TArray<uint16> Indices16;
+
+	TArray<uint32> Indices32;
+
+	bool b32BitIndices;
+
+	FGridIndexBuffer() :
+		b32BitIndices(false)
+	{}
+
+	void Reset(bool bUse32BitIndices, int32 numIndices)
+	{
+		b32BitIndices = bUse32BitIndices;
+		Indices16.Empty(b32BitIndices ? 0 : numIndices);
+		Indices32.Empty(b32BitIndices ? numIndices : 0);
+	}
+
+	int32 Num() const
+	{
+		return b32BitIndices ? Indices32.Num() : Indices16.Num();
+	}
+
+	void Append(const std::vector<uint32_t>& indices)
+	{
+		if (b32BitIndices)
+		{
+			Indices32.Append(indices.data(), indices.size());
+			return;
+		}
+		int32 first = Indices16.AddUninitialized(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+			Indices16[first + i] = uint16(indices[i]);
+	}
+
 	virtual void InitRHI() override
 	{
-		if (Indices.Num())
+		int32 numIndices = Num();
+		if (numIndices)
 		{
+			uint32 stride = b32BitIndices ? sizeof(uint32) : sizeof(uint16);
+			const void* indices = b32BitIndices ? (const void*)Indices32.GetData() : (const void*)Indices16.GetData();
 			FRHIResourceCreateInfo createInfo;
-			IndexBufferRHI = RHICreateIndexBuffer(sizeof(uint16), Indices.Num() * sizeof(uint16), BUF_Static, createInfo);
+			IndexBufferRHI = RHICreateIndexBuffer(stride, numIndices * stride, BUF_Static, createInfo);
 
-			void* indexBufferData = RHILockIndexBuffer(IndexBufferRHI, 0, Indices.Num() * sizeof(uint16), RLM_WriteOnly);
-			FMemory::Memcpy(indexBufferData, Indices.GetData(), Indices.Num() * sizeof(uint16));
+			void* indexBufferData = RHILockIndexBuffer(IndexBufferRHI, 0, numIndices * stride, RLM_WriteOnly);
+			FMemory::Memcpy(indexBufferData, indices, numIndices * stride);
 			RHIUnlockIndexBuffer(IndexBufferRHI);
 		}
 	}
@@ -128,7 +93,7 @@ class FGridVertexTangentBuffer : public FVertexBuffer
 		FPackedNormal* vertexTangentData = (FPackedNormal*)RHILockVertexBuffer(VertexBufferRHI, 0, 6 * 2 * sizeof(FPackedNormal), RLM_WriteOnly);
 		for (int32 i = 0; i < 6; i++)
 		{
-			FVector normal = GetFaceNormal(i).ToFloat().GetSafeNormal();
+			FVector normal = FInt3(voxel::GetFaceNormal(i)).ToFloat().GetSafeNormal();
 			FVector unProjectTangentT = FVector(1, -1, 0).GetSafeNormal();
 			FVector projectTangentT = (unProjectTangentT - normal * unProjectTangentT * normal).GetSafeNormal();
 			FVector projectTangentB = (normal ^ projectTangentT).GetSafeNormal();
@@ -148,6 +113,7 @@ public:
 		DataType dataType;
 		dataType.PositionComponent = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(&vertexBuffer, FGridVertex, X, VET_UByte4N);
 		dataType.TextureCoordinates.Add(STRUCTMEMBER_VERTEXSTREAMCOMPONENT(&vertexBuffer, FGridVertex, X, VET_UByte4N));
+		//按BGRA读取，A通道为AmbientOcclusionFactor，材质中用VertexColor的A通道得到环境光遮蔽
 		dataType.ColorComponent = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(&vertexBuffer, FGridVertex, X, VET_Color);
 		dataType.TangentBasisComponents[0] = FVertexStreamComponent(&TangentBuffer, sizeof(FGridVertexTangentBuffer) * (2 * faceIndex + 0), 0, VET_PackedNormal);
 		dataType.TangentBasisComponents[1] = FVertexStreamComponent(&TangentBuffer, sizeof(FGridVertexTangentBuffer) * (2 * faceIndex + 1), 0, VET_PackedNormal);
@@ -161,16 +127,6 @@ public:
 	}
 };
 
-struct FFaceBatch
-{
-	TArray<uint16> Indices;
-};
-
-struct FMaterialBatch
-{
-	FFaceBatch FaceBatches[6];
-};
-
 class FGridChunkProxy: public FPrimitiveSceneProxy
 {
 public:
@@ -190,7 +146,7 @@ public:
 
 	struct FElement
 	{
-		uint16 FirstIndex;
+		uint32 FirstIndex;
 		uint32 PrimitiveNum;
 		uint16 MaterialIndex;
 		uint8 FaceIndex;
@@ -199,12 +155,29 @@ public:
 
 	TUniformBufferRef<FPrimitiveUniformShaderParameters> PrimitiveUniformBuffer;
 
-	FGridChunkProxy(UGridChunkRenderComponent* pComponent):
+	//网格的最小角在组件空间中的偏移，格子坐标
+	voxel::Int3 MeshOffset;
+
+	//网格的尺寸，一个单位为2^Lod个格子
+	voxel::Int3 MeshSize;
+
+	//远处的块降采样后构建网格，顶点坐标放大2^Lod倍
+	int32 Lod;
+
+	//逐个视图剔除背向观察点的面，只能走动态绘制。投射动态阴影的块不剔除，见构造函数
+	bool bCullFaceBatches;
+
+	FGridChunkProxy(UGridChunkRenderComponent* pComponent, const voxel::Int3& meshOffset, const voxel::Int3& meshSize, int32 lod, bool bInCullFaceBatches):
 		FPrimitiveSceneProxy(pComponent),
 		WireframeRenderProxy(
 			WITH_EDITOR ? GEngine->WireframeMaterial->GetRenderProxy(IsSelected()) : NULL,
 			FLinearColor(0.0, 0.5, 1.0)
-		)
+		),
+		MeshOffset(meshOffset),
+		MeshSize(meshSize),
+		Lod(lod),
+		//4.11收集动态阴影投射者时传入的是主视图而不是光源的视图，按主视图剔除会丢掉朝向光源的面，投射阴影的块仍走静态绘制
+		bCullFaceBatches(bInCullFaceBatches && !CastsDynamicShadow())
 	{}
 	virtual ~FGridChunkProxy()
 	{
@@ -216,9 +189,13 @@ public:
 
 	void BeginInitResources()
 	{
-		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(WaitForSetupCompleteEvent, FGraphEventRef, SetupCompleteEvent, SetupCompleteEvent, {
-			FTaskGraphInterface::Get().WaitUntilTaskCompletes(SetupCompleteEvent, ENamedThreads::RenderThread);
-		});
+		//网格已经在后台构建好时没有需要等待的任务
+		if (SetupCompleteEvent.GetReference())
+		{
+			ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(WaitForSetupCompleteEvent, FGraphEventRef, SetupCompleteEvent, SetupCompleteEvent, {
+				FTaskGraphInterface::Get().WaitUntilTaskCompletes(SetupCompleteEvent, ENamedThreads::RenderThread);
+			});
+		}
 		BeginInitResource(&VertexBuffer);
 		BeginInitResource(&IndexBuffer);
 		for (int32 i = 0; i < 6; ++i)
@@ -235,20 +212,49 @@ public:
 	virtual void OnTransformChanged() override
 	{
 		// Create a uniform buffer with the transform for the chunk.
-		PrimitiveUniformBuffer = CreatePrimitiveUniformBufferImmediate(FScaleMatrix(FVector(255, 255, 255)) * GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, UseEditorDepthTest());
+		PrimitiveUniformBuffer = CreatePrimitiveUniformBufferImmediate(FScaleMatrix(FVector(float(255 << Lod))) * GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, UseEditorDepthTest());
+	}
+
+	//视图中朝向观察点的面的方向掩码
+	uint8 GetFacingFaceMask(const FSceneView* view) const
+	{
+		if (!bCullFaceBatches)
+			return 0x3f;
+		const FMatrix& localToWorld = GetLocalToWorld();
+		if (view->IsPerspectiveProjection())
+		{
+			FVector localViewOrigin = localToWorld.InverseTransformPosition(view->ViewMatrices.ViewOrigin);
+			FVector meshViewOrigin = (localViewOrigin - FInt3(MeshOffset).ToFloat()) / float(1 << Lod);
+			double viewPosition[3] = { meshViewOrigin.X, meshViewOrigin.Y, meshViewOrigin.Z };
+			return voxel::GetFacingFaceMask(viewPosition, MeshSize);
+		}
+		FVector localViewDirection = localToWorld.InverseTransformVector(view->GetViewDirection());
+		double viewDirection[3] = { localViewDirection.X, localViewDirection.Y, localViewDirection.Z };
+		return voxel::GetFacingFaceMaskForDirection(viewDirection);
 	}
 
 	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, class FMeshElementCollector& Collector) const override
 	{
+		uint8 facingFaceMasks[32] = { 0 };
+		for (int32 viewIndex = 0; viewIndex < Views.Num() && viewIndex < 32; ++viewIndex)
+			if (VisibilityMap & (1 << viewIndex))
+				facingFaceMasks[viewIndex] = GetFacingFaceMask(Views[viewIndex]);
 		for (int32 i = 0; i < Elements.Num(); ++i)
 		{
-			FMeshBatch& meshBatch = Collector.AllocateMesh();
-			InitMeshBatch(meshBatch, Elements[i], ViewFamily.EngineShowFlags.Wireframe ? &WireframeRenderProxy : NULL);
-			for (int32 viewIndex = 0; viewIndex < Views.Num(); ++viewIndex)
-				if (VisibilityMap & (1 << viewIndex))
-					Collector.AddMesh(viewIndex, meshBatch);
+			FMeshBatch* meshBatch = NULL;
+			for (int32 viewIndex = 0; viewIndex < Views.Num() && viewIndex < 32; ++viewIndex)
+			{
+				if (!(facingFaceMasks[viewIndex] & (1 << Elements[i].FaceIndex)))
+					continue;
+				//所有视图都背向这个方向时不分配
+				if (!meshBatch)
+				{
+					meshBatch = &Collector.AllocateMesh();
+					InitMeshBatch(*meshBatch, Elements[i], ViewFamily.EngineShowFlags.Wireframe ? &WireframeRenderProxy : NULL);
+				}
+				Collector.AddMesh(viewIndex, *meshBatch);
+			}
 		}
-
 	}
 
 	virtual void DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) override
@@ -284,7 +290,7 @@ public:
 		FPrimitiveViewRelevance Result;
 		Result.bDrawRelevance = IsShown(View);
 		Result.bShadowRelevance = IsShadowCast(View);
-		Result.bDynamicRelevance = View->Family->EngineShowFlags.Wireframe || IsSelected();
+		Result.bDynamicRelevance = bCullFaceBatches || View->Family->EngineShowFlags.Wireframe || IsSelected();
 		Result.bStaticRelevance = !Result.bDynamicRelevance;
 		MaterialRelevance.SetPrimitiveViewRelevance(Result);
 		return Result;
@@ -297,194 +303,135 @@ public:
 
 };
 
-uint16 UGridChunkRenderComponent::GetMaterialIndex(FInt3 coord)
+//把构建好的网格拷贝到场景代理中，按材质以及面的朝向分成元素，可以在任意线程调用
+static void SetupProxyMesh(FGridChunkProxy* pProxy, const voxel::ChunkMesh& mesh, const TArray<FGridMaterial>& gridMaterials, ERHIFeatureLevel::Type featureLevel)
 {
-	const FInt3& gridPerChunk = this->Mgr->GridParameters.GridPerChunk;
-	FInt3 chunkCoord = coord;
-	if (chunkCoord.X < 0)
-		chunkCoord.X -= gridPerChunk.X;
-	if (chunkCoord.Y < 0)
-		chunkCoord.Y -= gridPerChunk.Y;
-	if (chunkCoord.Z < 0)
-		chunkCoord.Z -= gridPerChunk.Z;
-	chunkCoord = chunkCoord / gridPerChunk * gridPerChunk;
-	FChunkGridData* data = this->Mgr->Coord2ChunkData.Find(chunkCoord);
-	if (!data)
+	pProxy->VertexBuffer.Vertices.Append(mesh.Vertices.data(), mesh.Vertices.size());
+	pProxy->IndexBuffer.Reset(mesh.Requires32BitIndices(), mesh.GetNumIndices());
+	for (int32 i = 0; i < (int32)mesh.MaterialBatches.size(); i++)
 	{
-		return 0;
+		const FGridMaterial& gridMaterial = gridMaterials[i];
+		UMaterialInterface* surfaceMaterial = gridMaterial.SurfaceMaterial;
+		if (!surfaceMaterial)
+			surfaceMaterial = UMaterial::GetDefaultMaterial(MD_Surface);
+		pProxy->MaterialRelevance |= surfaceMaterial->GetRelevance_Concurrent(featureLevel);
+		uint16 sufaceMaterialIndex = pProxy->Materails.Add(surfaceMaterial);
+
+		UMaterialInterface* topMaterial = gridMaterials[i].TopSurfaceMaterial;
+		if (!topMaterial)
+			topMaterial = gridMaterials[i].SurfaceMaterial;
+		else
+			pProxy->MaterialRelevance |= topMaterial->GetRelevance_Concurrent(featureLevel);
+
+		uint16 topMaterialIndex = sufaceMaterialIndex;
+		if (topMaterial != surfaceMaterial)
+			topMaterialIndex = pProxy->Materails.Add(topMaterial);
+
+		for (int32 j = 0; j < 6; j++)
+		{
+			const std::vector<uint32_t>& batchIndices = mesh.MaterialBatches[i].FaceBatches[j].Indices;
+			if (batchIndices.empty())
+				continue;
+			FGridChunkProxy::FElement& newElem = *new(pProxy->Elements)FGridChunkProxy::FElement;
+			newElem.FirstIndex = pProxy->IndexBuffer.Num();
+			newElem.PrimitiveNum = batchIndices.size() / 3;
+			// 2 是正上面
+			newElem.MaterialIndex = j == 4 ? topMaterialIndex : sufaceMaterialIndex;
+			newElem.FaceIndex = j;
+			pProxy->IndexBuffer.Append(batchIndices);
+		}
 	}
-	FInt3 offset = coord - chunkCoord;
-	return data->GridMaterialIndex[(offset.X * (gridPerChunk.Y + 1) + offset.Y) * (gridPerChunk.Z + 1) + offset.Z];
+}
+
+uint16 UGridChunkRenderComponent::GetMaterialIndex(FInt3 coord)
+{
+	return this->Mgr->GetVoxelWorld().GetMaterialIndex(coord.ToVoxel());
 }
 
 
+UGridChunkRenderComponent::UGridChunkRenderComponent() :
+	bInUse(false)
+{
+}
+
 void UGridChunkRenderComponent::Init(const FInt3& cood)
 {
 	this->Coordinate = cood;
+	this->bInUse = true;
+	this->BuiltMesh.reset();
+	SetRelativeLocation(cood.ToFloat());
+	RebuildSceneProxy();
+}
+
+void UGridChunkRenderComponent::RebuildSceneProxy()
+{
+	if (IsRegistered())
+		RecreateRenderState_Concurrent();
+	else
+		MarkRenderStateDirty();
+}
+
+void UGridChunkRenderComponent::SetBuiltMesh(const voxel::BuiltChunkMeshPtr& builtMesh)
+{
+	this->BuiltMesh = builtMesh;
+	RebuildSceneProxy();
+}
+
+void UGridChunkRenderComponent::Recycle()
+{
+	this->bInUse = false;
+	this->BuiltMesh.reset();
+	MarkRenderStateDirty();
 }
 
 FPrimitiveSceneProxy* UGridChunkRenderComponent::CreateSceneProxy()
 {	
-	TArray<EGridMaterialType> materialType;
-	for (int16 index = 0; index < this->Mgr->GridParameters.GridMaterials.Num(); ++ index)
+	if (!this->bInUse)
+		return NULL;
+	const ERHIFeatureLevel::Type SceneFeatureLevel = GetScene()->GetFeatureLevel();
+	if (this->BuiltMesh)
 	{
-		if (index == this->Mgr->GridParameters.EmptyMaterialIndex)
-			materialType.Add(EGMT_Empty);
-		else
-		{
-			if (this->Mgr->GridParameters.GridMaterials[index].SurfaceMaterial->GetBlendMode() == BLEND_Translucent)
-				materialType.Add(EGMT_Translucent);
-			else
-				materialType.Add(EGMT_Opaque);
-		}
+		//后台已经按最新的数据构建好网格，只需要拷贝，不用在渲染线程等待
+		voxel::BuiltChunkMeshPtr builtMesh = this->BuiltMesh;
+		this->BuiltMesh.reset();
+		if (builtMesh->Mesh.Vertices.empty())
+			return NULL;
+		FGridChunkProxy* pBuiltProxy = new FGridChunkProxy(this, builtMesh->MeshOffset, builtMesh->MeshSize, builtMesh->Lod, this->Mgr->GridParameters.bCullFaceBatches);
+		SetupProxyMesh(pBuiltProxy, builtMesh->Mesh, this->Mgr->GridParameters.GridMaterials, SceneFeatureLevel);
+		pBuiltProxy->BeginInitResources();
+		return pBuiltProxy;
 	}
-	FChunkGridData* chunkData = this->Mgr->Coord2ChunkData.Find(this->Coordinate);
+	voxel::MeshSettings meshSettings;
+	this->Mgr->GetVoxelMaterialTypes(meshSettings.MaterialTypes);
+	meshSettings.GreedyMeshing = this->Mgr->GridParameters.bGreedyMeshing;
+	meshSettings.AmbientOcclusion = this->Mgr->GridParameters.bAmbientOcclusion;
+	//后台线程只读取这份快照，管理器在游戏线程上继续加入新生成的块
+	voxel::ChunkNeighbourhood neighbourhood;
+	this->Mgr->GetVoxelWorld().GetNeighbourhood(this->Coordinate.ToVoxel(), neighbourhood);
 
 	FInt3 minCoordinate = FInt3::Max(this->Mgr->GridParameters.MinCoordinate, this->Coordinate);
 	FInt3 maxCoordinate = FInt3::Min(this->Mgr->GridParameters.MaxCoordinate, this->Coordinate + this->Mgr->GridParameters.GridPerChunk);
-	FInt3 chunkSize = maxCoordinate - minCoordinate;
 
-	//ǰǿհ׵ĸӣȾ
-	bool hasNotEmptyGrid = false;
-	for (int32 x = minCoordinate.X; x < maxCoordinate.X; ++x)
-	{
-		for (int32 y = minCoordinate.Y; y < maxCoordinate.Y; ++y)
-		{
-			for (int32 z = minCoordinate.Z; z < maxCoordinate.Z; ++z)
-			{
-				FInt3 gridPos = FInt3(x, y, z);
-				uint16 matrialIndex = GetMaterialIndex(gridPos);
-				if (materialType[matrialIndex] != EGMT_Empty)
-					hasNotEmptyGrid = true;
-			}
-		}
-	}
-
-// 	if (chunkData)
-// 		for (int32 index = 0; index < chunkData->GridMaterialIndex.Num(); ++ index)
-// 			if (materialType[chunkData->GridMaterialIndex[index]] != EGMT_Empty)
-// 				hasNotEmptyGrid = true;
-	if (hasNotEmptyGrid == false)
+	//如果当前都是空白的格子，则不渲染
+	const voxel::ChunkData* chunkData = neighbourhood.GetCenter();
+	if (!chunkData || !voxel::HasNonEmptyGrid(*chunkData, meshSettings.MaterialTypes, (minCoordinate - this->Coordinate).ToVoxel(), (maxCoordinate - this->Coordinate).ToVoxel()))
 		return NULL;
-	const ERHIFeatureLevel::Type SceneFeatureLevel = GetScene()->GetFeatureLevel();
 
-	//߳
+	//远处的块按细节层级降采样，与细节层级不同的相邻块之间加裙边
+	const voxel::ChunkWorld& world = this->Mgr->GetVoxelWorld();
+	int32 lod = voxel::ClampChunkLod(world.GetChunkLod(this->Coordinate.ToVoxel()), (maxCoordinate - minCoordinate).ToVoxel());
+	uint8 skirtFaceMask = world.GetSkirtFaceMask(this->Coordinate.ToVoxel());
+	voxel::Int3 meshSize = (maxCoordinate - minCoordinate).ToVoxel() >> voxel::Int3::Scalar(lod);
+
+	//多线程
 	FGridChunkProxy *pProxy = NULL;
-	pProxy = new FGridChunkProxy(this);
+	pProxy = new FGridChunkProxy(this, (minCoordinate - this->Coordinate).ToVoxel(), meshSize, lod, this->Mgr->GridParameters.bCullFaceBatches);
 	pProxy->SetupCompleteEvent = FFunctionGraphTask::CreateAndDispatchWhenReady([=]() {
-		TArray<uint16> indexBuffer;
-		indexBuffer.Empty(chunkSize.X * chunkSize.Y * chunkSize.Z);
-		//ÿ㣬İ˸ӣõǷҪӵbuffer
-		for (int32 x = 0; x <= maxCoordinate.X - minCoordinate.X; ++x)
-		{
-			for (int32 y = 0; y <= maxCoordinate.Y - minCoordinate.Y; ++y)
-			{
-				for (int32 z = 0; z <= maxCoordinate.Z - minCoordinate.Z; ++z)
-				{
-					FInt3 vertexPos = FInt3(x, y, z);
-					bool hasMatrialType[EGMT_Count] = { false };
-					for (int32 i = 0; i < 8; ++i)
-					{
-						FInt3 gridPos = minCoordinate + vertexPos + GetVertexAdjGridOffset(i);
-						uint16 matrialIndex = GetMaterialIndex(gridPos);
-						hasMatrialType[materialType[matrialIndex]] = true;
-					}
-					//ڵİ˸һĲʣöҪʾ
-					uint8 typeCnt = 0;
-					for (int32 i = 0; i < EGMT_Count; i++)
-						if (hasMatrialType[i])
-							++typeCnt;
-					if (typeCnt > 1)
-					{
-						indexBuffer.Add(pProxy->VertexBuffer.Vertices.Num());
-						new (pProxy->VertexBuffer.Vertices) FGridVertex(vertexPos);
-					}
-					else
-					{
-						indexBuffer.Add(0);
-					}
-				}
-			}
-		}
-		TArray<FMaterialBatch> MaterialBatches;
-		MaterialBatches.Init(FMaterialBatch(), this->Mgr->GridParameters.GridMaterials.Num());
-		//ÿӣ棬ǷҪʾ
-		for (int32 x = minCoordinate.X; x < maxCoordinate.X; ++x)
-		{
-			for (int32 y = minCoordinate.Y; y < maxCoordinate.Y; y++)
-			{
-				for (int32 z = minCoordinate.Z; z < maxCoordinate.Z; ++z)
-				{
-					FInt3 gridPos = FInt3(x, y, z);
-					uint16 materialIndex = GetMaterialIndex(gridPos);
-					for (int32 i = 0; i < 6; ++i)
-					{
-						FInt3 adjGridPos = gridPos + GetGridAdjGridOffset(i);
-						uint16 adjMaterialIndex = GetMaterialIndex(adjGridPos);
-
-						//ǰӱڸӸӵĲ͸ҪȾ
-						if (materialType[materialIndex] > materialType[adjMaterialIndex])
-						{
-							//ǰĸ
-							uint16 faceCornerIndices[4];
-							for (int32 j = 0; j < 4; ++j)
-							{
-								FInt3 faceCornerPos = gridPos + GetGridCornerOffset(GetFaceCornerIndex(i, j));
-								FInt3 offset = faceCornerPos - minCoordinate;
-								faceCornerIndices[j] = indexBuffer[(offset.X * (chunkSize.Y + 1) + offset.Y) * (chunkSize.Z + 1) + offset.Z];
-							}
-							FFaceBatch& faceBatch = MaterialBatches[materialIndex].FaceBatches[i];
-							uint16* indices = &faceBatch.Indices[faceBatch.Indices.AddUninitialized(6)];
-							*(indices++) = faceCornerIndices[0];
-							*(indices++) = faceCornerIndices[1];
-							*(indices++) = faceCornerIndices[2];
-							*(indices++) = faceCornerIndices[0];
-							*(indices++) = faceCornerIndices[2];
-							*(indices++) = faceCornerIndices[3];
-						}
-					}
-				}
-			}
-		}
-		uint32 IndexNum = 0;
-		for (int32 i = 0; i < MaterialBatches.Num(); i++)
-			for (int32 j = 0; j < 6; j++)
-				IndexNum += MaterialBatches[i].FaceBatches[j].Indices.Num();
-		pProxy->IndexBuffer.Indices.Empty(IndexNum);
-		for (int32 i = 0; i < MaterialBatches.Num(); i++)
-		{
-			const FGridMaterial& gridMaterial = this->Mgr->GridParameters.GridMaterials[i];
-			UMaterialInterface* surfaceMaterial = gridMaterial.SurfaceMaterial;
-			if (!surfaceMaterial)
-				surfaceMaterial = UMaterial::GetDefaultMaterial(MD_Surface);
-			pProxy->MaterialRelevance |= surfaceMaterial->GetRelevance_Concurrent(SceneFeatureLevel);
-			uint16 sufaceMaterialIndex = pProxy->Materails.Add(surfaceMaterial);
-
-			UMaterialInterface* topMaterial = this->Mgr->GridParameters.GridMaterials[i].TopSurfaceMaterial;
-			if (!topMaterial)
-				topMaterial = this->Mgr->GridParameters.GridMaterials[i].SurfaceMaterial;
-			else
-				pProxy->MaterialRelevance |= topMaterial->GetRelevance_Concurrent(SceneFeatureLevel);
-
-			uint16 topMaterialIndex = sufaceMaterialIndex;
-			if (topMaterial != surfaceMaterial)
-				topMaterialIndex = pProxy->Materails.Add(topMaterial);
-
-			for (int32 j = 0; j < 6; j++)
-			{
-				FFaceBatch &batch = MaterialBatches[i].FaceBatches[j];
-				if (batch.Indices.Num() <= 0)
-					continue;
-				FGridChunkProxy::FElement& newElem = *new(pProxy->Elements)FGridChunkProxy::FElement;
-				newElem.FirstIndex = pProxy->IndexBuffer.Indices.Num();
-				newElem.PrimitiveNum = batch.Indices.Num() / 3;
-				// 2 
-				newElem.MaterialIndex = j == 4 ? topMaterialIndex : sufaceMaterialIndex;
-				newElem.FaceIndex = j;
-				pProxy->IndexBuffer.Indices.Append(batch.Indices);
-			}
-		}
-
+		voxel::PaddedChunkGrid grid;
+		voxel::GatherLodGrid(neighbourhood, minCoordinate.ToVoxel(), maxCoordinate.ToVoxel(), lod, skirtFaceMask, meshSettings.MaterialTypes, grid);
+		voxel::ChunkMesh mesh;
+		voxel::BuildChunkMesh(grid, meshSize, meshSettings, mesh);
+		SetupProxyMesh(pProxy, mesh, this->Mgr->GridParameters.GridMaterials, SceneFeatureLevel);
 	}, TStatId(), NULL);
 	pProxy->BeginInitResources();
 	return pProxy;
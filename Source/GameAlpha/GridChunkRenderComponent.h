@@ -15,8 +15,25 @@ class GAMEALPHA_API UGridChunkRenderComponent : public UPrimitiveComponent
 	GENERATED_BODY()
 	
 public:
+	UGridChunkRenderComponent();
+
+	//绑定到一个块并移动过去，回收的组件也用它重新绑定，之后立即创建场景代理
 	void Init(const FInt3& cood);
 
+	//立即重建场景代理，而不是等到帧末，耗时计入管理器每帧的预算
+	void RebuildSceneProxy();
+
+	//用后台构建完的网格替换场景代理，不用在渲染线程等待构建网格，旧的场景代理一直显示到替换时
+	void SetBuiltMesh(const voxel::BuiltChunkMeshPtr& builtMesh);
+
+	//放回管理器的组件池，释放场景代理但保持注册
+	void Recycle();
+
+	bool IsInUse() const
+	{
+		return bInUse;
+	}
+
 	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
 
 	uint16 GetMaterialIndex(FInt3 coord);
@@ -25,6 +42,13 @@ public:
 	
 	class UGridChunkMgrComponent* Mgr;
 
-	//ϽΪ꣬
+	//以这个块的左上角为坐标，而不是中心
 	FInt3 Coordinate;
+
+protected:
+	//在组件池中时不创建场景代理
+	bool bInUse;
+
+	//下一次创建场景代理时使用，用过后释放
+	voxel::BuiltChunkMeshPtr BuiltMesh;
 };
@@ -37,3 +37,29 @@ double Add::GetValue (double x, double y, double z) const
   return m_pSourceModule[0]->GetValue (x, y, z)
        + m_pSourceModule[1]->GetValue (x, y, z);
 }
+
+void Add::GetValueBatch (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  double v1[MAX_BATCH_SIZE];
+  m_pSourceModule[0]->GetValueBatch (x, y, z, out, count);
+  m_pSourceModule[1]->GetValueBatch (x, y, z, v1, count);
+  for (int i = 0; i < count; i++) {
+    out[i] += v1[i];
+  }
+}
+
+void Add::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  double v1[MAX_BATCH_SIZE];
+  m_pSourceModule[0]->GetValueBatch2D (x, z, out, count);
+  m_pSourceModule[1]->GetValueBatch2D (x, z, v1, count);
+  for (int i = 0; i < count; i++) {
+    out[i] += v1[i];
+  }
+}
@@ -164,6 +164,14 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        virtual double GetValue2D (double x, double z) const;
+
+        virtual void GetValueBatch2D (const double* x, const double* z,
+          double* out, int count) const;
+
         /// Sets the frequency of the first octave.
         ///
         /// @param frequency The frequency of the first octave.
@@ -41,3 +41,37 @@ double Blend::GetValue (double x, double y, double z) const
   double alpha = (m_pSourceModule[2]->GetValue (x, y, z) + 1.0) / 2.0;
   return LinearInterp (v0, v1, alpha);
 }
+
+void Blend::GetValueBatch (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  assert (m_pSourceModule[2] != NULL);
+  double v1[MAX_BATCH_SIZE];
+  double control[MAX_BATCH_SIZE];
+  m_pSourceModule[0]->GetValueBatch (x, y, z, out, count);
+  m_pSourceModule[1]->GetValueBatch (x, y, z, v1, count);
+  m_pSourceModule[2]->GetValueBatch (x, y, z, control, count);
+  for (int i = 0; i < count; i++) {
+    double alpha = (control[i] + 1.0) / 2.0;
+    out[i] = LinearInterp (out[i], v1[i], alpha);
+  }
+}
+
+void Blend::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  assert (m_pSourceModule[2] != NULL);
+  double v1[MAX_BATCH_SIZE];
+  double control[MAX_BATCH_SIZE];
+  m_pSourceModule[0]->GetValueBatch2D (x, z, out, count);
+  m_pSourceModule[1]->GetValueBatch2D (x, z, v1, count);
+  m_pSourceModule[2]->GetValueBatch2D (x, z, control, count);
+  for (int i = 0; i < count; i++) {
+    double alpha = (control[i] + 1.0) / 2.0;
+    out[i] = LinearInterp (out[i], v1[i], alpha);
+  }
+}
@@ -105,6 +105,12 @@ namespace noise
 
 	      virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        virtual void GetValueBatch2D (const double* x, const double* z,
+          double* out, int count) const;
+
         /// Sets the control module.
         ///
         /// @param controlModule The control module.
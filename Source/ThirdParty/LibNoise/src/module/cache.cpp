@@ -26,7 +26,8 @@ using namespace noise::module;
 
 Cache::Cache ():
   Module (GetSourceModuleCount ()),
-  m_isCached (false)
+  m_isCached (false),
+  m_generation (0)
 {
 }
 
@@ -34,6 +35,21 @@ double Cache::GetValue (double x, double y, double z) const
 {
   assert (m_pSourceModule[0] != NULL);
 
+  EvalContext* pContext = EvalContext::GetCurrent ();
+  if (pContext != NULL) {
+    EvalContext::CacheState& state = pContext->GetCacheState (this);
+    if (!(state.m_isCached && state.m_generation == m_generation
+      && x == state.m_xCache && y == state.m_yCache && z == state.m_zCache)) {
+      state.m_cachedValue = m_pSourceModule[0]->GetValue (x, y, z);
+      state.m_xCache = x;
+      state.m_yCache = y;
+      state.m_zCache = z;
+      state.m_generation = m_generation;
+    }
+    state.m_isCached = true;
+    return state.m_cachedValue;
+  }
+
   if (!(m_isCached && x == m_xCache && y == m_yCache && z == m_zCache)) {
     m_cachedValue = m_pSourceModule[0]->GetValue (x, y, z);
     m_xCache = x;
@@ -43,3 +59,49 @@ double Cache::GetValue (double x, double y, double z) const
   m_isCached = true;
   return m_cachedValue;
 }
+
+void Cache::GetValueBatch (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  if (count <= 1) {
+    Module::GetValueBatch (x, y, z, out, count);
+    return;
+  }
+  // A batch rarely repeats the cached input value, so evaluate the whole
+  // batch and cache the last value.
+  m_pSourceModule[0]->GetValueBatch (x, y, z, out, count);
+  CacheLastValue (x[count - 1], y[count - 1], z[count - 1], out[count - 1]);
+}
+
+void Cache::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  if (count <= 1) {
+    Module::GetValueBatch2D (x, z, out, count);
+    return;
+  }
+  m_pSourceModule[0]->GetValueBatch2D (x, z, out, count);
+  CacheLastValue (x[count - 1], 0.0, z[count - 1], out[count - 1]);
+}
+
+void Cache::CacheLastValue (double x, double y, double z, double value) const
+{
+  EvalContext* pContext = EvalContext::GetCurrent ();
+  if (pContext != NULL) {
+    EvalContext::CacheState& state = pContext->GetCacheState (this);
+    state.m_cachedValue = value;
+    state.m_xCache = x;
+    state.m_yCache = y;
+    state.m_zCache = z;
+    state.m_generation = m_generation;
+    state.m_isCached = true;
+    return;
+  }
+  m_cachedValue = value;
+  m_xCache = x;
+  m_yCache = y;
+  m_zCache = z;
+  m_isCached = true;
+}
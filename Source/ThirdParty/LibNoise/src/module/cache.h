@@ -58,6 +58,12 @@ namespace noise
     /// If an application passes a new source module to the SetSourceModule()
     /// method, the cache is invalidated.
     ///
+    /// If an evaluation context (see noise::module::EvalContext) is bound
+    /// to the calling thread, the cached value is stored in that context
+    /// instead of in this noise module.  Several threads can then evaluate
+    /// this noise module at once, as long as each thread uses its own
+    /// context.
+    ///
     /// Caching a noise module is useful if it is used as a source module for
     /// multiple noise modules.  If a source module is not cached, the source
     /// module will redundantly calculate the same output value once for each
@@ -79,14 +85,32 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        virtual void GetValueBatch2D (const double* x, const double* z,
+          double* out, int count) const;
+
         virtual void SetSourceModule (int index, const Module& sourceModule)
         {
           Module::SetSourceModule (index, sourceModule);
           m_isCached = false;
+          m_generation++;
         }
 
       protected:
 
+        /// Caches the last output value of a batch.
+        ///
+        /// @param x The @a x coordinate of the last input value.
+        /// @param y The @a y coordinate of the last input value.
+        /// @param z The @a z coordinate of the last input value.
+        /// @param value The output value at that input value.
+        ///
+        /// Shared by GetValueBatch() and GetValueBatch2D().
+        void CacheLastValue (double x, double y, double z, double value)
+          const;
+
         /// The cached output value at the cached input value.
         mutable double m_cachedValue;
 
@@ -103,6 +127,10 @@ namespace noise
         /// @a z coordinate of the cached input value.
         mutable double m_zCache;
 
+        /// Incremented each time the source module changes, so that values
+        /// cached in an evaluation context before the change are discarded.
+        int m_generation;
+
     };
 
     /// @}
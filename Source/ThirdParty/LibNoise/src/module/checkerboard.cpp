@@ -36,3 +36,11 @@ double Checkerboard::GetValue (double x, double y, double z) const
   int iz = (int)(floor (MakeInt32Range (z)));
   return (ix & 1 ^ iy & 1 ^ iz & 1)? -1.0: 1.0;
 }
+
+void Checkerboard::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    out[i] = Checkerboard::GetValue (x[i], y[i], z[i]);
+  }
+}
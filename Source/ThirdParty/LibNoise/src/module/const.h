@@ -83,6 +83,22 @@ namespace noise
           return m_constValue;
         }
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const
+        {
+          for (int i = 0; i < count; i++) {
+            out[i] = m_constValue;
+          }
+        }
+
+        virtual void GetValueBatch2D (const double* x, const double* z,
+          double* out, int count) const
+        {
+          for (int i = 0; i < count; i++) {
+            out[i] = m_constValue;
+          }
+        }
+
         /// Sets the constant output value for this noise module.
         ///
         /// @param constValue The constant output value for this noise module.
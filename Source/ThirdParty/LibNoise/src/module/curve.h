@@ -137,6 +137,12 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        virtual void GetValueBatch2D (const double* x, const double* z,
+          double* out, int count) const;
+
       protected:
 
         /// Determines the array index in which to insert the control point
@@ -157,6 +163,15 @@ namespace noise
         /// sorted control point array.
         int FindInsertionPos (double inputValue);
 
+        /// Maps an output value from the source module onto the curve.
+        ///
+        /// @param sourceModuleValue The output value from the source module.
+        ///
+        /// @returns The mapped value.
+        ///
+        /// Shared by GetValue() and GetValueBatch().
+        double MapValue (double sourceModuleValue) const;
+
         /// Inserts the control point at the specified position in the
         /// internal control point array.
         ///
@@ -42,3 +42,11 @@ double Cylinders::GetValue (double x, double y, double z) const
   double nearestDist = GetMin (distFromSmallerSphere, distFromLargerSphere);
   return 1.0 - (nearestDist * 4.0); // Puts it in the -1.0 to +1.0 range.
 }
+
+void Cylinders::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    out[i] = Cylinders::GetValue (x[i], y[i], z[i]);
+  }
+}
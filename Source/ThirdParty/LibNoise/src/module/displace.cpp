@@ -46,3 +46,25 @@ double Displace::GetValue (double x, double y, double z) const
   // the original input value.
   return m_pSourceModule[0]->GetValue (xDisplace, yDisplace, zDisplace);
 }
+
+void Displace::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  assert (m_pSourceModule[2] != NULL);
+  assert (m_pSourceModule[3] != NULL);
+  double xDisplace[MAX_BATCH_SIZE];
+  double yDisplace[MAX_BATCH_SIZE];
+  double zDisplace[MAX_BATCH_SIZE];
+  m_pSourceModule[1]->GetValueBatch (x, y, z, xDisplace, count);
+  m_pSourceModule[2]->GetValueBatch (x, y, z, yDisplace, count);
+  m_pSourceModule[3]->GetValueBatch (x, y, z, zDisplace, count);
+  for (int i = 0; i < count; i++) {
+    xDisplace[i] = x[i] + xDisplace[i];
+    yDisplace[i] = y[i] + yDisplace[i];
+    zDisplace[i] = z[i] + zDisplace[i];
+  }
+  m_pSourceModule[0]->GetValueBatch (xDisplace, yDisplace, zDisplace, out,
+    count);
+}
@@ -81,6 +81,9 @@ namespace noise
 
       virtual double GetValue (double x, double y, double z) const;
 
+      virtual void GetValueBatch (const double* x, const double* y,
+        const double* z, double* out, int count) const;
+
       /// Returns the @a x displacement module.
       ///
       /// @returns A reference to the @a x displacement module.
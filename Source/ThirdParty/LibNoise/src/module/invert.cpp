@@ -35,3 +35,23 @@ double Invert::GetValue (double x, double y, double z) const
 
   return -(m_pSourceModule[0]->GetValue (x, y, z));
 }
+
+void Invert::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  m_pSourceModule[0]->GetValueBatch (x, y, z, out, count);
+  for (int i = 0; i < count; i++) {
+    out[i] = -out[i];
+  }
+}
+
+void Invert::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  m_pSourceModule[0]->GetValueBatch2D (x, z, out, count);
+  for (int i = 0; i < count; i++) {
+    out[i] = -out[i];
+  }
+}
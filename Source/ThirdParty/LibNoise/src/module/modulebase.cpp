@@ -20,10 +20,39 @@
 // off every 'zig'.)
 //
 
+#include "../misc.h"
 #include "modulebase.h"
 
 using namespace noise::module;
 
+// The evaluation context bound to each thread.
+static thread_local EvalContext* s_pCurrentContext = NULL;
+
+EvalContext::EvalContext ()
+{
+}
+
+void EvalContext::Clear ()
+{
+  m_cacheStates.clear ();
+}
+
+EvalContext* EvalContext::GetCurrent ()
+{
+  return s_pCurrentContext;
+}
+
+EvalContextScope::EvalContextScope (EvalContext& context):
+  m_pPrevContext (s_pCurrentContext)
+{
+  s_pCurrentContext = &context;
+}
+
+EvalContextScope::~EvalContextScope ()
+{
+  s_pCurrentContext = m_pPrevContext;
+}
+
 Module::Module (int sourceModuleCount)
 {
   m_pSourceModule = NULL;
@@ -44,3 +73,53 @@ Module::~Module ()
 {
   delete[] m_pSourceModule;
 }
+
+void Module::GetValues (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  for (int first = 0; first < count; first += MAX_BATCH_SIZE) {
+    int batchCount = GetMin (count - first, MAX_BATCH_SIZE);
+    GetValueBatch (x + first, y + first, z + first, out + first, batchCount);
+  }
+}
+
+void Module::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (count <= MAX_BATCH_SIZE);
+  for (int i = 0; i < count; i++) {
+    out[i] = GetValue (x[i], y[i], z[i]);
+  }
+}
+
+double Module::GetValue2D (double x, double z) const
+{
+  return GetValue (x, 0.0, z);
+}
+
+void Module::GetValues2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  for (int first = 0; first < count; first += MAX_BATCH_SIZE) {
+    int batchCount = GetMin (count - first, MAX_BATCH_SIZE);
+    GetValueBatch2D (x + first, z + first, out + first, batchCount);
+  }
+}
+
+void Module::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  assert (count <= MAX_BATCH_SIZE);
+  double y[MAX_BATCH_SIZE];
+  for (int i = 0; i < count; i++) {
+    y[i] = 0.0;
+  }
+  GetValueBatch (x, y, z, out, count);
+}
+
+void Module::GetValues (EvalContext& context, const double* x,
+  const double* y, const double* z, double* out, int count) const
+{
+  EvalContextScope scope (context);
+  GetValues (x, y, z, out, count);
+}
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <unordered_map>
 #include "../exception.h"
 #include "../noisegen.h"
 
@@ -42,6 +43,109 @@ namespace noise
     /// @addtogroup modules
     /// @{
 
+    /// Maximum number of input values passed to
+    /// noise::module::Module::GetValueBatch().
+    ///
+    /// Noise modules keep their intermediate values for a batch on the
+    /// stack, so this value bounds the stack space used by each module in a
+    /// noise-module graph.
+    const int MAX_BATCH_SIZE = 64;
+
+    class Cache;
+
+    /// Per-thread state used while evaluating a noise-module graph.
+    ///
+    /// Most noise modules do not change while they are evaluated, but some
+    /// (such as noise::module::Cache) remember values between calls.  An
+    /// evaluation context holds that state instead, so one graph can be
+    /// evaluated from several threads at once if each thread uses its own
+    /// context.
+    ///
+    /// Pass a context to the GetValues() overload that takes one, or bind it
+    /// to the calling thread with an EvalContextScope object.  If no context
+    /// is bound to the calling thread, stateful noise modules keep their
+    /// state in the module itself; this is only safe if a single thread
+    /// evaluates the graph.
+    class EvalContext
+    {
+
+      public:
+
+        /// Constructor.
+        EvalContext ();
+
+        /// Discards all state stored in this context.
+        void Clear ();
+
+        /// Returns the evaluation context bound to the calling thread.
+        ///
+        /// @returns The evaluation context, or NULL if no context is bound.
+        static EvalContext* GetCurrent ();
+
+      private:
+
+        friend class Cache;
+        friend class EvalContextScope;
+
+        /// State of a noise::module::Cache noise module.
+        struct CacheState
+        {
+          CacheState ():
+            m_generation (0),
+            m_isCached (false)
+          {
+          }
+
+          double m_cachedValue;
+          double m_xCache;
+          double m_yCache;
+          double m_zCache;
+
+          /// Value of Cache::m_generation when the value was cached.
+          int m_generation;
+
+          bool m_isCached;
+        };
+
+        /// Returns the state of a noise::module::Cache noise module,
+        /// creating it if necessary.
+        CacheState& GetCacheState (const Cache* pCache)
+        {
+          return m_cacheStates[pCache];
+        }
+
+        /// States of the noise::module::Cache noise modules evaluated with
+        /// this context.
+        std::unordered_map<const Cache*, CacheState> m_cacheStates;
+
+    };
+
+    /// Binds an evaluation context to the calling thread for the lifetime of
+    /// this object.
+    ///
+    /// The previously bound context, if any, is bound again when this object
+    /// is destroyed.
+    class EvalContextScope
+    {
+
+      public:
+
+        /// Constructor.
+        ///
+        /// @param context The evaluation context to bind to the calling
+        /// thread.
+        explicit EvalContextScope (EvalContext& context);
+
+        /// Destructor.
+        ~EvalContextScope ();
+
+      private:
+
+        /// The evaluation context bound before this object was created.
+        EvalContext* m_pPrevContext;
+
+    };
+
     /// Abstract base class for noise modules.
     ///
     /// A <i>noise module</i> is an object that calculates and outputs a value
@@ -294,6 +398,113 @@ namespace noise
         /// module, call the GetSourceModuleCount() method.
         virtual double GetValue (double x, double y, double z) const = 0;
 
+        /// Generates an output value given the coordinates of an input value
+        /// on the plane @a y = 0.
+        ///
+        /// @param x The @a x coordinate of the input value.
+        /// @param z The @a z coordinate of the input value.
+        ///
+        /// @returns The output value.
+        ///
+        /// @pre All source modules required by this noise module have been
+        /// passed to the SetSourceModule() method.
+        ///
+        /// The output value is identical to the value returned by
+        /// GetValue (x, 0.0, z).  The default implementation calls that
+        /// method; generator modules override it to skip the work along the
+        /// @a y axis.
+        virtual double GetValue2D (double x, double z) const;
+
+        /// Generates output values for a batch of input values.
+        ///
+        /// @param x The @a x coordinates of the input values.
+        /// @param y The @a y coordinates of the input values.
+        /// @param z The @a z coordinates of the input values.
+        /// @param out The array that receives the output values.
+        /// @param count The number of input values.
+        ///
+        /// @pre All source modules required by this noise module have been
+        /// passed to the SetSourceModule() method.
+        ///
+        /// This method splits the input values into batches of at most
+        /// MAX_BATCH_SIZE values and passes each batch to the
+        /// GetValueBatch() method.  Each output value is identical to the
+        /// value returned by GetValue() for the same input value.
+        void GetValues (const double* x, const double* y, const double* z,
+          double* out, int count) const;
+
+        /// Generates output values for an array of input values using an
+        /// evaluation context.
+        ///
+        /// @param context The evaluation context that holds the state of the
+        /// stateful noise modules in this graph.
+        /// @param x The @a x coordinates of the input values.
+        /// @param y The @a y coordinates of the input values.
+        /// @param z The @a z coordinates of the input values.
+        /// @param out The array that receives the output values.
+        /// @param count The number of input values.
+        ///
+        /// This method binds the context to the calling thread and calls
+        /// GetValues().  Several threads can evaluate the same graph at once
+        /// if each thread uses its own context.
+        void GetValues (EvalContext& context, const double* x,
+          const double* y, const double* z, double* out, int count) const;
+
+        /// Generates output values for a single batch of input values.
+        ///
+        /// @param x The @a x coordinates of the input values.
+        /// @param y The @a y coordinates of the input values.
+        /// @param z The @a z coordinates of the input values.
+        /// @param out The array that receives the output values.
+        /// @param count The number of input values.
+        ///
+        /// @pre @a count is no greater than MAX_BATCH_SIZE.
+        ///
+        /// The default implementation calls GetValue() once for each input
+        /// value.  Noise modules override this method to evaluate the whole
+        /// batch with one call per source module, so that the cost of the
+        /// virtual call is shared by every value in the batch.
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        /// Generates output values for an array of input values on the plane
+        /// @a y = 0.
+        ///
+        /// @param x The @a x coordinates of the input values.
+        /// @param z The @a z coordinates of the input values.
+        /// @param out The array that receives the output values.
+        /// @param count The number of input values.
+        ///
+        /// @pre All source modules required by this noise module have been
+        /// passed to the SetSourceModule() method.
+        ///
+        /// This method splits the input values into batches of at most
+        /// MAX_BATCH_SIZE values and passes each batch to the
+        /// GetValueBatch2D() method.  Each output value is identical to the
+        /// value returned by GetValue2D() for the same input value.
+        void GetValues2D (const double* x, const double* z, double* out,
+          int count) const;
+
+        /// Generates output values for a single batch of input values on the
+        /// plane @a y = 0.
+        ///
+        /// @param x The @a x coordinates of the input values.
+        /// @param z The @a z coordinates of the input values.
+        /// @param out The array that receives the output values.
+        /// @param count The number of input values.
+        ///
+        /// @pre @a count is no greater than MAX_BATCH_SIZE.
+        ///
+        /// The default implementation passes the batch to GetValueBatch()
+        /// with every @a y coordinate set to zero.  Generator modules override
+        /// it to skip the work along the @a y axis, and modules that do not
+        /// transform the input coordinates override it to pass the batch to
+        /// the GetValueBatch2D() method of their source modules.  Modules
+        /// that move the input values off the plane, such as Displace and
+        /// Turbulence, keep the default implementation.
+        virtual void GetValueBatch2D (const double* x, const double* z,
+          double* out, int count) const;
+
         /// Connects a source module to this noise module.
         ///
         /// @param index An index value to assign to this source module.
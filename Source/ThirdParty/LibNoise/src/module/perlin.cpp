@@ -70,3 +70,102 @@ double Perlin::GetValue (double x, double y, double z) const
 
   return value;
 }
+
+void Perlin::GetValueBatch (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (count <= MAX_BATCH_SIZE);
+  double xCur[MAX_BATCH_SIZE], yCur[MAX_BATCH_SIZE], zCur[MAX_BATCH_SIZE];
+  double nx[MAX_BATCH_SIZE], ny[MAX_BATCH_SIZE], nz[MAX_BATCH_SIZE];
+  double signal[MAX_BATCH_SIZE];
+  double curPersistence = 1.0;
+  int seed;
+
+  for (int i = 0; i < count; i++) {
+    xCur[i] = x[i] * m_frequency;
+    yCur[i] = y[i] * m_frequency;
+    zCur[i] = z[i] * m_frequency;
+    out[i] = 0.0;
+  }
+
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    for (int i = 0; i < count; i++) {
+      nx[i] = MakeInt32Range (xCur[i]);
+      ny[i] = MakeInt32Range (yCur[i]);
+      nz[i] = MakeInt32Range (zCur[i]);
+    }
+
+    seed = (m_seed + curOctave) & 0xffffffff;
+    GradientCoherentNoise3DBatch (nx, ny, nz, seed, m_noiseQuality, signal,
+      count);
+    for (int i = 0; i < count; i++) {
+      out[i] += signal[i] * curPersistence;
+      xCur[i] *= m_lacunarity;
+      yCur[i] *= m_lacunarity;
+      zCur[i] *= m_lacunarity;
+    }
+    curPersistence *= m_persistence;
+  }
+}
+
+double Perlin::GetValue2D (double x, double z) const
+{
+  // Same as GetValue (x, 0.0, z).  The y coordinate stays zero in every
+  // octave, so each octave can use the two-dimensional noise function.
+  double value = 0.0;
+  double signal = 0.0;
+  double curPersistence = 1.0;
+  double nx, nz;
+  int seed;
+
+  x *= m_frequency;
+  z *= m_frequency;
+
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    nx = MakeInt32Range (x);
+    nz = MakeInt32Range (z);
+
+    seed = (m_seed + curOctave) & 0xffffffff;
+    signal = GradientCoherentNoise2D (nx, nz, seed, m_noiseQuality);
+    value += signal * curPersistence;
+
+    x *= m_lacunarity;
+    z *= m_lacunarity;
+    curPersistence *= m_persistence;
+  }
+
+  return value;
+}
+
+void Perlin::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  assert (count <= MAX_BATCH_SIZE);
+  double xCur[MAX_BATCH_SIZE], zCur[MAX_BATCH_SIZE];
+  double nx[MAX_BATCH_SIZE], nz[MAX_BATCH_SIZE];
+  double signal[MAX_BATCH_SIZE];
+  double curPersistence = 1.0;
+  int seed;
+
+  for (int i = 0; i < count; i++) {
+    xCur[i] = x[i] * m_frequency;
+    zCur[i] = z[i] * m_frequency;
+    out[i] = 0.0;
+  }
+
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    for (int i = 0; i < count; i++) {
+      nx[i] = MakeInt32Range (xCur[i]);
+      nz[i] = MakeInt32Range (zCur[i]);
+    }
+
+    seed = (m_seed + curOctave) & 0xffffffff;
+    GradientCoherentNoise2DBatch (nx, nz, seed, m_noiseQuality, signal, count);
+    for (int i = 0; i < count; i++) {
+      out[i] += signal[i] * curPersistence;
+      xCur[i] *= m_lacunarity;
+      zCur[i] *= m_lacunarity;
+    }
+    curPersistence *= m_persistence;
+  }
+}
@@ -112,3 +112,149 @@ double RidgedMulti::GetValue (double x, double y, double z) const
 
   return (value * 1.25) - 1.0;
 }
+
+void RidgedMulti::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (count <= MAX_BATCH_SIZE);
+  double xCur[MAX_BATCH_SIZE], yCur[MAX_BATCH_SIZE], zCur[MAX_BATCH_SIZE];
+  double nx[MAX_BATCH_SIZE], ny[MAX_BATCH_SIZE], nz[MAX_BATCH_SIZE];
+  double signal[MAX_BATCH_SIZE];
+  double weight[MAX_BATCH_SIZE];
+
+  // The same parameters as GetValue().
+  double offset = 1.0;
+  double gain = 2.0;
+
+  for (int i = 0; i < count; i++) {
+    xCur[i] = x[i] * m_frequency;
+    yCur[i] = y[i] * m_frequency;
+    zCur[i] = z[i] * m_frequency;
+    weight[i] = 1.0;
+    out[i] = 0.0;
+  }
+
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    for (int i = 0; i < count; i++) {
+      nx[i] = MakeInt32Range (xCur[i]);
+      ny[i] = MakeInt32Range (yCur[i]);
+      nz[i] = MakeInt32Range (zCur[i]);
+    }
+
+    int seed = (m_seed + curOctave) & 0x7fffffff;
+    GradientCoherentNoise3DBatch (nx, ny, nz, seed, m_noiseQuality, signal,
+      count);
+    for (int i = 0; i < count; i++) {
+      double curSignal = offset - fabs (signal[i]);
+      curSignal *= curSignal;
+      curSignal *= weight[i];
+      weight[i] = curSignal * gain;
+      if (weight[i] > 1.0) {
+        weight[i] = 1.0;
+      }
+      if (weight[i] < 0.0) {
+        weight[i] = 0.0;
+      }
+      out[i] += (curSignal * m_pSpectralWeights[curOctave]);
+      xCur[i] *= m_lacunarity;
+      yCur[i] *= m_lacunarity;
+      zCur[i] *= m_lacunarity;
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    out[i] = (out[i] * 1.25) - 1.0;
+  }
+}
+
+double RidgedMulti::GetValue2D (double x, double z) const
+{
+  // Same as GetValue (x, 0.0, z); see Perlin::GetValue2D().
+  x *= m_frequency;
+  z *= m_frequency;
+
+  double signal = 0.0;
+  double value  = 0.0;
+  double weight = 1.0;
+
+  double offset = 1.0;
+  double gain = 2.0;
+
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    double nx, nz;
+    nx = MakeInt32Range (x);
+    nz = MakeInt32Range (z);
+
+    int seed = (m_seed + curOctave) & 0x7fffffff;
+    signal = GradientCoherentNoise2D (nx, nz, seed, m_noiseQuality);
+
+    signal = fabs (signal);
+    signal = offset - signal;
+    signal *= signal;
+    signal *= weight;
+
+    weight = signal * gain;
+    if (weight > 1.0) {
+      weight = 1.0;
+    }
+    if (weight < 0.0) {
+      weight = 0.0;
+    }
+
+    value += (signal * m_pSpectralWeights[curOctave]);
+
+    x *= m_lacunarity;
+    z *= m_lacunarity;
+  }
+
+  return (value * 1.25) - 1.0;
+}
+
+void RidgedMulti::GetValueBatch2D (const double* x, const double* z,
+  double* out, int count) const
+{
+  assert (count <= MAX_BATCH_SIZE);
+  double xCur[MAX_BATCH_SIZE], zCur[MAX_BATCH_SIZE];
+  double nx[MAX_BATCH_SIZE], nz[MAX_BATCH_SIZE];
+  double signal[MAX_BATCH_SIZE];
+  double weight[MAX_BATCH_SIZE];
+
+  double offset = 1.0;
+  double gain = 2.0;
+
+  for (int i = 0; i < count; i++) {
+    xCur[i] = x[i] * m_frequency;
+    zCur[i] = z[i] * m_frequency;
+    weight[i] = 1.0;
+    out[i] = 0.0;
+  }
+
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    for (int i = 0; i < count; i++) {
+      nx[i] = MakeInt32Range (xCur[i]);
+      nz[i] = MakeInt32Range (zCur[i]);
+    }
+
+    int seed = (m_seed + curOctave) & 0x7fffffff;
+    GradientCoherentNoise2DBatch (nx, nz, seed, m_noiseQuality, signal, count);
+    for (int i = 0; i < count; i++) {
+      double curSignal = offset - fabs (signal[i]);
+      curSignal *= curSignal;
+      curSignal *= weight[i];
+      weight[i] = curSignal * gain;
+      if (weight[i] > 1.0) {
+        weight[i] = 1.0;
+      }
+      if (weight[i] < 0.0) {
+        weight[i] = 0.0;
+      }
+      out[i] += (curSignal * m_pSpectralWeights[curOctave]);
+      xCur[i] *= m_lacunarity;
+      zCur[i] *= m_lacunarity;
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    out[i] = (out[i] * 1.25) - 1.0;
+  }
+}
@@ -66,3 +66,18 @@ void RotatePoint::SetAngles (double xAngle, double yAngle,
   m_yAngle = yAngle;
   m_zAngle = zAngle;
 }
+
+void RotatePoint::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  double nx[MAX_BATCH_SIZE];
+  double ny[MAX_BATCH_SIZE];
+  double nz[MAX_BATCH_SIZE];
+  for (int i = 0; i < count; i++) {
+    nx[i] = (m_x1Matrix * x[i]) + (m_y1Matrix * y[i]) + (m_z1Matrix * z[i]);
+    ny[i] = (m_x2Matrix * x[i]) + (m_y2Matrix * y[i]) + (m_z2Matrix * z[i]);
+    nz[i] = (m_x3Matrix * x[i]) + (m_y3Matrix * y[i]) + (m_z3Matrix * z[i]);
+  }
+  m_pSourceModule[0]->GetValueBatch (nx, ny, nz, out, count);
+}
@@ -93,6 +93,9 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Returns the rotation angle around the @a x axis to apply to the
         /// input value.
         ///
@@ -39,3 +39,18 @@ double ScalePoint::GetValue (double x, double y, double z) const
   return m_pSourceModule[0]->GetValue (x * m_xScale, y * m_yScale,
     z * m_zScale);
 }
+
+void ScalePoint::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  double nx[MAX_BATCH_SIZE];
+  double ny[MAX_BATCH_SIZE];
+  double nz[MAX_BATCH_SIZE];
+  for (int i = 0; i < count; i++) {
+    nx[i] = x[i] * m_xScale;
+    ny[i] = y[i] * m_yScale;
+    nz[i] = z[i] * m_zScale;
+  }
+  m_pSourceModule[0]->GetValueBatch (nx, ny, nz, out, count);
+}
@@ -89,6 +89,9 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Returns the scaling factor applied to the @a x coordinate of the
         /// input value.
         ///
@@ -107,3 +107,65 @@ void Select::SetEdgeFalloff (double edgeFalloff)
   double boundSize = m_upperBound - m_lowerBound;
   m_edgeFalloff = (edgeFalloff > boundSize / 2)? boundSize / 2: edgeFalloff;
 }
+
+void Select::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  assert (m_pSourceModule[2] != NULL);
+  // Both source modules are evaluated for the whole batch; the selection is
+  // then made per value exactly as in GetValue().
+  double control[MAX_BATCH_SIZE];
+  double v1[MAX_BATCH_SIZE];
+  m_pSourceModule[2]->GetValueBatch (x, y, z, control, count);
+  m_pSourceModule[0]->GetValueBatch (x, y, z, out, count);
+  m_pSourceModule[1]->GetValueBatch (x, y, z, v1, count);
+  SelectBatch (control, v1, out, count);
+}
+
+void Select::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  assert (m_pSourceModule[2] != NULL);
+  double control[MAX_BATCH_SIZE];
+  double v1[MAX_BATCH_SIZE];
+  m_pSourceModule[2]->GetValueBatch2D (x, z, control, count);
+  m_pSourceModule[0]->GetValueBatch2D (x, z, out, count);
+  m_pSourceModule[1]->GetValueBatch2D (x, z, v1, count);
+  SelectBatch (control, v1, out, count);
+}
+
+void Select::SelectBatch (const double* control, const double* v1,
+  double* out, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    double controlValue = control[i];
+    double alpha;
+    if (m_edgeFalloff > 0.0) {
+      if (controlValue < (m_lowerBound - m_edgeFalloff)) {
+        // out[i] already holds the output value from the first source module.
+      } else if (controlValue < (m_lowerBound + m_edgeFalloff)) {
+        double lowerCurve = (m_lowerBound - m_edgeFalloff);
+        double upperCurve = (m_lowerBound + m_edgeFalloff);
+        alpha = SCurve3 (
+          (controlValue - lowerCurve) / (upperCurve - lowerCurve));
+        out[i] = LinearInterp (out[i], v1[i], alpha);
+      } else if (controlValue < (m_upperBound - m_edgeFalloff)) {
+        out[i] = v1[i];
+      } else if (controlValue < (m_upperBound + m_edgeFalloff)) {
+        double lowerCurve = (m_upperBound - m_edgeFalloff);
+        double upperCurve = (m_upperBound + m_edgeFalloff);
+        alpha = SCurve3 (
+          (controlValue - lowerCurve) / (upperCurve - lowerCurve));
+        out[i] = LinearInterp (v1[i], out[i], alpha);
+      }
+    } else {
+      if (!(controlValue < m_lowerBound || controlValue > m_upperBound)) {
+        out[i] = v1[i];
+      }
+    }
+  }
+}
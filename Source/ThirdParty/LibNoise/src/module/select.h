@@ -170,6 +170,12 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        virtual void GetValueBatch2D (const double* x, const double* z,
+          double* out, int count) const;
+
         /// Sets the lower and upper bounds of the selection range.
         ///
         /// @param lowerBound The lower bound.
@@ -243,6 +249,20 @@ namespace noise
 
       protected:
 
+        /// Selects between the output values from the two source modules
+        /// for each value in a batch.
+        ///
+        /// @param control The output values from the control module.
+        /// @param v1 The output values from the source module with an index
+        /// value of 1.
+        /// @param out On entry, the output values from the source module with
+        /// an index value of 0; on exit, the selected output values.
+        /// @param count The number of values in the batch.
+        ///
+        /// Shared by GetValueBatch() and GetValueBatch2D().
+        void SelectBatch (const double* control, const double* v1,
+          double* out, int count) const;
+
         /// Edge-falloff value.
         double m_edgeFalloff;
 
@@ -43,3 +43,11 @@ double Spheres::GetValue (double x, double y, double z) const
   double nearestDist = GetMin (distFromSmallerSphere, distFromLargerSphere);
   return 1.0 - (nearestDist * 4.0); // Puts it in the -1.0 to +1.0 range.
 }
+
+void Spheres::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    out[i] = Spheres::GetValue (x[i], y[i], z[i]);
+  }
+}
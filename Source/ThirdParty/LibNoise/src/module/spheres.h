@@ -96,6 +96,9 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Sets the frequenct of the concentric spheres.
         ///
         /// @param frequency The frequency of the concentric spheres.
@@ -80,8 +80,11 @@ double Terrace::GetValue (double x, double y, double z) const
   assert (m_controlPointCount >= 2);
 
   // Get the output value from the source module.
-  double sourceModuleValue = m_pSourceModule[0]->GetValue (x, y, z);
+  return MapValue (m_pSourceModule[0]->GetValue (x, y, z));
+}
 
+double Terrace::MapValue (double sourceModuleValue) const
+{
   // Find the first element in the control point array that has a value
   // larger than the output value from the source module.
   int indexPos;
@@ -158,3 +161,25 @@ void Terrace::MakeControlPoints (int controlPointCount)
     curValue += terraceStep;
   }
 }
+
+void Terrace::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_controlPointCount >= 2);
+  m_pSourceModule[0]->GetValueBatch (x, y, z, out, count);
+  for (int i = 0; i < count; i++) {
+    out[i] = MapValue (out[i]);
+  }
+}
+
+void Terrace::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_controlPointCount >= 2);
+  m_pSourceModule[0]->GetValueBatch2D (x, z, out, count);
+  for (int i = 0; i < count; i++) {
+    out[i] = MapValue (out[i]);
+  }
+}
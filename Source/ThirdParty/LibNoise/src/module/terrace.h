@@ -161,6 +161,12 @@ namespace noise
 
     	  virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetValueBatch (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        virtual void GetValueBatch2D (const double* x, const double* z,
+          double* out, int count) const;
+
 	      /// Creates a number of equally-spaced control points that range from
         /// -1 to +1.
 	      ///
@@ -200,6 +206,16 @@ namespace noise
         /// control point array.
 	      int FindInsertionPos (double value);
 
+        /// Maps an output value from the source module onto the
+        /// terrace-forming curve.
+        ///
+        /// @param sourceModuleValue The output value from the source module.
+        ///
+        /// @returns The mapped value.
+        ///
+        /// Shared by GetValue() and GetValueBatch().
+        double MapValue (double sourceModuleValue) const;
+
 	      /// Inserts the control point at the specified position in the
 	      /// internal control point array.
 	      ///
@@ -89,3 +89,37 @@ void Turbulence::SetSeed (int seed)
   m_yDistortModule.SetSeed (seed + 1);
   m_zDistortModule.SetSeed (seed + 2);
 }
+
+void Turbulence::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  // The same offsets as GetValue(); see the comments there.
+  double x0[MAX_BATCH_SIZE], y0[MAX_BATCH_SIZE], z0[MAX_BATCH_SIZE];
+  double x1[MAX_BATCH_SIZE], y1[MAX_BATCH_SIZE], z1[MAX_BATCH_SIZE];
+  double x2[MAX_BATCH_SIZE], y2[MAX_BATCH_SIZE], z2[MAX_BATCH_SIZE];
+  for (int i = 0; i < count; i++) {
+    x0[i] = x[i] + (12414.0 / 65536.0);
+    y0[i] = y[i] + (65124.0 / 65536.0);
+    z0[i] = z[i] + (31337.0 / 65536.0);
+    x1[i] = x[i] + (26519.0 / 65536.0);
+    y1[i] = y[i] + (18128.0 / 65536.0);
+    z1[i] = z[i] + (60493.0 / 65536.0);
+    x2[i] = x[i] + (53820.0 / 65536.0);
+    y2[i] = y[i] + (11213.0 / 65536.0);
+    z2[i] = z[i] + (44845.0 / 65536.0);
+  }
+  double xDistort[MAX_BATCH_SIZE];
+  double yDistort[MAX_BATCH_SIZE];
+  double zDistort[MAX_BATCH_SIZE];
+  m_xDistortModule.GetValueBatch (x0, y0, z0, xDistort, count);
+  m_yDistortModule.GetValueBatch (x1, y1, z1, yDistort, count);
+  m_zDistortModule.GetValueBatch (x2, y2, z2, zDistort, count);
+  for (int i = 0; i < count; i++) {
+    xDistort[i] = x[i] + (xDistort[i] * m_power);
+    yDistort[i] = y[i] + (yDistort[i] * m_power);
+    zDistort[i] = z[i] + (zDistort[i] * m_power);
+  }
+  m_pSourceModule[0]->GetValueBatch (xDistort, yDistort, zDistort, out,
+    count);
+}
@@ -20,6 +20,7 @@
 // off every 'zig'.)
 //
 
+#include <algorithm>
 #include "../mathconsts.h"
 #include "voronoi.h"
 
@@ -34,6 +35,65 @@ Voronoi::Voronoi ():
 {
 }
 
+// Returns a lower bound of the squared distance along one axis between the
+// coordinate v and the seed point of the cube at cur.  The seed point lies
+// within [cur - 1, cur + 1] because the value noise ranges from -1.0 to +1.0,
+// and rounding is monotonic, so the bound never exceeds the squared distance
+// computed from the actual seed point.
+static inline double GetMinAxisDist (int cur, double v)
+{
+  double d = 0.0;
+  if (v < (double)(cur - 1)) {
+    d = (double)(cur - 1) - v;
+  } else if (v > (double)(cur + 1)) {
+    d = v - (double)(cur + 1);
+  }
+  return d * d;
+}
+
+namespace
+{
+
+  // The offset of a nearby cube from the cube that contains the input value,
+  // and the position of that cube in the order GetValue() visits them.
+  struct CubeOffset
+  {
+    int x, y, z;
+    int order;
+  };
+
+  bool IsNearerCube (const CubeOffset& a, const CubeOffset& b)
+  {
+    int aDist = a.x * a.x + a.y * a.y + a.z * a.z;
+    int bDist = b.x * b.x + b.y * b.y + b.z * b.z;
+    return aDist < bDist || (aDist == bDist && a.order < b.order);
+  }
+
+  // The 125 nearby cubes, nearest first.
+  struct NearFirstCubes
+  {
+    CubeOffset offsets[125];
+
+    NearFirstCubes ()
+    {
+      int order = 0;
+      for (int zOffset = -2; zOffset <= 2; zOffset++) {
+        for (int yOffset = -2; yOffset <= 2; yOffset++) {
+          for (int xOffset = -2; xOffset <= 2; xOffset++) {
+            CubeOffset& offset = offsets[order];
+            offset.x = xOffset;
+            offset.y = yOffset;
+            offset.z = zOffset;
+            offset.order = order++;
+          }
+        }
+      }
+      std::sort (offsets, offsets + 125, IsNearerCube);
+    }
+  };
+
+}
+
 double Voronoi::GetValue (double x, double y, double z) const
 {
   // This method could be more efficient by caching the seed values.  Fix
@@ -99,3 +159,249 @@ double Voronoi::GetValue (double x, double y, double z) const
     (int)(floor (yCandidate)),
     (int)(floor (zCandidate))));
 }
+
+void Voronoi::GetValueBatch (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (count <= MAX_BATCH_SIZE);
+  double xs[MAX_BATCH_SIZE], ys[MAX_BATCH_SIZE], zs[MAX_BATCH_SIZE];
+  int xInt[MAX_BATCH_SIZE], yInt[MAX_BATCH_SIZE], zInt[MAX_BATCH_SIZE];
+  double minDist[MAX_BATCH_SIZE];
+  double xCandidate[MAX_BATCH_SIZE];
+  double yCandidate[MAX_BATCH_SIZE];
+  double zCandidate[MAX_BATCH_SIZE];
+
+  for (int i = 0; i < count; i++) {
+    xs[i] = x[i] * m_frequency;
+    ys[i] = y[i] * m_frequency;
+    zs[i] = z[i] * m_frequency;
+    xInt[i] = (xs[i] > 0.0? (int)xs[i]: (int)xs[i] - 1);
+    yInt[i] = (ys[i] > 0.0? (int)ys[i]: (int)ys[i] - 1);
+    zInt[i] = (zs[i] > 0.0? (int)zs[i]: (int)zs[i] - 1);
+    minDist[i] = 2147483647.0;
+    xCandidate[i] = 0;
+    yCandidate[i] = 0;
+    zCandidate[i] = 0;
+  }
+
+  // Visit the nearby cubes in the same order as GetValue() so that ties are
+  // resolved identically; each cube is visited for the whole batch at once.
+  int xCur[MAX_BATCH_SIZE], yCur[MAX_BATCH_SIZE], zCur[MAX_BATCH_SIZE];
+  double xNoise[MAX_BATCH_SIZE];
+  double yNoise[MAX_BATCH_SIZE];
+  double zNoise[MAX_BATCH_SIZE];
+  for (int zOffset = -2; zOffset <= 2; zOffset++) {
+    for (int yOffset = -2; yOffset <= 2; yOffset++) {
+      for (int xOffset = -2; xOffset <= 2; xOffset++) {
+        for (int i = 0; i < count; i++) {
+          xCur[i] = xInt[i] + xOffset;
+          yCur[i] = yInt[i] + yOffset;
+          zCur[i] = zInt[i] + zOffset;
+        }
+        ValueNoise3DBatch (xCur, yCur, zCur, m_seed    , xNoise, count);
+        ValueNoise3DBatch (xCur, yCur, zCur, m_seed + 1, yNoise, count);
+        ValueNoise3DBatch (xCur, yCur, zCur, m_seed + 2, zNoise, count);
+        for (int i = 0; i < count; i++) {
+          double xPos = xCur[i] + xNoise[i];
+          double yPos = yCur[i] + yNoise[i];
+          double zPos = zCur[i] + zNoise[i];
+          double xDist = xPos - xs[i];
+          double yDist = yPos - ys[i];
+          double zDist = zPos - zs[i];
+          double dist = xDist * xDist + yDist * yDist + zDist * zDist;
+          if (dist < minDist[i]) {
+            minDist[i] = dist;
+            xCandidate[i] = xPos;
+            yCandidate[i] = yPos;
+            zCandidate[i] = zPos;
+          }
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    double value;
+    if (m_enableDistance) {
+      double xDist = xCandidate[i] - xs[i];
+      double yDist = yCandidate[i] - ys[i];
+      double zDist = zCandidate[i] - zs[i];
+      value = (sqrt (xDist * xDist + yDist * yDist + zDist * zDist)
+        ) * SQRT_3 - 1.0;
+    } else {
+      value = 0.0;
+    }
+    out[i] = value + (m_displacement * (double)ValueNoise3D (
+      (int)(floor (xCandidate[i])),
+      (int)(floor (yCandidate[i])),
+      (int)(floor (zCandidate[i]))));
+  }
+}
+
+double Voronoi::GetValue2D (double x, double z) const
+{
+  static const NearFirstCubes cubes;
+
+  x *= m_frequency;
+  z *= m_frequency;
+
+  // The input value lies on the plane y = 0.  The nearby cubes are visited
+  // nearest first, so a close seed point is found early and most of the
+  // other cubes are skipped before their value noise is calculated.  A cube
+  // is skipped only when its seed point must be farther away than the
+  // candidate, and equal distances are resolved by the order in which
+  // GetValue() visits the cubes, so the result is identical.
+  double y = 0.0;
+  int xInt = (x > 0.0? (int)x: (int)x - 1);
+  int yInt = -1;
+  int zInt = (z > 0.0? (int)z: (int)z - 1);
+
+  double minDist = 2147483647.0;
+  int candidateOrder = 125;
+  double xCandidate = 0;
+  double yCandidate = 0;
+  double zCandidate = 0;
+
+  for (int i = 0; i < 125; i++) {
+    const CubeOffset& offset = cubes.offsets[i];
+    int xCur = xInt + offset.x;
+    int yCur = yInt + offset.y;
+    int zCur = zInt + offset.z;
+    double boundDist = GetMinAxisDist (xCur, x) + GetMinAxisDist (yCur, y)
+      + GetMinAxisDist (zCur, z);
+    if (boundDist > minDist) {
+      continue;
+    }
+
+    double xPos = xCur + ValueNoise3D (xCur, yCur, zCur, m_seed    );
+    double yPos = yCur + ValueNoise3D (xCur, yCur, zCur, m_seed + 1);
+    double zPos = zCur + ValueNoise3D (xCur, yCur, zCur, m_seed + 2);
+    double xDist = xPos - x;
+    double yDist = yPos - y;
+    double zDist = zPos - z;
+    double dist = xDist * xDist + yDist * yDist + zDist * zDist;
+
+    if (dist < minDist
+      || (dist == minDist && offset.order < candidateOrder)) {
+      minDist = dist;
+      candidateOrder = offset.order;
+      xCandidate = xPos;
+      yCandidate = yPos;
+      zCandidate = zPos;
+    }
+  }
+
+  double value;
+  if (m_enableDistance) {
+    double xDist = xCandidate - x;
+    double yDist = yCandidate - y;
+    double zDist = zCandidate - z;
+    value = (sqrt (xDist * xDist + yDist * yDist + zDist * zDist)
+      ) * SQRT_3 - 1.0;
+  } else {
+    value = 0.0;
+  }
+
+  return value + (m_displacement * (double)ValueNoise3D (
+    (int)(floor (xCandidate)),
+    (int)(floor (yCandidate)),
+    (int)(floor (zCandidate))));
+}
+
+void Voronoi::GetValueBatch2D (const double* x, const double* z, double* out,
+  int count) const
+{
+  static const NearFirstCubes cubes;
+
+  assert (count <= MAX_BATCH_SIZE);
+  double xs[MAX_BATCH_SIZE], zs[MAX_BATCH_SIZE];
+  int xInt[MAX_BATCH_SIZE], zInt[MAX_BATCH_SIZE];
+  double minDist[MAX_BATCH_SIZE];
+  int candidateOrder[MAX_BATCH_SIZE];
+  double xCandidate[MAX_BATCH_SIZE];
+  double yCandidate[MAX_BATCH_SIZE];
+  double zCandidate[MAX_BATCH_SIZE];
+  double y = 0.0;
+  int yInt = -1;
+
+  for (int i = 0; i < count; i++) {
+    xs[i] = x[i] * m_frequency;
+    zs[i] = z[i] * m_frequency;
+    xInt[i] = (xs[i] > 0.0? (int)xs[i]: (int)xs[i] - 1);
+    zInt[i] = (zs[i] > 0.0? (int)zs[i]: (int)zs[i] - 1);
+    minDist[i] = 2147483647.0;
+    candidateOrder[i] = 125;
+    xCandidate[i] = 0;
+    yCandidate[i] = 0;
+    zCandidate[i] = 0;
+  }
+
+  // Same as GetValue2D().  For each cube, the input values that cannot skip
+  // it are packed together so that their value noise is still calculated in
+  // one batch.
+  int active[MAX_BATCH_SIZE];
+  int xCur[MAX_BATCH_SIZE], yCur[MAX_BATCH_SIZE], zCur[MAX_BATCH_SIZE];
+  double xNoise[MAX_BATCH_SIZE];
+  double yNoise[MAX_BATCH_SIZE];
+  double zNoise[MAX_BATCH_SIZE];
+  for (int c = 0; c < 125; c++) {
+    const CubeOffset& offset = cubes.offsets[c];
+    double yBoundDist = GetMinAxisDist (yInt + offset.y, y);
+    int activeCount = 0;
+    for (int i = 0; i < count; i++) {
+      int xCube = xInt[i] + offset.x;
+      int zCube = zInt[i] + offset.z;
+      double boundDist = GetMinAxisDist (xCube, xs[i]) + yBoundDist
+        + GetMinAxisDist (zCube, zs[i]);
+      if (boundDist <= minDist[i]) {
+        active[activeCount] = i;
+        xCur[activeCount] = xCube;
+        yCur[activeCount] = yInt + offset.y;
+        zCur[activeCount] = zCube;
+        activeCount++;
+      }
+    }
+    if (activeCount == 0) {
+      continue;
+    }
+
+    ValueNoise3DBatch (xCur, yCur, zCur, m_seed    , xNoise, activeCount);
+    ValueNoise3DBatch (xCur, yCur, zCur, m_seed + 1, yNoise, activeCount);
+    ValueNoise3DBatch (xCur, yCur, zCur, m_seed + 2, zNoise, activeCount);
+    for (int k = 0; k < activeCount; k++) {
+      int i = active[k];
+      double xPos = xCur[k] + xNoise[k];
+      double yPos = yCur[k] + yNoise[k];
+      double zPos = zCur[k] + zNoise[k];
+      double xDist = xPos - xs[i];
+      double yDist = yPos - y;
+      double zDist = zPos - zs[i];
+      double dist = xDist * xDist + yDist * yDist + zDist * zDist;
+      if (dist < minDist[i]
+        || (dist == minDist[i] && offset.order < candidateOrder[i])) {
+        minDist[i] = dist;
+        candidateOrder[i] = offset.order;
+        xCandidate[i] = xPos;
+        yCandidate[i] = yPos;
+        zCandidate[i] = zPos;
+      }
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    double value;
+    if (m_enableDistance) {
+      double xDist = xCandidate[i] - xs[i];
+      double yDist = yCandidate[i] - y;
+      double zDist = zCandidate[i] - zs[i];
+      value = (sqrt (xDist * xDist + yDist * yDist + zDist * zDist)
+        ) * SQRT_3 - 1.0;
+    } else {
+      value = 0.0;
+    }
+    out[i] = value + (m_displacement * (double)ValueNoise3D (
+      (int)(floor (xCandidate[i])),
+      (int)(floor (yCandidate[i])),
+      (int)(floor (zCandidate[i]))));
+  }
+}
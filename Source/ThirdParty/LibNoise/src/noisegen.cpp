@@ -20,41 +20,17 @@
 // off every 'zig'.)
 //
 
-#include "noisegen.h"
+#include "noisegenbatch.h"
 #include "interp.h"
 #include "vectortable.h"
 
-using namespace noise;
-
-// Specifies the version of the coherent-noise functions to use.
-// - Set to 2 to use the current version.
-// - Set to 1 to use the flawed version from the original version of libnoise.
-// If your application requires coherent-noise values that were generated by
-// an earlier version of libnoise, change this constant to the appropriate
-// value and recompile libnoise.
-#define NOISE_VERSION 2
-
-// These constants control certain parameters that all coherent-noise
-// functions require.
-#if (NOISE_VERSION == 1)
-// Constants used by the original version of libnoise.
-// Because X_NOISE_GEN is not relatively prime to the other values, and
-// Z_NOISE_GEN is close to 256 (the number of random gradient vectors),
-// patterns show up in high-frequency coherent noise.
-const int X_NOISE_GEN = 1;
-const int Y_NOISE_GEN = 31337;
-const int Z_NOISE_GEN = 263;
-const int SEED_NOISE_GEN = 1013;
-const int SHIFT_NOISE_GEN = 13;
-#else
-// Constants used by the current version of libnoise.
-const int X_NOISE_GEN = 1619;
-const int Y_NOISE_GEN = 31337;
-const int Z_NOISE_GEN = 6971;
-const int SEED_NOISE_GEN = 1013;
-const int SHIFT_NOISE_GEN = 8;
+#if defined(NOISE_BATCH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
 #endif
 
+using namespace noise;
+
 double noise::GradientCoherentNoise3D (double x, double y, double z, int seed,
   NoiseQuality noiseQuality)
 {
@@ -144,18 +120,84 @@ double noise::GradientNoise3D (double fx, double fy, double fz, int ix,
     + (zvGradient * zvPoint)) * 2.12;
 }
 
+double noise::GradientCoherentNoise2D (double x, double z, int seed,
+  NoiseQuality noiseQuality)
+{
+  // Create a unit-length square aligned along an integer boundary.  This
+  // square surrounds the input point.
+  int x0 = (x > 0.0? (int)x: (int)x - 1);
+  int x1 = x0 + 1;
+  int z0 = (z > 0.0? (int)z: (int)z - 1);
+  int z1 = z0 + 1;
+
+  // Map the difference between the coordinates of the input value and the
+  // coordinates of the square's lower-left vertex onto an S-curve.
+  double xs = 0, zs = 0;
+  switch (noiseQuality) {
+    case QUALITY_FAST:
+      xs = (x - (double)x0);
+      zs = (z - (double)z0);
+      break;
+    case QUALITY_STD:
+      xs = SCurve3 (x - (double)x0);
+      zs = SCurve3 (z - (double)z0);
+      break;
+    case QUALITY_BEST:
+      xs = SCurve5 (x - (double)x0);
+      zs = SCurve5 (z - (double)z0);
+      break;
+  }
+
+  // These are the vertices GradientCoherentNoise3D() uses for y1 = 0, which
+  // are the only ones with a nonzero weight when y = 0.
+  double n0, n1, ix0, ix1;
+  n0   = GradientNoise2D (x, z, x0, z0, seed);
+  n1   = GradientNoise2D (x, z, x1, z0, seed);
+  ix0  = LinearInterp (n0, n1, xs);
+  n0   = GradientNoise2D (x, z, x0, z1, seed);
+  n1   = GradientNoise2D (x, z, x1, z1, seed);
+  ix1  = LinearInterp (n0, n1, xs);
+
+  return LinearInterp (ix0, ix1, zs);
+}
+
+double noise::GradientNoise2D (double fx, double fz, int ix, int iz, int seed)
+{
+  // Same vector index as GradientNoise3D() with iy = 0.  Only the low eight
+  // bits are used, so an unsigned shift gives the same index.
+  unsigned int vectorIndex = (
+      X_NOISE_GEN    * (unsigned int)ix
+    + Z_NOISE_GEN    * (unsigned int)iz
+    + SEED_NOISE_GEN * (unsigned int)seed);
+  vectorIndex ^= (vectorIndex >> SHIFT_NOISE_GEN);
+  vectorIndex &= 0xff;
+
+  double xvGradient = g_randomVectors[(vectorIndex << 2)    ];
+  double zvGradient = g_randomVectors[(vectorIndex << 2) + 2];
+
+  double xvPoint = (fx - (double)ix);
+  double zvPoint = (fz - (double)iz);
+
+  return ((xvGradient * xvPoint)
+    + (zvGradient * zvPoint)) * 2.12;
+}
+
 int noise::IntValueNoise3D (int x, int y, int z, int seed)
 {
   // All constants are primes and must remain prime in order for this noise
   // function to work correctly.
-  int n = (
-      X_NOISE_GEN    * x
-    + Y_NOISE_GEN    * y
-    + Z_NOISE_GEN    * z
-    + SEED_NOISE_GEN * seed)
+  //
+  // The products are meant to wrap around, so compute them with unsigned
+  // integers; signed overflow is undefined and lets some compilers drop the
+  // final mask.
+  unsigned int n = (
+      X_NOISE_GEN    * (unsigned int)x
+    + Y_NOISE_GEN    * (unsigned int)y
+    + Z_NOISE_GEN    * (unsigned int)z
+    + SEED_NOISE_GEN * (unsigned int)seed)
     & 0x7fffffff;
   n = (n >> 13) ^ n;
-  return (n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff;
+  return (int)((n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff);
 }
 
 double noise::ValueCoherentNoise3D (double x, double y, double z, int seed,
@@ -213,8 +255,214 @@ double noise::ValueCoherentNoise3D (double x, double y, double z, int seed,
   return LinearInterp (iy0, iy1, zs);
 }
 
+double noise::ValueCoherentNoise2D (double x, double z, int seed,
+  NoiseQuality noiseQuality)
+{
+  int x0 = (x > 0.0? (int)x: (int)x - 1);
+  int x1 = x0 + 1;
+  int z0 = (z > 0.0? (int)z: (int)z - 1);
+  int z1 = z0 + 1;
+
+  double xs = 0, zs = 0;
+  switch (noiseQuality) {
+    case QUALITY_FAST:
+      xs = (x - (double)x0);
+      zs = (z - (double)z0);
+      break;
+    case QUALITY_STD:
+      xs = SCurve3 (x - (double)x0);
+      zs = SCurve3 (z - (double)z0);
+      break;
+    case QUALITY_BEST:
+      xs = SCurve5 (x - (double)x0);
+      zs = SCurve5 (z - (double)z0);
+      break;
+  }
+
+  // See GradientCoherentNoise2D().
+  double n0, n1, ix0, ix1;
+  n0   = ValueNoise3D (x0, 0, z0, seed);
+  n1   = ValueNoise3D (x1, 0, z0, seed);
+  ix0  = LinearInterp (n0, n1, xs);
+  n0   = ValueNoise3D (x0, 0, z1, seed);
+  n1   = ValueNoise3D (x1, 0, z1, seed);
+  ix1  = LinearInterp (n0, n1, xs);
+  return LinearInterp (ix0, ix1, zs);
+}
+
 double noise::ValueNoise3D (int x, int y, int z, int seed)
 {
   return 1.0 - ((double)IntValueNoise3D (x, y, z, seed) / 1073741824.0);
 }
 
+namespace
+{
+
+  // Finds the best instruction set that both the processor and the
+  // operating system support.  AVX2 additionally requires the operating
+  // system to save the YMM registers on a context switch.
+  BatchInstructionSet DetectBatchInstructionSet ()
+  {
+#if defined(NOISE_BATCH_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid (info, 0);
+    int maxLeaf = info[0];
+    __cpuid (info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv (0) & 6) == 6) {
+      __cpuidex (info, 7, 0);
+      avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    if (avx2) {
+      return BATCH_AVX2;
+    } else if (sse41) {
+      return BATCH_SSE41;
+    }
+#elif defined(NOISE_BATCH_X86) && defined(__GNUC__)
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+      return BATCH_AVX2;
+    } else if (__builtin_cpu_supports ("sse4.1")) {
+      return BATCH_SSE41;
+    }
+#endif
+    return BATCH_SCALAR;
+  }
+
+  BatchInstructionSet& GetCurrentBatchInstructionSet ()
+  {
+    static BatchInstructionSet instructionSet = DetectBatchInstructionSet ();
+    return instructionSet;
+  }
+
+}
+
+noise::BatchInstructionSet noise::GetBatchInstructionSet ()
+{
+  return GetCurrentBatchInstructionSet ();
+}
+
+void noise::LimitBatchInstructionSet (BatchInstructionSet instructionSet)
+{
+  BatchInstructionSet& current = GetCurrentBatchInstructionSet ();
+  if (instructionSet < current) {
+    current = instructionSet;
+  }
+}
+
+void noise::GradientCoherentNoise3DBatch (const double* x, const double* y,
+  const double* z, int seed, NoiseQuality noiseQuality, double* out,
+  int count)
+{
+  int i = 0;
+#ifdef NOISE_BATCH_X86
+  switch (GetCurrentBatchInstructionSet ()) {
+    case BATCH_AVX2:
+      i = GradientCoherentNoise3DBatchAvx2 (x, y, z, seed, noiseQuality, out,
+        count);
+      break;
+    case BATCH_SSE41:
+      i = GradientCoherentNoise3DBatchSse41 (x, y, z, seed, noiseQuality, out,
+        count);
+      break;
+    default:
+      break;
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = GradientCoherentNoise3D (x[i], y[i], z[i], seed, noiseQuality);
+  }
+}
+
+void noise::ValueCoherentNoise3DBatch (const double* x, const double* y,
+  const double* z, int seed, NoiseQuality noiseQuality, double* out,
+  int count)
+{
+  int i = 0;
+#ifdef NOISE_BATCH_X86
+  switch (GetCurrentBatchInstructionSet ()) {
+    case BATCH_AVX2:
+      i = ValueCoherentNoise3DBatchAvx2 (x, y, z, seed, noiseQuality, out,
+        count);
+      break;
+    case BATCH_SSE41:
+      i = ValueCoherentNoise3DBatchSse41 (x, y, z, seed, noiseQuality, out,
+        count);
+      break;
+    default:
+      break;
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = ValueCoherentNoise3D (x[i], y[i], z[i], seed, noiseQuality);
+  }
+}
+
+void noise::ValueNoise3DBatch (const int* x, const int* y, const int* z,
+  int seed, double* out, int count)
+{
+  int i = 0;
+#ifdef NOISE_BATCH_X86
+  switch (GetCurrentBatchInstructionSet ()) {
+    case BATCH_AVX2:
+      i = ValueNoise3DBatchAvx2 (x, y, z, seed, out, count);
+      break;
+    case BATCH_SSE41:
+      i = ValueNoise3DBatchSse41 (x, y, z, seed, out, count);
+      break;
+    default:
+      break;
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = ValueNoise3D (x[i], y[i], z[i], seed);
+  }
+}
+
+void noise::GradientCoherentNoise2DBatch (const double* x, const double* z,
+  int seed, NoiseQuality noiseQuality, double* out, int count)
+{
+  int i = 0;
+#ifdef NOISE_BATCH_X86
+  switch (GetCurrentBatchInstructionSet ()) {
+    case BATCH_AVX2:
+      i = GradientCoherentNoise2DBatchAvx2 (x, z, seed, noiseQuality, out,
+        count);
+      break;
+    case BATCH_SSE41:
+      i = GradientCoherentNoise2DBatchSse41 (x, z, seed, noiseQuality, out,
+        count);
+      break;
+    default:
+      break;
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = GradientCoherentNoise2D (x[i], z[i], seed, noiseQuality);
+  }
+}
+
+void noise::ValueCoherentNoise2DBatch (const double* x, const double* z,
+  int seed, NoiseQuality noiseQuality, double* out, int count)
+{
+  int i = 0;
+#ifdef NOISE_BATCH_X86
+  switch (GetCurrentBatchInstructionSet ()) {
+    case BATCH_AVX2:
+      i = ValueCoherentNoise2DBatchAvx2 (x, z, seed, noiseQuality, out, count);
+      break;
+    case BATCH_SSE41:
+      i = ValueCoherentNoise2DBatchSse41 (x, z, seed, noiseQuality, out,
+        count);
+      break;
+    default:
+      break;
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = ValueCoherentNoise2D (x[i], z[i], seed, noiseQuality);
+  }
+}
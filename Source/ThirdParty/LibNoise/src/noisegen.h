@@ -58,6 +58,42 @@ namespace noise
 
   };
 
+  /// Enumerates the instruction sets that the batch functions can use.
+  enum BatchInstructionSet
+  {
+
+    /// The batch functions call the scalar functions for each input value.
+    BATCH_SCALAR = 0,
+
+    /// The batch functions process two input values at a time with SSE4.1.
+    BATCH_SSE41 = 1,
+
+    /// The batch functions process four input values at a time with AVX2.
+    BATCH_AVX2 = 2
+
+  };
+
+  /// Returns the instruction set that the batch functions use.
+  ///
+  /// @returns The best instruction set that is supported by the processor
+  /// and the operating system, or the limit set by
+  /// LimitBatchInstructionSet(), whichever is lower.
+  ///
+  /// The instruction set is detected at run time, the first time it is
+  /// needed, so libnoise runs on any x86 processor.  On other processors the
+  /// batch functions always call the scalar functions.
+  BatchInstructionSet GetBatchInstructionSet ();
+
+  /// Prevents the batch functions from using instruction sets later than
+  /// the specified one.
+  ///
+  /// @param instructionSet The latest instruction set to use.
+  ///
+  /// The batch functions produce the same values with every instruction
+  /// set; this function is meant for measuring and testing them.  Call it
+  /// before any batch function is called from another thread.
+  void LimitBatchInstructionSet (BatchInstructionSet instructionSet);
+
   /// Generates a gradient-coherent-noise value from the coordinates of a
   /// three-dimensional input value.
   ///
@@ -76,6 +112,58 @@ namespace noise
   double GradientCoherentNoise3D (double x, double y, double z, int seed = 0,
     NoiseQuality noiseQuality = QUALITY_STD);
 
+  /// Generates gradient-coherent-noise values for a batch of
+  /// three-dimensional input values.
+  ///
+  /// @param x The @a x coordinates of the input values.
+  /// @param y The @a y coordinates of the input values.
+  /// @param z The @a z coordinates of the input values.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  /// @param out The array that receives the generated values.
+  /// @param count The number of input values.
+  ///
+  /// Each generated value is identical to the value returned by
+  /// GradientCoherentNoise3D() for the same input value.  When libnoise is
+  /// compiled with AVX2 (or SSE4.1) enabled, this function evaluates four
+  /// (or two) input values at a time.
+  void GradientCoherentNoise3DBatch (const double* x, const double* y,
+    const double* z, int seed, NoiseQuality noiseQuality, double* out,
+    int count);
+
+  /// Generates a gradient-coherent-noise value from the coordinates of an
+  /// input value on the plane @a y = 0.
+  ///
+  /// @param x The @a x coordinate of the input value.
+  /// @param z The @a z coordinate of the input value.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  ///
+  /// @returns The generated gradient-coherent-noise value.
+  ///
+  /// The return value is identical to the value returned by
+  /// GradientCoherentNoise3D (x, 0.0, z, seed, noiseQuality).  At @a y = 0
+  /// the S-curve value for @a y is exactly one, so the three-dimensional
+  /// function only uses the four cube vertices that lie on the plane; this
+  /// function skips the other four and the interpolation along @a y.
+  double GradientCoherentNoise2D (double x, double z, int seed = 0,
+    NoiseQuality noiseQuality = QUALITY_STD);
+
+  /// Generates gradient-coherent-noise values for a batch of input values on
+  /// the plane @a y = 0.
+  ///
+  /// @param x The @a x coordinates of the input values.
+  /// @param z The @a z coordinates of the input values.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  /// @param out The array that receives the generated values.
+  /// @param count The number of input values.
+  ///
+  /// Each generated value is identical to the value returned by
+  /// GradientCoherentNoise2D() for the same input value.
+  void GradientCoherentNoise2DBatch (const double* x, const double* z,
+    int seed, NoiseQuality noiseQuality, double* out, int count);
+
   /// Generates a gradient-noise value from the coordinates of a
   /// three-dimensional input value and the integer coordinates of a
   /// nearby three-dimensional value.
@@ -120,6 +208,23 @@ namespace noise
   double GradientNoise3D (double fx, double fy, double fz, int ix, int iy,
     int iz, int seed = 0);
 
+  /// Generates a gradient-noise value from the coordinates of an input value
+  /// on the plane @a y = 0 and the integer coordinates of a nearby value on
+  /// the same plane.
+  ///
+  /// @param fx The floating-point @a x coordinate of the input value.
+  /// @param fz The floating-point @a z coordinate of the input value.
+  /// @param ix The integer @a x coordinate of a nearby value.
+  /// @param iz The integer @a z coordinate of a nearby value.
+  /// @param seed The random number seed.
+  ///
+  /// @returns The generated gradient-noise value.
+  ///
+  /// The return value is equal to the value returned by
+  /// GradientNoise3D (fx, 0.0, fz, ix, 0, iz, seed).
+  double GradientNoise2D (double fx, double fz, int ix, int iz,
+    int seed = 0);
+
   /// Generates an integer-noise value from the coordinates of a
   /// three-dimensional input value.
   ///
@@ -183,6 +288,53 @@ namespace noise
   double ValueCoherentNoise3D (double x, double y, double z, int seed = 0,
     NoiseQuality noiseQuality = QUALITY_STD);
 
+  /// Generates value-coherent-noise values for a batch of
+  /// three-dimensional input values.
+  ///
+  /// @param x The @a x coordinates of the input values.
+  /// @param y The @a y coordinates of the input values.
+  /// @param z The @a z coordinates of the input values.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  /// @param out The array that receives the generated values.
+  /// @param count The number of input values.
+  ///
+  /// Each generated value is identical to the value returned by
+  /// ValueCoherentNoise3D() for the same input value.
+  void ValueCoherentNoise3DBatch (const double* x, const double* y,
+    const double* z, int seed, NoiseQuality noiseQuality, double* out,
+    int count);
+
+  /// Generates a value-coherent-noise value from the coordinates of an input
+  /// value on the plane @a y = 0.
+  ///
+  /// @param x The @a x coordinate of the input value.
+  /// @param z The @a z coordinate of the input value.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  ///
+  /// @returns The generated value-coherent-noise value.
+  ///
+  /// The return value is identical to the value returned by
+  /// ValueCoherentNoise3D (x, 0.0, z, seed, noiseQuality).
+  double ValueCoherentNoise2D (double x, double z, int seed = 0,
+    NoiseQuality noiseQuality = QUALITY_STD);
+
+  /// Generates value-coherent-noise values for a batch of input values on
+  /// the plane @a y = 0.
+  ///
+  /// @param x The @a x coordinates of the input values.
+  /// @param z The @a z coordinates of the input values.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  /// @param out The array that receives the generated values.
+  /// @param count The number of input values.
+  ///
+  /// Each generated value is identical to the value returned by
+  /// ValueCoherentNoise2D() for the same input value.
+  void ValueCoherentNoise2DBatch (const double* x, const double* z, int seed,
+    NoiseQuality noiseQuality, double* out, int count);
+
   /// Generates a value-noise value from the coordinates of a
   /// three-dimensional input value.
   ///
@@ -200,6 +352,21 @@ namespace noise
   /// to it.
   double ValueNoise3D (int x, int y, int z, int seed = 0);
 
+  /// Generates value-noise values for a batch of three-dimensional integer
+  /// input values.
+  ///
+  /// @param x The @a x coordinates of the input values.
+  /// @param y The @a y coordinates of the input values.
+  /// @param z The @a z coordinates of the input values.
+  /// @param seed A random number seed.
+  /// @param out The array that receives the generated values.
+  /// @param count The number of input values.
+  ///
+  /// Each generated value is identical to the value returned by
+  /// ValueNoise3D() for the same input value.
+  void ValueNoise3DBatch (const int* x, const int* y, const int* z, int seed,
+    double* out, int count);
+
   /// @}
 
 }
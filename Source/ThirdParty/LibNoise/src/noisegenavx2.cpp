@@ -0,0 +1,33 @@
+// noisegenavx2.cpp
+//
+// Copyright (C) 2003, 2004 Jason Bevins
+//
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation; either version 2.1 of the License, or (at
+// your option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License (COPYING.txt) for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// The developer's email is jlbezigvins@gmzigail.com (for great email, take
+// off every 'zig'.)
+//
+
+// The AVX2 batch kernels.  Only this file is compiled with AVX2 enabled
+// (-mavx2 with GCC and Clang, /arch:AVX2 with MSVC).
+
+#define NOISE_SIMD_LANES 4
+#define NOISE_BATCH_KERNEL(name) name ## Avx2
+
+#include "noisegenbatch.h"
+
+#ifdef NOISE_BATCH_X86
+#include "noisegenbatch.inl"
+#endif
@@ -0,0 +1,113 @@
+// noisegenbatch.h
+//
+// Copyright (C) 2003, 2004 Jason Bevins
+//
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation; either version 2.1 of the License, or (at
+// your option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License (COPYING.txt) for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// The developer's email is jlbezigvins@gmzigail.com (for great email, take
+// off every 'zig'.)
+//
+
+#ifndef NOISE_NOISEGENBATCH_H
+#define NOISE_NOISEGENBATCH_H
+
+#include "noisegen.h"
+
+// Internal to libnoise: shared by noisegen.cpp and the batch kernels that
+// are compiled once per instruction set.  Not installed with the public
+// headers.
+
+// Specifies the version of the coherent-noise functions to use.
+// - Set to 2 to use the current version.
+// - Set to 1 to use the flawed version from the original version of libnoise.
+// If your application requires coherent-noise values that were generated by
+// an earlier version of libnoise, change this constant to the appropriate
+// value and recompile libnoise.
+#define NOISE_VERSION 2
+
+// These constants control certain parameters that all coherent-noise
+// functions require.
+#if (NOISE_VERSION == 1)
+// Constants used by the original version of libnoise.
+// Because X_NOISE_GEN is not relatively prime to the other values, and
+// Z_NOISE_GEN is close to 256 (the number of random gradient vectors),
+// patterns show up in high-frequency coherent noise.
+const int X_NOISE_GEN = 1;
+const int Y_NOISE_GEN = 31337;
+const int Z_NOISE_GEN = 263;
+const int SEED_NOISE_GEN = 1013;
+const int SHIFT_NOISE_GEN = 13;
+#else
+// Constants used by the current version of libnoise.
+const int X_NOISE_GEN = 1619;
+const int Y_NOISE_GEN = 31337;
+const int Z_NOISE_GEN = 6971;
+const int SEED_NOISE_GEN = 1013;
+const int SHIFT_NOISE_GEN = 8;
+#endif
+
+// The batch kernels are available on x86 and x86-64 only; elsewhere the
+// batch functions always use the scalar functions.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) \
+  || defined(__i386__)
+#define NOISE_BATCH_X86
+#endif
+
+#ifdef NOISE_BATCH_X86
+
+namespace noise
+{
+
+  // Defined in vectortable.h, which is included by noisegen.cpp only.
+  extern double g_randomVectors[256 * 4];
+
+  // Each kernel processes the largest prefix of the batch that fills whole
+  // SIMD registers and returns its length; the caller processes the rest
+  // with the scalar functions.  The Avx2 kernels are compiled in
+  // noisegenavx2.cpp, the Sse41 kernels in noisegensse41.cpp, and they may
+  // only be called when GetBatchInstructionSet() reports that instruction
+  // set or a later one.
+
+  int GradientCoherentNoise3DBatchAvx2 (const double* x, const double* y,
+    const double* z, int seed, NoiseQuality noiseQuality, double* out,
+    int count);
+  int ValueCoherentNoise3DBatchAvx2 (const double* x, const double* y,
+    const double* z, int seed, NoiseQuality noiseQuality, double* out,
+    int count);
+  int ValueNoise3DBatchAvx2 (const int* x, const int* y, const int* z,
+    int seed, double* out, int count);
+  int GradientCoherentNoise2DBatchAvx2 (const double* x, const double* z,
+    int seed, NoiseQuality noiseQuality, double* out, int count);
+  int ValueCoherentNoise2DBatchAvx2 (const double* x, const double* z,
+    int seed, NoiseQuality noiseQuality, double* out, int count);
+
+  int GradientCoherentNoise3DBatchSse41 (const double* x, const double* y,
+    const double* z, int seed, NoiseQuality noiseQuality, double* out,
+    int count);
+  int ValueCoherentNoise3DBatchSse41 (const double* x, const double* y,
+    const double* z, int seed, NoiseQuality noiseQuality, double* out,
+    int count);
+  int ValueNoise3DBatchSse41 (const int* x, const int* y, const int* z,
+    int seed, double* out, int count);
+  int GradientCoherentNoise2DBatchSse41 (const double* x, const double* z,
+    int seed, NoiseQuality noiseQuality, double* out, int count);
+  int ValueCoherentNoise2DBatchSse41 (const double* x, const double* z,
+    int seed, NoiseQuality noiseQuality, double* out, int count);
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,370 @@
+// noisegenbatch.inl
+//
+// Copyright (C) 2003, 2004 Jason Bevins
+//
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation; either version 2.1 of the License, or (at
+// your option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License (COPYING.txt) for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// The developer's email is jlbezigvins@gmzigail.com (for great email, take
+// off every 'zig'.)
+//
+
+// The batch kernels, compiled once per instruction set.  The including file
+// defines NOISE_SIMD_LANES as 4 for AVX2 or 2 for SSE4.1, and
+// NOISE_BATCH_KERNEL (name) to append the matching suffix to each kernel
+// name.  It is compiled with the compiler options that enable that
+// instruction set, and nothing else in libnoise is, so the library still
+// runs on processors without it.
+
+#include "noisegenbatch.h"
+
+#if NOISE_SIMD_LANES == 4
+#include <immintrin.h>
+#else
+#include <smmintrin.h>
+#endif
+
+using namespace noise;
+
+// Thin wrappers around the SIMD instructions used by the batch functions.
+// VDouble holds NOISE_SIMD_LANES double-precision values; VInt holds the
+// same number of 32-bit integers in its lowest lanes.  Every operation is
+// performed in the same order as the scalar functions, so the batch
+// functions produce bit-identical results.
+namespace
+{
+
+  typedef __m128i VInt;
+
+#if NOISE_SIMD_LANES == 4
+
+  typedef __m256d VDouble;
+
+  inline VDouble VLoad (const double* p) { return _mm256_loadu_pd (p); }
+  inline void VStore (double* p, VDouble v) { _mm256_storeu_pd (p, v); }
+  inline VDouble VSet (double d) { return _mm256_set1_pd (d); }
+  inline VDouble VAdd (VDouble a, VDouble b) { return _mm256_add_pd (a, b); }
+  inline VDouble VSub (VDouble a, VDouble b) { return _mm256_sub_pd (a, b); }
+  inline VDouble VMul (VDouble a, VDouble b) { return _mm256_mul_pd (a, b); }
+  inline VDouble VDiv (VDouble a, VDouble b) { return _mm256_div_pd (a, b); }
+  inline VInt VLoadInt (const int* p)
+  {
+    return _mm_loadu_si128 ((const __m128i*)p);
+  }
+  inline VInt VToInt (VDouble v) { return _mm256_cvttpd_epi32 (v); }
+  inline VDouble VToDouble (VInt v) { return _mm256_cvtepi32_pd (v); }
+
+  // Returns 1 in each lane where v is not greater than zero, including NaN.
+  inline VInt VNotPositive (VDouble v)
+  {
+    VDouble mask = _mm256_cmp_pd (v, _mm256_setzero_pd (), _CMP_NGT_UQ);
+    return VToInt (_mm256_and_pd (mask, VSet (1.0)));
+  }
+
+  inline VDouble VGather (const double* table, VInt index)
+  {
+    return _mm256_i32gather_pd (table, index, 8);
+  }
+
+#else
+
+  typedef __m128d VDouble;
+
+  inline VDouble VLoad (const double* p) { return _mm_loadu_pd (p); }
+  inline void VStore (double* p, VDouble v) { _mm_storeu_pd (p, v); }
+  inline VDouble VSet (double d) { return _mm_set1_pd (d); }
+  inline VDouble VAdd (VDouble a, VDouble b) { return _mm_add_pd (a, b); }
+  inline VDouble VSub (VDouble a, VDouble b) { return _mm_sub_pd (a, b); }
+  inline VDouble VMul (VDouble a, VDouble b) { return _mm_mul_pd (a, b); }
+  inline VDouble VDiv (VDouble a, VDouble b) { return _mm_div_pd (a, b); }
+  inline VInt VLoadInt (const int* p)
+  {
+    return _mm_loadl_epi64 ((const __m128i*)p);
+  }
+  inline VInt VToInt (VDouble v) { return _mm_cvttpd_epi32 (v); }
+  inline VDouble VToDouble (VInt v) { return _mm_cvtepi32_pd (v); }
+
+  inline VInt VNotPositive (VDouble v)
+  {
+    VDouble mask = _mm_cmpngt_pd (v, _mm_setzero_pd ());
+    return VToInt (_mm_and_pd (mask, VSet (1.0)));
+  }
+
+  inline VDouble VGather (const double* table, VInt index)
+  {
+    return _mm_set_pd (table[_mm_extract_epi32 (index, 1)],
+      table[_mm_cvtsi128_si32 (index)]);
+  }
+
+#endif
+
+  inline VInt VSetInt (int i) { return _mm_set1_epi32 (i); }
+  inline VInt VAddInt (VInt a, VInt b) { return _mm_add_epi32 (a, b); }
+  inline VInt VSubInt (VInt a, VInt b) { return _mm_sub_epi32 (a, b); }
+  inline VInt VMulInt (VInt a, VInt b) { return _mm_mullo_epi32 (a, b); }
+  inline VInt VAndInt (VInt a, VInt b) { return _mm_and_si128 (a, b); }
+  inline VInt VXorInt (VInt a, VInt b) { return _mm_xor_si128 (a, b); }
+
+  // Same as (x > 0.0? (int)x: (int)x - 1) in the scalar functions.
+  inline VInt VFloorInt (VDouble x)
+  {
+    return VSubInt (VToInt (x), VNotPositive (x));
+  }
+
+  inline VDouble VLinearInterp (VDouble n0, VDouble n1, VDouble a)
+  {
+    return VAdd (VMul (VSub (VSet (1.0), a), n0), VMul (a, n1));
+  }
+
+  inline VDouble VSCurve (VDouble a, NoiseQuality noiseQuality)
+  {
+    switch (noiseQuality) {
+      case QUALITY_FAST:
+        return a;
+      case QUALITY_STD:
+        return VMul (VMul (a, a), VSub (VSet (3.0), VMul (VSet (2.0), a)));
+      default: {
+        VDouble a3 = VMul (VMul (a, a), a);
+        VDouble a4 = VMul (a3, a);
+        VDouble a5 = VMul (a4, a);
+        return VAdd (VSub (VMul (VSet (6.0), a5), VMul (VSet (15.0), a4)),
+          VMul (VSet (10.0), a3));
+      }
+    }
+  }
+
+  // The sum X_NOISE_GEN * ix + Y_NOISE_GEN * iy + Z_NOISE_GEN * iz +
+  // SEED_NOISE_GEN * seed, wrapping on overflow like the scalar functions.
+  inline VInt VNoiseHash (VInt ix, VInt iy, VInt iz, VInt seedTerm)
+  {
+    return VAddInt (VAddInt (VAddInt (
+        VMulInt (VSetInt (X_NOISE_GEN), ix),
+        VMulInt (VSetInt (Y_NOISE_GEN), iy)),
+        VMulInt (VSetInt (Z_NOISE_GEN), iz)),
+        seedTerm);
+  }
+
+  inline VDouble VGradientNoise3D (VDouble fx, VDouble fy, VDouble fz,
+    VInt ix, VInt iy, VInt iz, VInt seedTerm)
+  {
+    VInt vectorIndex = VNoiseHash (ix, iy, iz, seedTerm);
+    vectorIndex = VXorInt (vectorIndex,
+      _mm_srai_epi32 (vectorIndex, SHIFT_NOISE_GEN));
+    vectorIndex = _mm_slli_epi32 (VAndInt (vectorIndex, VSetInt (0xff)), 2);
+
+    VDouble xvGradient = VGather (g_randomVectors    , vectorIndex);
+    VDouble yvGradient = VGather (g_randomVectors + 1, vectorIndex);
+    VDouble zvGradient = VGather (g_randomVectors + 2, vectorIndex);
+
+    VDouble xvPoint = VSub (fx, VToDouble (ix));
+    VDouble yvPoint = VSub (fy, VToDouble (iy));
+    VDouble zvPoint = VSub (fz, VToDouble (iz));
+
+    return VMul (VAdd (VAdd (
+        VMul (xvGradient, xvPoint),
+        VMul (yvGradient, yvPoint)),
+        VMul (zvGradient, zvPoint)),
+        VSet (2.12));
+  }
+
+  inline VDouble VGradientNoise2D (VDouble fx, VDouble fz, VInt ix, VInt iz,
+    VInt seedTerm)
+  {
+    VInt vectorIndex = VAddInt (VAddInt (
+        VMulInt (VSetInt (X_NOISE_GEN), ix),
+        VMulInt (VSetInt (Z_NOISE_GEN), iz)),
+        seedTerm);
+    vectorIndex = VXorInt (vectorIndex,
+      _mm_srai_epi32 (vectorIndex, SHIFT_NOISE_GEN));
+    vectorIndex = _mm_slli_epi32 (VAndInt (vectorIndex, VSetInt (0xff)), 2);
+
+    VDouble xvGradient = VGather (g_randomVectors    , vectorIndex);
+    VDouble zvGradient = VGather (g_randomVectors + 2, vectorIndex);
+
+    VDouble xvPoint = VSub (fx, VToDouble (ix));
+    VDouble zvPoint = VSub (fz, VToDouble (iz));
+
+    return VMul (VAdd (
+        VMul (xvGradient, xvPoint),
+        VMul (zvGradient, zvPoint)),
+        VSet (2.12));
+  }
+
+  inline VDouble VValueNoise3D (VInt x, VInt y, VInt z, VInt seedTerm)
+  {
+    VInt n = VAndInt (VNoiseHash (x, y, z, seedTerm), VSetInt (0x7fffffff));
+    n = VXorInt (_mm_srai_epi32 (n, 13), n);
+    VInt m = VAddInt (VMulInt (VMulInt (n, n), VSetInt (60493)),
+      VSetInt (19990303));
+    n = VAndInt (VAddInt (VMulInt (n, m), VSetInt (1376312589)),
+      VSetInt (0x7fffffff));
+    return VSub (VSet (1.0), VDiv (VToDouble (n), VSet (1073741824.0)));
+  }
+
+}
+
+int noise::NOISE_BATCH_KERNEL (GradientCoherentNoise3DBatch) (const double* x,
+  const double* y, const double* z, int seed, NoiseQuality noiseQuality,
+  double* out, int count)
+{
+  int i = 0;
+  VInt seedTerm = VSetInt (SEED_NOISE_GEN * seed);
+  VInt one = VSetInt (1);
+  for (; i + NOISE_SIMD_LANES <= count; i += NOISE_SIMD_LANES) {
+    VDouble vx = VLoad (x + i);
+    VDouble vy = VLoad (y + i);
+    VDouble vz = VLoad (z + i);
+    VInt x0 = VFloorInt (vx);
+    VInt x1 = VAddInt (x0, one);
+    VInt y0 = VFloorInt (vy);
+    VInt y1 = VAddInt (y0, one);
+    VInt z0 = VFloorInt (vz);
+    VInt z1 = VAddInt (z0, one);
+
+    VDouble xs = VSCurve (VSub (vx, VToDouble (x0)), noiseQuality);
+    VDouble ys = VSCurve (VSub (vy, VToDouble (y0)), noiseQuality);
+    VDouble zs = VSCurve (VSub (vz, VToDouble (z0)), noiseQuality);
+
+    VDouble n0, n1, ix0, ix1, iy0, iy1;
+    n0  = VGradientNoise3D (vx, vy, vz, x0, y0, z0, seedTerm);
+    n1  = VGradientNoise3D (vx, vy, vz, x1, y0, z0, seedTerm);
+    ix0 = VLinearInterp (n0, n1, xs);
+    n0  = VGradientNoise3D (vx, vy, vz, x0, y1, z0, seedTerm);
+    n1  = VGradientNoise3D (vx, vy, vz, x1, y1, z0, seedTerm);
+    ix1 = VLinearInterp (n0, n1, xs);
+    iy0 = VLinearInterp (ix0, ix1, ys);
+    n0  = VGradientNoise3D (vx, vy, vz, x0, y0, z1, seedTerm);
+    n1  = VGradientNoise3D (vx, vy, vz, x1, y0, z1, seedTerm);
+    ix0 = VLinearInterp (n0, n1, xs);
+    n0  = VGradientNoise3D (vx, vy, vz, x0, y1, z1, seedTerm);
+    n1  = VGradientNoise3D (vx, vy, vz, x1, y1, z1, seedTerm);
+    ix1 = VLinearInterp (n0, n1, xs);
+    iy1 = VLinearInterp (ix0, ix1, ys);
+    VStore (out + i, VLinearInterp (iy0, iy1, zs));
+  }
+  return i;
+}
+
+int noise::NOISE_BATCH_KERNEL (ValueCoherentNoise3DBatch) (const double* x,
+  const double* y, const double* z, int seed, NoiseQuality noiseQuality,
+  double* out, int count)
+{
+  int i = 0;
+  VInt seedTerm = VSetInt (SEED_NOISE_GEN * seed);
+  VInt one = VSetInt (1);
+  for (; i + NOISE_SIMD_LANES <= count; i += NOISE_SIMD_LANES) {
+    VDouble vx = VLoad (x + i);
+    VDouble vy = VLoad (y + i);
+    VDouble vz = VLoad (z + i);
+    VInt x0 = VFloorInt (vx);
+    VInt x1 = VAddInt (x0, one);
+    VInt y0 = VFloorInt (vy);
+    VInt y1 = VAddInt (y0, one);
+    VInt z0 = VFloorInt (vz);
+    VInt z1 = VAddInt (z0, one);
+
+    VDouble xs = VSCurve (VSub (vx, VToDouble (x0)), noiseQuality);
+    VDouble ys = VSCurve (VSub (vy, VToDouble (y0)), noiseQuality);
+    VDouble zs = VSCurve (VSub (vz, VToDouble (z0)), noiseQuality);
+
+    VDouble n0, n1, ix0, ix1, iy0, iy1;
+    n0  = VValueNoise3D (x0, y0, z0, seedTerm);
+    n1  = VValueNoise3D (x1, y0, z0, seedTerm);
+    ix0 = VLinearInterp (n0, n1, xs);
+    n0  = VValueNoise3D (x0, y1, z0, seedTerm);
+    n1  = VValueNoise3D (x1, y1, z0, seedTerm);
+    ix1 = VLinearInterp (n0, n1, xs);
+    iy0 = VLinearInterp (ix0, ix1, ys);
+    n0  = VValueNoise3D (x0, y0, z1, seedTerm);
+    n1  = VValueNoise3D (x1, y0, z1, seedTerm);
+    ix0 = VLinearInterp (n0, n1, xs);
+    n0  = VValueNoise3D (x0, y1, z1, seedTerm);
+    n1  = VValueNoise3D (x1, y1, z1, seedTerm);
+    ix1 = VLinearInterp (n0, n1, xs);
+    iy1 = VLinearInterp (ix0, ix1, ys);
+    VStore (out + i, VLinearInterp (iy0, iy1, zs));
+  }
+  return i;
+}
+
+int noise::NOISE_BATCH_KERNEL (ValueNoise3DBatch) (const int* x, const int* y,
+  const int* z, int seed, double* out, int count)
+{
+  int i = 0;
+  VInt seedTerm = VSetInt (SEED_NOISE_GEN * seed);
+  for (; i + NOISE_SIMD_LANES <= count; i += NOISE_SIMD_LANES) {
+    VStore (out + i, VValueNoise3D (VLoadInt (x + i), VLoadInt (y + i),
+      VLoadInt (z + i), seedTerm));
+  }
+  return i;
+}
+
+int noise::NOISE_BATCH_KERNEL (GradientCoherentNoise2DBatch) (const double* x,
+  const double* z, int seed, NoiseQuality noiseQuality, double* out, int count)
+{
+  int i = 0;
+  VInt seedTerm = VSetInt (SEED_NOISE_GEN * seed);
+  VInt one = VSetInt (1);
+  for (; i + NOISE_SIMD_LANES <= count; i += NOISE_SIMD_LANES) {
+    VDouble vx = VLoad (x + i);
+    VDouble vz = VLoad (z + i);
+    VInt x0 = VFloorInt (vx);
+    VInt x1 = VAddInt (x0, one);
+    VInt z0 = VFloorInt (vz);
+    VInt z1 = VAddInt (z0, one);
+
+    VDouble xs = VSCurve (VSub (vx, VToDouble (x0)), noiseQuality);
+    VDouble zs = VSCurve (VSub (vz, VToDouble (z0)), noiseQuality);
+
+    VDouble n0, n1, ix0, ix1;
+    n0  = VGradientNoise2D (vx, vz, x0, z0, seedTerm);
+    n1  = VGradientNoise2D (vx, vz, x1, z0, seedTerm);
+    ix0 = VLinearInterp (n0, n1, xs);
+    n0  = VGradientNoise2D (vx, vz, x0, z1, seedTerm);
+    n1  = VGradientNoise2D (vx, vz, x1, z1, seedTerm);
+    ix1 = VLinearInterp (n0, n1, xs);
+    VStore (out + i, VLinearInterp (ix0, ix1, zs));
+  }
+  return i;
+}
+
+int noise::NOISE_BATCH_KERNEL (ValueCoherentNoise2DBatch) (const double* x,
+  const double* z, int seed, NoiseQuality noiseQuality, double* out, int count)
+{
+  int i = 0;
+  VInt seedTerm = VSetInt (SEED_NOISE_GEN * seed);
+  VInt zero = VSetInt (0);
+  VInt one = VSetInt (1);
+  for (; i + NOISE_SIMD_LANES <= count; i += NOISE_SIMD_LANES) {
+    VDouble vx = VLoad (x + i);
+    VDouble vz = VLoad (z + i);
+    VInt x0 = VFloorInt (vx);
+    VInt x1 = VAddInt (x0, one);
+    VInt z0 = VFloorInt (vz);
+    VInt z1 = VAddInt (z0, one);
+
+    VDouble xs = VSCurve (VSub (vx, VToDouble (x0)), noiseQuality);
+    VDouble zs = VSCurve (VSub (vz, VToDouble (z0)), noiseQuality);
+
+    VDouble n0, n1, ix0, ix1;
+    n0  = VValueNoise3D (x0, zero, z0, seedTerm);
+    n1  = VValueNoise3D (x1, zero, z0, seedTerm);
+    ix0 = VLinearInterp (n0, n1, xs);
+    n0  = VValueNoise3D (x0, zero, z1, seedTerm);
+    n1  = VValueNoise3D (x1, zero, z1, seedTerm);
+    ix1 = VLinearInterp (n0, n1, xs);
+    VStore (out + i, VLinearInterp (ix0, ix1, zs));
+  }
+  return i;
+}
@@ -20,9 +20,14 @@
 // off every 'zig'.)
 //
 
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 #include "interp.h"
+#include "latlon.h"
 #include "mathconsts.h"
 
 #include "noiseutils.h"
@@ -164,6 +169,12 @@ int GradientColor::FindInsertionPos (double gradientPos)
 }
 
 const Color& GradientColor::GetColor (double gradientPos) const
+{
+  return GetColor (gradientPos, m_workingColor);
+}
+
+const Color& GradientColor::GetColor (double gradientPos,
+  Color& workingColor) const
 {
   assert (m_gradientPointCount >= 2);
 
@@ -187,8 +198,8 @@ const Color& GradientColor::GetColor (double gradientPos) const
   // the corresponding gradient color of the nearest gradient point and exit
   // now.
   if (index0 == index1) {
-    m_workingColor = m_pGradientPoints[index1].color;
-    return m_workingColor;
+    workingColor = m_pGradientPoints[index1].color;
+    return workingColor;
   }
   
   // Compute the alpha value used for linear interpolation.
@@ -199,8 +210,8 @@ const Color& GradientColor::GetColor (double gradientPos) const
   // Now perform the linear interpolation given the alpha value.
   const Color& color0 = m_pGradientPoints[index0].color;
   const Color& color1 = m_pGradientPoints[index1].color;
-  LinearInterpColor (color0, color1, (float)alpha, m_workingColor);
-  return m_workingColor;
+  LinearInterpColor (color0, color1, (float)alpha, workingColor);
+  return workingColor;
 }
 
 void GradientColor::InsertAtPos (int insertionPos, double gradientPos,
@@ -757,7 +768,9 @@ NoiseMapBuilder::NoiseMapBuilder ():
   m_destHeight (0),
   m_destWidth  (0),
   m_pDestNoiseMap (NULL),
-  m_pSourceModule (NULL)
+  m_pSourceModule (NULL),
+  m_threadCount (1),
+  m_bandHeight (0)
 {
 }
 
@@ -766,6 +779,88 @@ void NoiseMapBuilder::SetCallback (NoiseMapCallback pCallback)
   m_pCallback = pCallback;
 }
 
+void NoiseMapBuilder::SetupCoords (double columnStart, double columnDelta,
+  double rowStart, double rowDelta)
+{
+  m_columnCoords.resize (m_destWidth);
+  double columnCur = columnStart;
+  for (int x = 0; x < m_destWidth; x++) {
+    m_columnCoords[x] = columnCur;
+    columnCur += columnDelta;
+  }
+  m_rowCoords.resize (m_destHeight);
+  double rowCur = rowStart;
+  for (int y = 0; y < m_destHeight; y++) {
+    m_rowCoords[y] = rowCur;
+    rowCur += rowDelta;
+  }
+}
+
+void NoiseMapBuilder::BuildRows ()
+{
+  if (m_threadCount <= 1 || m_destHeight <= 1) {
+    for (int y = 0; y < m_destHeight; y++) {
+      BuildRow (y, m_pDestNoiseMap->GetSlabPtr (y));
+      if (m_pCallback != NULL) {
+        m_pCallback (y);
+      }
+    }
+    return;
+  }
+
+  // By default, give each thread several bands so that the threads stay
+  // busy until the end even if some bands take longer to fill than others.
+  int bandHeight = m_bandHeight;
+  if (bandHeight <= 0) {
+    bandHeight = ClampValue (m_destHeight / (m_threadCount * 8), 1, 64);
+  }
+  int bandCount = (m_destHeight + bandHeight - 1) / bandHeight;
+  int threadCount = GetMin (m_threadCount, bandCount);
+
+  // The worker threads take the bands in order.  The calling thread waits for
+  // each band in turn and calls the callback function for its rows, so the
+  // callback function is called in row order from a single thread.
+  std::atomic<int> nextBand (0);
+  std::vector<bool> isBandDone (bandCount, false);
+  std::mutex mutex;
+  std::condition_variable bandDone;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadCount; i++) {
+    threads.push_back (std::thread ([&] () {
+      // Each worker thread has its own evaluation context, so source
+      // modules that contain noise::module::Cache modules are safe to use.
+      module::EvalContext context;
+      module::EvalContextScope scope (context);
+      for (int band = nextBand++; band < bandCount; band = nextBand++) {
+        int yEnd = GetMin ((band + 1) * bandHeight, m_destHeight);
+        for (int y = band * bandHeight; y < yEnd; y++) {
+          BuildRow (y, m_pDestNoiseMap->GetSlabPtr (y));
+        }
+        std::lock_guard<std::mutex> lock (mutex);
+        isBandDone[band] = true;
+        bandDone.notify_all ();
+      }
+    }));
+  }
+
+  for (int band = 0; band < bandCount; band++) {
+    {
+      std::unique_lock<std::mutex> lock (mutex);
+      bandDone.wait (lock, [&] () { return isBandDone[band]; });
+    }
+    if (m_pCallback != NULL) {
+      int yEnd = GetMin ((band + 1) * bandHeight, m_destHeight);
+      for (int y = band * bandHeight; y < yEnd; y++) {
+        m_pCallback (y);
+      }
+    }
+  }
+
+  for (int i = 0; i < threadCount; i++) {
+    threads[i].join ();
+  }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // NoiseMapBuilderCylinder class
 
@@ -792,29 +887,38 @@ void NoiseMapBuilderCylinder::Build ()
   // values from the source model.
   m_pDestNoiseMap->SetSize (m_destWidth, m_destHeight);
 
-  // Create the cylinder model.
-  model::Cylinder cylinderModel;
-  cylinderModel.SetModule (*m_pSourceModule);
-
   double angleExtent  = m_upperAngleBound  - m_lowerAngleBound ;
   double heightExtent = m_upperHeightBound - m_lowerHeightBound;
   double xDelta = angleExtent  / (double)m_destWidth ;
   double yDelta = heightExtent / (double)m_destHeight;
-  double curAngle  = m_lowerAngleBound ;
-  double curHeight = m_lowerHeightBound;
+  SetupCoords (m_lowerAngleBound, xDelta, m_lowerHeightBound, yDelta);
 
   // Fill every point in the noise map with the output values from the model.
-  for (int y = 0; y < m_destHeight; y++) {
-    float* pDest = m_pDestNoiseMap->GetSlabPtr (y);
-    curAngle = m_lowerAngleBound;
-    for (int x = 0; x < m_destWidth; x++) {
-      float curValue = (float)cylinderModel.GetValue (curAngle, curHeight);
-      *pDest++ = curValue;
-      curAngle += xDelta;
+  BuildRows ();
+}
+
+void NoiseMapBuilderCylinder::BuildRow (int row, float* pDest) const
+{
+  // Input and output values of one batch of points along the row.  This is
+  // equivalent to calling model::Cylinder::GetValue() for each point.
+  double xValues[module::MAX_BATCH_SIZE];
+  double yValues[module::MAX_BATCH_SIZE];
+  double zValues[module::MAX_BATCH_SIZE];
+  double outValues[module::MAX_BATCH_SIZE];
+
+  double curHeight = m_rowCoords[row];
+  for (int x = 0; x < m_destWidth; x += module::MAX_BATCH_SIZE) {
+    int count = GetMin (m_destWidth - x, module::MAX_BATCH_SIZE);
+    for (int i = 0; i < count; i++) {
+      double curAngle = m_columnCoords[x + i];
+      xValues[i] = cos (curAngle * DEG_TO_RAD);
+      yValues[i] = curHeight;
+      zValues[i] = sin (curAngle * DEG_TO_RAD);
     }
-    curHeight += yDelta;
-    if (m_pCallback != NULL) {
-      m_pCallback (y);
+    m_pSourceModule->GetValueBatch (xValues, yValues, zValues, outValues,
+      count);
+    for (int i = 0; i < count; i++) {
+      *pDest++ = (float)outValues[i];
     }
   }
 }
@@ -846,43 +950,53 @@ void NoiseMapBuilderPlane::Build ()
   // values from the source model.
   m_pDestNoiseMap->SetSize (m_destWidth, m_destHeight);
 
-  // Create the plane model.
-  model::Plane planeModel;
-  planeModel.SetModule (*m_pSourceModule);
-
   double xExtent = m_upperXBound - m_lowerXBound;
   double zExtent = m_upperZBound - m_lowerZBound;
   double xDelta  = xExtent / (double)m_destWidth ;
   double zDelta  = zExtent / (double)m_destHeight;
-  double xCur    = m_lowerXBound;
-  double zCur    = m_lowerZBound;
+  SetupCoords (m_lowerXBound, xDelta, m_lowerZBound, zDelta);
 
   // Fill every point in the noise map with the output values from the model.
-  for (int z = 0; z < m_destHeight; z++) {
-    float* pDest = m_pDestNoiseMap->GetSlabPtr (z);
-    xCur = m_lowerXBound;
-    for (int x = 0; x < m_destWidth; x++) {
-      float finalValue;
-      if (!m_isSeamlessEnabled) {
-        finalValue = (float)planeModel.GetValue (xCur, zCur);
-      } else {
-        double swValue, seValue, nwValue, neValue;
-        swValue = planeModel.GetValue (xCur          , zCur          );
-        seValue = planeModel.GetValue (xCur + xExtent, zCur          );
-        nwValue = planeModel.GetValue (xCur          , zCur + zExtent);
-        neValue = planeModel.GetValue (xCur + xExtent, zCur + zExtent);
-        double xBlend = 1.0 - ((xCur - m_lowerXBound) / xExtent);
-        double zBlend = 1.0 - ((zCur - m_lowerZBound) / zExtent);
-        double z0 = LinearInterp (swValue, seValue, xBlend);
-        double z1 = LinearInterp (nwValue, neValue, xBlend);
-        finalValue = (float)LinearInterp (z0, z1, zBlend);
+  BuildRows ();
+}
+
+void NoiseMapBuilderPlane::BuildRow (int row, float* pDest) const
+{
+  double zCur = m_rowCoords[row];
+  if (!m_isSeamlessEnabled) {
+    // Input and output values of one batch of points along the row.  This
+    // is equivalent to calling model::Plane::GetValue() for each point; the
+    // points lie on the plane y = 0, so the two-dimensional path is used.
+    double zValues[module::MAX_BATCH_SIZE];
+    double outValues[module::MAX_BATCH_SIZE];
+    for (int i = 0; i < module::MAX_BATCH_SIZE; i++) {
+      zValues[i] = zCur;
+    }
+    for (int x = 0; x < m_destWidth; x += module::MAX_BATCH_SIZE) {
+      int count = GetMin (m_destWidth - x, module::MAX_BATCH_SIZE);
+      m_pSourceModule->GetValueBatch2D (&m_columnCoords[x], zValues,
+        outValues, count);
+      for (int i = 0; i < count; i++) {
+        *pDest++ = (float)outValues[i];
       }
-      *pDest++ = finalValue;
-      xCur += xDelta;
     }
-    zCur += zDelta;
-    if (m_pCallback != NULL) {
-      m_pCallback (z);
+  } else {
+    model::Plane planeModel;
+    planeModel.SetModule (*m_pSourceModule);
+    double xExtent = m_upperXBound - m_lowerXBound;
+    double zExtent = m_upperZBound - m_lowerZBound;
+    for (int x = 0; x < m_destWidth; x++) {
+      double xCur = m_columnCoords[x];
+      double swValue, seValue, nwValue, neValue;
+      swValue = planeModel.GetValue (xCur          , zCur          );
+      seValue = planeModel.GetValue (xCur + xExtent, zCur          );
+      nwValue = planeModel.GetValue (xCur          , zCur + zExtent);
+      neValue = planeModel.GetValue (xCur + xExtent, zCur + zExtent);
+      double xBlend = 1.0 - ((xCur - m_lowerXBound) / xExtent);
+      double zBlend = 1.0 - ((zCur - m_lowerZBound) / zExtent);
+      double z0 = LinearInterp (swValue, seValue, xBlend);
+      double z1 = LinearInterp (nwValue, neValue, xBlend);
+      *pDest++ = (float)LinearInterp (z0, z1, zBlend);
     }
   }
 }
@@ -913,29 +1027,36 @@ void NoiseMapBuilderSphere::Build ()
   // values from the source model.
   m_pDestNoiseMap->SetSize (m_destWidth, m_destHeight);
 
-  // Create the plane model.
-  model::Sphere sphereModel;
-  sphereModel.SetModule (*m_pSourceModule);
-
   double lonExtent = m_eastLonBound  - m_westLonBound ;
   double latExtent = m_northLatBound - m_southLatBound;
   double xDelta = lonExtent / (double)m_destWidth ;
   double yDelta = latExtent / (double)m_destHeight;
-  double curLon = m_westLonBound ;
-  double curLat = m_southLatBound;
+  SetupCoords (m_westLonBound, xDelta, m_southLatBound, yDelta);
 
   // Fill every point in the noise map with the output values from the model.
-  for (int y = 0; y < m_destHeight; y++) {
-    float* pDest = m_pDestNoiseMap->GetSlabPtr (y);
-    curLon = m_westLonBound;
-    for (int x = 0; x < m_destWidth; x++) {
-      float curValue = (float)sphereModel.GetValue (curLat, curLon);
-      *pDest++ = curValue;
-      curLon += xDelta;
+  BuildRows ();
+}
+
+void NoiseMapBuilderSphere::BuildRow (int row, float* pDest) const
+{
+  // Input and output values of one batch of points along the row.  This is
+  // equivalent to calling model::Sphere::GetValue() for each point.
+  double xValues[module::MAX_BATCH_SIZE];
+  double yValues[module::MAX_BATCH_SIZE];
+  double zValues[module::MAX_BATCH_SIZE];
+  double outValues[module::MAX_BATCH_SIZE];
+
+  double curLat = m_rowCoords[row];
+  for (int x = 0; x < m_destWidth; x += module::MAX_BATCH_SIZE) {
+    int count = GetMin (m_destWidth - x, module::MAX_BATCH_SIZE);
+    for (int i = 0; i < count; i++) {
+      LatLonToXYZ (curLat, m_columnCoords[x + i], xValues[i], yValues[i],
+        zValues[i]);
     }
-    curLat += yDelta;
-    if (m_pCallback != NULL) {
-      m_pCallback (y);
+    m_pSourceModule->GetValueBatch (xValues, yValues, zValues, outValues,
+      count);
+    for (int i = 0; i < count; i++) {
+      *pDest++ = (float)outValues[i];
     }
   }
 }
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <string>
+#include <vector>
 
 #include "noise.h"
 
@@ -231,8 +232,24 @@ namespace noise
         /// @param gradientPos The specified position.
         ///
         /// @returns The color at that position.
+        ///
+        /// The returned color is stored in this object, so this method is not
+        /// safe to call from several threads at once; use the overload that
+        /// takes a working color instead.
         const Color& GetColor (double gradientPos) const;
 
+        /// Returns the color at the specified position in the color gradient,
+        /// using storage owned by the caller.
+        ///
+        /// @param gradientPos The specified position.
+        /// @param workingColor The color object that receives the color.
+        ///
+        /// @returns A reference to @a workingColor.
+        ///
+        /// This method does not modify this object, so several threads can
+        /// call it at once if each thread passes its own working color.
+        const Color& GetColor (double gradientPos, Color& workingColor) const;
+
         /// Returns a pointer to the array of gradient points in this object.
         ///
         /// @returns A pointer to the array of gradient points.
@@ -1337,6 +1354,12 @@ namespace noise
     /// Note that SetBounds() is not defined in the abstract base class; it is
     /// only defined in the derived classes.  This is because each model uses
     /// a different coordinate system.
+    ///
+    /// <b>Building in Parallel</b>
+    ///
+    /// Pass a thread count greater than one to the SetThreadCount() method
+    /// to fill bands of rows on several worker threads.  The contents of the
+    /// noise map are identical to a single-threaded build.
     class NoiseMapBuilder
     {
 
@@ -1388,6 +1411,14 @@ namespace noise
           return m_destWidth;
         }
 
+        /// Returns the number of worker threads that Build() uses.
+        ///
+        /// @returns The number of worker threads.
+        int GetThreadCount () const
+        {
+          return m_threadCount;
+        }
+
         /// Sets the callback function that Build() calls each time it fills a
         /// row of the noise map with coherent-noise values.
         ///
@@ -1442,8 +1473,65 @@ namespace noise
           m_destHeight = destHeight;
         }
 
+        /// Sets the number of worker threads that Build() uses to fill the
+        /// noise map.
+        ///
+        /// @param threadCount The number of worker threads.  A value of 1 or
+        /// less fills the noise map on the calling thread.
+        /// @param bandHeight The number of rows that a worker thread fills at
+        /// a time.  A value of 0 picks a band height from the size of the
+        /// noise map.
+        ///
+        /// The noise map is split into bands of rows, and the worker threads
+        /// fill the bands in parallel.  The contents of the noise map are
+        /// identical to a single-threaded build.  The callback function is
+        /// still called once per row, in row order, on the thread that called
+        /// Build().
+        ///
+        /// Each worker thread evaluates the source module with its own
+        /// noise::module::EvalContext, so source modules that contain
+        /// noise::module::Cache modules can be built in parallel.  Other
+        /// stateful noise modules must be safe to evaluate concurrently.
+        void SetThreadCount (int threadCount, int bandHeight = 0)
+        {
+          m_threadCount = threadCount;
+          m_bandHeight  = bandHeight ;
+        }
+
       protected:
 
+        /// Fills one row of the destination noise map.
+        ///
+        /// @param row The row to fill.
+        /// @param pDest A pointer to the first value in the row.
+        ///
+        /// This method may be called from several worker threads at once, so
+        /// it must not modify this object.
+        virtual void BuildRow (int row, float* pDest) const = 0;
+
+        /// Fills every row of the destination noise map by calling
+        /// BuildRow(), and calls the callback function for each row.
+        ///
+        /// @pre The destination noise map has the size of the noise map to
+        /// build.
+        /// @pre SetupCoords() was previously called.
+        ///
+        /// The rows are filled on the worker threads specified by
+        /// SetThreadCount().
+        void BuildRows ();
+
+        /// Computes the input coordinate of each column and each row.
+        ///
+        /// @param columnStart The input coordinate of the first column.
+        /// @param columnDelta The distance between two adjacent columns.
+        /// @param rowStart The input coordinate of the first row.
+        /// @param rowDelta The distance between two adjacent rows.
+        ///
+        /// The coordinates are accumulated one step at a time, so every band
+        /// of rows uses exactly the coordinates of a single-threaded build.
+        void SetupCoords (double columnStart, double columnDelta,
+          double rowStart, double rowDelta);
+
         /// The callback function that Build() calls each time it fills a row
         /// of the noise map with coherent-noise values.
         ///
@@ -1465,6 +1553,18 @@ namespace noise
         /// Source noise module that will generate the coherent-noise values.
         const module::Module* m_pSourceModule;
 
+        /// Number of worker threads that Build() uses.
+        int m_threadCount;
+
+        /// Number of rows that a worker thread fills at a time.
+        int m_bandHeight;
+
+        /// Input coordinate of each column.
+        std::vector<double> m_columnCoords;
+
+        /// Input coordinate of each row.
+        std::vector<double> m_rowCoords;
+
     };
 
     /// Builds a cylindrical noise map.
@@ -1567,6 +1667,10 @@ namespace noise
           m_upperHeightBound = upperHeightBound;
         }
 
+      protected:
+
+        virtual void BuildRow (int row, float* pDest) const;
+
       private:
 
         /// Lower angle boundary of the cylindrical noise map, in degrees.
@@ -1692,6 +1796,10 @@ namespace noise
           m_upperZBound = upperZBound;
         }
 
+      protected:
+
+        virtual void BuildRow (int row, float* pDest) const;
+
       private:
 
         /// A flag specifying whether seamless tiling is enabled.
@@ -1801,6 +1909,10 @@ namespace noise
           m_eastLonBound  = eastLonBound ;
         }
 
+      protected:
+
+        virtual void BuildRow (int row, float* pDest) const;
+
       private:
 
         /// Eastern boundary of the spherical noise map, in degrees.
@@ -0,0 +1,203 @@
+// chunkmapbench.cpp
+//
+// 块坐标容器的性能测试：在构建网格式的大量查找、相邻块查找以及遍历上比较ChunkMap与哈希表
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "voxelcore.h"
+
+using namespace voxel;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double ElapsedSeconds(const Clock::time_point& start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//与UE的FCrc::MemCrc32相同的查表CRC32，TMap<FInt3, ...>原来的GetTypeHash对12个字节做这个计算
+struct Crc32Int3Hash
+{
+	static const uint32_t* GetTable()
+	{
+		static uint32_t table[256];
+		static bool bInitialized = false;
+		if (!bInitialized)
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t crc = i;
+				for (int32_t j = 0; j < 8; ++j)
+					crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+				table[i] = crc;
+			}
+			bInitialized = true;
+		}
+		return table;
+	}
+
+	size_t operator()(const Int3& v) const
+	{
+		static const uint32_t* table = GetTable();
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(&v);
+		uint32_t crc = ~0u;
+		for (size_t i = 0; i < sizeof(Int3); ++i)
+			crc = (crc >> 8) ^ table[(crc ^ data[i]) & 0xff];
+		return ~crc;
+	}
+};
+
+//让不同的容器用同一套测试代码
+template <typename HashType>
+struct StdMapAdapter
+{
+	std::unordered_map<Int3, ChunkDataPtr, HashType> Map;
+
+	void Insert(const ChunkDataPtr& data) { Map[data->Coordinate] = data; }
+
+	const ChunkData* Find(const Int3& coord) const
+	{
+		typename std::unordered_map<Int3, ChunkDataPtr, HashType>::const_iterator it = Map.find(coord);
+		return it != Map.end() ? it->second.get() : NULL;
+	}
+
+	size_t SumResident() const
+	{
+		size_t sum = 0;
+		for (typename std::unordered_map<Int3, ChunkDataPtr, HashType>::const_iterator it = Map.begin(); it != Map.end(); ++it)
+			sum += size_t(it->second->Coordinate.X);
+		return sum;
+	}
+};
+
+struct ChunkMapAdapter
+{
+	ChunkMap<ChunkDataPtr> Map;
+
+	void Insert(const ChunkDataPtr& data) { Map[data->Coordinate] = data; }
+
+	const ChunkData* Find(const Int3& coord) const
+	{
+		const ChunkDataPtr* data = Map.Find(coord);
+		return data ? data->get() : NULL;
+	}
+
+	size_t SumResident() const
+	{
+		size_t sum = 0;
+		for (ChunkMap<ChunkDataPtr>::ConstIterator it = Map.begin(); it != Map.end(); ++it)
+			sum += size_t(it->Value->Coordinate.X);
+		return sum;
+	}
+};
+
+struct BenchSetup
+{
+	Int3 GridPerChunk;
+
+	std::vector<ChunkDataPtr> Chunks;
+
+	int32_t Repeat;
+};
+
+template <typename Adapter>
+static void RunContainer(const char* name, const BenchSetup& setup)
+{
+	Adapter container;
+	for (size_t i = 0; i < setup.Chunks.size(); ++i)
+		container.Insert(setup.Chunks[i]);
+	const Int3& gridPerChunk = setup.GridPerChunk;
+
+	//旧的网格构建方式：对块以及外围一圈的每个格子按格子坐标找所在的块
+	size_t meshLookups = 0;
+	size_t found = 0;
+	Clock::time_point meshStart = Clock::now();
+	for (int32_t r = 0; r < setup.Repeat; ++r)
+	{
+		for (size_t c = 0; c < setup.Chunks.size(); c += 7)
+		{
+			const Int3& coord = setup.Chunks[c]->Coordinate;
+			for (int32_t x = -1; x <= gridPerChunk.X; ++x)
+				for (int32_t y = -1; y <= gridPerChunk.Y; ++y)
+					for (int32_t z = -1; z <= gridPerChunk.Z; ++z)
+					{
+						Int3 gridCoord = coord + Int3(x, y, z);
+						found += container.Find(GetChunkCoordinate(gridCoord, gridPerChunk)) ? 1 : 0;
+						++meshLookups;
+					}
+		}
+	}
+	double meshSeconds = ElapsedSeconds(meshStart);
+
+	//收集相邻块：每个块查27次
+	size_t neighbourLookups = 0;
+	Clock::time_point neighbourStart = Clock::now();
+	for (int32_t r = 0; r < setup.Repeat * 16; ++r)
+	{
+		for (size_t c = 0; c < setup.Chunks.size(); ++c)
+		{
+			const Int3& coord = setup.Chunks[c]->Coordinate;
+			for (int32_t i = 0; i < 27; ++i)
+			{
+				Int3 adjCoord = coord + (Int3(i / 9, i / 3 % 3, i % 3) - Int3::Scalar(1)) * gridPerChunk;
+				found += container.Find(adjCoord) ? 1 : 0;
+			}
+			neighbourLookups += 27;
+		}
+	}
+	double neighbourSeconds = ElapsedSeconds(neighbourStart);
+
+	const int32_t iterations = setup.Repeat * 64;
+	Clock::time_point iterateStart = Clock::now();
+	for (int32_t r = 0; r < iterations; ++r)
+		found += container.SumResident() & 1;
+	double iterateSeconds = ElapsedSeconds(iterateStart);
+
+	printf("  %-26s mesh %7.1f M lookups/s  neighbours %7.1f M lookups/s  iterate %7.1f M chunks/s  (check %zu)\n", name,
+		meshLookups / meshSeconds * 1e-6, neighbourLookups / neighbourSeconds * 1e-6,
+		double(setup.Chunks.size()) * iterations / iterateSeconds * 1e-6, found);
+}
+
+int main(int argc, char** argv)
+{
+	int32_t regionChunks = 24;
+	int32_t layers = 4;
+	BenchSetup setup;
+	setup.GridPerChunk = Int3(16, 16, 16);
+	setup.Repeat = 4;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			regionChunks = atoi(argv[++i]);
+		else if (arg == "-layers" && i + 1 < argc)
+			layers = atoi(argv[++i]);
+		else if (arg == "-size" && i + 1 < argc)
+			setup.GridPerChunk = Int3::Scalar(atoi(argv[++i]));
+		else if (arg == "-repeat" && i + 1 < argc)
+			setup.Repeat = atoi(argv[++i]);
+		else
+		{
+			printf("usage: chunkmapbench [-n regionChunks] [-layers chunkLayers] [-size gridPerChunk] [-repeat times]\n");
+			return 1;
+		}
+	}
+
+	//以原点为中心的区域，包含负坐标的块
+	for (int32_t x = -regionChunks / 2; x < regionChunks - regionChunks / 2; ++x)
+		for (int32_t y = -regionChunks / 2; y < regionChunks - regionChunks / 2; ++y)
+			for (int32_t z = 0; z < layers; ++z)
+				setup.Chunks.push_back(std::make_shared<ChunkData>(Int3(x, y, z) * setup.GridPerChunk, setup.GridPerChunk));
+
+	printf("chunk map: %zu resident chunks (%d x %d x %d of %d^3 grids)\n", setup.Chunks.size(), regionChunks, regionChunks,
+		layers, setup.GridPerChunk.X);
+	RunContainer<StdMapAdapter<Crc32Int3Hash> >("unordered_map + MemCrc32", setup);
+	RunContainer<StdMapAdapter<Int3Hash> >("unordered_map + Int3Hash", setup);
+	RunContainer<ChunkMapAdapter>("ChunkMap", setup);
+	return 0;
+}
@@ -0,0 +1,485 @@
+// noisebench.cpp
+//
+// 噪声模块的性能测试：比较逐点GetValue与批量GetValues的吞吐量，并检查两者结果是否一致
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "noise.h"
+#include "noiseutils.h"
+#include "noiseprogram.h"
+
+using namespace noise;
+using voxel::NoiseProgram;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double ElapsedSeconds(const Clock::time_point& start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//与块高度图相同的采样方式：平面上间距为1的格点，乘以频率
+struct SamplePoints
+{
+	std::vector<double> X;
+	std::vector<double> Y;
+	std::vector<double> Z;
+
+	SamplePoints(int32_t size, double frequency)
+	{
+		for (int32_t i = 0; i < size; ++i)
+		{
+			for (int32_t j = 0; j < size; ++j)
+			{
+				X.push_back(j * frequency - 1000.25);
+				Y.push_back(0.5 + i * 0.001);
+				Z.push_back(i * frequency + 17.75);
+			}
+		}
+	}
+
+	int32_t Num() const
+	{
+		return int32_t(X.size());
+	}
+};
+
+//返回两种求值方式的最大误差，0表示完全一致
+static double RunModule(const char* name, const module::Module& source, const SamplePoints& points, int32_t repeat)
+{
+	int32_t num = points.Num();
+	std::vector<double> scalarValues(num);
+	std::vector<double> batchValues(num);
+
+	Clock::time_point scalarStart = Clock::now();
+	for (int32_t r = 0; r < repeat; ++r)
+		for (int32_t i = 0; i < num; ++i)
+			scalarValues[i] = source.GetValue(points.X[i], points.Y[i], points.Z[i]);
+	double scalarSeconds = ElapsedSeconds(scalarStart);
+
+	Clock::time_point batchStart = Clock::now();
+	for (int32_t r = 0; r < repeat; ++r)
+		source.GetValues(&points.X[0], &points.Y[0], &points.Z[0], &batchValues[0], num);
+	double batchSeconds = ElapsedSeconds(batchStart);
+
+	double maxDiff = 0;
+	for (int32_t i = 0; i < num; ++i)
+		maxDiff = std::max(maxDiff, fabs(scalarValues[i] - batchValues[i]));
+
+	double total = double(num) * repeat;
+	printf("  %-12s GetValue %8.2f Mpts/s  GetValues %8.2f Mpts/s  speedup %5.2fx  max diff %g\n", name,
+		total / scalarSeconds * 1e-6, total / batchSeconds * 1e-6, scalarSeconds / batchSeconds, maxDiff);
+	return maxDiff;
+}
+
+//y = 0平面上的采样：比较三维批量求值与二维路径，二维的结果必须与GetValue(x, 0, z)一致
+static double RunModule2D(const char* name, const module::Module& source, const SamplePoints& points, int32_t repeat)
+{
+	int32_t num = points.Num();
+	std::vector<double> zeroY(num, 0.0);
+	std::vector<double> scalarValues(num);
+	std::vector<double> batchValues(num);
+	std::vector<double> scalar2DValues(num);
+	std::vector<double> batch2DValues(num);
+
+	for (int32_t i = 0; i < num; ++i)
+		scalarValues[i] = source.GetValue(points.X[i], 0.0, points.Z[i]);
+
+	Clock::time_point batchStart = Clock::now();
+	for (int32_t r = 0; r < repeat; ++r)
+		source.GetValues(&points.X[0], &zeroY[0], &points.Z[0], &batchValues[0], num);
+	double batchSeconds = ElapsedSeconds(batchStart);
+
+	Clock::time_point scalar2DStart = Clock::now();
+	for (int32_t r = 0; r < repeat; ++r)
+		for (int32_t i = 0; i < num; ++i)
+			scalar2DValues[i] = source.GetValue2D(points.X[i], points.Z[i]);
+	double scalar2DSeconds = ElapsedSeconds(scalar2DStart);
+
+	Clock::time_point batch2DStart = Clock::now();
+	for (int32_t r = 0; r < repeat; ++r)
+		source.GetValues2D(&points.X[0], &points.Z[0], &batch2DValues[0], num);
+	double batch2DSeconds = ElapsedSeconds(batch2DStart);
+
+	double maxDiff = 0;
+	for (int32_t i = 0; i < num; ++i)
+	{
+		maxDiff = std::max(maxDiff, fabs(scalarValues[i] - batchValues[i]));
+		maxDiff = std::max(maxDiff, fabs(scalarValues[i] - scalar2DValues[i]));
+		maxDiff = std::max(maxDiff, fabs(scalarValues[i] - batch2DValues[i]));
+	}
+
+	double total = double(num) * repeat;
+	printf("  %-12s GetValues %8.2f Mpts/s  GetValue2D %8.2f Mpts/s  GetValues2D %8.2f Mpts/s  speedup %5.2fx  max diff %g\n", name,
+		total / batchSeconds * 1e-6, total / scalar2DSeconds * 1e-6, total / batch2DSeconds * 1e-6, batchSeconds / batch2DSeconds,
+		maxDiff);
+	return maxDiff;
+}
+
+//按块生成时的方式构建16x16的高度图，与逐点求值对比
+static double RunHeightMap(const module::Module& source, int32_t chunks, int32_t size)
+{
+	utils::NoiseMap heightMap;
+	utils::NoiseMapBuilderPlane heightMapBuilder;
+	heightMapBuilder.SetSourceModule(source);
+	heightMapBuilder.SetDestNoiseMap(heightMap);
+	heightMapBuilder.SetDestSize(size, size);
+	std::vector<float> scalarValues(size * size);
+
+	double scalarSeconds = 0;
+	double batchSeconds = 0;
+	double maxDiff = 0;
+	for (int32_t c = 0; c < chunks; ++c)
+	{
+		double lowerX = (c % 64) * size;
+		double lowerZ = (c / 64) * size;
+		double delta = 1.0;
+
+		Clock::time_point scalarStart = Clock::now();
+		double zCur = lowerZ;
+		for (int32_t z = 0; z < size; ++z)
+		{
+			double xCur = lowerX;
+			for (int32_t x = 0; x < size; ++x)
+			{
+				scalarValues[z * size + x] = float(source.GetValue(xCur, 0, zCur));
+				xCur += delta;
+			}
+			zCur += delta;
+		}
+		scalarSeconds += ElapsedSeconds(scalarStart);
+
+		Clock::time_point batchStart = Clock::now();
+		heightMapBuilder.SetBounds(lowerX, lowerX + size, lowerZ, lowerZ + size);
+		heightMapBuilder.Build();
+		batchSeconds += ElapsedSeconds(batchStart);
+
+		for (int32_t z = 0; z < size; ++z)
+			for (int32_t x = 0; x < size; ++x)
+				maxDiff = std::max(maxDiff, double(fabsf(scalarValues[z * size + x] - heightMap.GetValue(x, z))));
+	}
+	printf("  %-12s GetValue %8.1f chunks/s  Build %8.1f chunks/s  speedup %5.2fx  max diff %g\n", "heightmap",
+		chunks / scalarSeconds, chunks / batchSeconds, scalarSeconds / batchSeconds, maxDiff);
+	return maxDiff;
+}
+
+//地形生成中常见的模块图：共享的大陆子图经Cache被多处引用，另有参数相同的重复模块
+struct TerrainGraph
+{
+	module::Perlin ContinentNoise;
+	module::Curve ContinentCurve;
+	module::Perlin CarverNoise;
+	module::ScaleBias CarverScale;
+	module::Min CarvedContinent;
+	module::Clamp ClampedContinent;
+	module::Cache Continent;
+	module::Turbulence ContinentTurbulence;
+	module::Select ContinentEdge;
+	module::Cache ContinentDef;
+	module::Turbulence TerrainTypeTurbulence;
+	module::Terrace TerrainTypeTerrace;
+	module::Cache TerrainType;
+	module::RidgedMulti MountainNoise;
+	module::ScaleBias Mountains;
+	module::Billow HillNoise;
+	module::ScaleBias Hills;
+	module::Billow PlainNoise;
+	module::ScaleBias PlainScale;
+	module::Const PlainOffset;
+	module::ScaleBias PlainOffsetScale;
+	module::Add Plains;
+	module::Select Highlands;
+	module::Blend Lowlands;
+	module::Add Elevation;
+	module::Exponent Final;
+
+	//bUseCache为false时不使用Cache，共享的子图在模块树中被重复求值
+	explicit TerrainGraph(bool bUseCache)
+	{
+		ContinentNoise.SetOctaveCount(8);
+		ContinentNoise.SetLacunarity(2.208984375);
+		ContinentCurve.SetSourceModule(0, ContinentNoise);
+		ContinentCurve.AddControlPoint(-2.0, -1.625);
+		ContinentCurve.AddControlPoint(-1.0, -1.375);
+		ContinentCurve.AddControlPoint(0.0, -0.375);
+		ContinentCurve.AddControlPoint(0.0625, 0.125);
+		ContinentCurve.AddControlPoint(0.25, 0.25);
+		ContinentCurve.AddControlPoint(1.0, 0.5);
+		ContinentCurve.AddControlPoint(2.0, 0.5);
+		CarverNoise.SetFrequency(4.34375);
+		CarverNoise.SetOctaveCount(6);
+		CarverNoise.SetLacunarity(2.208984375);
+		CarverScale.SetSourceModule(0, CarverNoise);
+		CarverScale.SetScale(0.375);
+		CarverScale.SetBias(0.625);
+		CarvedContinent.SetSourceModule(0, CarverScale);
+		CarvedContinent.SetSourceModule(1, ContinentCurve);
+		ClampedContinent.SetSourceModule(0, CarvedContinent);
+		ClampedContinent.SetBounds(-1.0, 1.0);
+		Continent.SetSourceModule(0, ClampedContinent);
+		const module::Module& continent = bUseCache ? (const module::Module&)Continent : ClampedContinent;
+
+		ContinentTurbulence.SetSourceModule(0, continent);
+		ContinentTurbulence.SetSeed(1);
+		ContinentTurbulence.SetFrequency(15.25);
+		ContinentTurbulence.SetPower(1.0 / 113.75);
+		ContinentTurbulence.SetRoughness(4);
+		ContinentEdge.SetSourceModule(0, continent);
+		ContinentEdge.SetSourceModule(1, ContinentTurbulence);
+		ContinentEdge.SetControlModule(continent);
+		ContinentEdge.SetBounds(-0.0375, 1000.0375);
+		ContinentEdge.SetEdgeFalloff(0.0625);
+		ContinentDef.SetSourceModule(0, ContinentEdge);
+		const module::Module& continentDef = bUseCache ? (const module::Module&)ContinentDef : ContinentEdge;
+
+		TerrainTypeTurbulence.SetSourceModule(0, continentDef);
+		TerrainTypeTurbulence.SetSeed(2);
+		TerrainTypeTurbulence.SetFrequency(18.125);
+		TerrainTypeTurbulence.SetPower(1.0 / 20.59375);
+		TerrainTypeTurbulence.SetRoughness(3);
+		TerrainTypeTerrace.SetSourceModule(0, TerrainTypeTurbulence);
+		TerrainTypeTerrace.AddControlPoint(-1.0);
+		TerrainTypeTerrace.AddControlPoint(0.25);
+		TerrainTypeTerrace.AddControlPoint(0.5);
+		TerrainTypeTerrace.AddControlPoint(1.0);
+		TerrainTypeTerrace.InvertTerraces(true);
+		TerrainType.SetSourceModule(0, TerrainTypeTerrace);
+		const module::Module& terrainType = bUseCache ? (const module::Module&)TerrainType : TerrainTypeTerrace;
+
+		MountainNoise.SetFrequency(1723.0 / 1000.0);
+		MountainNoise.SetOctaveCount(6);
+		Mountains.SetSourceModule(0, MountainNoise);
+		Mountains.SetScale(0.5);
+		Mountains.SetBias(0.375);
+		HillNoise.SetFrequency(1663.0 / 1000.0);
+		HillNoise.SetOctaveCount(6);
+		Hills.SetSourceModule(0, HillNoise);
+		Hills.SetScale(0.5);
+		Hills.SetBias(0.0625);
+		//与HillNoise参数相同的另一个模块
+		PlainNoise.SetFrequency(1663.0 / 1000.0);
+		PlainNoise.SetOctaveCount(6);
+		PlainScale.SetSourceModule(0, PlainNoise);
+		PlainScale.SetScale(0.125);
+		PlainScale.SetBias(0.0);
+		//常量链在编译时折叠
+		PlainOffset.SetConstValue(0.5);
+		PlainOffsetScale.SetSourceModule(0, PlainOffset);
+		PlainOffsetScale.SetScale(0.25);
+		PlainOffsetScale.SetBias(-0.125);
+		Plains.SetSourceModule(0, PlainScale);
+		Plains.SetSourceModule(1, PlainOffsetScale);
+
+		Highlands.SetSourceModule(0, Hills);
+		Highlands.SetSourceModule(1, Mountains);
+		Highlands.SetControlModule(terrainType);
+		Highlands.SetBounds(0.25, 1000.0);
+		Highlands.SetEdgeFalloff(0.25);
+		Lowlands.SetSourceModule(0, Plains);
+		Lowlands.SetSourceModule(1, Highlands);
+		Lowlands.SetControlModule(continentDef);
+		Elevation.SetSourceModule(0, Lowlands);
+		Elevation.SetSourceModule(1, continentDef);
+		Final.SetSourceModule(0, Elevation);
+		Final.SetExponent(1.25);
+	}
+};
+
+//比较模块树逐点求值、模块树批量求值与编译后的程序
+static double RunProgram(const SamplePoints& points, bool bUseCache)
+{
+	TerrainGraph graph(bUseCache);
+	const module::Module& source = graph.Final;
+	int32_t num = points.Num();
+	std::vector<double> scalarValues(num);
+	std::vector<double> batchValues(num);
+	std::vector<double> programValues(num);
+
+	Clock::time_point compileStart = Clock::now();
+	NoiseProgram program;
+	program.Compile(source);
+	double compileSeconds = ElapsedSeconds(compileStart);
+
+	Clock::time_point scalarStart = Clock::now();
+	for (int32_t i = 0; i < num; ++i)
+		scalarValues[i] = source.GetValue(points.X[i], points.Y[i], points.Z[i]);
+	double scalarSeconds = ElapsedSeconds(scalarStart);
+
+	Clock::time_point batchStart = Clock::now();
+	source.GetValues(&points.X[0], &points.Y[0], &points.Z[0], &batchValues[0], num);
+	double batchSeconds = ElapsedSeconds(batchStart);
+
+	Clock::time_point programStart = Clock::now();
+	program.GetValues(&points.X[0], &points.Y[0], &points.Z[0], &programValues[0], num);
+	double programSeconds = ElapsedSeconds(programStart);
+
+	double maxDiff = 0;
+	for (int32_t i = 0; i < num; ++i)
+	{
+		maxDiff = std::max(maxDiff, fabs(scalarValues[i] - batchValues[i]));
+		maxDiff = std::max(maxDiff, fabs(scalarValues[i] - programValues[i]));
+	}
+
+	printf("  %-12s %zu ops, %d registers, compiled in %.3f ms\n", "program", program.GetOps().size(), program.GetNumRegisters(),
+		compileSeconds * 1e3);
+	printf("  %-12s GetValue %8.2f Mpts/s  GetValues %8.2f Mpts/s  program %8.2f Mpts/s  speedup %5.2fx / %5.2fx  max diff %g\n",
+		bUseCache ? "terrain" : "terrain/nc", num / scalarSeconds * 1e-6, num / batchSeconds * 1e-6, num / programSeconds * 1e-6, scalarSeconds / programSeconds,
+		batchSeconds / programSeconds, maxDiff);
+	return maxDiff;
+}
+
+//回调按行的顺序调用时，NextCallbackRow等于已完成的行数
+static int32_t NextCallbackRow = 0;
+
+static bool bCallbackInOrder = true;
+
+static void OnRowBuilt(int row)
+{
+	bCallbackInOrder = bCallbackInOrder && row == NextCallbackRow;
+	++NextCallbackRow;
+}
+
+//多线程构建平面、球面、柱面噪声图，与单线程的结果逐点比较
+static double RunParallelBuild(utils::NoiseMapBuilder& builder, const char* name, int32_t size, int32_t threads)
+{
+	utils::NoiseMap serialMap;
+	utils::NoiseMap parallelMap;
+	builder.SetDestSize(size, size);
+	builder.SetCallback(OnRowBuilt);
+
+	NextCallbackRow = 0;
+	builder.SetThreadCount(1);
+	builder.SetDestNoiseMap(serialMap);
+	Clock::time_point serialStart = Clock::now();
+	builder.Build();
+	double serialSeconds = ElapsedSeconds(serialStart);
+
+	NextCallbackRow = 0;
+	builder.SetThreadCount(threads);
+	builder.SetDestNoiseMap(parallelMap);
+	Clock::time_point parallelStart = Clock::now();
+	builder.Build();
+	double parallelSeconds = ElapsedSeconds(parallelStart);
+
+	double maxDiff = bCallbackInOrder && NextCallbackRow == size ? 0 : 1;
+	for (int32_t y = 0; y < size; ++y)
+		maxDiff = std::max(maxDiff, memcmp(serialMap.GetConstSlabPtr(y), parallelMap.GetConstSlabPtr(y), size * sizeof(float)) == 0 ? 0.0 : 1.0);
+	printf("  %-12s 1 thread %8.3f s  %d threads %8.3f s  speedup %5.2fx  callbacks %s  %s\n", name, serialSeconds, threads,
+		parallelSeconds, serialSeconds / parallelSeconds, bCallbackInOrder ? "in order" : "OUT OF ORDER",
+		maxDiff == 0 ? "identical" : "DIFFERENT");
+	builder.SetCallback(NULL);
+	return maxDiff;
+}
+
+//批量求值可用的指令集，下标与noise::BatchInstructionSet一致
+static const char* InstructionSetNames[] = { "none", "sse4.1", "avx2" };
+
+static int ParseInstructionSet(const std::string& name)
+{
+	for (int i = 0; i < (int)(sizeof(InstructionSetNames) / sizeof(InstructionSetNames[0])); i++)
+	{
+		if (name == InstructionSetNames[i])
+			return i;
+	}
+	return -1;
+}
+
+int main(int argc, char** argv)
+{
+	int32_t size = 256;
+	int32_t repeat = 4;
+	int32_t threads = std::max(int32_t(std::thread::hardware_concurrency()), 2);
+	int32_t mapSize = 1024;
+	double frequency = 1.0 / 32.0;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-size" && i + 1 < argc)
+			size = atoi(argv[++i]);
+		else if (arg == "-repeat" && i + 1 < argc)
+			repeat = atoi(argv[++i]);
+		else if (arg == "-threads" && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (arg == "-map" && i + 1 < argc)
+			mapSize = atoi(argv[++i]);
+		else if (arg == "-simd" && i + 1 < argc && ParseInstructionSet(argv[i + 1]) >= 0)
+			noise::LimitBatchInstructionSet((noise::BatchInstructionSet)ParseInstructionSet(argv[++i]));
+		else
+		{
+			printf("usage: noisebench [-size pointsPerAxis] [-repeat times] [-threads buildThreads] [-map noiseMapSize] [-simd none|sse4.1|avx2]\n");
+			return 1;
+		}
+	}
+
+	printf("noise: %d x %d points, repeated %d times, SIMD %s\n", size, size, repeat, InstructionSetNames[noise::GetBatchInstructionSet()]);
+	SamplePoints points(size, frequency);
+
+	module::Perlin perlin;
+	module::Billow billow;
+	module::RidgedMulti ridgedMulti;
+	module::Voronoi voronoi;
+	voronoi.EnableDistance(true);
+
+	//组合模块：选择、缩放、扰动
+	module::ScaleBias flatTerrain;
+	flatTerrain.SetSourceModule(0, billow);
+	flatTerrain.SetScale(0.125);
+	flatTerrain.SetBias(-0.75);
+	module::Select terrainSelector;
+	terrainSelector.SetSourceModule(0, flatTerrain);
+	terrainSelector.SetSourceModule(1, ridgedMulti);
+	terrainSelector.SetControlModule(perlin);
+	terrainSelector.SetBounds(0.0, 1000.0);
+	terrainSelector.SetEdgeFalloff(0.125);
+	module::Turbulence finalTerrain;
+	finalTerrain.SetSourceModule(0, terrainSelector);
+	finalTerrain.SetFrequency(4.0);
+	finalTerrain.SetPower(0.125);
+
+	double maxDiff = 0;
+	maxDiff = std::max(maxDiff, RunModule("perlin", perlin, points, repeat));
+	maxDiff = std::max(maxDiff, RunModule("billow", billow, points, repeat));
+	maxDiff = std::max(maxDiff, RunModule("ridgedmulti", ridgedMulti, points, repeat));
+	maxDiff = std::max(maxDiff, RunModule("voronoi", voronoi, points, 1));
+	maxDiff = std::max(maxDiff, RunModule("graph", finalTerrain, points, 1));
+	printf("plane y = 0:\n");
+	maxDiff = std::max(maxDiff, RunModule2D("perlin", perlin, points, repeat));
+	maxDiff = std::max(maxDiff, RunModule2D("billow", billow, points, repeat));
+	maxDiff = std::max(maxDiff, RunModule2D("ridgedmulti", ridgedMulti, points, repeat));
+	maxDiff = std::max(maxDiff, RunModule2D("voronoi", voronoi, points, 1));
+	//扰动会把输入值移出平面，只能走三维路径；扰动之前的选择部分整个走二维路径
+	maxDiff = std::max(maxDiff, RunModule2D("select", terrainSelector, points, 1));
+	maxDiff = std::max(maxDiff, RunModule2D("graph", finalTerrain, points, 1));
+
+	maxDiff = std::max(maxDiff, RunProgram(points, true));
+	maxDiff = std::max(maxDiff, RunProgram(points, false));
+
+	module::Perlin heightModule;
+	heightModule.SetFrequency(frequency);
+	maxDiff = std::max(maxDiff, RunHeightMap(heightModule, 4096, 16));
+
+	//包含Cache的模块图，每个工作线程使用自己的求值上下文
+	TerrainGraph cachedTerrain(true);
+	utils::NoiseMapBuilderPlane planeBuilder;
+	planeBuilder.SetSourceModule(cachedTerrain.Final);
+	planeBuilder.SetBounds(-4.0, 4.0, -4.0, 4.0);
+	maxDiff = std::max(maxDiff, RunParallelBuild(planeBuilder, "plane", mapSize, threads));
+	utils::NoiseMapBuilderSphere sphereBuilder;
+	sphereBuilder.SetSourceModule(finalTerrain);
+	sphereBuilder.SetBounds(-90.0, 90.0, -180.0, 180.0);
+	maxDiff = std::max(maxDiff, RunParallelBuild(sphereBuilder, "sphere", mapSize, threads));
+	utils::NoiseMapBuilderCylinder cylinderBuilder;
+	cylinderBuilder.SetSourceModule(finalTerrain);
+	cylinderBuilder.SetBounds(-180.0, 180.0, -1.0, 1.0);
+	maxDiff = std::max(maxDiff, RunParallelBuild(cylinderBuilder, "cylinder", mapSize, threads));
+
+	//结果不一致时返回非0，便于脚本检查
+	return maxDiff == 0 ? 0 : 2;
+}
@@ -0,0 +1,1227 @@
+// voxelbench.cpp
+//
+// 体素核心的性能测试：生成并构建N*N个块的区域，输出吞吐量、每块内存以及延迟分位数
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "voxelcore.h"
+
+using namespace voxel;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct BenchOptions
+{
+	int32_t RegionSize;
+
+	int32_t Layers;
+
+	int32_t Threads;
+
+	GridParam Param;
+
+	MeshSettings Mesh;
+
+	//不为空时测试保存以及从区域文件重新读取
+	std::string StoreDirectory;
+
+	//流式加载时每帧取回数据以及构建网格各自的时间预算
+	double BudgetSeconds;
+
+	BenchOptions() : RegionSize(16), Layers(1), Threads(4), BudgetSeconds(HUGE_VAL)
+	{
+		Param.GridPerChunk = Int3(16, 16, 16);
+		Param.MaxHeight = 32;
+		Param.NoiseFrequency = 1.0 / 32.0;
+		Mesh.MaterialTypes.push_back(MT_Empty);
+		Mesh.MaterialTypes.push_back(MT_Opaque);
+	}
+};
+
+static double ElapsedSeconds(const Clock::time_point& start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//输出一组延迟(微秒)的分位数
+static void PrintLatency(const char* name, std::vector<double> samples)
+{
+	if (samples.empty())
+		return;
+	std::sort(samples.begin(), samples.end());
+	double total = 0;
+	for (size_t i = 0; i < samples.size(); ++i)
+		total += samples[i];
+	size_t last = samples.size() - 1;
+	printf("  %-10s latency us: mean %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f\n", name,
+		total / samples.size(), samples[last * 50 / 100], samples[last * 90 / 100], samples[last * 99 / 100], samples[last]);
+}
+
+static void PrintUsage()
+{
+	printf("usage: voxelbench [-n regionChunks] [-layers chunkLayers] [-size gridPerChunk] [-height maxHeight]\n");
+	printf("                  [-freq noiseFrequency] [-threads streamingThreads] [-greedy] [-noao] [-store directory]\n");
+	printf("                  [-budget frameBudgetMs]\n");
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-greedy")
+			options.Mesh.GreedyMeshing = true;
+		else if (arg == "-noao")
+			options.Mesh.AmbientOcclusion = false;
+		else if (arg == "-n" && hasValue)
+			options.RegionSize = atoi(argv[++i]);
+		else if (arg == "-layers" && hasValue)
+			options.Layers = atoi(argv[++i]);
+		else if (arg == "-size" && hasValue)
+			options.Param.GridPerChunk = Int3::Scalar(atoi(argv[++i]));
+		else if (arg == "-height" && hasValue)
+			options.Param.MaxHeight = atoi(argv[++i]);
+		else if (arg == "-freq" && hasValue)
+			options.Param.NoiseFrequency = atof(argv[++i]);
+		else if (arg == "-threads" && hasValue)
+			options.Threads = atoi(argv[++i]);
+		else if (arg == "-store" && hasValue)
+			options.StoreDirectory = argv[++i];
+		else if (arg == "-budget" && hasValue)
+			options.BudgetSeconds = atof(argv[++i]) * 1e-3;
+		else
+			return false;
+	}
+	//顶点坐标用uint8存储
+	return options.RegionSize > 0 && options.Layers > 0 && options.Param.GridPerChunk.X > 0 && options.Param.GridPerChunk.X <= 255;
+}
+
+//单线程逐块生成、逐块构建网格，得到每个块的延迟
+static void RunSerial(const BenchOptions& options)
+{
+	const Int3& gridPerChunk = options.Param.GridPerChunk;
+	ChunkWorld world(options.Param);
+	std::vector<Int3> coords;
+	for (int32_t x = 0; x < options.RegionSize; ++x)
+		for (int32_t y = 0; y < options.RegionSize; ++y)
+			for (int32_t z = 0; z < options.Layers; ++z)
+				coords.push_back(Int3(x, y, z) * gridPerChunk);
+
+	//同一列不同层的块共享高度场
+	HeightColumnCache columns(options.Param);
+	std::vector<double> generateLatency;
+	size_t storageBytes = 0;
+	size_t uniformChunks = 0;
+	Clock::time_point generateStart = Clock::now();
+	for (size_t i = 0; i < coords.size(); ++i)
+	{
+		Clock::time_point start = Clock::now();
+		ChunkDataPtr data = GenerateChunk(coords[i], options.Param, &columns);
+		generateLatency.push_back(ElapsedSeconds(start) * 1e6);
+		storageBytes += sizeof(ChunkData) + data->Grids.GetAllocatedSize();
+		uniformChunks += data->Grids.IsUniform() ? 1 : 0;
+		world.AddChunkData(data);
+	}
+	double generateSeconds = ElapsedSeconds(generateStart);
+
+	std::vector<double> meshLatency;
+	size_t triangles = 0;
+	size_t vertices = 0;
+	size_t occludedVertices = 0;
+	size_t maxChunkVertices = 0;
+	size_t wideIndexChunks = 0;
+	size_t facingTriangles = 0;
+	//观察点在区域中心，地表最高处
+	double viewPosition[3] = { options.RegionSize * gridPerChunk.X * 0.5, options.RegionSize * gridPerChunk.Y * 0.5, double(options.Param.MaxHeight) };
+	size_t skippedChunks = 0;
+	ChunkMesh mesh;
+	Clock::time_point meshStart = Clock::now();
+	for (size_t i = 0; i < coords.size(); ++i)
+	{
+		Clock::time_point start = Clock::now();
+		ChunkNeighbourhood neighbourhood;
+		world.GetNeighbourhood(coords[i], neighbourhood);
+		if (!HasNonEmptyGrid(*neighbourhood.GetCenter(), options.Mesh.MaterialTypes, Int3::Scalar(0), gridPerChunk))
+		{
+			++skippedChunks;
+			meshLatency.push_back(ElapsedSeconds(start) * 1e6);
+			continue;
+		}
+		PaddedChunkGrid grid;
+		neighbourhood.Gather(coords[i], coords[i] + gridPerChunk, GetPaddedGridScratch(), grid);
+		BuildChunkMesh(grid, gridPerChunk, options.Mesh, mesh);
+		meshLatency.push_back(ElapsedSeconds(start) * 1e6);
+		triangles += mesh.GetNumTriangles();
+		vertices += mesh.Vertices.size();
+		for (size_t j = 0; j < mesh.Vertices.size(); ++j)
+			occludedVertices += mesh.Vertices[j].AmbientOcclusionFactor < 255 ? 1 : 0;
+		maxChunkVertices = std::max(maxChunkVertices, mesh.Vertices.size());
+		wideIndexChunks += mesh.Requires32BitIndices() ? 1 : 0;
+		//只提交朝向观察点的面
+		double localView[3] = { viewPosition[0] - coords[i].X, viewPosition[1] - coords[i].Y, viewPosition[2] - coords[i].Z };
+		uint8_t facingMask = GetFacingFaceMask(localView, gridPerChunk);
+		for (size_t m = 0; m < mesh.MaterialBatches.size(); ++m)
+			for (int32_t face = 0; face < 6; ++face)
+				facingTriangles += (facingMask & (1 << face)) ? mesh.MaterialBatches[m].FaceBatches[face].Indices.size() / 3 : 0;
+	}
+	double meshSeconds = ElapsedSeconds(meshStart);
+
+	//同样的区域按各级细节层级构建网格，比较三角形数量与耗时，另外统计四个水平方向都加裙边时的三角形数量
+	size_t lodTriangles[MaxChunkLod + 1] = { triangles };
+	size_t lodSkirtTriangles[MaxChunkLod + 1] = { 0 };
+	double lodSeconds[MaxChunkLod + 1] = { meshSeconds };
+	for (int32_t lod = 1; lod <= MaxChunkLod; ++lod)
+	{
+		Clock::time_point lodStart = Clock::now();
+		for (int32_t skirts = 0; skirts < 2; ++skirts)
+		{
+			for (size_t i = 0; i < coords.size(); ++i)
+			{
+				ChunkNeighbourhood neighbourhood;
+				world.GetNeighbourhood(coords[i], neighbourhood);
+				if (!HasNonEmptyGrid(*neighbourhood.GetCenter(), options.Mesh.MaterialTypes, Int3::Scalar(0), gridPerChunk))
+					continue;
+				PaddedChunkGrid grid;
+				int32_t usedLod = GatherLodGrid(neighbourhood, coords[i], coords[i] + gridPerChunk, lod, skirts ? 0x0f : 0, options.Mesh.MaterialTypes, grid);
+				BuildChunkMesh(grid, gridPerChunk >> Int3::Scalar(usedLod), options.Mesh, mesh);
+				(skirts ? lodSkirtTriangles : lodTriangles)[lod] += mesh.GetNumTriangles();
+			}
+			if (!skirts)
+				lodSeconds[lod] = ElapsedSeconds(lodStart);
+		}
+	}
+
+	size_t numChunks = coords.size();
+	size_t rawBytes = size_t(gridPerChunk.Volume());
+	printf("serial: %zu chunks (%d x %d x %d of %d^3 grids), %s meshing, ambient occlusion %s\n", numChunks, options.RegionSize,
+		options.RegionSize, options.Layers, gridPerChunk.X, options.Mesh.GreedyMeshing ? "greedy" : "voxel",
+		options.Mesh.AmbientOcclusion ? "on" : "off");
+	printf("  generate   %10.1f chunks/s  (%zu height columns sampled, %zu resident)\n", numChunks / generateSeconds,
+		columns.GetNumBuiltColumns(), columns.GetNumResidentColumns());
+	printf("  mesh       %10.1f chunks/s  %12.1f triangles/s  (%zu triangles, %zu vertices, %zu empty chunks skipped)\n",
+		numChunks / meshSeconds, triangles / meshSeconds, triangles, vertices, skippedChunks);
+	printf("  occlusion  %10.1f%% of vertices occluded\n", vertices ? 100.0 * occludedVertices / vertices : 0.0);
+	printf("  indices    %10zu max vertices/chunk  (%zu chunks need 32-bit indices)\n", maxChunkVertices, wideIndexChunks);
+	printf("  culling    %10.1f%% of triangles face a viewer above the region centre\n", triangles ? 100.0 * facingTriangles / triangles : 0.0);
+	for (int32_t lod = 1; lod <= MaxChunkLod; ++lod)
+	{
+		printf("  lod %d      %10.1f chunks/s  %12zu triangles  (%.1f%% of full resolution, %.1f%% with skirts on all sides)\n", lod,
+			numChunks / lodSeconds[lod], lodTriangles[lod], triangles ? 100.0 * lodTriangles[lod] / triangles : 0.0,
+			triangles ? 100.0 * lodSkirtTriangles[lod] / triangles : 0.0);
+	}
+	printf("  storage    %10.1f bytes/chunk (raw %zu bytes/chunk, %zu uniform chunks)\n",
+		double(storageBytes) / numChunks, rawBytes, uniformChunks);
+	PrintLatency("generate", generateLatency);
+	PrintLatency("mesh", meshLatency);
+}
+
+//为每个块构建合并的碰撞盒，与每个格子一个碰撞体(每个格子一个方块Actor)对比数量，并校验碰撞盒恰好覆盖参与碰撞的格子。
+//再在格子上从高处向下扫掠角色大小的长方体，落点应在脚下最高的格子顶面
+static bool RunCollision(const BenchOptions& options)
+{
+	const Int3& gridPerChunk = options.Param.GridPerChunk;
+	const std::vector<MaterialType>& materialTypes = options.Mesh.MaterialTypes;
+	ChunkWorld world(options.Param);
+	world.SetCollisionMaterialTypes(materialTypes);
+	std::vector<ChunkDataPtr> chunks;
+	HeightColumnCache columns(options.Param);
+	for (int32_t x = 0; x < options.RegionSize; ++x)
+	{
+		for (int32_t y = 0; y < options.RegionSize; ++y)
+		{
+			for (int32_t z = 0; z < options.Layers; ++z)
+			{
+				chunks.push_back(GenerateChunk(Int3(x, y, z) * gridPerChunk, options.Param, &columns));
+				world.AddChunkData(chunks.back());
+			}
+		}
+	}
+
+	std::vector<CollisionBox> boxes;
+	size_t numBoxes = 0;
+	size_t solidGrids = 0;
+	size_t mismatches = 0;
+	double buildSeconds = 0;
+	std::vector<uint8_t> covered;
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		const ChunkData& data = *chunks[i];
+		Clock::time_point start = Clock::now();
+		BuildChunkCollision(data, materialTypes, boxes);
+		buildSeconds += ElapsedSeconds(start);
+		numBoxes += boxes.size();
+		covered.assign(gridPerChunk.Volume(), 0);
+		for (size_t b = 0; b < boxes.size(); ++b)
+			for (int32_t x = boxes[b].Min.X; x < boxes[b].Max.X; ++x)
+				for (int32_t y = boxes[b].Min.Y; y < boxes[b].Max.Y; ++y)
+					for (int32_t z = boxes[b].Min.Z; z < boxes[b].Max.Z; ++z)
+						++covered[data.GetIndex(Int3(x, y, z))];
+		for (int32_t g = 0; g < gridPerChunk.Volume(); ++g)
+		{
+			bool bSolid = IsSolidMaterial(materialTypes, data.Grids.Get(g));
+			solidGrids += bSolid ? 1 : 0;
+			mismatches += covered[g] != (bSolid ? 1 : 0) ? 1 : 0;
+		}
+	}
+
+	//角色的包围盒：0.6 x 0.6 x 1.8个格子
+	const int32_t numSweeps = 20000;
+	const double halfWidth = 0.3;
+	const double height = 1.8;
+	double top = options.Layers * gridPerChunk.Z + 2.0;
+	double extent = options.RegionSize * gridPerChunk.X - 1.0;
+	size_t sweepMismatches = 0;
+	uint32_t seed = 54321;
+	std::vector<double> starts;
+	for (int32_t i = 0; i < numSweeps * 2; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		starts.push_back(1.0 + (seed >> 8) * (1.0 / 16777216.0) * (extent - 2.0));
+	}
+	std::vector<SweepHit> hits(numSweeps);
+	std::vector<bool> bHits(numSweeps);
+	const double delta[3] = { 0, 0, -top };
+	Clock::time_point sweepStart = Clock::now();
+	for (int32_t i = 0; i < numSweeps; ++i)
+	{
+		double boxMin[3] = { starts[i * 2] - halfWidth, starts[i * 2 + 1] - halfWidth, top };
+		double boxMax[3] = { starts[i * 2] + halfWidth, starts[i * 2 + 1] + halfWidth, top + height };
+		bHits[i] = world.SweepBox(boxMin, boxMax, delta, hits[i]);
+	}
+	double sweepSeconds = ElapsedSeconds(sweepStart);
+	for (int32_t i = 0; i < numSweeps; ++i)
+	{
+		//脚下四列中最高的格子顶面
+		int32_t groundHeight = 0;
+		for (int32_t c = 0; c < 4; ++c)
+		{
+			int32_t x = int32_t(floor(starts[i * 2] + (c & 1 ? halfWidth : -halfWidth)));
+			int32_t y = int32_t(floor(starts[i * 2 + 1] + (c & 2 ? halfWidth : -halfWidth)));
+			for (int32_t z = int32_t(top) - 1; z >= groundHeight; --z)
+			{
+				if (IsSolidMaterial(materialTypes, world.GetMaterialIndex(Int3(x, y, z))))
+				{
+					groundHeight = z + 1;
+					break;
+				}
+			}
+		}
+		double landing = top + delta[2] * hits[i].Time;
+		bool bExpectHit = groundHeight > 0;
+		if (bHits[i] != bExpectHit || (bHits[i] && (fabs(landing - groundHeight) > 1e-9 || hits[i].FaceIndex != 4)))
+			++sweepMismatches;
+	}
+
+	//流式加载时碰撞在后台构建，同一帧改动两次只重建一次
+	std::vector<std::function<void()> > jobs;
+	GridParam param = options.Param;
+	ChunkWorld streamingWorld(param, [&jobs](const std::function<void()>& job) { jobs.push_back(job); });
+	streamingWorld.SetCollisionMaterialTypes(materialTypes);
+	ChunkViewer viewer;
+	viewer.CollisionDistance = options.RegionSize * gridPerChunk.X / 4;
+	int32_t viewerId = streamingWorld.AddViewer(viewer);
+	std::vector<Int3> enteredChunks;
+	std::vector<Int3> leftChunks;
+	std::vector<Int3> readyChunks;
+	std::vector<ChunkCollisionPtr> builtCollisions;
+	std::vector<Int3> removedChunks;
+	size_t numBuilt = 0;
+	size_t numRemoved = 0;
+	for (int32_t step = 0; step < 3; ++step)
+	{
+		if (step == 1)
+		{
+			streamingWorld.MarkChunkChanged(Int3(0, 0, 0));
+			streamingWorld.MarkChunkChanged(Int3(0, 0, 0));
+		}
+		if (step == 2)
+			streamingWorld.RemoveViewer(viewerId);
+		streamingWorld.UpdateViewers(enteredChunks, leftChunks);
+		while (!jobs.empty())
+		{
+			std::vector<std::function<void()> > runJobs;
+			runJobs.swap(jobs);
+			for (size_t j = 0; j < runJobs.size(); ++j)
+				runJobs[j]();
+			streamingWorld.ProcessCompletedTasks(readyChunks);
+			streamingWorld.DispatchGenerationTasks();
+		}
+		builtCollisions.clear();
+		removedChunks.clear();
+		streamingWorld.PopCollisionChanges(builtCollisions, removedChunks);
+		if (step == 0)
+			mismatches += builtCollisions.size() != streamingWorld.GetNumCollisionChunks() ? 1 : 0;
+		if (step == 1)
+			mismatches += builtCollisions.size() != 1 ? 1 : 0;
+		numBuilt += builtCollisions.size();
+		numRemoved += removedChunks.size();
+	}
+	mismatches += numRemoved != numBuilt - 1 ? 1 : 0;
+
+	printf("collision: %zu chunks, %zu solid grids\n", chunks.size(), solidGrids);
+	printf("  build      %10.1f chunks/s  (%.1f boxes/chunk, %.2f%% of one box per solid grid, %zu coverage mismatches)\n",
+		chunks.size() / buildSeconds, double(numBoxes) / chunks.size(), solidGrids ? 100.0 * numBoxes / solidGrids : 0.0, mismatches);
+	printf("  sweep      %10.1f sweeps/s  (character box falling %.0f grids, %zu wrong landings)\n", numSweeps / sweepSeconds, top, sweepMismatches);
+	printf("  streaming  %10zu collisions built in the background, %zu removed\n", numBuilt, numRemoved);
+	return mismatches == 0 && sweepMismatches == 0;
+}
+
+//与VoxelQuery::Raycast相同的遍历，但每个格子都用ChunkWorld::GetMaterialIndex按格子坐标查表，作为对比和校验
+static bool RaycastByGridLookup(const ChunkWorld& world, const VoxelRay& ray, RaycastHit& outHit)
+{
+	outHit = RaycastHit();
+	const std::vector<MaterialType>& materialTypes = world.GetCollisionMaterialTypes();
+	double length = sqrt(ray.Direction[0] * ray.Direction[0] + ray.Direction[1] * ray.Direction[1] + ray.Direction[2] * ray.Direction[2]);
+	Int3 grid;
+	int32_t step[3];
+	double nextBoundary[3];
+	double boundaryDelta[3];
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		double direction = ray.Direction[axis] / length;
+		grid[axis] = int32_t(floor(ray.Origin[axis]));
+		step[axis] = direction > 0 ? 1 : -1;
+		nextBoundary[axis] = direction == 0 ? HUGE_VAL : ((direction > 0 ? grid[axis] + 1.0 : double(grid[axis])) - ray.Origin[axis]) / direction;
+		boundaryDelta[axis] = direction == 0 ? HUGE_VAL : 1.0 / fabs(direction);
+	}
+	double distance = 0;
+	int32_t faceIndex = -1;
+	for (;;)
+	{
+		if (IsSolidMaterial(materialTypes, world.GetMaterialIndex(grid)) && world.FindChunkData(GetChunkCoordinate(grid, world.GetParam().GridPerChunk)))
+		{
+			outHit.bHit = true;
+			outHit.Distance = distance;
+			outHit.GridCoord = grid;
+			outHit.FaceIndex = faceIndex;
+			return true;
+		}
+		int32_t axis = nextBoundary[0] < nextBoundary[1] ? (nextBoundary[0] < nextBoundary[2] ? 0 : 2) : (nextBoundary[1] < nextBoundary[2] ? 1 : 2);
+		distance = nextBoundary[axis];
+		if (distance > ray.MaxDistance)
+			return false;
+		nextBoundary[axis] += boundaryDelta[axis];
+		grid[axis] += step[axis];
+		faceIndex = axis * 2 + (step[axis] > 0 ? 1 : 0);
+	}
+}
+
+//随机的射线：起点在地表附近，方向在球面上均匀分布。比较逐格查表、逐块查表以及批量检测的吞吐量，并与逐格查表的结果校验
+static bool RunQueries(const BenchOptions& options)
+{
+	const Int3& gridPerChunk = options.Param.GridPerChunk;
+	ChunkWorld world(options.Param);
+	world.SetCollisionMaterialTypes(options.Mesh.MaterialTypes);
+	HeightColumnCache columns(options.Param);
+	for (int32_t x = 0; x < options.RegionSize; ++x)
+		for (int32_t y = 0; y < options.RegionSize; ++y)
+			for (int32_t z = 0; z < options.Layers; ++z)
+				world.AddChunkData(GenerateChunk(Int3(x, y, z) * gridPerChunk, options.Param, &columns));
+
+	const int32_t numRays = 20000;
+	double extent = options.RegionSize * gridPerChunk.X;
+	double top = std::min(options.Layers * gridPerChunk.Z, options.Param.MaxHeight);
+	uint32_t seed = 24680;
+	std::function<double()> random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) * (1.0 / 16777216.0);
+	};
+	size_t mismatches = 0;
+	printf("queries: %d random rays from near the surface over %zu chunks\n", numRays, world.GetNumChunks());
+	const double lengths[2] = { 8.0, 128.0 };
+	for (int32_t l = 0; l < 2; ++l)
+	{
+		std::vector<VoxelRay> rays(numRays);
+		for (int32_t i = 0; i < numRays; ++i)
+		{
+			VoxelRay& ray = rays[i];
+			ray.Origin[0] = random() * extent;
+			ray.Origin[1] = random() * extent;
+			ray.Origin[2] = top * 0.5 + random() * top;
+			double z = random() * 2.0 - 1.0;
+			double angle = random() * 2.0 * M_PI;
+			double radius = sqrt(1.0 - z * z);
+			ray.Direction[0] = radius * cos(angle);
+			ray.Direction[1] = radius * sin(angle);
+			ray.Direction[2] = z;
+			ray.MaxDistance = lengths[l];
+		}
+
+		std::vector<RaycastHit> referenceHits(numRays);
+		Clock::time_point lookupStart = Clock::now();
+		for (int32_t i = 0; i < numRays; ++i)
+			RaycastByGridLookup(world, rays[i], referenceHits[i]);
+		double lookupSeconds = ElapsedSeconds(lookupStart);
+
+		//按生成的顺序逐条检测，相邻射线的起点不在同一个块
+		std::vector<RaycastHit> singleHits(numRays);
+		Clock::time_point singleStart = Clock::now();
+		VoxelQuery singleQuery(world);
+		for (int32_t i = 0; i < numRays; ++i)
+			singleQuery.Raycast(rays[i], singleHits[i]);
+		double singleSeconds = ElapsedSeconds(singleStart);
+
+		std::vector<RaycastHit> batchHits;
+		Clock::time_point batchStart = Clock::now();
+		VoxelQuery batchQuery(world);
+		size_t numHits = batchQuery.RaycastBatch(rays, batchHits);
+		double batchSeconds = ElapsedSeconds(batchStart);
+
+		for (int32_t i = 0; i < numRays; ++i)
+		{
+			const RaycastHit& reference = referenceHits[i];
+			for (int32_t k = 0; k < 2; ++k)
+			{
+				const RaycastHit& hit = k ? batchHits[i] : singleHits[i];
+				if (hit.bHit != reference.bHit || (hit.bHit && (hit.GridCoord != reference.GridCoord || hit.FaceIndex != reference.FaceIndex)))
+					++mismatches;
+			}
+		}
+		printf("  ray %-5.0f  %10.0f rays/s by grid lookup  %10.0f rays/s by chunk  %10.0f rays/s batched  (%.1f%% hit, %.2f / %.2f chunk lookups/ray)\n",
+			lengths[l], numRays / lookupSeconds, numRays / singleSeconds, numRays / batchSeconds, 100.0 * numHits / numRays,
+			double(singleQuery.GetNumChunkLookups()) / numRays, double(batchQuery.GetNumChunkLookups()) / numRays);
+	}
+
+	//重叠查询与逐格查表的结果对比
+	const int32_t numOverlaps = 20000;
+	VoxelQuery query(world);
+	std::vector<Int3> grids;
+	size_t sphereHits = 0;
+	size_t boxHits = 0;
+	double sphereSeconds = 0;
+	double boxSeconds = 0;
+	for (int32_t i = 0; i < numOverlaps; ++i)
+	{
+		double center[3] = { random() * extent, random() * extent, top * 0.5 + random() * top * 0.5 };
+		double radius = 0.5 + random() * 2.0;
+		double boxMin[3] = { center[0] - 0.3, center[1] - 0.3, center[2] - 0.9 };
+		double boxMax[3] = { center[0] + 0.3, center[1] + 0.3, center[2] + 0.9 };
+		for (int32_t k = 0; k < 2; ++k)
+		{
+			grids.clear();
+			Clock::time_point start = Clock::now();
+			bool bAny = k ? query.OverlapBox(boxMin, boxMax) : query.OverlapSphere(center, radius);
+			(k ? boxSeconds : sphereSeconds) += ElapsedSeconds(start);
+			if (k)
+				query.OverlapBox(boxMin, boxMax, &grids);
+			else
+				query.OverlapSphere(center, radius, &grids);
+			(k ? boxHits : sphereHits) += bAny ? 1 : 0;
+			size_t expected = 0;
+			double reach = k ? 1.0 : radius + 1.0;
+			for (int32_t x = int32_t(floor(center[0] - reach)); x <= int32_t(floor(center[0] + reach)); ++x)
+			{
+				for (int32_t y = int32_t(floor(center[1] - reach)); y <= int32_t(floor(center[1] + reach)); ++y)
+				{
+					for (int32_t z = int32_t(floor(center[2] - reach - 1.0)); z <= int32_t(floor(center[2] + reach + 1.0)); ++z)
+					{
+						if (!IsSolidMaterial(world.GetCollisionMaterialTypes(), world.GetMaterialIndex(Int3(x, y, z))))
+							continue;
+						const double gridMin[3] = { double(x), double(y), double(z) };
+						bool bOverlap = true;
+						double distanceSquared = 0;
+						for (int32_t axis = 0; axis < 3; ++axis)
+						{
+							bOverlap = bOverlap && gridMin[axis] < boxMax[axis] && gridMin[axis] + 1.0 > boxMin[axis];
+							double nearest = std::min(std::max(center[axis], gridMin[axis]), gridMin[axis] + 1.0);
+							distanceSquared += (nearest - center[axis]) * (nearest - center[axis]);
+						}
+						expected += (k ? bOverlap : distanceSquared < radius * radius) ? 1 : 0;
+					}
+				}
+			}
+			mismatches += grids.size() != expected || bAny != (expected > 0) ? 1 : 0;
+		}
+	}
+	printf("  overlap    %10.0f spheres/s  %10.0f boxes/s  (%.1f%% / %.1f%% touch terrain, %zu mismatches with grid lookup)\n",
+		numOverlaps / sphereSeconds, numOverlaps / boxSeconds, 100.0 * sphereHits / numOverlaps, 100.0 * boxHits / numOverlaps, mismatches);
+	return mismatches == 0;
+}
+
+//按游戏中的方式流式加载：观察点在区域中心，后台线程生成或读取，主线程轮询取回并构建网格，返回耗时。
+//与UE中一样，新就绪的块构建网格，已有网格的块只在标记为过期时重建。每次轮询相当于一帧，
+//取回数据与构建网格各自超出budgetSeconds后留到下一帧，outMaxFrameSeconds为单帧中这两部分耗时之和的最大值
+static double StreamRegion(ChunkWorld& world, const MeshSettings& meshSettings, double budgetSeconds, size_t& outTriangles, size_t& outRemeshes,
+	double& outMaxFrameSeconds)
+{
+	const GridParam& param = world.GetParam();
+	Clock::time_point start = Clock::now();
+	world.Update(Int3(0, 0, 0));
+	size_t renderChunks = world.GetRenderChunks().size();
+	std::unordered_set<Int3, Int3Hash> meshedChunks;
+	outTriangles = 0;
+	outRemeshes = 0;
+	outMaxFrameSeconds = 0;
+	std::vector<Int3> readyChunks;
+	std::vector<Int3> dirtyChunks;
+	//等待构建网格的块，按加入的顺序构建
+	std::deque<Int3> pendingBuilds;
+	std::unordered_set<Int3, Int3Hash> pendingChunks;
+	ChunkMesh mesh;
+	while (meshedChunks.size() < renderChunks)
+	{
+		Clock::time_point frameStart = Clock::now();
+		readyChunks.clear();
+		world.ProcessCompletedTasks(readyChunks, budgetSeconds);
+		double handOffSeconds = ElapsedSeconds(frameStart);
+		world.DispatchGenerationTasks();
+		dirtyChunks.clear();
+		world.PopDirtyMeshes(dirtyChunks);
+		for (size_t i = 0; i < readyChunks.size(); ++i)
+		{
+			if (meshedChunks.count(readyChunks[i]) == 0 && pendingChunks.insert(readyChunks[i]).second)
+				pendingBuilds.push_back(readyChunks[i]);
+		}
+		//还在等待构建的块不用重复构建
+		for (size_t i = 0; i < dirtyChunks.size(); ++i)
+		{
+			if (meshedChunks.count(dirtyChunks[i]) != 0 && pendingChunks.insert(dirtyChunks[i]).second)
+			{
+				pendingBuilds.push_back(dirtyChunks[i]);
+				++outRemeshes;
+			}
+		}
+		if (pendingBuilds.empty() && world.GetNumArrivedChunks() == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			continue;
+		}
+		Clock::time_point buildStart = Clock::now();
+		for (bool bFirst = true; !pendingBuilds.empty() && (bFirst || ElapsedSeconds(buildStart) < budgetSeconds); bFirst = false)
+		{
+			Int3 coord = pendingBuilds.front();
+			pendingBuilds.pop_front();
+			pendingChunks.erase(coord);
+			ChunkNeighbourhood neighbourhood;
+			world.GetNeighbourhood(coord, neighbourhood);
+			PaddedChunkGrid grid;
+			neighbourhood.Gather(coord, coord + param.GridPerChunk, GetPaddedGridScratch(), grid);
+			BuildChunkMesh(grid, param.GridPerChunk, meshSettings, mesh);
+			outTriangles += mesh.GetNumTriangles();
+			meshedChunks.insert(coord);
+		}
+		outMaxFrameSeconds = std::max(outMaxFrameSeconds, handOffSeconds + ElapsedSeconds(buildStart));
+	}
+	return ElapsedSeconds(start);
+}
+
+static GridParam GetStreamingParam(const BenchOptions& options)
+{
+	GridParam param = options.Param;
+	param.MaxGenerationTasks = options.Threads;
+	param.MaxRenderDistance = options.RegionSize * param.GridPerChunk.X / 2;
+	return param;
+}
+
+static void RunStreaming(const BenchOptions& options)
+{
+	ChunkWorld world(GetStreamingParam(options));
+	size_t triangles = 0;
+	size_t remeshes = 0;
+	double maxFrameSeconds = 0;
+	double seconds = StreamRegion(world, options.Mesh, options.BudgetSeconds, triangles, remeshes, maxFrameSeconds);
+	size_t renderChunks = world.GetRenderChunks().size();
+	printf("streaming: %zu render chunks, %zu data chunks, %d generation threads\n", renderChunks, world.GetNumChunks(), options.Threads);
+	printf("  total      %10.1f chunks/s  %12.1f triangles/s  (%.3f s, %zu remeshes)\n", renderChunks / seconds, triangles / seconds, seconds, remeshes);
+	printf("  frame      %10.2f ms max hand-off + meshing per poll  (budget %.2f ms for hand-off and for meshing)\n", maxFrameSeconds * 1e3,
+		options.BudgetSeconds * 1e3);
+	printf("  storage    %10.1f bytes/chunk\n", double(world.GetAllocatedSize()) / world.GetNumChunks());
+
+	//观察点不动时每次更新都不应该重建网格，改动一个块只重建它和面相邻的块
+	const int32_t steadyUpdates = 100;
+	size_t steadyRemeshes = 0;
+	std::vector<Int3> readyChunks;
+	std::vector<Int3> dirtyChunks;
+	Clock::time_point steadyStart = Clock::now();
+	for (int32_t i = 0; i < steadyUpdates; ++i)
+	{
+		world.Update(Int3(0, 0, 0));
+		readyChunks.clear();
+		world.ProcessCompletedTasks(readyChunks);
+		dirtyChunks.clear();
+		world.PopDirtyMeshes(dirtyChunks);
+		steadyRemeshes += readyChunks.size() + dirtyChunks.size();
+	}
+	double steadySeconds = ElapsedSeconds(steadyStart);
+	world.MarkChunkChanged(Int3(0, 0, 0));
+	dirtyChunks.clear();
+	world.PopDirtyMeshes(dirtyChunks);
+	printf("  steady     %10.1f us/update  (%zu remeshes in %d updates, %zu remeshes after changing one chunk)\n",
+		steadySeconds / steadyUpdates * 1e6, steadyRemeshes, steadyUpdates, dirtyChunks.size());
+}
+
+//与UE中一样为显示块请求后台构建网格，世界边界上的块只构建边界内的部分
+static void RequestChunkMesh(const ChunkWorld& world, const MeshSettings& meshSettings, const Int3& coord, ChunkMeshQueue& queue)
+{
+	const GridParam& param = world.GetParam();
+	ChunkNeighbourhood neighbourhood;
+	world.GetNeighbourhood(coord, neighbourhood);
+	Int3 minCoordinate = Int3::Max(param.MinCoordinate, coord);
+	Int3 maxCoordinate = Int3::Min(param.MaxCoordinate, coord + param.GridPerChunk);
+	queue.Request(neighbourhood, minCoordinate, maxCoordinate, world.GetChunkLod(coord), world.GetSkirtFaceMask(coord), meshSettings);
+}
+
+static bool IsSameMesh(const ChunkMesh& a, const ChunkMesh& b)
+{
+	if (a.Vertices.size() != b.Vertices.size() || a.MaterialBatches.size() != b.MaterialBatches.size())
+		return false;
+	if (!a.Vertices.empty() && memcmp(&a.Vertices[0], &b.Vertices[0], a.Vertices.size() * sizeof(GridVertex)) != 0)
+		return false;
+	for (size_t i = 0; i < a.MaterialBatches.size(); ++i)
+	{
+		for (int32_t j = 0; j < 6; ++j)
+		{
+			if (a.MaterialBatches[i].FaceBatches[j].Indices != b.MaterialBatches[i].FaceBatches[j].Indices)
+				return false;
+		}
+	}
+	return true;
+}
+
+//在观察者附近每帧挖几个球形的坑并放下几个方块，网格与碰撞在后台重建，后台任务隔一帧才执行完，模拟重建慢于一帧的情况。
+//统计主线程每帧的耗时以及重建的块数，最后校验显示的网格与碰撞都与最终的数据一致，后台持有的快照不受修改影响
+static bool RunEditing(const BenchOptions& options)
+{
+	GridParam param = GetStreamingParam(options);
+	const Int3& gridPerChunk = param.GridPerChunk;
+	std::vector<std::function<void()> > jobs;
+	TaskDispatcher dispatcher = [&jobs](const std::function<void()>& job) { jobs.push_back(job); };
+	ChunkWorld world(param, dispatcher);
+	world.SetCollisionMaterialTypes(options.Mesh.MaterialTypes);
+	ChunkMeshQueue meshQueue(dispatcher);
+	ChunkViewer viewer;
+	viewer.RenderDistance = param.MaxRenderDistance;
+	viewer.CollisionDistance = param.MaxRenderDistance / 2;
+	world.AddViewer(viewer);
+
+	std::unordered_map<Int3, BuiltChunkMeshPtr, Int3Hash> displayedMeshes;
+	std::unordered_map<Int3, ChunkCollisionPtr, Int3Hash> collisions;
+	std::unordered_set<Int3, Int3Hash> pendingMeshes;
+	std::vector<Int3> enteredChunks;
+	std::vector<Int3> leftChunks;
+	std::vector<Int3> readyChunks;
+	std::vector<Int3> dirtyChunks;
+	std::vector<BuiltChunkMeshPtr> builtMeshes;
+	std::vector<ChunkCollisionPtr> builtCollisions;
+	std::vector<Int3> removedCollisions;
+	size_t numRequests = 0;
+	size_t numApplied = 0;
+	//一帧中主线程的部分：取回结果，为过期的块请求重建，上一次请求还没完成的块留到之后的帧
+	std::function<void()> runFrame = [&]() {
+		readyChunks.clear();
+		world.ProcessCompletedTasks(readyChunks);
+		pendingMeshes.insert(readyChunks.begin(), readyChunks.end());
+		dirtyChunks.clear();
+		world.PopDirtyMeshes(dirtyChunks);
+		pendingMeshes.insert(dirtyChunks.begin(), dirtyChunks.end());
+		for (std::unordered_set<Int3, Int3Hash>::iterator it = pendingMeshes.begin(); it != pendingMeshes.end(); )
+		{
+			if (meshQueue.IsRequested(*it))
+			{
+				++it;
+				continue;
+			}
+			RequestChunkMesh(world, options.Mesh, *it, meshQueue);
+			++numRequests;
+			it = pendingMeshes.erase(it);
+		}
+		builtMeshes.clear();
+		meshQueue.PopCompleted(builtMeshes);
+		for (size_t i = 0; i < builtMeshes.size(); ++i)
+			displayedMeshes[builtMeshes[i]->Coordinate] = builtMeshes[i];
+		numApplied += builtMeshes.size();
+		builtCollisions.clear();
+		removedCollisions.clear();
+		world.PopCollisionChanges(builtCollisions, removedCollisions);
+		for (size_t i = 0; i < removedCollisions.size(); ++i)
+			collisions.erase(removedCollisions[i]);
+		for (size_t i = 0; i < builtCollisions.size(); ++i)
+			collisions[builtCollisions[i]->Coordinate] = builtCollisions[i];
+		world.DispatchGenerationTasks();
+	};
+	std::function<double()> runJobs = [&jobs]() {
+		Clock::time_point start = Clock::now();
+		while (!jobs.empty())
+		{
+			std::vector<std::function<void()> > runJobs;
+			runJobs.swap(jobs);
+			for (size_t j = 0; j < runJobs.size(); ++j)
+				runJobs[j]();
+		}
+		return ElapsedSeconds(start);
+	};
+	world.UpdateViewers(enteredChunks, leftChunks);
+	while (!jobs.empty() || !pendingMeshes.empty() || meshQueue.GetNumRequested() > 0)
+	{
+		runJobs();
+		runFrame();
+	}
+	size_t loadRequests = numRequests;
+
+	//后台任务持有的修改前的快照
+	ChunkDataPtr snapshot = world.FindChunkData(Int3(0, 0, 0));
+	ChunkData snapshotCopy = *snapshot;
+
+	const int32_t numFrames = 120;
+	const int32_t digsPerFrame = 4;
+	const int32_t blocksPerFrame = 4;
+	int32_t editRange = std::max(viewer.CollisionDistance - gridPerChunk.X, gridPerChunk.X);
+	uint32_t seed = 97531;
+	std::function<int32_t(int32_t)> random = [&seed](int32_t range) {
+		seed = seed * 1664525u + 1013904223u;
+		return int32_t((seed >> 8) % uint32_t(range));
+	};
+	//格子所在列最高的非空白格子之上
+	std::function<int32_t(int32_t, int32_t)> getSurface = [&world, &gridPerChunk](int32_t x, int32_t y) {
+		int32_t z = gridPerChunk.Z - 1;
+		while (z > 0 && world.GetMaterialIndex(Int3(x, y, z)) == 0)
+			--z;
+		return z;
+	};
+	size_t numChanged = 0;
+	size_t numEdits = 0;
+	double maxFrameSeconds = 0;
+	double frameSeconds = 0;
+	double editSeconds = 0;
+	double backgroundSeconds = 0;
+	size_t requestsBefore = numRequests;
+	size_t appliedBefore = numApplied;
+	for (int32_t frame = 0; frame < numFrames; ++frame)
+	{
+		Clock::time_point frameStart = Clock::now();
+		for (int32_t i = 0; i < digsPerFrame; ++i)
+		{
+			int32_t x = frame == 0 && i == 0 ? 4 : random(editRange * 2) - editRange;
+			int32_t y = frame == 0 && i == 0 ? 4 : random(editRange * 2) - editRange;
+			double center[3] = { x + 0.5, y + 0.5, getSurface(x, y) + 0.5 };
+			numChanged += world.FillSphere(center, 2.5, 0);
+		}
+		for (int32_t i = 0; i < blocksPerFrame; ++i)
+		{
+			int32_t x = random(editRange * 2) - editRange;
+			int32_t y = random(editRange * 2) - editRange;
+			Int3 grid(x, y, std::min(getSurface(x, y) + 1, gridPerChunk.Z - 1));
+			numChanged += world.FillBox(grid, grid + Int3(1, 1, 0), 1);
+		}
+		numEdits += digsPerFrame + blocksPerFrame;
+		editSeconds += ElapsedSeconds(frameStart);
+		runFrame();
+		double seconds = ElapsedSeconds(frameStart);
+		frameSeconds += seconds;
+		maxFrameSeconds = std::max(maxFrameSeconds, seconds);
+		if (frame % 2 == 1)
+			backgroundSeconds += runJobs();
+	}
+	size_t frameRequests = numRequests - requestsBefore;
+	size_t frameApplied = numApplied - appliedBefore;
+	while (!jobs.empty() || !pendingMeshes.empty() || meshQueue.GetNumRequested() > 0)
+	{
+		runJobs();
+		runFrame();
+	}
+
+	//显示的网格以及碰撞与按最终的数据同步构建的结果比较
+	size_t mismatches = 0;
+	ChunkMeshQueue syncQueue([](const std::function<void()>& job) { job(); });
+	for (std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = world.GetRenderChunks().begin(); it != world.GetRenderChunks().end(); ++it)
+	{
+		std::unordered_map<Int3, BuiltChunkMeshPtr, Int3Hash>::const_iterator displayed = displayedMeshes.find(it->first);
+		if (displayed == displayedMeshes.end())
+		{
+			++mismatches;
+			continue;
+		}
+		RequestChunkMesh(world, options.Mesh, it->first, syncQueue);
+		builtMeshes.clear();
+		syncQueue.PopCompleted(builtMeshes);
+		mismatches += builtMeshes.size() != 1 || !IsSameMesh(builtMeshes[0]->Mesh, displayed->second->Mesh) ? 1 : 0;
+	}
+	std::vector<CollisionBox> boxes;
+	for (std::unordered_map<Int3, ChunkCollisionPtr, Int3Hash>::const_iterator it = collisions.begin(); it != collisions.end(); ++it)
+	{
+		BuildChunkCollision(*world.FindChunkData(it->first), options.Mesh.MaterialTypes, boxes);
+		bool bSame = boxes.size() == it->second->Boxes.size();
+		for (size_t i = 0; i < boxes.size() && bSame; ++i)
+			bSame = boxes[i].Min == it->second->Boxes[i].Min && boxes[i].Max == it->second->Boxes[i].Max;
+		mismatches += bSame ? 0 : 1;
+	}
+	mismatches += collisions.size() != world.GetNumCollisionChunks() ? 1 : 0;
+	bool bSnapshotKept = world.FindChunkData(Int3(0, 0, 0)) != snapshot;
+	for (int32_t i = 0; i < gridPerChunk.Volume() && bSnapshotKept; ++i)
+		bSnapshotKept = snapshot->Grids.Get(i) == snapshotCopy.Grids.Get(i);
+	mismatches += bSnapshotKept ? 0 : 1;
+
+	printf("editing: %d frames of %d dug spheres and %d placed blocks, %zu render chunks, background jobs finish every other frame\n",
+		numFrames, digsPerFrame, blocksPerFrame, world.GetRenderChunks().size());
+	printf("  main       %10.3f ms/frame avg  %8.3f ms max  (%.3f ms/frame editing, %zu grids changed)\n",
+		frameSeconds / numFrames * 1e3, maxFrameSeconds * 1e3, editSeconds / numFrames * 1e3, numChanged);
+	printf("  remesh     %10.2f requests/frame  %6.2f applied/frame  %6.2f chunks/edit  (%.3f ms/frame in the background, %zu to load)\n",
+		double(frameRequests) / numFrames, double(frameApplied) / numFrames, double(frameRequests) / numEdits,
+		backgroundSeconds / numFrames * 1e3, loadRequests);
+	printf("  verify     %10zu mismatches with meshes and collision built from the final data, snapshot %s\n",
+		mismatches, bSnapshotKept ? "unchanged" : "modified");
+	return mismatches == 0;
+}
+
+//校验流式加载的范围：加载半径内的块都在显示，显示的块都在卸载半径内，细节层级在滞后范围内稳定，驻留的数据不超过卸载半径，返回违反的数量
+static size_t CountStreamingViolations(const ChunkWorld& world, const Int3& viewPosition)
+{
+	const GridParam& param = world.GetParam();
+	const Int3& gridPerChunk = param.GridPerChunk;
+	Int3 viewCenter = FloorDivide(viewPosition, gridPerChunk) * gridPerChunk + gridPerChunk / Int3::Scalar(2);
+	int64_t renderDistance = param.MaxRenderDistance;
+	int64_t unloadDistance = renderDistance + param.StreamingHysteresis;
+	int64_t dataUnloadDistance = unloadDistance + std::max(gridPerChunk.X, gridPerChunk.Y);
+	int32_t range = int32_t(dataUnloadDistance / std::min(gridPerChunk.X, gridPerChunk.Y)) + 2;
+	Int3 viewIndex = FloorDivide(viewPosition, gridPerChunk);
+	size_t violations = 0;
+	size_t maxDataChunks = 0;
+	for (int32_t x = viewIndex.X - range; x <= viewIndex.X + range; ++x)
+	{
+		for (int32_t y = viewIndex.Y - range; y <= viewIndex.Y + range; ++y)
+		{
+			Int3 coord = Int3(x, y, 0) * gridPerChunk;
+			Int3 center = coord + gridPerChunk / Int3::Scalar(2);
+			int64_t dx = center.X - viewCenter.X;
+			int64_t dy = center.Y - viewCenter.Y;
+			int64_t distanceSquared = dx * dx + dy * dy;
+			maxDataChunks += distanceSquared < dataUnloadDistance * dataUnloadDistance ? 1 : 0;
+			bool bRender = world.IsRenderChunk(coord);
+			if (distanceSquared < renderDistance * renderDistance && !bRender)
+				++violations;
+			if (!bRender)
+				continue;
+			if (distanceSquared >= unloadDistance * unloadDistance)
+				++violations;
+			int32_t lod = world.GetChunkLod(coord);
+			if (SelectChunkLod(distanceSquared, lod, param) != lod)
+				++violations;
+		}
+	}
+	return violations + (world.GetNumChunks() > maxDataChunks ? 1 : 0);
+}
+
+//观察点斜向移动，每次跨过一个块。Update只处理两个圆之间变化的部分，与第一次更新整个范围的耗时对比，并校验每一步之后的范围
+static bool RunMoving(const BenchOptions& options)
+{
+	GridParam param = GetStreamingParam(options);
+	param.StreamingHysteresis = param.GridPerChunk.X;
+	param.LodDistances[0] = param.MaxRenderDistance / 2;
+	param.LodHysteresis = param.GridPerChunk.X / 2;
+	//生成任务先记下来，在计时之外的主线程上执行，避免后台线程抢占计时
+	std::vector<std::function<void()> > jobs;
+	ChunkWorld world(param, [&jobs](const std::function<void()>& job) { jobs.push_back(job); });
+	const int32_t steps = 64;
+	std::vector<Int3> enteredChunks;
+	std::vector<Int3> leftChunks;
+	std::vector<Int3> readyChunks;
+	size_t numEntered = 0;
+	size_t numLeft = 0;
+	size_t violations = 0;
+	double firstSeconds = 0;
+	double moveSeconds = 0;
+	for (int32_t i = 0; i < steps; ++i)
+	{
+		//运行中先放大再缩小半径和细节层级的分界，之后的范围按新的参数校验
+		if (i == steps / 3 || i == steps * 2 / 3)
+		{
+			GridParam newParam = world.GetParam();
+			newParam.MaxRenderDistance += (i == steps / 3 ? 2 : -3) * param.GridPerChunk.X;
+			newParam.LodDistances[0] = newParam.MaxRenderDistance / 3;
+			world.SetParam(newParam);
+		}
+		Int3 viewPosition = Int3(i, i / 2, 0) * param.GridPerChunk;
+		enteredChunks.clear();
+		leftChunks.clear();
+		Clock::time_point start = Clock::now();
+		world.Update(viewPosition, enteredChunks, leftChunks);
+		(i == 0 ? firstSeconds : moveSeconds) += ElapsedSeconds(start);
+		numEntered += i > 0 ? enteredChunks.size() : 0;
+		numLeft += leftChunks.size();
+		//等生成跟上再走下一步，与玩家正常行走时一样，每次只有新进入的圆环在排队
+		while (!jobs.empty())
+		{
+			std::vector<std::function<void()> > runJobs;
+			runJobs.swap(jobs);
+			for (size_t j = 0; j < runJobs.size(); ++j)
+				runJobs[j]();
+			world.DispatchGenerationTasks();
+		}
+		readyChunks.clear();
+		world.ProcessCompletedTasks(readyChunks);
+		violations += CountStreamingViolations(world, viewPosition);
+	}
+	printf("moving: %d steps across one chunk each, hysteresis %d grids, lod 1 beyond %d grids, render distance and lod changed at steps %d and %d\n",
+		steps, param.StreamingHysteresis, param.LodDistances[0], steps / 3, steps * 2 / 3);
+	printf("  update     %10.1f us/step  (first update %.1f us, %zu chunks entered, %zu left, %zu resident, %zu violations)\n",
+		moveSeconds / (steps - 1) * 1e6, firstSeconds * 1e6, numEntered, numLeft, world.GetNumChunks(), violations);
+	return violations == 0;
+}
+
+//校验多个观察者的范围：在某个观察者数据半径内的块都有数据，有数据的块都在某个观察者的卸载半径内，显示块都在本地观察者的卸载半径内
+static size_t CountViewerViolations(const ChunkWorld& world, const std::vector<ChunkViewer>& viewers, const Int3& minIndex, const Int3& maxIndex)
+{
+	const GridParam& param = world.GetParam();
+	const Int3& gridPerChunk = param.GridPerChunk;
+	int64_t dataMargin = std::max(gridPerChunk.X, gridPerChunk.Y);
+	size_t violations = 0;
+	for (int32_t x = minIndex.X; x <= maxIndex.X; ++x)
+	{
+		for (int32_t y = minIndex.Y; y <= maxIndex.Y; ++y)
+		{
+			Int3 coord = Int3(x, y, 0) * gridPerChunk;
+			Int3 center = coord + gridPerChunk / Int3::Scalar(2);
+			bool bNeedData = false;
+			bool bAllowData = false;
+			bool bAllowRender = false;
+			for (size_t i = 0; i < viewers.size(); ++i)
+			{
+				Int3 viewCenter = FloorDivide(viewers[i].Position, gridPerChunk) * gridPerChunk + gridPerChunk / Int3::Scalar(2);
+				int64_t dx = center.X - viewCenter.X;
+				int64_t dy = center.Y - viewCenter.Y;
+				int64_t distanceSquared = dx * dx + dy * dy;
+				int64_t renderDistance = viewers[i].RenderDistance;
+				int64_t dataDistance = std::max(renderDistance > 0 ? renderDistance + dataMargin : 0, int64_t(viewers[i].CollisionDistance));
+				int64_t dataUnloadDistance = dataDistance + param.StreamingHysteresis;
+				int64_t renderUnloadDistance = renderDistance + param.StreamingHysteresis;
+				bNeedData = bNeedData || distanceSquared < dataDistance * dataDistance;
+				bAllowData = bAllowData || distanceSquared < dataUnloadDistance * dataUnloadDistance;
+				bAllowRender = bAllowRender || (renderDistance > 0 && distanceSquared < renderUnloadDistance * renderUnloadDistance);
+			}
+			bool bHasData = world.FindChunkData(coord) != NULL;
+			violations += (bNeedData && !bHasData) || (bHasData && !bAllowData) || (world.IsRenderChunk(coord) && !bAllowRender) ? 1 : 0;
+		}
+	}
+	return violations;
+}
+
+//服务器上的一群远程玩家只需要数据，加上一个需要显示的本地玩家，每一步所有观察者各自随机走一个块。
+//与每个观察者单独持有一份范围相比，驻留和生成的块数随覆盖的面积增长
+static bool RunViewers(const BenchOptions& options)
+{
+	GridParam param = GetStreamingParam(options);
+	param.StreamingHysteresis = param.GridPerChunk.X;
+	std::vector<std::function<void()> > jobs;
+	size_t numGenerated = 0;
+	ChunkWorld world(param, [&jobs](const std::function<void()>& job) { jobs.push_back(job); });
+	const int32_t numRemoteViewers = 32;
+	const int32_t steps = 32;
+	//玩家聚在边长为半径的区域里，范围大量重叠
+	int32_t spread = std::max(param.MaxRenderDistance / param.GridPerChunk.X, 1);
+	std::vector<ChunkViewer> viewers(numRemoteViewers + 1);
+	std::vector<int32_t> viewerIds(viewers.size());
+	uint32_t seed = 12345;
+	for (size_t i = 0; i < viewers.size(); ++i)
+	{
+		if (i == 0)
+			viewers[i].RenderDistance = param.MaxRenderDistance;
+		viewers[i].CollisionDistance = param.MaxRenderDistance / 2;
+		seed = seed * 1664525u + 1013904223u;
+		int32_t x = int32_t(seed >> 8) % spread - spread / 2;
+		seed = seed * 1664525u + 1013904223u;
+		int32_t y = int32_t(seed >> 8) % spread - spread / 2;
+		viewers[i].Position = Int3(x, y, 0) * param.GridPerChunk;
+		viewerIds[i] = world.AddViewer(viewers[i]);
+	}
+	int32_t range = (param.MaxRenderDistance + param.StreamingHysteresis) / param.GridPerChunk.X + spread + steps + 2;
+	Int3 minIndex = Int3(-range, -range, 0);
+	Int3 maxIndex = Int3(range, range, 0);
+
+	std::vector<Int3> enteredChunks;
+	std::vector<Int3> leftChunks;
+	std::vector<Int3> readyChunks;
+	size_t violations = 0;
+	size_t maxDataChunks = 0;
+	size_t maxHeldChunks = 0;
+	double firstSeconds = 0;
+	double moveSeconds = 0;
+	for (int32_t step = 0; step <= steps; ++step)
+	{
+		if (step > 0)
+		{
+			for (size_t i = 0; i < viewers.size(); ++i)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				static const int32_t offsets[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+				const int32_t* offset = offsets[(seed >> 16) & 3];
+				viewers[i].Position = viewers[i].Position + Int3(offset[0], offset[1], 0) * param.GridPerChunk;
+				world.SetViewerPosition(viewerIds[i], viewers[i].Position);
+			}
+		}
+		enteredChunks.clear();
+		leftChunks.clear();
+		Clock::time_point start = Clock::now();
+		world.UpdateViewers(enteredChunks, leftChunks);
+		(step == 0 ? firstSeconds : moveSeconds) += ElapsedSeconds(start);
+		while (!jobs.empty())
+		{
+			std::vector<std::function<void()> > runJobs;
+			runJobs.swap(jobs);
+			for (size_t j = 0; j < runJobs.size(); ++j)
+				runJobs[j]();
+			numGenerated += runJobs.size();
+			world.DispatchGenerationTasks();
+		}
+		readyChunks.clear();
+		world.ProcessCompletedTasks(readyChunks);
+		violations += CountViewerViolations(world, viewers, minIndex, maxIndex);
+		maxDataChunks = std::max(maxDataChunks, world.GetNumDataChunks());
+	}
+	//每个观察者单独持有时的块数：各自数据半径内的块数之和
+	for (size_t i = 0; i < viewers.size(); ++i)
+	{
+		int64_t dataDistance = std::max(i == 0 ? viewers[i].RenderDistance + param.GridPerChunk.X : 0, viewers[i].CollisionDistance);
+		int32_t chunkRadius = int32_t(dataDistance / param.GridPerChunk.X) + 1;
+		for (int32_t x = -chunkRadius; x <= chunkRadius; ++x)
+			for (int32_t y = -chunkRadius; y <= chunkRadius; ++y)
+				maxHeldChunks += int64_t(x * x + y * y) * param.GridPerChunk.X * param.GridPerChunk.X < dataDistance * dataDistance ? 1 : 0;
+	}
+
+	world.RemoveViewer(viewerIds[0]);
+	enteredChunks.clear();
+	leftChunks.clear();
+	world.UpdateViewers(enteredChunks, leftChunks);
+	viewers.erase(viewers.begin());
+	violations += CountViewerViolations(world, viewers, minIndex, maxIndex);
+	violations += world.GetRenderChunks().empty() ? 0 : 1;
+
+	printf("viewers: 1 local + %d remote viewers, collision distance %d grids, %d random steps\n", numRemoteViewers,
+		viewers[0].CollisionDistance, steps);
+	printf("  update     %10.1f us/step  (first update %.1f us, %zu resident at most, %zu if held per viewer, %zu generated, %zu violations)\n",
+		moveSeconds / steps * 1e6, firstSeconds * 1e6, maxDataChunks, maxHeldChunks, numGenerated, violations);
+	return violations == 0;
+}
+
+//先生成并保存整个区域，再用新的世界从区域文件流式读取，比较两次的耗时并校验读回的数据
+static bool RunStore(const BenchOptions& options)
+{
+	GridParam param = GetStreamingParam(options);
+	//清掉上次运行留下的文件，保证第一遍全部走生成
+	std::string removeCommand = "rm -f '" + options.StoreDirectory + "'/r.*.vxr";
+	if (system(removeCommand.c_str()) != 0)
+		return false;
+
+	ChunkWorld generatedWorld(param);
+	generatedWorld.SetChunkStore(std::make_shared<RegionStore>(options.StoreDirectory, param.GridPerChunk));
+	size_t triangles = 0;
+	size_t remeshes = 0;
+	double maxFrameSeconds = 0;
+	double generateSeconds = StreamRegion(generatedWorld, options.Mesh, options.BudgetSeconds, triangles, remeshes, maxFrameSeconds);
+	Clock::time_point saveStart = Clock::now();
+	size_t savedChunks = generatedWorld.SaveDirtyChunks();
+	generatedWorld.GetChunkStore()->Flush();
+	double saveSeconds = ElapsedSeconds(saveStart);
+
+	std::vector<uint8_t> payload;
+	size_t payloadBytes = 0;
+	for (std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = generatedWorld.GetRenderChunks().begin(); it != generatedWorld.GetRenderChunks().end(); ++it)
+	{
+		EncodeChunkPayload(*generatedWorld.FindChunkData(it->first), payload);
+		payloadBytes += payload.size();
+	}
+
+	ChunkWorld loadedWorld(param);
+	loadedWorld.SetChunkStore(std::make_shared<RegionStore>(options.StoreDirectory, param.GridPerChunk));
+	size_t loadedTriangles = 0;
+	double loadSeconds = StreamRegion(loadedWorld, options.Mesh, options.BudgetSeconds, loadedTriangles, remeshes, maxFrameSeconds);
+
+	//读回的每个格子都要与生成的一致
+	size_t mismatches = 0;
+	for (std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = loadedWorld.GetRenderChunks().begin(); it != loadedWorld.GetRenderChunks().end(); ++it)
+	{
+		ChunkDataPtr generated = generatedWorld.FindChunkData(it->first);
+		ChunkDataPtr loaded = loadedWorld.FindChunkData(it->first);
+		for (int32_t i = 0; i < param.GridPerChunk.Volume(); ++i)
+			mismatches += generated->Grids.Get(i) != loaded->Grids.Get(i) ? 1 : 0;
+	}
+
+	//只读取不构建网格，与前面单线程生成的吞吐量对比
+	RegionStore store(options.StoreDirectory, param.GridPerChunk);
+	Clock::time_point readStart = Clock::now();
+	for (std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = loadedWorld.GetRenderChunks().begin(); it != loadedWorld.GetRenderChunks().end(); ++it)
+		store.RequestLoad(it->first);
+	store.Flush();
+	double readSeconds = ElapsedSeconds(readStart);
+	std::vector<ChunkLoadResult> readChunks;
+	store.PopLoaded(readChunks);
+
+	//只比较数据本身：生成与解码同一批块，各重复几遍取最快的一遍，不受网格构建和调度的干扰
+	std::vector<Int3> coords;
+	std::vector<std::vector<uint8_t> > payloads;
+	for (std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = loadedWorld.GetRenderChunks().begin(); it != loadedWorld.GetRenderChunks().end(); ++it)
+	{
+		coords.push_back(it->first);
+		payloads.push_back(std::vector<uint8_t>());
+		EncodeChunkPayload(*loadedWorld.FindChunkData(it->first), payloads.back());
+	}
+	const int32_t repeats = 3;
+	double generateDataSeconds = 0;
+	double decodeSeconds = 0;
+	for (int32_t repeat = 0; repeat < repeats; ++repeat)
+	{
+		HeightColumnCache columns(param);
+		Clock::time_point generateStart = Clock::now();
+		for (size_t i = 0; i < coords.size(); ++i)
+			GenerateChunk(coords[i], param, &columns);
+		double seconds = ElapsedSeconds(generateStart);
+		generateDataSeconds = repeat == 0 ? seconds : std::min(generateDataSeconds, seconds);
+
+		Clock::time_point decodeStart = Clock::now();
+		for (size_t i = 0; i < coords.size(); ++i)
+		{
+			if (!DecodeChunkPayload(coords[i], param.GridPerChunk, payloads[i].data(), payloads[i].size()))
+				return false;
+		}
+		seconds = ElapsedSeconds(decodeStart);
+		decodeSeconds = repeat == 0 ? seconds : std::min(decodeSeconds, seconds);
+	}
+
+	size_t renderChunks = loadedWorld.GetRenderChunks().size();
+	printf("store: %zu render chunks, %zu chunks saved to %s\n", renderChunks, savedChunks, options.StoreDirectory.c_str());
+	printf("  save       %10.1f chunks/s  (%.3f s, payload %.1f bytes/chunk)\n", savedChunks / saveSeconds, saveSeconds,
+		double(payloadBytes) / renderChunks);
+	printf("  generate   %10.1f chunks/s  (%.3f s)\n", renderChunks / generateSeconds, generateSeconds);
+	printf("  reopen     %10.1f chunks/s  (%.3f s, %.2fx, %zu grid mismatches, %zu dirty chunks)\n", renderChunks / loadSeconds, loadSeconds,
+		generateSeconds / loadSeconds, mismatches, loadedWorld.GetNumDirtyChunks());
+	printf("  read       %10.1f chunks/s  (%zu chunks on the I/O thread)\n", readChunks.size() / readSeconds, readChunks.size());
+	printf("  data       %10.1f chunks/s generated, %.1f chunks/s decoded  (%.2fx, best of %d)\n", coords.size() / generateDataSeconds,
+		coords.size() / decodeSeconds, generateDataSeconds / decodeSeconds, repeats);
+	return mismatches == 0 && loadedTriangles == triangles && loadedWorld.GetNumDirtyChunks() == 0;
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+	RunSerial(options);
+	if (!RunCollision(options))
+		return 1;
+	if (!RunQueries(options))
+		return 1;
+	if (options.Threads > 0)
+		RunStreaming(options);
+	if (options.Threads > 0 && !RunMoving(options))
+		return 1;
+	if (options.Threads > 0 && !RunViewers(options))
+		return 1;
+	if (options.Threads > 0 && !RunEditing(options))
+		return 1;
+	if (options.Threads > 0 && !options.StoreDirectory.empty() && !RunStore(options))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,179 @@
+// chunkcollision.cpp
+//
+// 与引擎无关的体素核心：块的碰撞盒以及直接在格子上的扫掠查询
+//
+
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+#include "chunkcollision.h"
+
+using namespace voxel;
+
+//(x, y)这一列上[z0, z1)的格子都还没有放进长方体
+static bool IsRunRemaining(const std::vector<uint8_t>& remaining, const ChunkData& data, int32_t x, int32_t y, int32_t z0, int32_t z1)
+{
+	const uint8_t* column = &remaining[data.GetIndex(Int3(x, y, 0))];
+	for (int32_t z = z0; z < z1; ++z)
+	{
+		if (!column[z])
+			return false;
+	}
+	return true;
+}
+
+void voxel::BuildChunkCollision(const ChunkData& data, const std::vector<MaterialType>& materialTypes, std::vector<CollisionBox>& outBoxes)
+{
+	outBoxes.clear();
+	const Int3& size = data.Size;
+	if (data.Grids.IsUniform())
+	{
+		if (IsSolidMaterial(materialTypes, data.Grids.Get(0)))
+			outBoxes.push_back(CollisionBox(Int3(0, 0, 0), size));
+		return;
+	}
+
+	//还没有放进长方体的参与碰撞的格子，下标与ChunkData::GetIndex一致
+	std::vector<uint8_t> remaining(size.Volume());
+	for (int32_t i = 0; i < size.Volume(); ++i)
+		remaining[i] = IsSolidMaterial(materialTypes, data.Grids.Get(i)) ? 1 : 0;
+
+	for (int32_t x = 0; x < size.X; ++x)
+	{
+		for (int32_t y = 0; y < size.Y; ++y)
+		{
+			for (int32_t z = 0; z < size.Z; ++z)
+			{
+				if (!remaining[data.GetIndex(Int3(x, y, z))])
+					continue;
+				int32_t z1 = z + 1;
+				while (z1 < size.Z && remaining[data.GetIndex(Int3(x, y, z1))])
+					++z1;
+				int32_t y1 = y + 1;
+				while (y1 < size.Y && IsRunRemaining(remaining, data, x, y1, z, z1))
+					++y1;
+				int32_t x1 = x + 1;
+				for (bool bExtend = true; bExtend && x1 < size.X; )
+				{
+					for (int32_t yy = y; yy < y1 && bExtend; ++yy)
+						bExtend = IsRunRemaining(remaining, data, x1, yy, z, z1);
+					x1 += bExtend ? 1 : 0;
+				}
+				for (int32_t xx = x; xx < x1; ++xx)
+				{
+					for (int32_t yy = y; yy < y1; ++yy)
+						std::fill_n(&remaining[data.GetIndex(Int3(xx, yy, z))], z1 - z, uint8_t(0));
+				}
+				outBoxes.push_back(CollisionBox(Int3(x, y, z), Int3(x1, y1, z1)));
+				z = z1 - 1;
+			}
+		}
+	}
+}
+
+ChunkCollisionQueue::ChunkCollisionQueue(const TaskDispatcher& dispatcher) :
+	Dispatcher(dispatcher), Shared(std::make_shared<SharedState>()), NextVersion(1)
+{
+	assert(Dispatcher);
+}
+
+void ChunkCollisionQueue::Request(const ChunkDataPtr& data, const std::vector<MaterialType>& materialTypes)
+{
+	uint64_t version = NextVersion++;
+	LatestVersions[data->Coordinate] = version;
+	std::shared_ptr<SharedState> shared = Shared;
+	Dispatcher([data, materialTypes, version, shared]() {
+		ChunkCollisionPtr collision = std::make_shared<ChunkCollision>();
+		collision->Coordinate = data->Coordinate;
+		BuildChunkCollision(*data, materialTypes, collision->Boxes);
+		std::lock_guard<std::mutex> lock(shared->Mutex);
+		shared->Completed.push_back(std::make_pair(version, collision));
+	});
+}
+
+void ChunkCollisionQueue::Cancel(const Int3& coord)
+{
+	LatestVersions.erase(coord);
+}
+
+void ChunkCollisionQueue::PopCompleted(std::vector<ChunkCollisionPtr>& outCollisions)
+{
+	std::vector<std::pair<uint64_t, ChunkCollisionPtr> > completed;
+	{
+		std::lock_guard<std::mutex> lock(Shared->Mutex);
+		completed.swap(Shared->Completed);
+	}
+	for (size_t i = 0; i < completed.size(); ++i)
+	{
+		const Int3& coord = completed[i].second->Coordinate;
+		std::unordered_map<Int3, uint64_t, Int3Hash>::iterator it = LatestVersions.find(coord);
+		if (it == LatestVersions.end() || it->second != completed[i].first)
+			continue;
+		LatestVersions.erase(it);
+		outCollisions.push_back(completed[i].second);
+	}
+}
+
+bool voxel::SweepBox(ChunkGridReader& reader, const std::vector<MaterialType>& materialTypes, const double boxMin[3], const double boxMax[3],
+	const double delta[3], SweepHit& outHit)
+{
+	//扫过范围的包围盒覆盖的格子
+	int32_t minGrid[3];
+	int32_t maxGrid[3];
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		minGrid[axis] = int32_t(floor(std::min(boxMin[axis], boxMin[axis] + delta[axis])));
+		maxGrid[axis] = int32_t(ceil(std::max(boxMax[axis], boxMax[axis] + delta[axis])));
+	}
+
+	bool bHit = false;
+	outHit.Time = 1.0;
+	for (int32_t x = minGrid[0]; x < maxGrid[0]; ++x)
+	{
+		for (int32_t y = minGrid[1]; y < maxGrid[1]; ++y)
+		{
+			for (int32_t z = minGrid[2]; z < maxGrid[2]; ++z)
+			{
+				Int3 gridCoord(x, y, z);
+				if (!IsSolidMaterial(materialTypes, reader.GetMaterialIndex(gridCoord)))
+					continue;
+				//分轴求进入与离开格子的时间，三个轴都重叠的区间即接触的区间
+				double entryTime = -HUGE_VAL;
+				double exitTime = HUGE_VAL;
+				int32_t entryAxis = -1;
+				const int32_t grid[3] = { x, y, z };
+				for (int32_t axis = 0; axis < 3 && entryTime < exitTime; ++axis)
+				{
+					double lower = grid[axis];
+					double upper = grid[axis] + 1.0;
+					if (delta[axis] == 0)
+					{
+						if (boxMin[axis] >= upper || boxMax[axis] <= lower)
+							exitTime = -HUGE_VAL;
+						continue;
+					}
+					double enter = delta[axis] > 0 ? (lower - boxMax[axis]) / delta[axis] : (upper - boxMin[axis]) / delta[axis];
+					double leave = delta[axis] > 0 ? (upper - boxMin[axis]) / delta[axis] : (lower - boxMax[axis]) / delta[axis];
+					if (enter > entryTime)
+					{
+						entryTime = enter;
+						entryAxis = axis;
+					}
+					exitTime = std::min(exitTime, leave);
+				}
+				if (entryTime >= exitTime || exitTime <= 0 || entryTime > outHit.Time || (bHit && entryTime == outHit.Time))
+					continue;
+				bool bStartPenetrating = entryTime < 0;
+				if (bHit && outHit.bStartPenetrating && bStartPenetrating)
+					continue;
+				bHit = true;
+				outHit.Time = std::max(entryTime, 0.0);
+				outHit.GridCoord = gridCoord;
+				outHit.bStartPenetrating = bStartPenetrating;
+				//法线与移动方向相反
+				outHit.FaceIndex = entryAxis < 0 ? -1 : entryAxis * 2 + (delta[entryAxis] > 0 ? 1 : 0);
+			}
+		}
+	}
+	return bHit;
+}
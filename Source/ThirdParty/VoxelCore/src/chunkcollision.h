@@ -0,0 +1,153 @@
+// chunkcollision.h
+//
+// 与引擎无关的体素核心：块的碰撞盒以及直接在格子上的扫掠查询
+//
+
+#ifndef VOXEL_CHUNKCOLLISION_H
+#define VOXEL_CHUNKCOLLISION_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "chunkgenerationqueue.h"
+#include "chunkmap.h"
+
+namespace voxel
+{
+	//材质下标是否参与碰撞，不在materialTypes中的下标当作空白
+	inline bool IsSolidMaterial(const std::vector<MaterialType>& materialTypes, int32_t materialIndex)
+	{
+		return materialIndex >= 0 && size_t(materialIndex) < materialTypes.size() && materialTypes[materialIndex] != MT_Empty;
+	}
+
+	//块内格子坐标的长方体[Min, Max)
+	struct CollisionBox
+	{
+		Int3 Min;
+
+		Int3 Max;
+
+		CollisionBox() {}
+
+		CollisionBox(const Int3& min, const Int3& max) : Min(min), Max(max) {}
+	};
+
+	//把块中参与碰撞的格子合并为尽量少的长方体：先沿Z合并成一段，再沿Y扩展成矩形，最后沿X扩展。
+	//高度场地形的每一段高度相同的区域只需要一个长方体，可以在任意线程调用
+	void BuildChunkCollision(const ChunkData& data, const std::vector<MaterialType>& materialTypes, std::vector<CollisionBox>& outBoxes);
+
+	struct ChunkCollision
+	{
+		Int3 Coordinate;
+
+		std::vector<CollisionBox> Boxes;
+	};
+
+	typedef std::shared_ptr<ChunkCollision> ChunkCollisionPtr;
+
+	//在后台构建块的碰撞，同一个块请求多次时只保留最后一次请求的结果，除后台任务外都在主线程调用
+	class ChunkCollisionQueue
+	{
+	public:
+		explicit ChunkCollisionQueue(const TaskDispatcher& dispatcher);
+
+		//data在后台读取，之后修改块数据需要换一份新的数据，不能原地修改
+		void Request(const ChunkDataPtr& data, const std::vector<MaterialType>& materialTypes);
+
+		//还没取回的结果丢弃
+		void Cancel(const Int3& coord);
+
+		void PopCompleted(std::vector<ChunkCollisionPtr>& outCollisions);
+
+		size_t GetNumRequested() const
+		{
+			return LatestVersions.size();
+		}
+
+		//请求过、结果还没有取回
+		bool IsRequested(const Int3& coord) const
+		{
+			return LatestVersions.count(coord) != 0;
+		}
+
+	private:
+		//后台线程与队列共享的完成列表，队列销毁后仍在运行的任务也能安全地写入
+		struct SharedState
+		{
+			std::mutex Mutex;
+
+			std::vector<std::pair<uint64_t, ChunkCollisionPtr> > Completed;
+		};
+
+		TaskDispatcher Dispatcher;
+
+		std::shared_ptr<SharedState> Shared;
+
+		//每个块最后一次请求的序号，完成的结果序号不同时已经过期
+		std::unordered_map<Int3, uint64_t, Int3Hash> LatestVersions;
+
+		uint64_t NextVersion;
+	};
+
+	//按格子坐标读取材质，连续访问同一个块的格子时不重复查表
+	class ChunkGridReader
+	{
+	public:
+		ChunkGridReader(const ChunkMap<ChunkDataPtr>& chunks, const Int3& gridPerChunk) :
+			Chunks(chunks), GridPerChunk(gridPerChunk), CachedCoordinate(0, 0, 0), CachedChunk(NULL), bHasCachedChunk(false)
+		{}
+
+		//没有数据的格子返回-1
+		int32_t GetMaterialIndex(const Int3& gridCoord)
+		{
+			Int3 chunkCoord = GetChunkCoordinate(gridCoord, GridPerChunk);
+			if (!bHasCachedChunk || chunkCoord != CachedCoordinate)
+			{
+				const ChunkDataPtr* data = Chunks.Find(chunkCoord);
+				CachedChunk = data ? data->get() : NULL;
+				CachedCoordinate = chunkCoord;
+				bHasCachedChunk = true;
+			}
+			return CachedChunk ? CachedChunk->GetMaterialIndex(gridCoord - chunkCoord) : -1;
+		}
+
+		const Int3& GetGridPerChunk() const
+		{
+			return GridPerChunk;
+		}
+
+	private:
+		const ChunkMap<ChunkDataPtr>& Chunks;
+
+		Int3 GridPerChunk;
+
+		Int3 CachedCoordinate;
+
+		const ChunkData* CachedChunk;
+
+		bool bHasCachedChunk;
+	};
+
+	struct SweepHit
+	{
+		//沿delta移动的比例，[0, 1]
+		double Time;
+
+		//碰到的格子
+		Int3 GridCoord;
+
+		//碰到格子的哪个面，即碰撞的法线，与GetFaceNormal的下标一致
+		int32_t FaceIndex;
+
+		//开始时已经与格子重叠，Time为0
+		bool bStartPenetrating;
+	};
+
+	//长方体[boxMin, boxMax)沿delta平移，返回最先接触的参与碰撞的格子，格子坐标系。只是贴着格子滑过不算接触。
+	//检查扫过范围的包围盒内的所有格子，用于角色移动这样的短距离
+	bool SweepBox(ChunkGridReader& reader, const std::vector<MaterialType>& materialTypes, const double boxMin[3], const double boxMax[3],
+		const double delta[3], SweepHit& outHit);
+}
+
+#endif
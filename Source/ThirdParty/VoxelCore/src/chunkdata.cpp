@@ -0,0 +1,40 @@
+// chunkdata.cpp
+//
+// 与引擎无关的体素核心：块数据与地形生成
+//
+
+#include "chunkdata.h"
+
+using namespace voxel;
+
+ChunkDataPtr voxel::GenerateChunk(const Int3& coord, const GridParam& param, HeightColumnCache* columns)
+{
+	ChunkDataPtr data = std::make_shared<ChunkData>(coord, param.GridPerChunk);
+	const Int3& size = data->Size;
+	data->Column = columns ? columns->Acquire(coord) : BuildHeightColumn(Int3(coord.X, coord.Y, 0), param);
+	const HeightColumn& column = *data->Column;
+
+	//整块在地表之上或之下时不用逐个格子判断
+	if (coord.Z >= column.MaxHeight || coord.Z + size.Z <= column.MinHeight)
+	{
+		data->Grids.Init(size.Volume(), coord.Z >= column.MaxHeight ? 0 : 1);
+		return data;
+	}
+
+	data->Grids.Init(size.Volume(), 0);
+	int32_t index = 0;
+	for (int32_t i = 0; i < size.X; ++i)
+	{
+		for (int32_t j = 0; j < size.Y; ++j)
+		{
+			int32_t height = column.GetHeight(i, j);
+			for (int32_t k = 0; k < size.Z; ++k, ++index)
+			{
+				int32_t curGridHeight = coord.Z + k;
+				if (curGridHeight < height)
+					data->Grids.Set(index, 1);
+			}
+		}
+	}
+	return data;
+}
@@ -0,0 +1,53 @@
+// chunkdata.h
+//
+// 与引擎无关的体素核心：块数据与地形生成
+//
+
+#ifndef VOXEL_CHUNKDATA_H
+#define VOXEL_CHUNKDATA_H
+
+#include <memory>
+#include "chunkstorage.h"
+#include "heightcolumn.h"
+
+namespace voxel
+{
+	struct ChunkData
+	{
+		//块的最小角的格子坐标
+		Int3 Coordinate;
+
+		//每个轴GridPerChunk个格子，块边界外的格子由构建网格时的收集步骤从相邻块读取
+		Int3 Size;
+
+		ChunkStorage Grids;
+
+		//生成时使用的高度场，同一列的块共享，从存储读取的块为空
+		HeightColumnPtr Column;
+
+		ChunkData() {}
+
+		ChunkData(const Int3& coord, const Int3& size) :
+			Coordinate(coord), Size(size)
+		{}
+
+		//offset为相对块坐标的格子偏移
+		inline int32_t GetIndex(const Int3& offset) const
+		{
+			return (offset.X * Size.Y + offset.Y) * Size.Z + offset.Z;
+		}
+
+		inline uint8_t GetMaterialIndex(const Int3& offset) const
+		{
+			return Grids.Get(GetIndex(offset));
+		}
+	};
+
+	//块数据在后台线程生成，生成完后交给主线程，用共享指针避免拷贝
+	typedef std::shared_ptr<ChunkData> ChunkDataPtr;
+
+	//按高度图生成一个块的格子，可以在任意线程调用。columns不为空时从中取得所在列的高度场
+	ChunkDataPtr GenerateChunk(const Int3& coord, const GridParam& param, HeightColumnCache* columns = NULL);
+}
+
+#endif
@@ -0,0 +1,175 @@
+// chunkgenerationqueue.cpp
+//
+// 与引擎无关的体素核心：按优先级在后台生成块数据
+//
+
+#include <algorithm>
+#include "chunkgenerationqueue.h"
+
+using namespace voxel;
+
+WorkerPool::WorkerPool(int32_t numThreads) :
+	bStopping(false)
+{
+	for (int32_t i = 0; i < std::max(numThreads, 1); ++i)
+		Threads.push_back(std::thread(&WorkerPool::WorkerMain, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		bStopping = true;
+	}
+	JobAvailable.notify_all();
+	for (size_t i = 0; i < Threads.size(); ++i)
+		Threads[i].join();
+}
+
+void WorkerPool::Run(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Jobs.push_back(job);
+	}
+	JobAvailable.notify_one();
+}
+
+void WorkerPool::WorkerMain()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			JobAvailable.wait(lock, [this]() { return bStopping || !Jobs.empty(); });
+			if (Jobs.empty())
+				return;
+			job = Jobs.front();
+			Jobs.pop_front();
+		}
+		job();
+	}
+}
+
+//PendingTasks小顶堆的比较函数
+struct ChunkGenerationTaskPriority
+{
+	bool operator()(const ChunkGenerationTaskPtr& a, const ChunkGenerationTaskPtr& b) const
+	{
+		return a->Priority > b->Priority;
+	}
+};
+
+ChunkGenerationQueue::ChunkGenerationQueue(const GridParam& param, const TaskDispatcher& dispatcher) :
+	Param(param), Dispatcher(dispatcher), Shared(std::make_shared<SharedState>(param)), bPendingTasksDirty(false)
+{
+	if (!Dispatcher)
+	{
+		Pool.reset(new WorkerPool(param.MaxGenerationTasks));
+		WorkerPool* pool = Pool.get();
+		Dispatcher = [pool](const std::function<void()>& job) { pool->Run(job); };
+	}
+}
+
+ChunkGenerationQueue::~ChunkGenerationQueue()
+{
+	CancelAll();
+	//自带的线程池在这里等待正在运行的任务结束
+	Pool.reset();
+}
+
+void ChunkGenerationQueue::Request(const Int3& coord, int64_t priority)
+{
+	std::unordered_map<Int3, ChunkGenerationTaskPtr, Int3Hash>::iterator it = Coord2Task.find(coord);
+	if (it != Coord2Task.end())
+	{
+		//已经在队列里，下次派发前统一重建堆
+		if (it->second->Priority != priority)
+		{
+			it->second->Priority = priority;
+			bPendingTasksDirty = true;
+		}
+		return;
+	}
+	ChunkGenerationTaskPtr task = std::make_shared<ChunkGenerationTask>(coord, priority);
+	Coord2Task[coord] = task;
+	PendingTasks.push_back(task);
+	bPendingTasksDirty = true;
+}
+
+void ChunkGenerationQueue::Cancel(const Int3& coord)
+{
+	std::unordered_map<Int3, ChunkGenerationTaskPtr, Int3Hash>::iterator it = Coord2Task.find(coord);
+	if (it == Coord2Task.end())
+		return;
+	it->second->bCancelled = true;
+	Coord2Task.erase(it);
+	bPendingTasksDirty = true;
+}
+
+void ChunkGenerationQueue::UpdatePriorities(const std::function<int64_t(const Int3&)>& getPriority)
+{
+	for (std::unordered_map<Int3, ChunkGenerationTaskPtr, Int3Hash>::iterator it = Coord2Task.begin(); it != Coord2Task.end(); ++it)
+		it->second->Priority = getPriority(it->first);
+	bPendingTasksDirty = true;
+}
+
+void ChunkGenerationQueue::CancelAll()
+{
+	for (std::unordered_map<Int3, ChunkGenerationTaskPtr, Int3Hash>::iterator it = Coord2Task.begin(); it != Coord2Task.end(); ++it)
+		it->second->bCancelled = true;
+	Coord2Task.clear();
+	PendingTasks.clear();
+	bPendingTasksDirty = false;
+}
+
+void ChunkGenerationQueue::Dispatch()
+{
+	if (bPendingTasksDirty)
+	{
+		PendingTasks.erase(std::remove_if(PendingTasks.begin(), PendingTasks.end(),
+			[](const ChunkGenerationTaskPtr& task) { return bool(task->bCancelled); }), PendingTasks.end());
+		std::make_heap(PendingTasks.begin(), PendingTasks.end(), ChunkGenerationTaskPriority());
+		bPendingTasksDirty = false;
+	}
+
+	while (!PendingTasks.empty() && Shared->RunningTaskCount < std::max(Param.MaxGenerationTasks, 1))
+	{
+		std::pop_heap(PendingTasks.begin(), PendingTasks.end(), ChunkGenerationTaskPriority());
+		ChunkGenerationTaskPtr task = PendingTasks.back();
+		PendingTasks.pop_back();
+		if (task->bCancelled)
+			continue;
+
+		++Shared->RunningTaskCount;
+		std::shared_ptr<SharedState> shared = Shared;
+		GridParam param = Param;
+		Dispatcher([task, shared, param]() {
+			if (!task->bCancelled)
+			{
+				task->Result = GenerateChunk(task->Coordinate, param, &shared->Columns);
+				std::lock_guard<std::mutex> lock(shared->Mutex);
+				shared->CompletedTasks.push_back(task);
+			}
+			--shared->RunningTaskCount;
+		});
+	}
+}
+
+void ChunkGenerationQueue::PopCompleted(std::vector<ChunkDataPtr>& outChunks)
+{
+	std::vector<ChunkGenerationTaskPtr> completedTasks;
+	{
+		std::lock_guard<std::mutex> lock(Shared->Mutex);
+		completedTasks.swap(Shared->CompletedTasks);
+	}
+	for (size_t i = 0; i < completedTasks.size(); ++i)
+	{
+		const ChunkGenerationTaskPtr& task = completedTasks[i];
+		if (task->bCancelled)
+			continue;
+		Coord2Task.erase(task->Coordinate);
+		outChunks.push_back(task->Result);
+	}
+}
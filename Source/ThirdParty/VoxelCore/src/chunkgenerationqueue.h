@@ -0,0 +1,164 @@
+// chunkgenerationqueue.h
+//
+// 与引擎无关的体素核心：按优先级在后台生成块数据
+//
+
+#ifndef VOXEL_CHUNKGENERATIONQUEUE_H
+#define VOXEL_CHUNKGENERATIONQUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "chunkdata.h"
+
+namespace voxel
+{
+	//把一个任务交给后台线程执行，UE中转发给TaskGraph，为空时使用自带的线程池
+	typedef std::function<void(const std::function<void()>&)> TaskDispatcher;
+
+	//固定数量线程的简单线程池
+	class WorkerPool
+	{
+	public:
+		explicit WorkerPool(int32_t numThreads);
+
+		//执行完已经提交的任务后退出
+		~WorkerPool();
+
+		void Run(const std::function<void()>& job);
+
+	private:
+		void WorkerMain();
+
+		std::mutex Mutex;
+
+		std::condition_variable JobAvailable;
+
+		std::deque<std::function<void()> > Jobs;
+
+		std::vector<std::thread> Threads;
+
+		bool bStopping;
+	};
+
+	//后台生成一个块数据的任务
+	struct ChunkGenerationTask
+	{
+		Int3 Coordinate;
+
+		//到观察点距离的平方，越小越先生成
+		int64_t Priority;
+
+		//块离开视距后置位，还没开始的任务直接跳过，已完成的结果丢弃
+		std::atomic<bool> bCancelled;
+
+		ChunkDataPtr Result;
+
+		ChunkGenerationTask(const Int3& coord, int64_t priority) :
+			Coordinate(coord), Priority(priority), bCancelled(false)
+		{}
+	};
+
+	typedef std::shared_ptr<ChunkGenerationTask> ChunkGenerationTaskPtr;
+
+	//等待、派发、取回生成任务，除后台任务本身外都在主线程调用
+	class ChunkGenerationQueue
+	{
+	public:
+		ChunkGenerationQueue(const GridParam& param, const TaskDispatcher& dispatcher);
+
+		~ChunkGenerationQueue();
+
+		//加入生成队列，已在队列中的只更新优先级
+		void Request(const Int3& coord, int64_t priority);
+
+		bool IsRequested(const Int3& coord) const
+		{
+			return Coord2Task.count(coord) != 0;
+		}
+
+		//取消一个块的任务，没有任务时什么都不做
+		void Cancel(const Int3& coord);
+
+		//观察点移动后按getPriority重新计算所有任务的优先级
+		void UpdatePriorities(const std::function<int64_t(const Int3&)>& getPriority);
+
+		void CancelAll();
+
+		//按优先级把等待中的任务派发到后台线程，直到达到并发上限
+		void Dispatch();
+
+		//修改并发上限，下次Dispatch时生效。自带线程池的线程数在创建时确定，不随之改变
+		void SetMaxTasks(int32_t maxTasks)
+		{
+			Param.MaxGenerationTasks = maxTasks;
+		}
+
+		//取回生成完且没有被取消的块数据
+		void PopCompleted(std::vector<ChunkDataPtr>& outChunks);
+
+		size_t GetNumPending() const
+		{
+			return PendingTasks.size();
+		}
+
+		int32_t GetNumRunning() const
+		{
+			return Shared->RunningTaskCount;
+		}
+
+		//其他后台任务(例如构建碰撞)也通过它派发
+		const TaskDispatcher& GetDispatcher() const
+		{
+			return Dispatcher;
+		}
+
+		const HeightColumnCache& GetHeightColumns() const
+		{
+			return Shared->Columns;
+		}
+
+	private:
+		//后台线程与队列共享的完成列表，队列销毁后仍在运行的任务也能安全地写入
+		struct SharedState
+		{
+			std::mutex Mutex;
+
+			std::vector<ChunkGenerationTaskPtr> CompletedTasks;
+
+			std::atomic<int32_t> RunningTaskCount;
+
+			//同一列的块共享高度场，多层的世界每列只采样一次噪声
+			HeightColumnCache Columns;
+
+			explicit SharedState(const GridParam& param) : RunningTaskCount(0), Columns(param) {}
+		};
+
+		GridParam Param;
+
+		TaskDispatcher Dispatcher;
+
+		//没有指定派发函数时使用
+		std::unique_ptr<WorkerPool> Pool;
+
+		std::shared_ptr<SharedState> Shared;
+
+		//等待派发的任务，按Priority组织成小顶堆
+		std::vector<ChunkGenerationTaskPtr> PendingTasks;
+
+		//优先级改变或有任务取消后需要重建堆
+		bool bPendingTasksDirty;
+
+		//等待中以及正在运行的任务
+		std::unordered_map<Int3, ChunkGenerationTaskPtr, Int3Hash> Coord2Task;
+	};
+}
+
+#endif
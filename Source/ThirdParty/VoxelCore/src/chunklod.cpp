@@ -0,0 +1,158 @@
+// chunklod.cpp
+//
+// 与引擎无关的体素核心：远处的块降采样后构建网格
+//
+
+#include <assert.h>
+#include <math.h>
+#include "chunklod.h"
+
+using namespace voxel;
+
+int32_t voxel::SelectChunkLod(int64_t distanceSquared, int32_t currentLod, const GridParam& param)
+{
+	int32_t numLods = 0;
+	while (numLods < MaxChunkLod && param.LodDistances[numLods] > 0)
+		++numLods;
+	double distance = sqrt(double(distanceSquared));
+	int32_t lod = 0;
+	while (lod < numLods && distance >= double(param.LodDistances[lod]))
+		++lod;
+	if (currentLod < 0 || currentLod > numLods)
+		return lod;
+	double minDistance = currentLod > 0 ? double(param.LodDistances[currentLod - 1] - param.LodHysteresis) : -HUGE_VAL;
+	double maxDistance = currentLod < numLods ? double(param.LodDistances[currentLod] + param.LodHysteresis) : HUGE_VAL;
+	return distance >= minDistance && distance < maxDistance ? currentLod : lod;
+}
+
+int32_t voxel::ClampChunkLod(int32_t lod, const Int3& chunkSize)
+{
+	while (lod > 0)
+	{
+		int32_t mask = (1 << lod) - 1;
+		if (!(chunkSize.X & mask) && !(chunkSize.Y & mask) && !(chunkSize.Z & mask))
+			break;
+		--lod;
+	}
+	return lod;
+}
+
+void voxel::DownsampleGrid(const PaddedChunkGrid& grid, int32_t lod, const std::vector<MaterialType>& materialTypes, std::vector<uint8_t>& scratch, PaddedChunkGrid& outGrid)
+{
+	int32_t factor = 1 << lod;
+	assert(grid.Size.X % factor == 0 && grid.Size.Y % factor == 0 && grid.Size.Z % factor == 0);
+	outGrid.Size = grid.Size / Int3::Scalar(factor);
+	outGrid.StrideY = outGrid.Size.Z;
+	outGrid.StrideX = outGrid.Size.Y * outGrid.Size.Z;
+	scratch.resize(outGrid.Size.Volume());
+
+	//每个粗格子先计数，再逐个材质比较并清零，计数表不用整个重置
+	int32_t numGrids = factor * factor * factor;
+	uint16_t counts[256] = { 0 };
+	uint8_t* dest = scratch.data();
+	for (int32_t x = 0; x < outGrid.Size.X; ++x)
+	{
+		for (int32_t y = 0; y < outGrid.Size.Y; ++y)
+		{
+			for (int32_t z = 0; z < outGrid.Size.Z; ++z)
+			{
+				const uint8_t* block = grid.Grids + grid.GetIndex(x * factor, y * factor, z * factor);
+				for (int32_t i = 0; i < factor; ++i)
+					for (int32_t j = 0; j < factor; ++j)
+						for (int32_t k = 0; k < factor; ++k)
+							++counts[block[i * grid.StrideX + j * grid.StrideY + k]];
+
+				int32_t numNonEmpty = 0;
+				int32_t bestNonEmptyCount = 0;
+				int32_t bestEmptyCount = 0;
+				uint8_t bestNonEmpty = 0;
+				uint8_t bestEmpty = 0;
+				for (int32_t i = 0; i < factor; ++i)
+				{
+					for (int32_t j = 0; j < factor; ++j)
+					{
+						for (int32_t k = 0; k < factor; ++k)
+						{
+							uint8_t materialIndex = block[i * grid.StrideX + j * grid.StrideY + k];
+							int32_t count = counts[materialIndex];
+							if (!count)
+								continue;
+							counts[materialIndex] = 0;
+							if (materialTypes[materialIndex] != MT_Empty)
+							{
+								numNonEmpty += count;
+								if (count > bestNonEmptyCount)
+								{
+									bestNonEmptyCount = count;
+									bestNonEmpty = materialIndex;
+								}
+							}
+							else if (count > bestEmptyCount)
+							{
+								bestEmptyCount = count;
+								bestEmpty = materialIndex;
+							}
+						}
+					}
+				}
+				*dest++ = numNonEmpty * 2 >= numGrids ? bestNonEmpty : bestEmpty;
+			}
+		}
+	}
+	outGrid.Grids = scratch.data();
+}
+
+void voxel::ApplySkirts(uint8_t skirtFaceMask, const std::vector<MaterialType>& materialTypes, std::vector<uint8_t>& scratch, PaddedChunkGrid& grid)
+{
+	if (!skirtFaceMask)
+		return;
+	assert(grid.Grids == scratch.data());
+	//没有空白材质时所有格子都不透明，不需要裙边
+	size_t emptyIndex = 0;
+	while (emptyIndex < materialTypes.size() && materialTypes[emptyIndex] != MT_Empty)
+		++emptyIndex;
+	if (emptyIndex == materialTypes.size())
+		return;
+
+	int32_t strides[3] = { grid.StrideX, grid.StrideY, 1 };
+	for (int32_t face = 0; face < 6; ++face)
+	{
+		if (!(skirtFaceMask & (1 << face)))
+			continue;
+		int32_t axis = face / 2;
+		int32_t uAxis = (axis + 1) % 3;
+		int32_t vAxis = (axis + 2) % 3;
+		int32_t layer = face % 2 == 0 ? grid.Size[axis] - 1 : 0;
+		uint8_t* base = scratch.data() + layer * strides[axis];
+		for (int32_t u = 0; u < grid.Size[uAxis]; ++u)
+			for (int32_t v = 0; v < grid.Size[vAxis]; ++v)
+				base[u * strides[uAxis] + v * strides[vAxis]] = uint8_t(emptyIndex);
+	}
+}
+
+//降采样后的粗网格，与收集用的缓冲区分开
+static std::vector<uint8_t>& GetLodGridScratch()
+{
+	static thread_local std::vector<uint8_t> scratch;
+	return scratch;
+}
+
+int32_t voxel::GatherLodGrid(const ChunkNeighbourhood& neighbourhood, const Int3& minCoordinate, const Int3& maxCoordinate, int32_t lod,
+	uint8_t skirtFaceMask, const std::vector<MaterialType>& materialTypes, PaddedChunkGrid& outGrid)
+{
+	lod = ClampChunkLod(lod, maxCoordinate - minCoordinate);
+	std::vector<uint8_t>& scratch = GetPaddedGridScratch();
+	if (lod == 0)
+	{
+		neighbourhood.Gather(minCoordinate, maxCoordinate, scratch, outGrid);
+		ApplySkirts(skirtFaceMask, materialTypes, scratch, outGrid);
+		return 0;
+	}
+	//外圈与一个粗格子一样宽，边界上的面与相邻块降采样后的格子比较
+	PaddedChunkGrid fineGrid;
+	neighbourhood.Gather(minCoordinate, maxCoordinate, 1 << lod, scratch, fineGrid);
+	std::vector<uint8_t>& lodScratch = GetLodGridScratch();
+	DownsampleGrid(fineGrid, lod, materialTypes, lodScratch, outGrid);
+	ApplySkirts(skirtFaceMask, materialTypes, lodScratch, outGrid);
+	return lod;
+}
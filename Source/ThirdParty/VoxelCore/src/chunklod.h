@@ -0,0 +1,35 @@
+// chunklod.h
+//
+// 与引擎无关的体素核心：远处的块降采样后构建网格
+//
+
+#ifndef VOXEL_CHUNKLOD_H
+#define VOXEL_CHUNKLOD_H
+
+#include <vector>
+#include "chunkneighbourhood.h"
+
+namespace voxel
+{
+	//由与观察点的水平距离的平方选择块的细节层级。currentLod为块当前的级别，新显示的块为-1，
+	//当前级别的距离范围向两侧放宽LodHysteresis，观察点离开放宽后的范围才切换
+	int32_t SelectChunkLod(int64_t distanceSquared, int32_t currentLod, const GridParam& param);
+
+	//块的尺寸在每个方向上都能被2^lod整除时才能降采样，否则降低级别，例如被世界边界截断的块
+	int32_t ClampChunkLod(int32_t lod, const Int3& chunkSize);
+
+	//grid的外圈为2^lod个格子，每2^lod个格子合并为一个，得到外圈为一个格子的粗网格。
+	//非空白的格子不少于一半时取其中数量最多的材质，否则取数量最多的空白材质
+	void DownsampleGrid(const PaddedChunkGrid& grid, int32_t lod, const std::vector<MaterialType>& materialTypes, std::vector<uint8_t>& scratch, PaddedChunkGrid& outGrid);
+
+	//skirtFaceMask的第i位对应GetFaceNormal(i)，把这些方向上的外圈改为空白，块在这些边界上总是露出面，
+	//遮住与细节层级不同的相邻块之间的缝隙。grid的格子需要存放在scratch中
+	void ApplySkirts(uint8_t skirtFaceMask, const std::vector<MaterialType>& materialTypes, std::vector<uint8_t>& scratch, PaddedChunkGrid& grid);
+
+	//按细节层级收集[minCoordinate, maxCoordinate)的格子，返回实际使用的级别。outGrid中一个格子对应2^lod个格子，
+	//构建网格时块尺寸为(maxCoordinate - minCoordinate) >> lod
+	int32_t GatherLodGrid(const ChunkNeighbourhood& neighbourhood, const Int3& minCoordinate, const Int3& maxCoordinate, int32_t lod,
+		uint8_t skirtFaceMask, const std::vector<MaterialType>& materialTypes, PaddedChunkGrid& outGrid);
+}
+
+#endif
@@ -0,0 +1,245 @@
+// chunkmap.h
+//
+// 与引擎无关的体素核心：以块坐标为键的开放寻址哈希表
+//
+
+#ifndef VOXEL_CHUNKMAP_H
+#define VOXEL_CHUNKMAP_H
+
+#include <assert.h>
+#include <utility>
+#include <vector>
+#include "voxeltypes.h"
+
+namespace voxel
+{
+	//块坐标是GridPerChunk的倍数，低位几乎都是0，先把三个分量混合再用乘法把高位散开
+	inline uint64_t MixInt3(const Int3& v)
+	{
+		uint64_t h = (uint64_t(uint32_t(v.X)) | uint64_t(uint32_t(v.Y)) << 32) ^ uint64_t(uint32_t(v.Z)) * 0x9E3779B97F4A7C15ull;
+		h ^= h >> 29;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 32;
+		return h;
+	}
+
+	//线性探测的哈希表，删除时把后面的元素前移，不留墓碑。容量为2的幂，元素超过3/4时加倍。
+	//插入或删除后之前取得的指针和迭代器失效
+	template <typename T>
+	class ChunkMap
+	{
+	public:
+		struct Slot
+		{
+			Int3 Key;
+
+			T Value;
+
+			bool bOccupied;
+
+			Slot() : bOccupied(false) {}
+		};
+
+		//只访问已占用的槽
+		template <typename SlotType>
+		class IteratorBase
+		{
+		public:
+			IteratorBase(SlotType* slot, SlotType* end) : Current(slot), End(end)
+			{
+				SkipEmpty();
+			}
+
+			SlotType& operator*() const { return *Current; }
+			SlotType* operator->() const { return Current; }
+
+			IteratorBase& operator++()
+			{
+				++Current;
+				SkipEmpty();
+				return *this;
+			}
+
+			bool operator==(const IteratorBase& other) const { return Current == other.Current; }
+			bool operator!=(const IteratorBase& other) const { return Current != other.Current; }
+
+		private:
+			void SkipEmpty()
+			{
+				while (Current != End && !Current->bOccupied)
+					++Current;
+			}
+
+			SlotType* Current;
+
+			SlotType* End;
+		};
+
+		typedef IteratorBase<Slot> Iterator;
+		typedef IteratorBase<const Slot> ConstIterator;
+
+		ChunkMap() : NumElements(0), Mask(0), Shift(64) {}
+
+		size_t Size() const
+		{
+			return NumElements;
+		}
+
+		bool Empty() const
+		{
+			return NumElements == 0;
+		}
+
+		void Clear()
+		{
+			std::vector<Slot>().swap(Slots);
+			NumElements = 0;
+			Mask = 0;
+			Shift = 64;
+		}
+
+		//预留至少numElements个元素的空间
+		void Reserve(size_t numElements)
+		{
+			size_t capacity = 8;
+			while (capacity * 3 < numElements * 4)
+				capacity *= 2;
+			if (capacity > Slots.size())
+				Rehash(capacity);
+		}
+
+		T* Find(const Int3& key)
+		{
+			return const_cast<T*>(static_cast<const ChunkMap*>(this)->Find(key));
+		}
+
+		const T* Find(const Int3& key) const
+		{
+			if (NumElements == 0)
+				return NULL;
+			for (size_t index = GetHomeIndex(key); ; index = (index + 1) & Mask)
+			{
+				const Slot& slot = Slots[index];
+				if (!slot.bOccupied)
+					return NULL;
+				if (slot.Key == key)
+					return &slot.Value;
+			}
+		}
+
+		bool Contains(const Int3& key) const
+		{
+			return Find(key) != NULL;
+		}
+
+		//不存在时插入默认值
+		T& operator[](const Int3& key)
+		{
+			return *Emplace(key).first;
+		}
+
+		//返回值的指针以及是否新插入
+		std::pair<T*, bool> Emplace(const Int3& key)
+		{
+			if ((NumElements + 1) * 4 > Slots.size() * 3)
+				Rehash(Slots.empty() ? 8 : Slots.size() * 2);
+			size_t index = GetHomeIndex(key);
+			for (; Slots[index].bOccupied; index = (index + 1) & Mask)
+			{
+				if (Slots[index].Key == key)
+					return std::make_pair(&Slots[index].Value, false);
+			}
+			Slots[index].Key = key;
+			Slots[index].Value = T();
+			Slots[index].bOccupied = true;
+			++NumElements;
+			return std::make_pair(&Slots[index].Value, true);
+		}
+
+		bool Erase(const Int3& key)
+		{
+			if (NumElements == 0)
+				return false;
+			size_t index = GetHomeIndex(key);
+			for (; ; index = (index + 1) & Mask)
+			{
+				if (!Slots[index].bOccupied)
+					return false;
+				if (Slots[index].Key == key)
+					break;
+			}
+			//后面探测链上的元素如果能放到空出的位置就前移，保证查找遇到空槽即可停止
+			size_t hole = index;
+			for (size_t next = (hole + 1) & Mask; Slots[next].bOccupied; next = (next + 1) & Mask)
+			{
+				size_t home = GetHomeIndex(Slots[next].Key);
+				if (((next - home) & Mask) >= ((next - hole) & Mask))
+				{
+					Slots[hole].Key = Slots[next].Key;
+					Slots[hole].Value = std::move(Slots[next].Value);
+					hole = next;
+				}
+			}
+			Slots[hole].Value = T();
+			Slots[hole].bOccupied = false;
+			--NumElements;
+			return true;
+		}
+
+		//outValues[i]为偏移(i / 9, i / 3 % 3, i % 3) - 1个块处的值，没有时为空，与ChunkNeighbourhood的顺序一致
+		void FindNeighbours(const Int3& coord, const Int3& gridPerChunk, const T* outValues[27]) const
+		{
+			for (int32_t i = 0; i < 27; ++i)
+				outValues[i] = Find(coord + (Int3(i / 9, i / 3 % 3, i % 3) - Int3::Scalar(1)) * gridPerChunk);
+		}
+
+		Iterator begin() { return Iterator(Slots.data(), Slots.data() + Slots.size()); }
+		Iterator end() { return Iterator(Slots.data() + Slots.size(), Slots.data() + Slots.size()); }
+		ConstIterator begin() const { return ConstIterator(Slots.data(), Slots.data() + Slots.size()); }
+		ConstIterator end() const { return ConstIterator(Slots.data() + Slots.size(), Slots.data() + Slots.size()); }
+
+		size_t GetAllocatedSize() const
+		{
+			return Slots.capacity() * sizeof(Slot);
+		}
+
+	private:
+		size_t GetHomeIndex(const Int3& key) const
+		{
+			return size_t(MixInt3(key) >> Shift);
+		}
+
+		void Rehash(size_t capacity)
+		{
+			assert((capacity & (capacity - 1)) == 0);
+			std::vector<Slot> oldSlots(capacity);
+			oldSlots.swap(Slots);
+			Mask = capacity - 1;
+			Shift = 64;
+			for (size_t i = capacity; i > 1; i >>= 1)
+				--Shift;
+			for (size_t i = 0; i < oldSlots.size(); ++i)
+			{
+				if (!oldSlots[i].bOccupied)
+					continue;
+				size_t index = GetHomeIndex(oldSlots[i].Key);
+				while (Slots[index].bOccupied)
+					index = (index + 1) & Mask;
+				Slots[index].Key = oldSlots[i].Key;
+				Slots[index].Value = std::move(oldSlots[i].Value);
+				Slots[index].bOccupied = true;
+			}
+		}
+
+		std::vector<Slot> Slots;
+
+		size_t NumElements;
+
+		size_t Mask;
+
+		//哈希值右移Shift位得到槽的下标，取高位比取低位分布更均匀
+		uint32_t Shift;
+	};
+}
+
+#endif
@@ -0,0 +1,361 @@
+// chunkmesher.cpp
+//
+// 与引擎无关的体素核心：由格子构建块的网格
+//
+
+#include <assert.h>
+#include "chunkmesher.h"
+
+using namespace voxel;
+
+uint8_t voxel::GetFaceCornerIndex(uint8_t faceIndex, uint8_t cornerIndex)
+{
+	static const uint8_t faceCornerIndex[6][4] = {
+		{4, 5, 7, 6},	//+x
+		{0, 2, 3, 1},	//-x
+		{2, 6, 7, 3},	//+y
+		{0, 1, 5, 4},	//-y
+		{1, 3, 7, 5},	//+z
+		{0, 4, 6, 2},	//-z
+	};
+	return faceCornerIndex[faceIndex][cornerIndex];
+}
+
+const Int3& voxel::GetGridAdjGridOffset(uint8_t faceIndex)
+{
+	static const Int3 gridOffset[6] = {
+		Int3(1, 0, 0),		//+x
+		Int3(-1, 0, 0),		//-x
+		Int3(0, 1, 0),		//+y
+		Int3(0, -1, 0),		//-y
+		Int3(0, 0, 1),		//+z
+		Int3(0, 0, -1),		//-z
+	};
+	return gridOffset[faceIndex];
+}
+
+uint8_t voxel::GetAmbientOcclusionFactor(int32_t numOpaqueGrids)
+{
+	static const uint8_t factors[9] = {255, 255, 255, 255, 255, 204, 153, 102, 51};
+	return factors[numOpaqueGrids];
+}
+
+void ChunkMesh::Reset(int32_t numMaterials)
+{
+	Vertices.clear();
+	MaterialBatches.clear();
+	MaterialBatches.resize(numMaterials);
+}
+
+size_t ChunkMesh::GetNumIndices() const
+{
+	size_t indexNum = 0;
+	for (size_t i = 0; i < MaterialBatches.size(); ++i)
+		for (int32_t j = 0; j < 6; ++j)
+			indexNum += MaterialBatches[i].FaceBatches[j].Indices.size();
+	return indexNum;
+}
+
+//一个四边形两个三角形。沿两端更亮的对角线切分，暗的角只影响一个三角形，不同朝向的面插值的效果一致
+static inline void AddQuad(FaceBatch& faceBatch, const uint32_t faceCornerIndices[4], const std::vector<GridVertex>& vertices)
+{
+	int32_t diagonal02 = vertices[faceCornerIndices[0]].AmbientOcclusionFactor + vertices[faceCornerIndices[2]].AmbientOcclusionFactor;
+	int32_t diagonal13 = vertices[faceCornerIndices[1]].AmbientOcclusionFactor + vertices[faceCornerIndices[3]].AmbientOcclusionFactor;
+	int32_t first = diagonal13 > diagonal02 ? 1 : 0;
+	size_t start = faceBatch.Indices.size();
+	faceBatch.Indices.resize(start + 6);
+	uint32_t* indices = &faceBatch.Indices[start];
+	*(indices++) = faceCornerIndices[first];
+	*(indices++) = faceCornerIndices[first + 1];
+	*(indices++) = faceCornerIndices[first + 2];
+	*(indices++) = faceCornerIndices[first];
+	*(indices++) = faceCornerIndices[first + 2];
+	*(indices++) = faceCornerIndices[(first + 3) & 3];
+}
+
+//顶点相邻八个格子在收集数组中的偏移
+static void GetVertexAdjGridOffsets(const PaddedChunkGrid& grid, int32_t outOffsets[8])
+{
+	for (int32_t i = 0; i < 8; ++i)
+	{
+		Int3 offset = GetVertexAdjGridOffset(i) + Int3::Scalar(1);
+		outOffsets[i] = grid.GetIndex(offset.X, offset.Y, offset.Z);
+	}
+}
+
+//逐个格子生成面，每个露出的面两个三角形
+static void BuildVoxelFaces(const PaddedChunkGrid& grid, const std::vector<MaterialType>& materialType,
+	const Int3& chunkSize, bool ambientOcclusion, ChunkMesh& mesh)
+{
+	//顶点相邻八个格子、格子六个相邻格子在收集数组中的偏移
+	int32_t vertexAdjGridOffsets[8];
+	GetVertexAdjGridOffsets(grid, vertexAdjGridOffsets);
+	int32_t gridAdjGridOffsets[6];
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		const Int3& offset = GetGridAdjGridOffset(i);
+		gridAdjGridOffsets[i] = grid.GetIndex(offset.X, offset.Y, offset.Z);
+	}
+
+	std::vector<uint32_t> indexBuffer;
+	indexBuffer.reserve((chunkSize.X + 1) * (chunkSize.Y + 1) * (chunkSize.Z + 1));
+	//对于每个点，遍历相领的八个格子，看该点是否需要加到顶点buffer
+	for (int32_t x = 0; x <= chunkSize.X; ++x)
+	{
+		for (int32_t y = 0; y <= chunkSize.Y; ++y)
+		{
+			for (int32_t z = 0; z <= chunkSize.Z; ++z)
+			{
+				int32_t baseIndex = grid.GetIndex(x, y, z);
+				bool hasMatrialType[MT_Count] = { false };
+				int32_t numOpaqueGrids = 0;
+				for (int32_t i = 0; i < 8; ++i)
+				{
+					uint8_t matrialIndex = grid.Get(baseIndex + vertexAdjGridOffsets[i]);
+					hasMatrialType[materialType[matrialIndex]] = true;
+					numOpaqueGrids += materialType[matrialIndex] == MT_Opaque ? 1 : 0;
+				}
+				//如果相邻的八个格子有一种以上种类的材质，则该顶点需要显示
+				uint8_t typeCnt = 0;
+				for (int32_t i = 0; i < MT_Count; i++)
+					if (hasMatrialType[i])
+						++typeCnt;
+				if (typeCnt > 1)
+				{
+					indexBuffer.push_back(uint32_t(mesh.Vertices.size()));
+					mesh.Vertices.push_back(GridVertex(Int3(x, y, z), ambientOcclusion ? GetAmbientOcclusionFactor(numOpaqueGrids) : 255));
+				}
+				else
+				{
+					indexBuffer.push_back(0);
+				}
+			}
+		}
+	}
+	//对于每个格子，遍历其六个面，看该面是否需要显示
+	for (int32_t x = 0; x < chunkSize.X; ++x)
+	{
+		for (int32_t y = 0; y < chunkSize.Y; y++)
+		{
+			for (int32_t z = 0; z < chunkSize.Z; ++z)
+			{
+				int32_t gridIndex = grid.GetIndex(x + 1, y + 1, z + 1);
+				uint8_t materialIndex = grid.Get(gridIndex);
+				if (materialType[materialIndex] == MT_Empty)
+					continue;
+				for (int32_t i = 0; i < 6; ++i)
+				{
+					uint8_t adjMaterialIndex = grid.Get(gridIndex + gridAdjGridOffsets[i]);
+
+					//如果当前格子比这个面的相邻格子更加的不透明，则这个面需要渲染
+					if (materialType[materialIndex] > materialType[adjMaterialIndex])
+					{
+						//当前面的四个顶点
+						uint32_t faceCornerIndices[4];
+						for (int32_t j = 0; j < 4; ++j)
+						{
+							Int3 offset = Int3(x, y, z) + GetGridCornerOffset(GetFaceCornerIndex(i, j));
+							faceCornerIndices[j] = indexBuffer[(offset.X * (chunkSize.Y + 1) + offset.Y) * (chunkSize.Z + 1) + offset.Z];
+						}
+						AddQuad(mesh.MaterialBatches[materialIndex].FaceBatches[i], faceCornerIndices, mesh.Vertices);
+					}
+				}
+			}
+		}
+	}
+}
+
+//贪心合并：同一平面上相邻、材质和朝向都相同的面合并成尽量大的矩形，只为矩形的角创建顶点。
+//计算环境光遮蔽时，只有四个角遮蔽相同的面才能与遮蔽也相同的面合并，矩形内部的插值与不合并时一致
+static void BuildGreedyFaces(const PaddedChunkGrid& grid, const std::vector<MaterialType>& materialType,
+	const Int3& chunkSize, bool ambientOcclusion, ChunkMesh& mesh)
+{
+	const uint32_t invalidVertex = 0xffffffff;
+	int32_t vertexNum = (chunkSize.X + 1) * (chunkSize.Y + 1) * (chunkSize.Z + 1);
+	std::vector<uint32_t> vertexIndices(vertexNum, invalidVertex);
+	//每个格点的遮蔽系数
+	std::vector<uint8_t> occlusionFactors(vertexNum, 255);
+	if (ambientOcclusion)
+	{
+		int32_t vertexAdjGridOffsets[8];
+		GetVertexAdjGridOffsets(grid, vertexAdjGridOffsets);
+		uint8_t* factor = occlusionFactors.data();
+		for (int32_t x = 0; x <= chunkSize.X; ++x)
+		{
+			for (int32_t y = 0; y <= chunkSize.Y; ++y)
+			{
+				for (int32_t z = 0; z <= chunkSize.Z; ++z)
+				{
+					int32_t baseIndex = grid.GetIndex(x, y, z);
+					int32_t numOpaqueGrids = 0;
+					for (int32_t i = 0; i < 8; ++i)
+						numOpaqueGrids += materialType[grid.Get(baseIndex + vertexAdjGridOffsets[i])] == MT_Opaque ? 1 : 0;
+					*(factor++) = GetAmbientOcclusionFactor(numOpaqueGrids);
+				}
+			}
+		}
+	}
+	//mask低16位存材质下标+1，0表示该位置没有面；再往上8位存四个角相同的遮蔽系数，四个角不同时置上unmergeable，不与其它面合并
+	const uint32_t unmergeable = 1u << 24;
+	std::vector<uint32_t> mask;
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		int32_t axis = i / 2;
+		int32_t uAxis = (axis + 1) % 3;
+		int32_t vAxis = (axis + 2) % 3;
+		int32_t uSize = chunkSize[uAxis];
+		int32_t vSize = chunkSize[vAxis];
+		const Int3& adjOffset = GetGridAdjGridOffset(i);
+		int32_t adjGridOffset = grid.GetIndex(adjOffset.X, adjOffset.Y, adjOffset.Z);
+		mask.assign(uSize * vSize, 0);
+		for (int32_t d = 0; d < chunkSize[axis]; ++d)
+		{
+			Int3 gridPos = Int3::Scalar(0);
+			gridPos[axis] += d;
+			for (int32_t v = 0; v < vSize; ++v)
+			{
+				for (int32_t u = 0; u < uSize; ++u)
+				{
+					Int3 curGridPos = gridPos + Int3::Scalar(1);
+					curGridPos[uAxis] += u;
+					curGridPos[vAxis] += v;
+					int32_t gridIndex = grid.GetIndex(curGridPos.X, curGridPos.Y, curGridPos.Z);
+					uint8_t materialIndex = grid.Get(gridIndex);
+					uint8_t adjMaterialIndex = grid.Get(gridIndex + adjGridOffset);
+					if (materialType[materialIndex] <= materialType[adjMaterialIndex])
+					{
+						mask[v * uSize + u] = 0;
+						continue;
+					}
+					uint32_t face = materialIndex + 1;
+					if (ambientOcclusion)
+					{
+						uint8_t cornerFactors[4];
+						for (int32_t j = 0; j < 4; ++j)
+						{
+							Int3 offset = curGridPos - Int3::Scalar(1) + GetGridCornerOffset(GetFaceCornerIndex(i, j));
+							cornerFactors[j] = occlusionFactors[(offset.X * (chunkSize.Y + 1) + offset.Y) * (chunkSize.Z + 1) + offset.Z];
+						}
+						bool uniform = cornerFactors[0] == cornerFactors[1] && cornerFactors[0] == cornerFactors[2] && cornerFactors[0] == cornerFactors[3];
+						face |= uniform ? uint32_t(cornerFactors[0]) << 16 : unmergeable;
+					}
+					mask[v * uSize + u] = face;
+				}
+			}
+			for (int32_t v = 0; v < vSize; ++v)
+			{
+				for (int32_t u = 0; u < uSize;)
+				{
+					uint32_t face = mask[v * uSize + u];
+					if (face == 0)
+					{
+						++u;
+						continue;
+					}
+					//先沿u方向延伸，再逐行沿v方向延伸
+					bool mergeable = (face & unmergeable) == 0;
+					int32_t width = 1;
+					while (mergeable && u + width < uSize && mask[v * uSize + u + width] == face)
+						++width;
+					int32_t height = 1;
+					for (; mergeable && v + height < vSize; ++height)
+					{
+						int32_t k = 0;
+						while (k < width && mask[(v + height) * uSize + u + k] == face)
+							++k;
+						if (k < width)
+							break;
+					}
+					for (int32_t h = 0; h < height; ++h)
+						for (int32_t k = 0; k < width; ++k)
+							mask[(v + h) * uSize + u + k] = 0;
+
+					Int3 rectPos = gridPos;
+					rectPos[uAxis] += u;
+					rectPos[vAxis] += v;
+					Int3 rectExtent = Int3::Scalar(1);
+					rectExtent[uAxis] = width;
+					rectExtent[vAxis] = height;
+					uint32_t faceCornerIndices[4];
+					for (int32_t j = 0; j < 4; ++j)
+					{
+						Int3 offset = rectPos + GetGridCornerOffset(GetFaceCornerIndex(i, j)) * rectExtent;
+						int32_t vertexOffset = (offset.X * (chunkSize.Y + 1) + offset.Y) * (chunkSize.Z + 1) + offset.Z;
+						uint32_t& vertexIndex = vertexIndices[vertexOffset];
+						if (vertexIndex == invalidVertex)
+						{
+							vertexIndex = uint32_t(mesh.Vertices.size());
+							mesh.Vertices.push_back(GridVertex(offset, occlusionFactors[vertexOffset]));
+						}
+						faceCornerIndices[j] = vertexIndex;
+					}
+					AddQuad(mesh.MaterialBatches[(face & 0xffff) - 1].FaceBatches[i], faceCornerIndices, mesh.Vertices);
+					u += width;
+				}
+			}
+		}
+	}
+}
+
+uint8_t voxel::GetFacingFaceMask(const double viewPosition[3], const Int3& chunkSize)
+{
+	uint8_t mask = 0;
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		//正方向的面在块的最小面之上，观察点高于最小面时可能看到，负方向的面同理
+		if (viewPosition[axis] > 0.0)
+			mask |= 1 << (axis * 2);
+		if (viewPosition[axis] < double(chunkSize[axis]))
+			mask |= 1 << (axis * 2 + 1);
+	}
+	return mask;
+}
+
+uint8_t voxel::GetFacingFaceMaskForDirection(const double viewDirection[3])
+{
+	uint8_t mask = 0;
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		//与观察方向垂直的面两侧都保留
+		if (viewDirection[axis] <= 0.0)
+			mask |= 1 << (axis * 2);
+		if (viewDirection[axis] >= 0.0)
+			mask |= 1 << (axis * 2 + 1);
+	}
+	return mask;
+}
+
+bool voxel::HasNonEmptyGrid(const ChunkData& data, const std::vector<MaterialType>& materialTypes, const Int3& minOffset, const Int3& maxOffset)
+{
+	if (data.Grids.IsUniform())
+		return materialTypes[data.Grids.Get(0)] != MT_Empty;
+	//调色板里都是空白材质时不用逐个格子检查
+	const std::vector<uint8_t>& palette = data.Grids.GetPalette();
+	bool hasNonEmptyMaterial = false;
+	for (size_t i = 0; i < palette.size(); ++i)
+		hasNonEmptyMaterial |= materialTypes[palette[i]] != MT_Empty;
+	if (!hasNonEmptyMaterial)
+		return false;
+	for (int32_t x = minOffset.X; x < maxOffset.X; ++x)
+	{
+		for (int32_t y = minOffset.Y; y < maxOffset.Y; ++y)
+		{
+			for (int32_t z = minOffset.Z; z < maxOffset.Z; ++z)
+			{
+				if (materialTypes[data.GetMaterialIndex(Int3(x, y, z))] != MT_Empty)
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void voxel::BuildChunkMesh(const PaddedChunkGrid& grid, const Int3& chunkSize, const MeshSettings& settings, ChunkMesh& outMesh)
+{
+	assert(chunkSize.X <= MaxMeshChunkSize && chunkSize.Y <= MaxMeshChunkSize && chunkSize.Z <= MaxMeshChunkSize);
+	outMesh.Reset(int32_t(settings.MaterialTypes.size()));
+	if (settings.GreedyMeshing)
+		BuildGreedyFaces(grid, settings.MaterialTypes, chunkSize, settings.AmbientOcclusion, outMesh);
+	else
+		BuildVoxelFaces(grid, settings.MaterialTypes, chunkSize, settings.AmbientOcclusion, outMesh);
+}
@@ -0,0 +1,120 @@
+// chunkmesher.h
+//
+// 与引擎无关的体素核心：由格子构建块的网格
+//
+
+#ifndef VOXEL_CHUNKMESHER_H
+#define VOXEL_CHUNKMESHER_H
+
+#include <vector>
+#include "chunkneighbourhood.h"
+
+namespace voxel
+{
+	//获取立方体格子各个顶点的偏移
+	inline Int3 GetGridCornerOffset(uint8_t cornerIndex)
+	{
+		return (Int3::Scalar(cornerIndex) >> Int3(2, 1, 0)) & Int3::Scalar(1);
+	}
+
+	//获取顶点相邻的格子的偏移
+	inline Int3 GetVertexAdjGridOffset(uint8_t gridIndex)
+	{
+		return ((Int3::Scalar(gridIndex) >> Int3(2, 1, 0)) & Int3::Scalar(1)) + Int3::Scalar(-1);
+	}
+
+	//获取立方体格子某个面的某个顶点的偏移
+	uint8_t GetFaceCornerIndex(uint8_t faceIndex, uint8_t cornerIndex);
+
+	//获取立方体格子相邻的格子的偏移，即面的法线
+	const Int3& GetGridAdjGridOffset(uint8_t faceIndex);
+
+	inline const Int3& GetFaceNormal(uint8_t faceIndex)
+	{
+		return GetGridAdjGridOffset(faceIndex);
+	}
+
+	//GridVertex的坐标用uint8存储，块每个方向最多这么多格子
+	const int32_t MaxMeshChunkSize = 255;
+
+	//顶点坐标为块内的格点，渲染时整体缩放
+	struct GridVertex
+	{
+		uint8_t X;
+		uint8_t Y;
+		uint8_t Z;
+		//环境光遮蔽系数，255为不遮蔽，越小越暗
+		uint8_t AmbientOcclusionFactor;
+
+		GridVertex(const Int3& coordinate, uint8_t ambientOcclusionFactor = 255) :
+			X(uint8_t(coordinate.X)), Y(uint8_t(coordinate.Y)), Z(uint8_t(coordinate.Z)), AmbientOcclusionFactor(ambientOcclusionFactor)
+		{}
+	};
+
+	//由顶点相邻八个格子中不透明格子的数量得到环境光遮蔽系数。平面上的顶点有四个不透明格子，不变暗
+	uint8_t GetAmbientOcclusionFactor(int32_t numOpaqueGrids);
+
+	//网格构建时总是使用32位索引，上传时顶点数不超过65536的网格再转为16位
+	struct FaceBatch
+	{
+		std::vector<uint32_t> Indices;
+	};
+
+	//按材质、再按面的朝向分组的索引
+	struct MaterialBatch
+	{
+		FaceBatch FaceBatches[6];
+	};
+
+	struct ChunkMesh
+	{
+		std::vector<GridVertex> Vertices;
+
+		std::vector<MaterialBatch> MaterialBatches;
+
+		void Reset(int32_t numMaterials);
+
+		size_t GetNumIndices() const;
+
+		size_t GetNumTriangles() const
+		{
+			return GetNumIndices() / 3;
+		}
+
+		//顶点数超过16位索引能表示的范围，需要32位索引
+		bool Requires32BitIndices() const
+		{
+			return Vertices.size() > 65536;
+		}
+	};
+
+	//构建网格时使用的参数
+	struct MeshSettings
+	{
+		//每种材质下标的透明程度
+		std::vector<MaterialType> MaterialTypes;
+
+		//合并同一平面上材质相同的面，减少顶点和三角形数量
+		bool GreedyMeshing;
+
+		//计算顶点的环境光遮蔽。贪心合并时只合并四个角遮蔽相同的面
+		bool AmbientOcclusion;
+
+		MeshSettings() : GreedyMeshing(false), AmbientOcclusion(true) {}
+	};
+
+	//朝向观察点的面的方向掩码，第i位对应GetFaceNormal(i)。viewPosition是以块最小角为原点的格子坐标，
+	//同一方向的面分布在块内不同的平面上，观察点在块的某个方向的范围内时这个方向两侧的面都保留
+	uint8_t GetFacingFaceMask(const double viewPosition[3], const Int3& chunkSize);
+
+	//平行投影时只由观察方向决定，viewDirection为从观察点看出去的方向
+	uint8_t GetFacingFaceMaskForDirection(const double viewDirection[3]);
+
+	//块中[minOffset, maxOffset)范围内是否有非空白的格子，没有时不需要构建网格
+	bool HasNonEmptyGrid(const ChunkData& data, const std::vector<MaterialType>& materialTypes, const Int3& minOffset, const Int3& maxOffset);
+
+	//由收集好的格子构建块的网格，chunkSize为不含外圈的尺寸。每个方向最多MaxMeshChunkSize个格子
+	void BuildChunkMesh(const PaddedChunkGrid& grid, const Int3& chunkSize, const MeshSettings& settings, ChunkMesh& outMesh);
+}
+
+#endif
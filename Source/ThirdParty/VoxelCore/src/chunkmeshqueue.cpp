@@ -0,0 +1,63 @@
+// chunkmeshqueue.cpp
+//
+// 与引擎无关的体素核心：在后台构建块的网格，旧的网格在新的网格完成前继续显示
+//
+
+#include <assert.h>
+#include "chunklod.h"
+#include "chunkmeshqueue.h"
+
+using namespace voxel;
+
+ChunkMeshQueue::ChunkMeshQueue(const TaskDispatcher& dispatcher) :
+	Dispatcher(dispatcher), Shared(std::make_shared<SharedState>()), NextVersion(1)
+{
+	assert(Dispatcher);
+}
+
+void ChunkMeshQueue::Request(const ChunkNeighbourhood& neighbourhood, const Int3& minCoordinate, const Int3& maxCoordinate, int32_t lod,
+	uint8_t skirtFaceMask, const MeshSettings& settings)
+{
+	uint64_t version = NextVersion++;
+	LatestVersions[neighbourhood.Coordinate] = version;
+	std::shared_ptr<SharedState> shared = Shared;
+	Dispatcher([neighbourhood, minCoordinate, maxCoordinate, lod, skirtFaceMask, settings, version, shared]() {
+		BuiltChunkMeshPtr built = std::make_shared<BuiltChunkMesh>();
+		built->Coordinate = neighbourhood.Coordinate;
+		built->MeshOffset = minCoordinate - neighbourhood.Coordinate;
+		built->Lod = ClampChunkLod(lod, maxCoordinate - minCoordinate);
+		built->MeshSize = (maxCoordinate - minCoordinate) >> Int3::Scalar(built->Lod);
+		const ChunkData* center = neighbourhood.GetCenter();
+		if (center && HasNonEmptyGrid(*center, settings.MaterialTypes, built->MeshOffset, maxCoordinate - neighbourhood.Coordinate))
+		{
+			PaddedChunkGrid grid;
+			GatherLodGrid(neighbourhood, minCoordinate, maxCoordinate, built->Lod, skirtFaceMask, settings.MaterialTypes, grid);
+			BuildChunkMesh(grid, built->MeshSize, settings, built->Mesh);
+		}
+		std::lock_guard<std::mutex> lock(shared->Mutex);
+		shared->Completed.push_back(std::make_pair(version, built));
+	});
+}
+
+void ChunkMeshQueue::Cancel(const Int3& coord)
+{
+	LatestVersions.erase(coord);
+}
+
+void ChunkMeshQueue::PopCompleted(std::vector<BuiltChunkMeshPtr>& outMeshes)
+{
+	std::vector<std::pair<uint64_t, BuiltChunkMeshPtr> > completed;
+	{
+		std::lock_guard<std::mutex> lock(Shared->Mutex);
+		completed.swap(Shared->Completed);
+	}
+	for (size_t i = 0; i < completed.size(); ++i)
+	{
+		const Int3& coord = completed[i].second->Coordinate;
+		std::unordered_map<Int3, uint64_t, Int3Hash>::iterator it = LatestVersions.find(coord);
+		if (it == LatestVersions.end() || it->second != completed[i].first)
+			continue;
+		LatestVersions.erase(it);
+		outMeshes.push_back(completed[i].second);
+	}
+}
@@ -0,0 +1,84 @@
+// chunkmeshqueue.h
+//
+// 与引擎无关的体素核心：在后台构建块的网格，旧的网格在新的网格完成前继续显示
+//
+
+#ifndef VOXEL_CHUNKMESHQUEUE_H
+#define VOXEL_CHUNKMESHQUEUE_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "chunkgenerationqueue.h"
+#include "chunkmesher.h"
+
+namespace voxel
+{
+	//后台构建完的网格
+	struct BuiltChunkMesh
+	{
+		Int3 Coordinate;
+
+		//网格的最小角相对块坐标的偏移，格子坐标
+		Int3 MeshOffset;
+
+		//网格的尺寸，一个单位为2^Lod个格子
+		Int3 MeshSize;
+
+		int32_t Lod;
+
+		ChunkMesh Mesh;
+	};
+
+	typedef std::shared_ptr<BuiltChunkMesh> BuiltChunkMeshPtr;
+
+	//在后台构建块的网格，同一个块请求多次时只保留最后一次请求的结果，除后台任务外都在主线程调用。
+	//调用者在同一个块的结果取回前不再请求，连续修改时结果总是比正在显示的新，不会因为不断被新的请求替换而一直不更新
+	class ChunkMeshQueue
+	{
+	public:
+		explicit ChunkMeshQueue(const TaskDispatcher& dispatcher);
+
+		//neighbourhood是在主线程收集的快照，之后修改块数据需要换一份新的数据。为[minCoordinate, maxCoordinate)的格子构建网格，
+		//在世界边界上可以小于块。lod会按尺寸限制，没有非空白的格子时结果的网格为空
+		void Request(const ChunkNeighbourhood& neighbourhood, const Int3& minCoordinate, const Int3& maxCoordinate, int32_t lod,
+			uint8_t skirtFaceMask, const MeshSettings& settings);
+
+		//还没取回的结果丢弃
+		void Cancel(const Int3& coord);
+
+		void PopCompleted(std::vector<BuiltChunkMeshPtr>& outMeshes);
+
+		//请求过、结果还没有取回
+		bool IsRequested(const Int3& coord) const
+		{
+			return LatestVersions.count(coord) != 0;
+		}
+
+		size_t GetNumRequested() const
+		{
+			return LatestVersions.size();
+		}
+
+	private:
+		//后台线程与队列共享的完成列表，队列销毁后仍在运行的任务也能安全地写入
+		struct SharedState
+		{
+			std::mutex Mutex;
+
+			std::vector<std::pair<uint64_t, BuiltChunkMeshPtr> > Completed;
+		};
+
+		TaskDispatcher Dispatcher;
+
+		std::shared_ptr<SharedState> Shared;
+
+		//每个块最后一次请求的序号，完成的结果序号不同时已经过期
+		std::unordered_map<Int3, uint64_t, Int3Hash> LatestVersions;
+
+		uint64_t NextVersion;
+	};
+}
+
+#endif
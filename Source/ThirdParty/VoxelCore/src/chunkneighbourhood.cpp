@@ -0,0 +1,57 @@
+// chunkneighbourhood.cpp
+//
+// 与引擎无关的体素核心：收集块以及外围一圈格子
+//
+
+#include <assert.h>
+#include "chunkneighbourhood.h"
+
+using namespace voxel;
+
+void ChunkNeighbourhood::Gather(const Int3& minCoordinate, const Int3& maxCoordinate, int32_t padding, std::vector<uint8_t>& scratch, PaddedChunkGrid& outGrid) const
+{
+	outGrid.Size = maxCoordinate - minCoordinate + Int3::Scalar(padding * 2);
+	outGrid.StrideY = outGrid.Size.Z;
+	outGrid.StrideX = outGrid.Size.Y * outGrid.Size.Z;
+	scratch.resize(outGrid.Size.Volume());
+
+	//每个轴上每个坐标所在的相邻块(0到2)以及在块内的偏移，三个轴互相独立
+	std::vector<int32_t> chunkSlots[3];
+	std::vector<int32_t> chunkOffsets[3];
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		int32_t gridPerChunk = GridPerChunk[axis];
+		int32_t chunkCoord = Coordinate[axis];
+		assert(padding <= gridPerChunk);
+		int32_t minCoord = minCoordinate[axis] - padding;
+		chunkSlots[axis].reserve(outGrid.Size[axis]);
+		chunkOffsets[axis].reserve(outGrid.Size[axis]);
+		for (int32_t i = 0; i < outGrid.Size[axis]; ++i)
+		{
+			int32_t chunkIndex = FloorDivide(minCoord + i, gridPerChunk);
+			chunkSlots[axis].push_back(chunkIndex - chunkCoord / gridPerChunk + 1);
+			chunkOffsets[axis].push_back(minCoord + i - chunkIndex * gridPerChunk);
+		}
+	}
+
+	uint8_t* dest = scratch.data();
+	for (int32_t x = 0; x < outGrid.Size.X; ++x)
+	{
+		for (int32_t y = 0; y < outGrid.Size.Y; ++y)
+		{
+			int32_t columnSlot = chunkSlots[0][x] * 9 + chunkSlots[1][y] * 3;
+			for (int32_t z = 0; z < outGrid.Size.Z; ++z)
+			{
+				const ChunkData* data = Chunks[columnSlot + chunkSlots[2][z]].get();
+				*dest++ = data ? data->GetMaterialIndex(Int3(chunkOffsets[0][x], chunkOffsets[1][y], chunkOffsets[2][z])) : 0;
+			}
+		}
+	}
+	outGrid.Grids = scratch.data();
+}
+
+std::vector<uint8_t>& voxel::GetPaddedGridScratch()
+{
+	static thread_local std::vector<uint8_t> scratch;
+	return scratch;
+}
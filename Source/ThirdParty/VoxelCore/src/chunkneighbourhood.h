@@ -0,0 +1,72 @@
+// chunkneighbourhood.h
+//
+// 与引擎无关的体素核心：收集块以及外围一圈格子
+//
+
+#ifndef VOXEL_CHUNKNEIGHBOURHOOD_H
+#define VOXEL_CHUNKNEIGHBOURHOOD_H
+
+#include <vector>
+#include "chunkdata.h"
+
+namespace voxel
+{
+	//块以及外围一圈格子的材质下标，连续存放，构建网格时用固定步长访问相邻格子
+	struct PaddedChunkGrid
+	{
+		//包含外圈的尺寸，外圈为一个格子时即块尺寸+2
+		Int3 Size;
+
+		int32_t StrideX;
+
+		int32_t StrideY;
+
+		const uint8_t* Grids;
+
+		//x, y, z为包含外圈的坐标，0对应块的最小坐标-1
+		inline int32_t GetIndex(int32_t x, int32_t y, int32_t z) const
+		{
+			return x * StrideX + y * StrideY + z;
+		}
+
+		inline uint8_t Get(int32_t index) const
+		{
+			return Grids[index];
+		}
+	};
+
+	//某个块以及周围26个块的数据，在主线程收集好后交给后台线程构建网格，后台线程不再读取块的索引表
+	struct ChunkNeighbourhood
+	{
+		Int3 Coordinate;
+
+		Int3 GridPerChunk;
+
+		//按(x, y, z)各-1到1排列，没有数据的块为空
+		ChunkDataPtr Chunks[27];
+
+		static int32_t GetSlot(int32_t x, int32_t y, int32_t z)
+		{
+			return ((x + 1) * 3 + y + 1) * 3 + z + 1;
+		}
+
+		const ChunkData* GetCenter() const
+		{
+			return Chunks[13].get();
+		}
+
+		//把[minCoordinate - 1, maxCoordinate]范围内的格子收集到scratch中，scratch由调用者复用
+		void Gather(const Int3& minCoordinate, const Int3& maxCoordinate, std::vector<uint8_t>& scratch, PaddedChunkGrid& outGrid) const
+		{
+			Gather(minCoordinate, maxCoordinate, 1, scratch, outGrid);
+		}
+
+		//外圈为padding个格子，收集[minCoordinate - padding, maxCoordinate + padding)，padding不超过块的尺寸
+		void Gather(const Int3& minCoordinate, const Int3& maxCoordinate, int32_t padding, std::vector<uint8_t>& scratch, PaddedChunkGrid& outGrid) const;
+	};
+
+	//每个线程复用同一块收集用的缓冲区
+	std::vector<uint8_t>& GetPaddedGridScratch();
+}
+
+#endif
@@ -0,0 +1,92 @@
+// chunkstorage.cpp
+//
+// 与引擎无关的体素核心：按调色板压缩的格子材质存储
+//
+
+#include <assert.h>
+#include <algorithm>
+#include "chunkstorage.h"
+
+using namespace voxel;
+
+void ChunkStorage::Init(int32_t numGrids, uint8_t materialIndex)
+{
+	NumGrids = numGrids;
+	BitsPerGrid = 0;
+	Palette.assign(1, materialIndex);
+	std::vector<uint32_t>().swap(Words);
+}
+
+void ChunkStorage::Set(int32_t index, uint8_t materialIndex)
+{
+	assert(index >= 0 && index < NumGrids);
+	std::vector<uint8_t>::iterator it = std::find(Palette.begin(), Palette.end(), materialIndex);
+	uint32_t paletteIndex = uint32_t(it - Palette.begin());
+	if (it == Palette.end())
+	{
+		Palette.push_back(materialIndex);
+		//调色板超出当前位宽能表示的范围时加宽
+		uint8_t newBitsPerGrid = BitsPerGrid;
+		while ((1u << newBitsPerGrid) < Palette.size())
+			newBitsPerGrid = newBitsPerGrid ? newBitsPerGrid * 2 : 1;
+		if (newBitsPerGrid != BitsPerGrid)
+			Repack(newBitsPerGrid);
+	}
+	else if (BitsPerGrid == 0)
+	{
+		return;
+	}
+	uint32_t bitIndex = uint32_t(index) * BitsPerGrid;
+	uint32_t mask = ((1u << BitsPerGrid) - 1) << (bitIndex & 31);
+	uint32_t& word = Words[bitIndex >> 5];
+	word = (word & ~mask) | (paletteIndex << (bitIndex & 31));
+}
+
+void ChunkStorage::Assign(const uint8_t* materialIndices, int32_t numGrids)
+{
+	//调色板按材质第一次出现的顺序排列，与从第一个格子开始逐个Set的结果相同
+	int32_t paletteIndices[256];
+	std::fill_n(paletteIndices, 256, -1);
+	Palette.clear();
+	for (int32_t index = 0; index < numGrids; ++index)
+	{
+		uint8_t materialIndex = materialIndices[index];
+		if (paletteIndices[materialIndex] < 0)
+		{
+			paletteIndices[materialIndex] = int32_t(Palette.size());
+			Palette.push_back(materialIndex);
+		}
+	}
+	if (Palette.size() <= 1)
+	{
+		Init(numGrids, numGrids > 0 ? materialIndices[0] : 0);
+		return;
+	}
+	NumGrids = numGrids;
+	BitsPerGrid = 1;
+	while ((1u << BitsPerGrid) < Palette.size())
+		BitsPerGrid *= 2;
+	Words.assign((uint32_t(NumGrids) * BitsPerGrid + 31) / 32, 0);
+	for (int32_t index = 0; index < NumGrids; ++index)
+	{
+		uint32_t bitIndex = uint32_t(index) * BitsPerGrid;
+		Words[bitIndex >> 5] |= uint32_t(paletteIndices[materialIndices[index]]) << (bitIndex & 31);
+	}
+}
+
+void ChunkStorage::Repack(uint8_t newBitsPerGrid)
+{
+	std::vector<uint32_t> newWords((uint32_t(NumGrids) * newBitsPerGrid + 31) / 32, 0);
+	if (BitsPerGrid != 0)
+	{
+		for (int32_t index = 0; index < NumGrids; ++index)
+		{
+			uint32_t oldBitIndex = uint32_t(index) * BitsPerGrid;
+			uint32_t paletteIndex = (Words[oldBitIndex >> 5] >> (oldBitIndex & 31)) & ((1u << BitsPerGrid) - 1);
+			uint32_t newBitIndex = uint32_t(index) * newBitsPerGrid;
+			newWords[newBitIndex >> 5] |= paletteIndex << (newBitIndex & 31);
+		}
+	}
+	Words.swap(newWords);
+	BitsPerGrid = newBitsPerGrid;
+}
@@ -0,0 +1,65 @@
+// chunkstorage.h
+//
+// 与引擎无关的体素核心：按调色板压缩的格子材质存储
+//
+
+#ifndef VOXEL_CHUNKSTORAGE_H
+#define VOXEL_CHUNKSTORAGE_H
+
+#include <vector>
+#include "voxeltypes.h"
+
+namespace voxel
+{
+	//每个块只记录用到的材质，格子里存调色板下标，位宽按1/2/4/8位自动加宽；整块只有一种材质时不分配格子数组
+	class ChunkStorage
+	{
+	public:
+		ChunkStorage() : NumGrids(0), BitsPerGrid(0) {}
+
+		//所有格子设为同一种材质
+		void Init(int32_t numGrids, uint8_t materialIndex);
+
+		inline uint8_t Get(int32_t index) const
+		{
+			if (BitsPerGrid == 0)
+				return Palette[0];
+			uint32_t bitIndex = uint32_t(index) * BitsPerGrid;
+			uint32_t paletteIndex = (Words[bitIndex >> 5] >> (bitIndex & 31)) & ((1u << BitsPerGrid) - 1);
+			return Palette[paletteIndex];
+		}
+
+		void Set(int32_t index, uint8_t materialIndex);
+
+		//由每个格子的材质一次建立调色板和下标，位宽直接取最终需要的，不会像逐个Set那样反复加宽重新打包
+		void Assign(const uint8_t* materialIndices, int32_t numGrids);
+
+		bool IsUniform() const { return BitsPerGrid == 0; }
+
+		int32_t Num() const { return NumGrids; }
+
+		uint8_t GetBitsPerGrid() const { return BitsPerGrid; }
+
+		const std::vector<uint8_t>& GetPalette() const { return Palette; }
+
+		size_t GetAllocatedSize() const
+		{
+			return Palette.capacity() * sizeof(uint8_t) + Words.capacity() * sizeof(uint32_t);
+		}
+
+	private:
+		//把下标重新打包为新的位宽
+		void Repack(uint8_t newBitsPerGrid);
+
+		std::vector<uint8_t> Palette;
+
+		//位宽整除32，一个下标不会跨越两个字
+		std::vector<uint32_t> Words;
+
+		int32_t NumGrids;
+
+		uint8_t BitsPerGrid;
+	};
+}
+
+#endif
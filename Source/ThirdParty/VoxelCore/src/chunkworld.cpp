@@ -0,0 +1,817 @@
+// chunkworld.cpp
+//
+// 与引擎无关的体素核心：管理所有块的数据以及需要显示的块
+//
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include "chunklod.h"
+#include "chunkmesher.h"
+#include "chunkworld.h"
+
+using namespace voxel;
+
+ChunkWorld::ChunkWorld(const GridParam& param, const TaskDispatcher& dispatcher) :
+	Param(param), NextViewerId(0), DefaultViewerId(-1), bViewersChanged(false), bLodParamChanged(false), GenerationQueue(param, dispatcher),
+	CollisionQueue(GenerationQueue.GetDispatcher())
+{
+}
+
+//索引为rowY的一行块中，与中心块的距离小于radius的块的列范围[outMinX, outMaxX]，为空时outMinX > outMaxX。距离为块中心之间的格子距离
+static void GetDiskRow(const Int3& centerIndex, int32_t radius, const Int3& gridPerChunk, int32_t rowY, int32_t& outMinX, int32_t& outMaxX)
+{
+	int64_t dy = int64_t(rowY - centerIndex.Y) * gridPerChunk.Y;
+	int64_t remaining = int64_t(radius) * radius - dy * dy;
+	if (radius <= 0 || remaining <= 0)
+	{
+		outMinX = 1;
+		outMaxX = 0;
+		return;
+	}
+	//满足(halfWidth * gridPerChunk.X)^2 < remaining的最大halfWidth，浮点估计后修正
+	int64_t halfWidth = int64_t(sqrt(double(remaining))) / gridPerChunk.X;
+	while (halfWidth > 0 && halfWidth * gridPerChunk.X * halfWidth * gridPerChunk.X >= remaining)
+		--halfWidth;
+	while ((halfWidth + 1) * gridPerChunk.X * (halfWidth + 1) * gridPerChunk.X < remaining)
+		++halfWidth;
+	outMinX = centerIndex.X - int32_t(halfWidth);
+	outMaxX = centerIndex.X + int32_t(halfWidth);
+}
+
+//对以newCenter为中心、半径为radius的圆内，但不在以oldCenter为中心的同样的圆内的块的索引调用visit，oldCenter为空时遍历整个圆。
+//每行只遍历两个区间的差，耗时与变化的部分成正比
+template <typename Visitor>
+static void ForEachEnteredInDisk(const Int3& newCenter, const Int3* oldCenter, int32_t radius, const Int3& gridPerChunk,
+	const Int3& minIndex, const Int3& maxIndex, Visitor visit)
+{
+	if (radius <= 0)
+		return;
+	int32_t rowRadius = radius / gridPerChunk.Y + 1;
+	int32_t minY = std::max(newCenter.Y - rowRadius, minIndex.Y);
+	int32_t maxY = std::min(newCenter.Y + rowRadius, maxIndex.Y);
+	for (int32_t y = minY; y <= maxY; ++y)
+	{
+		int32_t minX;
+		int32_t maxX;
+		GetDiskRow(newCenter, radius, gridPerChunk, y, minX, maxX);
+		minX = std::max(minX, minIndex.X);
+		maxX = std::min(maxX, maxIndex.X);
+		int32_t oldMinX = 1;
+		int32_t oldMaxX = 0;
+		if (oldCenter)
+			GetDiskRow(*oldCenter, radius, gridPerChunk, y, oldMinX, oldMaxX);
+		for (int32_t x = minX; x <= maxX; ++x)
+		{
+			if (x >= oldMinX && x <= oldMaxX)
+			{
+				x = oldMaxX;
+				continue;
+			}
+			visit(Int3(x, y, 0));
+		}
+	}
+}
+
+void ChunkWorld::SetParam(const GridParam& param)
+{
+	bool bLodChanged = param.LodHysteresis != Param.LodHysteresis;
+	for (int32_t i = 0; i < MaxChunkLod; ++i)
+		bLodChanged = bLodChanged || param.LodDistances[i] != Param.LodDistances[i];
+	if (bLodChanged)
+	{
+		std::copy(param.LodDistances, param.LodDistances + MaxChunkLod, Param.LodDistances);
+		Param.LodHysteresis = param.LodHysteresis;
+		bLodParamChanged = true;
+		bViewersChanged = true;
+	}
+	//滞后只影响离开的范围，已经持有的块在观察者下次移动时按新的范围释放
+	Param.StreamingHysteresis = param.StreamingHysteresis;
+	//默认观察者的半径在下次Update时更新
+	Param.MaxRenderDistance = param.MaxRenderDistance;
+	Param.MaxCollisionDistance = param.MaxCollisionDistance;
+	Param.MaxGenerationTasks = param.MaxGenerationTasks;
+	GenerationQueue.SetMaxTasks(param.MaxGenerationTasks);
+}
+
+void ChunkWorld::Update(const Int3& viewPosition, std::vector<Int3>& outEnteredChunks, std::vector<Int3>& outLeftChunks)
+{
+	//半径变了时换成新的默认观察者，同一次UpdateViewers中先按新的半径进入再释放旧的，两者都需要的块不会被卸载
+	const ViewerState* defaultViewer = FindViewer(DefaultViewerId);
+	if (defaultViewer && (defaultViewer->Viewer.RenderDistance != Param.MaxRenderDistance || defaultViewer->Viewer.CollisionDistance != Param.MaxCollisionDistance))
+		RemoveViewer(DefaultViewerId);
+	if (!FindViewer(DefaultViewerId))
+	{
+		ChunkViewer viewer;
+		viewer.RenderDistance = Param.MaxRenderDistance;
+		viewer.CollisionDistance = Param.MaxCollisionDistance;
+		DefaultViewerId = AddViewer(viewer);
+	}
+	SetViewerPosition(DefaultViewerId, viewPosition);
+	UpdateViewers(outEnteredChunks, outLeftChunks);
+}
+
+int32_t ChunkWorld::AddViewer(const ChunkViewer& viewer)
+{
+	ViewerState state;
+	state.Id = NextViewerId++;
+	state.Viewer = viewer;
+	Viewers.push_back(state);
+	bViewersChanged = true;
+	return state.Id;
+}
+
+void ChunkWorld::SetViewerPosition(int32_t viewerId, const Int3& position)
+{
+	ViewerState* viewer = FindViewer(viewerId);
+	assert(viewer);
+	if (!viewer)
+		return;
+	viewer->Viewer.Position = position;
+	//地形只有一层块，观察点的高度不影响范围
+	Int3 chunkIndex = FloorDivide(position, Param.GridPerChunk);
+	chunkIndex.Z = 0;
+	if (!viewer->bPlaced || chunkIndex != viewer->ChunkIndex)
+		bViewersChanged = true;
+}
+
+void ChunkWorld::RemoveViewer(int32_t viewerId)
+{
+	ViewerState* viewer = FindViewer(viewerId);
+	if (!viewer)
+		return;
+	viewer->bRemoved = true;
+	bViewersChanged = true;
+	if (viewerId == DefaultViewerId)
+		DefaultViewerId = -1;
+}
+
+size_t ChunkWorld::GetNumViewers() const
+{
+	size_t numViewers = 0;
+	for (size_t i = 0; i < Viewers.size(); ++i)
+		numViewers += Viewers[i].bRemoved ? 0 : 1;
+	return numViewers;
+}
+
+ChunkWorld::ViewerState* ChunkWorld::FindViewer(int32_t viewerId)
+{
+	for (size_t i = 0; i < Viewers.size(); ++i)
+	{
+		if (Viewers[i].Id == viewerId && !Viewers[i].bRemoved)
+			return &Viewers[i];
+	}
+	return NULL;
+}
+
+int32_t ChunkWorld::GetDataDistance(const ChunkViewer& viewer) const
+{
+	//显示的块需要外围一圈块的数据
+	int32_t dataMargin = std::max(Param.GridPerChunk.X, Param.GridPerChunk.Y);
+	int32_t renderDataDistance = viewer.RenderDistance > 0 ? viewer.RenderDistance + dataMargin : 0;
+	return std::max(renderDataDistance, viewer.CollisionDistance);
+}
+
+void ChunkWorld::UpdateViewers(std::vector<Int3>& outEnteredChunks, std::vector<Int3>& outLeftChunks)
+{
+	if (!bViewersChanged)
+	{
+		DispatchGenerationTasks();
+		return;
+	}
+	bViewersChanged = false;
+
+	//先让所有观察者移到新的位置，距离总是按最近的观察者计算
+	const Int3& gridPerChunk = Param.GridPerChunk;
+	std::vector<ViewerMove> moves;
+	for (size_t i = 0; i < Viewers.size(); ++i)
+	{
+		ViewerState& viewer = Viewers[i];
+		if (viewer.bRemoved)
+			continue;
+		Int3 chunkIndex = FloorDivide(viewer.Viewer.Position, gridPerChunk);
+		chunkIndex.Z = 0;
+		if (viewer.bPlaced && chunkIndex == viewer.ChunkIndex)
+			continue;
+		ViewerMove move = { &viewer, viewer.ChunkIndex, viewer.bPlaced };
+		moves.push_back(move);
+		viewer.ChunkIndex = chunkIndex;
+		viewer.Center = chunkIndex * gridPerChunk + gridPerChunk / Int3::Scalar(2);
+		viewer.bPlaced = true;
+	}
+
+	int32_t hysteresis = std::max(Param.StreamingHysteresis, 0);
+	Int3 minIndex = FloorDivide(Param.MinCoordinate, gridPerChunk);
+	Int3 maxIndex = FloorDivide(Param.MaxCoordinate, gridPerChunk);
+
+	//先处理进入再处理离开，从一个观察者交给另一个观察者的块计数不会降到0，数据不会被释放后重新读取。
+	//按距离从近到远提交读取请求。在卸载圆内还没离开的块已经在范围内，不再处理
+	std::vector<std::pair<int64_t, Int3> > loadRequests;
+	for (size_t i = 0; i < moves.size(); ++i)
+	{
+		ViewerState& viewer = *moves[i].Viewer;
+		const Int3* oldCenter = moves[i].bHadOldIndex ? &moves[i].OldIndex : NULL;
+		ForEachEnteredInDisk(viewer.ChunkIndex, oldCenter, GetDataDistance(viewer.Viewer), gridPerChunk, minIndex, maxIndex, [&](const Int3& index) {
+			Int3 coord = index * gridPerChunk;
+			if (!viewer.HeldDataChunks.insert(coord).second || ++DataChunks[coord] > 1 || Coord2ChunkData.Contains(coord))
+				return;
+			int64_t distanceSquared = GetViewDistanceSquared(coord);
+			//已经确认存储中没有的块直接更新生成的优先级
+			if (!Store || GenerationQueue.IsRequested(coord))
+				GenerationQueue.Request(coord, distanceSquared);
+			else if (LoadingChunks.count(coord) == 0)
+				loadRequests.push_back(std::make_pair(distanceSquared, coord));
+		});
+		ForEachEnteredInDisk(viewer.ChunkIndex, oldCenter, viewer.Viewer.RenderDistance, gridPerChunk, minIndex, maxIndex, [&](const Int3& index) {
+			Int3 coord = index * gridPerChunk;
+			if (viewer.HeldRenderChunks.insert(coord).second && ++RenderChunks[coord] == 1)
+				outEnteredChunks.push_back(coord);
+		});
+		//数据还没到的块在数据到达时再构建碰撞
+		ForEachEnteredInDisk(viewer.ChunkIndex, oldCenter, viewer.Viewer.CollisionDistance, gridPerChunk, minIndex, maxIndex, [&](const Int3& index) {
+			Int3 coord = index * gridPerChunk;
+			if (viewer.HeldCollisionChunks.insert(coord).second && ++CollisionChunks[coord] == 1 && Coord2ChunkData.Contains(coord))
+				CollisionDirtyChunks.insert(coord);
+		});
+	}
+
+	std::function<void(const Int3&)> releaseRenderChunk = [&](const Int3& coord) {
+		std::unordered_map<Int3, int32_t, Int3Hash>::iterator it = RenderChunks.find(coord);
+		assert(it != RenderChunks.end());
+		if (--it->second > 0)
+			return;
+		RenderChunks.erase(it);
+		ChunkLods.erase(coord);
+		outLeftChunks.push_back(coord);
+	};
+	std::function<void(const Int3&)> releaseDataChunk = [&](const Int3& coord) {
+		std::unordered_map<Int3, int32_t, Int3Hash>::iterator it = DataChunks.find(coord);
+		assert(it != DataChunks.end());
+		if (--it->second > 0)
+			return;
+		DataChunks.erase(it);
+		UnloadChunkData(coord);
+	};
+	std::function<void(const Int3&)> releaseCollisionChunk = [&](const Int3& coord) {
+		std::unordered_map<Int3, int32_t, Int3Hash>::iterator it = CollisionChunks.find(coord);
+		assert(it != CollisionChunks.end());
+		if (--it->second > 0)
+			return;
+		CollisionChunks.erase(it);
+		CollisionDirtyChunks.erase(coord);
+		CollisionQueue.Cancel(coord);
+		RemovedCollisionChunks.push_back(coord);
+	};
+	//离开观察者范围的块只可能在旧的卸载圆内、新的卸载圆外
+	for (size_t i = 0; i < moves.size(); ++i)
+	{
+		if (!moves[i].bHadOldIndex)
+			continue;
+		ViewerState& viewer = *moves[i].Viewer;
+		const Int3& oldIndex = moves[i].OldIndex;
+		ForEachEnteredInDisk(oldIndex, &viewer.ChunkIndex, viewer.Viewer.RenderDistance + hysteresis, gridPerChunk, minIndex, maxIndex, [&](const Int3& index) {
+			Int3 coord = index * gridPerChunk;
+			if (viewer.HeldRenderChunks.erase(coord))
+				releaseRenderChunk(coord);
+		});
+		ForEachEnteredInDisk(oldIndex, &viewer.ChunkIndex, GetDataDistance(viewer.Viewer) + hysteresis, gridPerChunk, minIndex, maxIndex, [&](const Int3& index) {
+			Int3 coord = index * gridPerChunk;
+			if (viewer.HeldDataChunks.erase(coord))
+				releaseDataChunk(coord);
+		});
+		ForEachEnteredInDisk(oldIndex, &viewer.ChunkIndex, viewer.Viewer.CollisionDistance + hysteresis, gridPerChunk, minIndex, maxIndex, [&](const Int3& index) {
+			Int3 coord = index * gridPerChunk;
+			if (viewer.HeldCollisionChunks.erase(coord))
+				releaseCollisionChunk(coord);
+		});
+	}
+	//离开的观察者释放持有的所有块，其附近的显示块之后按剩下的观察者重新选择细节层级
+	for (size_t i = 0; i < Viewers.size(); ++i)
+	{
+		ViewerState& viewer = Viewers[i];
+		if (!viewer.bRemoved)
+			continue;
+		std::for_each(viewer.HeldRenderChunks.begin(), viewer.HeldRenderChunks.end(), releaseRenderChunk);
+		std::for_each(viewer.HeldDataChunks.begin(), viewer.HeldDataChunks.end(), releaseDataChunk);
+		std::for_each(viewer.HeldCollisionChunks.begin(), viewer.HeldCollisionChunks.end(), releaseCollisionChunk);
+		if (viewer.bPlaced)
+		{
+			ViewerMove move = { &viewer, viewer.ChunkIndex, true };
+			moves.push_back(move);
+		}
+	}
+
+	std::sort(loadRequests.begin(), loadRequests.end(),
+		[](const std::pair<int64_t, Int3>& a, const std::pair<int64_t, Int3>& b) { return a.first < b.first; });
+	for (size_t i = 0; i < loadRequests.size(); ++i)
+	{
+		LoadingChunks.insert(loadRequests[i].second);
+		Store->RequestLoad(loadRequests[i].second);
+	}
+
+	//还在等待的生成任务按新的观察者位置重新排列
+	GenerationQueue.UpdatePriorities([this](const Int3& coord) { return GetViewDistanceSquared(coord); });
+	UpdateChunkLods(moves, outEnteredChunks);
+	Viewers.erase(std::remove_if(Viewers.begin(), Viewers.end(), [](const ViewerState& viewer) { return viewer.bRemoved; }), Viewers.end());
+	DispatchGenerationTasks();
+}
+
+void ChunkWorld::ProcessCompletedTasks(std::vector<Int3>& outReadyChunks, double budgetSeconds)
+{
+	std::vector<ChunkDataPtr> arrivedChunks;
+	GenerationQueue.PopCompleted(arrivedChunks);
+	//新生成的块还没有写入存储
+	for (size_t i = 0; i < arrivedChunks.size(); ++i)
+		DirtyChunks.insert(arrivedChunks[i]->Coordinate);
+
+	if (Store)
+	{
+		std::vector<ChunkLoadResult> loadedChunks;
+		Store->PopLoaded(loadedChunks);
+		for (size_t i = 0; i < loadedChunks.size(); ++i)
+		{
+			const Int3& coord = loadedChunks[i].Coordinate;
+			LoadingChunks.erase(coord);
+			//读取期间离开了范围的块丢弃，重新进入范围时再读
+			if (DataChunks.count(coord) == 0 || Coord2ChunkData.Contains(coord))
+				continue;
+			if (loadedChunks[i].Data)
+			{
+				arrivedChunks.push_back(loadedChunks[i].Data);
+				continue;
+			}
+			GenerationQueue.Request(coord, GetViewDistanceSquared(coord));
+		}
+	}
+
+	for (size_t i = 0; i < arrivedChunks.size(); ++i)
+	{
+		const Int3& coord = arrivedChunks[i]->Coordinate;
+		Coord2ChunkData[coord] = arrivedChunks[i];
+		ArrivedChunks.push_back(coord);
+		if (IsCollisionChunk(coord))
+			CollisionDirtyChunks.insert(coord);
+	}
+
+	//新到的数据可能让自身或相邻的块满足构建网格的条件
+	std::unordered_set<Int3, Int3Hash> readyChunks;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (bool bFirst = true; !ArrivedChunks.empty(); bFirst = false)
+	{
+		if (!bFirst && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budgetSeconds)
+			break;
+		Int3 coord = ArrivedChunks.front();
+		ArrivedChunks.pop_front();
+		for (int32_t x = -1; x <= 1; ++x)
+		{
+			for (int32_t y = -1; y <= 1; ++y)
+			{
+				for (int32_t z = -1; z <= 1; ++z)
+				{
+					Int3 adjCoord = coord + Int3(x, y, z) * Param.GridPerChunk;
+					if (!IsRenderChunk(adjCoord) || !IsChunkDataReady(adjCoord))
+						continue;
+					if (readyChunks.insert(adjCoord).second)
+						outReadyChunks.push_back(adjCoord);
+					//已经构建过网格的面相邻块之前把这个块当作空白格子
+					if (x * x + y * y + z * z == 1)
+						MarkMeshDirty(adjCoord, CMDF_NeighbourData);
+				}
+			}
+		}
+	}
+}
+
+void ChunkWorld::DispatchGenerationTasks()
+{
+	GenerationQueue.Dispatch();
+	DispatchCollisionBuilds();
+}
+
+void ChunkWorld::DispatchCollisionBuilds()
+{
+	//上一次构建还没完成的块留到之后的帧，连续修改时每个块同时只有一个任务，完成的结果总是比上一次新
+	for (std::unordered_set<Int3, Int3Hash>::iterator it = CollisionDirtyChunks.begin(); it != CollisionDirtyChunks.end(); )
+	{
+		if (CollisionQueue.IsRequested(*it))
+		{
+			++it;
+			continue;
+		}
+		const ChunkDataPtr* data = Coord2ChunkData.Find(*it);
+		if (data)
+			CollisionQueue.Request(*data, CollisionMaterialTypes);
+		it = CollisionDirtyChunks.erase(it);
+	}
+}
+
+void ChunkWorld::SetCollisionMaterialTypes(const std::vector<MaterialType>& materialTypes)
+{
+	CollisionMaterialTypes = materialTypes;
+	for (std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = CollisionChunks.begin(); it != CollisionChunks.end(); ++it)
+	{
+		if (Coord2ChunkData.Contains(it->first))
+			CollisionDirtyChunks.insert(it->first);
+	}
+}
+
+void ChunkWorld::PopCollisionChanges(std::vector<ChunkCollisionPtr>& outBuiltCollisions, std::vector<Int3>& outRemovedChunks)
+{
+	outRemovedChunks.insert(outRemovedChunks.end(), RemovedCollisionChunks.begin(), RemovedCollisionChunks.end());
+	RemovedCollisionChunks.clear();
+	CollisionQueue.PopCompleted(outBuiltCollisions);
+}
+
+bool ChunkWorld::SweepBox(const double boxMin[3], const double boxMax[3], const double delta[3], SweepHit& outHit) const
+{
+	ChunkGridReader reader(Coord2ChunkData, Param.GridPerChunk);
+	return voxel::SweepBox(reader, CollisionMaterialTypes, boxMin, boxMax, delta, outHit);
+}
+
+void ChunkWorld::CancelAllGenerationTasks()
+{
+	GenerationQueue.CancelAll();
+}
+
+void ChunkWorld::MarkChunkDirty(const Int3& coord)
+{
+	if (Coord2ChunkData.Contains(coord))
+		DirtyChunks.insert(coord);
+}
+
+size_t ChunkWorld::SaveDirtyChunks()
+{
+	if (!Store)
+		return 0;
+	size_t numSaved = 0;
+	for (std::unordered_set<Int3, Int3Hash>::const_iterator it = DirtyChunks.begin(); it != DirtyChunks.end(); ++it)
+	{
+		ChunkDataPtr data = FindChunkData(*it);
+		if (data)
+		{
+			Store->Save(*data);
+			++numSaved;
+		}
+	}
+	DirtyChunks.clear();
+	return numSaved;
+}
+
+void ChunkWorld::MarkChunkChanged(const Int3& coord)
+{
+	MarkGridsChanged(coord, Int3::Scalar(0), Param.GridPerChunk - Int3::Scalar(1));
+}
+
+void ChunkWorld::MarkGridsChanged(const Int3& coord, const Int3& minOffset, const Int3& maxOffset)
+{
+	const Int3& gridPerChunk = Param.GridPerChunk;
+	MarkChunkDirty(coord);
+	if (IsCollisionChunk(coord) && Coord2ChunkData.Contains(coord))
+		CollisionDirtyChunks.insert(coord);
+	MarkMeshDirty(coord, CMDF_Data);
+	for (int32_t i = 0; i < 27; ++i)
+	{
+		Int3 offset = Int3(i / 9, i / 3 % 3, i % 3) - Int3::Scalar(1);
+		Int3 neighbour = coord + offset * gridPerChunk;
+		if (offset == Int3::Scalar(0) || !IsRenderChunk(neighbour))
+			continue;
+		int32_t margin = 1 << GetChunkLod(neighbour);
+		bool bAffected = true;
+		for (int32_t axis = 0; axis < 3 && bAffected; ++axis)
+		{
+			if (offset[axis] < 0)
+				bAffected = minOffset[axis] < margin;
+			else if (offset[axis] > 0)
+				bAffected = maxOffset[axis] >= gridPerChunk[axis] - margin;
+		}
+		if (bAffected)
+			MarkMeshDirty(neighbour, CMDF_NeighbourData);
+	}
+}
+
+ChunkData* ChunkWorld::GetWritableChunkData(const Int3& coord)
+{
+	ChunkDataPtr* data = Coord2ChunkData.Find(coord);
+	if (!data)
+		return NULL;
+	if (data->use_count() > 1)
+		*data = std::make_shared<ChunkData>(**data);
+	return data->get();
+}
+
+size_t ChunkWorld::SetVoxels(const std::vector<VoxelEdit>& edits)
+{
+	//每个块中改动的范围，所有修改完成后每个块只标记一次
+	const Int3& gridPerChunk = Param.GridPerChunk;
+	std::unordered_map<Int3, std::pair<Int3, Int3>, Int3Hash> changedRanges;
+	size_t numChanged = 0;
+	Int3 chunkCoord(0, 0, 0);
+	ChunkData* data = NULL;
+	bool bHasChunk = false;
+	for (size_t i = 0; i < edits.size(); ++i)
+	{
+		const VoxelEdit& edit = edits[i];
+		Int3 editChunk = GetChunkCoordinate(edit.GridCoord, gridPerChunk);
+		if (!bHasChunk || editChunk != chunkCoord)
+		{
+			chunkCoord = editChunk;
+			const ChunkDataPtr* found = Coord2ChunkData.Find(chunkCoord);
+			data = found ? found->get() : NULL;
+			bHasChunk = true;
+		}
+		if (!data)
+			continue;
+		Int3 offset = edit.GridCoord - chunkCoord;
+		int32_t index = data->GetIndex(offset);
+		if (data->Grids.Get(index) == edit.MaterialIndex)
+			continue;
+		std::pair<std::unordered_map<Int3, std::pair<Int3, Int3>, Int3Hash>::iterator, bool> inserted =
+			changedRanges.insert(std::make_pair(chunkCoord, std::make_pair(offset, offset)));
+		if (inserted.second)
+			data = GetWritableChunkData(chunkCoord);
+		std::pair<Int3, Int3>& range = inserted.first->second;
+		range.first = Int3::Min(range.first, offset);
+		range.second = Int3::Max(range.second, offset);
+		data->Grids.Set(index, edit.MaterialIndex);
+		++numChanged;
+	}
+	for (std::unordered_map<Int3, std::pair<Int3, Int3>, Int3Hash>::const_iterator it = changedRanges.begin(); it != changedRanges.end(); ++it)
+		MarkGridsChanged(it->first, it->second.first, it->second.second);
+	return numChanged;
+}
+
+size_t ChunkWorld::FillBox(const Int3& minGrid, const Int3& maxGrid, uint8_t materialIndex)
+{
+	const Int3& gridPerChunk = Param.GridPerChunk;
+	Int3 minChunk = GetChunkCoordinate(minGrid, gridPerChunk);
+	Int3 maxChunk = GetChunkCoordinate(maxGrid, gridPerChunk);
+	size_t numChanged = 0;
+	for (int32_t cx = minChunk.X; cx <= maxChunk.X; cx += gridPerChunk.X)
+	{
+		for (int32_t cy = minChunk.Y; cy <= maxChunk.Y; cy += gridPerChunk.Y)
+		{
+			for (int32_t cz = minChunk.Z; cz <= maxChunk.Z; cz += gridPerChunk.Z)
+			{
+				Int3 chunkCoord(cx, cy, cz);
+				const ChunkDataPtr* found = Coord2ChunkData.Find(chunkCoord);
+				if (!found)
+					continue;
+				const ChunkData& oldData = **found;
+				if (oldData.Grids.IsUniform() && oldData.Grids.Get(0) == materialIndex)
+					continue;
+				Int3 minOffset = Int3::Max(minGrid - chunkCoord, Int3::Scalar(0));
+				Int3 maxOffset = Int3::Min(maxGrid - chunkCoord, gridPerChunk - Int3::Scalar(1));
+				//只统计并改动材质不同的格子，没有改动时不标记
+				int32_t numChunkChanged = 0;
+				for (int32_t x = minOffset.X; x <= maxOffset.X; ++x)
+					for (int32_t y = minOffset.Y; y <= maxOffset.Y; ++y)
+						for (int32_t z = minOffset.Z; z <= maxOffset.Z; ++z)
+							numChunkChanged += oldData.GetMaterialIndex(Int3(x, y, z)) != materialIndex ? 1 : 0;
+				if (numChunkChanged == 0)
+					continue;
+				ChunkData* data = GetWritableChunkData(chunkCoord);
+				if ((maxOffset - minOffset + Int3::Scalar(1)).Volume() == gridPerChunk.Volume())
+					data->Grids.Init(gridPerChunk.Volume(), materialIndex);
+				else
+				{
+					for (int32_t x = minOffset.X; x <= maxOffset.X; ++x)
+						for (int32_t y = minOffset.Y; y <= maxOffset.Y; ++y)
+							for (int32_t z = minOffset.Z; z <= maxOffset.Z; ++z)
+								data->Grids.Set(data->GetIndex(Int3(x, y, z)), materialIndex);
+				}
+				numChanged += numChunkChanged;
+				MarkGridsChanged(chunkCoord, minOffset, maxOffset);
+			}
+		}
+	}
+	return numChanged;
+}
+
+size_t ChunkWorld::FillSphere(const double center[3], double radius, uint8_t materialIndex)
+{
+	//按格子中心判断是否在球内
+	Int3 minGrid(int32_t(floor(center[0] - radius)), int32_t(floor(center[1] - radius)), int32_t(floor(center[2] - radius)));
+	Int3 maxGrid(int32_t(floor(center[0] + radius)), int32_t(floor(center[1] + radius)), int32_t(floor(center[2] + radius)));
+	std::vector<VoxelEdit> edits;
+	for (int32_t x = minGrid.X; x <= maxGrid.X; ++x)
+	{
+		for (int32_t y = minGrid.Y; y <= maxGrid.Y; ++y)
+		{
+			for (int32_t z = minGrid.Z; z <= maxGrid.Z; ++z)
+			{
+				double dx = x + 0.5 - center[0];
+				double dy = y + 0.5 - center[1];
+				double dz = z + 0.5 - center[2];
+				if (dx * dx + dy * dy + dz * dz <= radius * radius)
+					edits.push_back(VoxelEdit(Int3(x, y, z), materialIndex));
+			}
+		}
+	}
+	return SetVoxels(edits);
+}
+
+void ChunkWorld::MarkMeshDirty(const Int3& coord, uint32_t flags)
+{
+	//不显示的块没有网格，进入视距时会整个构建
+	if (IsRenderChunk(coord))
+		MeshDirtyFlags[coord] |= flags;
+}
+
+void ChunkWorld::MarkAllMeshesDirty(uint32_t flags)
+{
+	for (std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = RenderChunks.begin(); it != RenderChunks.end(); ++it)
+		MeshDirtyFlags[it->first] |= flags;
+}
+
+void ChunkWorld::PopDirtyMeshes(std::vector<Int3>& outChunks)
+{
+	//数据还没就绪的块不用保留标记，就绪时ProcessCompletedTasks会报告它
+	for (std::unordered_map<Int3, uint32_t, Int3Hash>::const_iterator it = MeshDirtyFlags.begin(); it != MeshDirtyFlags.end(); ++it)
+	{
+		if (IsRenderChunk(it->first) && IsChunkDataReady(it->first))
+			outChunks.push_back(it->first);
+	}
+	MeshDirtyFlags.clear();
+}
+
+void ChunkWorld::UpdateChunkLods(const std::vector<ViewerMove>& moves, const std::vector<Int3>& enteredChunks)
+{
+	//级别由最近的显示观察者决定，只有移动的观察者跨过某个分界(以及放宽LodHysteresis后的分界)时才可能改变，
+	//只需检查这些分界的圆移动后变化的部分以及新显示的块。新加入或离开的观察者附近的块都要检查
+	const Int3& gridPerChunk = Param.GridPerChunk;
+	std::unordered_set<Int3, Int3Hash> candidates(enteredChunks.begin(), enteredChunks.end());
+	//分界变了时所有显示块都可能改变级别
+	if (bLodParamChanged)
+	{
+		for (std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = RenderChunks.begin(); it != RenderChunks.end(); ++it)
+			candidates.insert(it->first);
+		bLodParamChanged = false;
+	}
+	Int3 minIndex = FloorDivide(Param.MinCoordinate, gridPerChunk);
+	Int3 maxIndex = FloorDivide(Param.MaxCoordinate, gridPerChunk);
+	std::function<void(const Int3&)> addCandidate = [&](const Int3& index) {
+		Int3 coord = index * gridPerChunk;
+		if (IsRenderChunk(coord))
+			candidates.insert(coord);
+	};
+	for (size_t m = 0; m < moves.size(); ++m)
+	{
+		const ViewerState& viewer = *moves[m].Viewer;
+		if (viewer.Viewer.RenderDistance <= 0)
+			continue;
+		if (!moves[m].bHadOldIndex || viewer.bRemoved)
+		{
+			int32_t radius = viewer.Viewer.RenderDistance + std::max(Param.StreamingHysteresis, 0);
+			ForEachEnteredInDisk(viewer.ChunkIndex, NULL, radius, gridPerChunk, minIndex, maxIndex, addCandidate);
+			continue;
+		}
+		for (int32_t i = 0; i < MaxChunkLod && Param.LodDistances[i] > 0; ++i)
+		{
+			for (int32_t side = -1; side <= 1; ++side)
+			{
+				int32_t radius = Param.LodDistances[i] + side * Param.LodHysteresis;
+				ForEachEnteredInDisk(viewer.ChunkIndex, &moves[m].OldIndex, radius, gridPerChunk, minIndex, maxIndex, addCandidate);
+				ForEachEnteredInDisk(moves[m].OldIndex, &viewer.ChunkIndex, radius, gridPerChunk, minIndex, maxIndex, addCandidate);
+			}
+		}
+	}
+
+	std::vector<std::pair<Int3, int32_t> > changedChunks;
+	for (std::unordered_set<Int3, Int3Hash>::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+	{
+		std::unordered_map<Int3, int32_t, Int3Hash>::iterator lodIt = ChunkLods.find(*it);
+		int32_t oldLod = lodIt != ChunkLods.end() ? lodIt->second : -1;
+		int32_t newLod = SelectChunkLod(GetViewDistanceSquared(*it, true), oldLod, Param);
+		if (newLod == oldLod)
+			continue;
+		ChunkLods[*it] = newLod;
+		changedChunks.push_back(std::make_pair(*it, oldLod));
+	}
+
+	for (size_t i = 0; i < changedChunks.size(); ++i)
+	{
+		const Int3& coord = changedChunks[i].first;
+		//新显示的块会整个构建，原来不显示时相邻块也没有为它加裙边
+		int32_t oldLod = changedChunks[i].second;
+		int32_t newLod = ChunkLods[coord];
+		if (oldLod >= 0)
+			MarkMeshDirty(coord, CMDF_Lod);
+		for (int32_t face = 0; face < 6; ++face)
+		{
+			Int3 adjCoord = coord + GetFaceNormal(uint8_t(face)) * gridPerChunk;
+			std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator adjIt = ChunkLods.find(adjCoord);
+			if (adjIt == ChunkLods.end())
+				continue;
+			bool bHadSkirt = oldLod >= 0 && oldLod != adjIt->second;
+			if (bHadSkirt != (newLod != adjIt->second))
+				MarkMeshDirty(adjCoord, CMDF_Lod);
+		}
+	}
+}
+
+void ChunkWorld::UnloadChunkData(const Int3& coord)
+{
+	GenerationQueue.Cancel(coord);
+	const ChunkDataPtr* data = Coord2ChunkData.Find(coord);
+	if (!data)
+		return;
+	//存储按提交顺序执行，之后重新进入范围时能读回写入的数据。没有存储时重新生成，改动会丢失
+	if (DirtyChunks.erase(coord) && Store)
+		Store->Save(**data);
+	Coord2ChunkData.Erase(coord);
+}
+
+int64_t ChunkWorld::GetViewDistanceSquared(const Int3& coord, bool bRenderViewersOnly) const
+{
+	Int3 center = coord + Param.GridPerChunk / Int3::Scalar(2);
+	int64_t minDistanceSquared = INT64_MAX;
+	for (size_t i = 0; i < Viewers.size(); ++i)
+	{
+		const ViewerState& viewer = Viewers[i];
+		if (!viewer.bPlaced || viewer.bRemoved || (bRenderViewersOnly && viewer.Viewer.RenderDistance <= 0))
+			continue;
+		int64_t dx = center.X - viewer.Center.X;
+		int64_t dy = center.Y - viewer.Center.Y;
+		minDistanceSquared = std::min(minDistanceSquared, dx * dx + dy * dy);
+	}
+	return minDistanceSquared;
+}
+
+int32_t ChunkWorld::GetChunkLod(const Int3& coord) const
+{
+	std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = ChunkLods.find(coord);
+	return it != ChunkLods.end() ? it->second : 0;
+}
+
+uint8_t ChunkWorld::GetSkirtFaceMask(const Int3& coord) const
+{
+	std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator it = ChunkLods.find(coord);
+	if (it == ChunkLods.end())
+		return 0;
+	uint8_t mask = 0;
+	for (int32_t face = 0; face < 6; ++face)
+	{
+		std::unordered_map<Int3, int32_t, Int3Hash>::const_iterator adjIt = ChunkLods.find(coord + GetFaceNormal(uint8_t(face)) * Param.GridPerChunk);
+		if (adjIt != ChunkLods.end() && adjIt->second != it->second)
+			mask |= 1 << face;
+	}
+	return mask;
+}
+
+bool ChunkWorld::IsChunkDataReady(const Int3& coord) const
+{
+	for (int32_t x = -1; x <= 1; ++x)
+	{
+		for (int32_t y = -1; y <= 1; ++y)
+		{
+			for (int32_t z = -1; z <= 1; ++z)
+			{
+				//不在生成范围内的相邻块永远不会有数据，按空白格子处理
+				Int3 adjCoord = coord + Int3(x, y, z) * Param.GridPerChunk;
+				if (DataChunks.count(adjCoord) != 0 && !Coord2ChunkData.Contains(adjCoord))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+ChunkDataPtr ChunkWorld::FindChunkData(const Int3& coord) const
+{
+	const ChunkDataPtr* data = Coord2ChunkData.Find(coord);
+	return data ? *data : ChunkDataPtr();
+}
+
+void ChunkWorld::AddChunkData(const ChunkDataPtr& data)
+{
+	Coord2ChunkData[data->Coordinate] = data;
+	if (IsCollisionChunk(data->Coordinate))
+		CollisionDirtyChunks.insert(data->Coordinate);
+}
+
+void ChunkWorld::GetNeighbourhood(const Int3& coord, ChunkNeighbourhood& outNeighbourhood) const
+{
+	outNeighbourhood.Coordinate = coord;
+	outNeighbourhood.GridPerChunk = Param.GridPerChunk;
+	const ChunkDataPtr* neighbours[27];
+	Coord2ChunkData.FindNeighbours(coord, Param.GridPerChunk, neighbours);
+	for (int32_t i = 0; i < 27; ++i)
+		outNeighbourhood.Chunks[i] = neighbours[i] ? *neighbours[i] : ChunkDataPtr();
+}
+
+uint8_t ChunkWorld::GetMaterialIndex(const Int3& gridCoord) const
+{
+	Int3 chunkCoord = GetChunkCoordinate(gridCoord, Param.GridPerChunk);
+	const ChunkDataPtr* data = Coord2ChunkData.Find(chunkCoord);
+	if (!data)
+		return 0;
+	return (*data)->GetMaterialIndex(gridCoord - chunkCoord);
+}
+
+size_t ChunkWorld::GetAllocatedSize() const
+{
+	size_t allocatedSize = 0;
+	for (ChunkMap<ChunkDataPtr>::ConstIterator it = Coord2ChunkData.begin(); it != Coord2ChunkData.end(); ++it)
+		allocatedSize += sizeof(ChunkData) + it->Value->Grids.GetAllocatedSize();
+	return allocatedSize;
+}
@@ -0,0 +1,359 @@
+// chunkworld.h
+//
+// 与引擎无关的体素核心：管理所有块的数据以及需要显示的块
+//
+
+#ifndef VOXEL_CHUNKWORLD_H
+#define VOXEL_CHUNKWORLD_H
+
+#include <math.h>
+#include "chunkcollision.h"
+#include "chunkgenerationqueue.h"
+#include "chunkmap.h"
+#include "chunkneighbourhood.h"
+#include "regionstore.h"
+
+namespace voxel
+{
+	//显示块的网格需要重新构建的原因
+	enum ChunkMeshDirtyFlags
+	{
+		//块自身的数据改动
+		CMDF_Data = 1,
+		//相邻的块的数据到达或改动，边界上的面可能露出或被遮住，边界上顶点的环境光遮蔽可能变化
+		CMDF_NeighbourData = 2,
+		//材质参数改动
+		CMDF_Material = 4,
+		//自身或面相邻的块的细节层级改变，需要换一级降采样或者增减边界上的裙边
+		CMDF_Lod = 8,
+	};
+
+	//修改一个格子的材质，GridCoord为格子坐标
+	struct VoxelEdit
+	{
+		Int3 GridCoord;
+
+		uint8_t MaterialIndex;
+
+		VoxelEdit() : GridCoord(0, 0, 0), MaterialIndex(0) {}
+
+		VoxelEdit(const Int3& gridCoord, uint8_t materialIndex) : GridCoord(gridCoord), MaterialIndex(materialIndex) {}
+	};
+
+	//流式加载的观察者，例如本地玩家的相机，或者服务器上只需要数据和碰撞的远程玩家
+	struct ChunkViewer
+	{
+		//格子坐标系下的位置
+		Int3 Position;
+
+		//显示半径，为0时不需要显示块
+		int32_t RenderDistance;
+
+		//需要碰撞的半径，这些块的碰撞在后台构建。显示块还需要外围一圈块的数据，数据的范围取两者中较大的
+		int32_t CollisionDistance;
+
+		ChunkViewer() : Position(0, 0, 0), RenderDistance(0), CollisionDistance(0) {}
+	};
+
+	//根据所有观察者的位置以及半径来决定哪些块需要显示和需要数据，并在后台生成数据，除后台任务外都在主线程调用。
+	//多个观察者需要的块只有一份数据，按需要它的观察者数量计数，耗时和内存随覆盖的面积增长，而不是观察者数量乘以半径
+	class ChunkWorld
+	{
+	public:
+		ChunkWorld(const GridParam& param, const TaskDispatcher& dispatcher = TaskDispatcher());
+
+		const GridParam& GetParam() const
+		{
+			return Param;
+		}
+
+		//运行中修改参数，可以每次Update前调用。距离、滞后、细节层级以及后台任务数下次Update或UpdateViewers时生效；
+		//GridPerChunk、MinCoordinate、MaxCoordinate、MaxHeight和NoiseFrequency决定已有块的坐标和内容，只在创建时生效，这里忽略
+		void SetParam(const GridParam& param);
+
+		//只有一个观察者时的简便接口：第一次调用时按MaxRenderDistance、MaxCollisionDistance加入默认的观察者，移动它后调用UpdateViewers
+		void Update(const Int3& viewPosition)
+		{
+			std::vector<Int3> enteredChunks;
+			std::vector<Int3> leftChunks;
+			Update(viewPosition, enteredChunks, leftChunks);
+		}
+
+		void Update(const Int3& viewPosition, std::vector<Int3>& outEnteredChunks, std::vector<Int3>& outLeftChunks);
+
+		//返回观察者的编号，下次UpdateViewers时生效
+		int32_t AddViewer(const ChunkViewer& viewer);
+
+		void SetViewerPosition(int32_t viewerId, const Int3& position);
+
+		//观察者需要的块在下次UpdateViewers时释放，其他观察者仍然需要的块保留
+		void RemoveViewer(int32_t viewerId);
+
+		size_t GetNumViewers() const;
+
+		//按观察者的变化更新范围，取所在块的中心计算距离，没有观察者离开所在的块时不做任何事。块在距离小于某个观察者的半径时进入
+		//这个观察者的范围，超过半径加StreamingHysteresis时才离开，只检查移动前后圆的差。outEnteredChunks、outLeftChunks为这次进入和离开显示范围的块
+		void UpdateViewers(std::vector<Int3>& outEnteredChunks, std::vector<Int3>& outLeftChunks);
+
+		//取回后台生成完的数据，outReadyChunks为因此满足构建网格条件的显示块。数据总是立即加入，
+		//检查相邻块是否就绪的部分超过budgetSeconds后留到下一次调用，每次至少处理一个块
+		void ProcessCompletedTasks(std::vector<Int3>& outReadyChunks, double budgetSeconds = HUGE_VAL);
+
+		//数据已经加入、还没检查相邻块是否就绪的块
+		size_t GetNumArrivedChunks() const
+		{
+			return ArrivedChunks.size();
+		}
+
+		void DispatchGenerationTasks();
+
+		void CancelAllGenerationTasks();
+
+		//设置后缺少的块先从存储中读取，存储中没有时再生成
+		void SetChunkStore(const std::shared_ptr<RegionStore>& store)
+		{
+			Store = store;
+		}
+
+		const std::shared_ptr<RegionStore>& GetChunkStore() const
+		{
+			return Store;
+		}
+
+		//块数据与存储中的不一致，下次SaveDirtyChunks时写入
+		void MarkChunkDirty(const Int3& coord);
+
+		//整个块的数据被修改：写入存储，并重新构建自身以及周围26个块的网格。边界上的面只影响面相邻的块，顶点的环境光遮蔽还会影响边、角相邻的块
+		void MarkChunkChanged(const Int3& coord);
+
+		//批量修改格子，返回材质真正改变的格子数，没有数据的块中的格子忽略。只标记改动的块，以及改动的格子离边界足够近、
+		//网格会受影响的相邻块。一帧中的多次修改只在PopDirtyMeshes、PopCollisionChanges时各重建一次
+		size_t SetVoxels(const std::vector<VoxelEdit>& edits);
+
+		//把[minGrid, maxGrid]中的格子都设为materialIndex，整个块都被覆盖时直接换成单一材质的存储
+		size_t FillBox(const Int3& minGrid, const Int3& maxGrid, uint8_t materialIndex);
+
+		//中心到center的距离不超过radius的格子设为materialIndex，格子坐标系
+		size_t FillSphere(const double center[3], double radius, uint8_t materialIndex);
+
+		//flags为ChunkMeshDirtyFlags的组合
+		void MarkMeshDirty(const Int3& coord, uint32_t flags);
+
+		//所有显示块都需要重新构建网格，例如材质改动
+		void MarkAllMeshesDirty(uint32_t flags);
+
+		//取出需要重新构建网格且数据已就绪的显示块并清除标记，稳定状态下为空
+		void PopDirtyMeshes(std::vector<Int3>& outChunks);
+
+		//把改动过以及新生成的块交给存储在后台写入，返回写入的块数
+		size_t SaveDirtyChunks();
+
+		size_t GetNumDirtyChunks() const
+		{
+			return DirtyChunks.size();
+		}
+
+		//需要显示的块以及需要它的本地观察者的数量
+		const std::unordered_map<Int3, int32_t, Int3Hash>& GetRenderChunks() const
+		{
+			return RenderChunks;
+		}
+
+		bool IsRenderChunk(const Int3& coord) const
+		{
+			return RenderChunks.count(coord) != 0;
+		}
+
+		//显示块构建网格时的细节层级，0为不降采样
+		int32_t GetChunkLod(const Int3& coord) const;
+
+		//与面相邻的显示块细节层级不同的方向，第i位对应GetFaceNormal(i)，构建网格时在这些方向加裙边
+		uint8_t GetSkirtFaceMask(const Int3& coord) const;
+
+		//块自身以及需要生成的相邻块的数据都已就绪
+		bool IsChunkDataReady(const Int3& coord) const;
+
+		//决定哪些格子参与碰撞，改变后重新构建所有碰撞块。没有设置时所有格子都当作空白
+		void SetCollisionMaterialTypes(const std::vector<MaterialType>& materialTypes);
+
+		const std::vector<MaterialType>& GetCollisionMaterialTypes() const
+		{
+			return CollisionMaterialTypes;
+		}
+
+		//在某个观察者碰撞半径内的块
+		bool IsCollisionChunk(const Int3& coord) const
+		{
+			return CollisionChunks.count(coord) != 0;
+		}
+
+		size_t GetNumCollisionChunks() const
+		{
+			return CollisionChunks.size();
+		}
+
+		//取出后台构建完的碰撞以及离开碰撞范围的块，需要先处理outRemovedChunks。同一帧中多次改动的块只重建一次
+		void PopCollisionChanges(std::vector<ChunkCollisionPtr>& outBuiltCollisions, std::vector<Int3>& outRemovedChunks);
+
+		//在已有的块数据上做长方体的扫掠，格子坐标系，没有数据的块当作空白。用于角色移动，不需要等待碰撞构建完
+		bool SweepBox(const double boxMin[3], const double boxMax[3], const double delta[3], SweepHit& outHit) const;
+
+		const ChunkMap<ChunkDataPtr>& GetChunkDataMap() const
+		{
+			return Coord2ChunkData;
+		}
+
+		//块在某个观察者的数据范围内，数据可能还在生成
+		bool IsDataChunk(const Int3& coord) const
+		{
+			return DataChunks.count(coord) != 0;
+		}
+
+		size_t GetNumDataChunks() const
+		{
+			return DataChunks.size();
+		}
+
+		ChunkDataPtr FindChunkData(const Int3& coord) const;
+
+		//直接加入已有的块数据，例如测试时在主线程生成
+		void AddChunkData(const ChunkDataPtr& data);
+
+		//在主线程收集构建网格需要的相邻块数据
+		void GetNeighbourhood(const Int3& coord, ChunkNeighbourhood& outNeighbourhood) const;
+
+		//gridCoord为格子坐标，没有数据的格子为0
+		uint8_t GetMaterialIndex(const Int3& gridCoord) const;
+
+		size_t GetNumChunks() const
+		{
+			return Coord2ChunkData.Size();
+		}
+
+		//所有块数据占用的内存
+		size_t GetAllocatedSize() const;
+
+		const ChunkGenerationQueue& GetGenerationQueue() const
+		{
+			return GenerationQueue;
+		}
+
+	private:
+		GridParam Param;
+
+		ChunkMap<ChunkDataPtr> Coord2ChunkData;
+
+		//观察者以及上一次UpdateViewers时所在的块
+		struct ViewerState
+		{
+			int32_t Id;
+
+			ChunkViewer Viewer;
+
+			//所在块的索引以及这个块的中心，bPlaced为false时还没有生效
+			Int3 ChunkIndex;
+
+			Int3 Center;
+
+			bool bPlaced;
+
+			bool bRemoved;
+
+			//这个观察者持有的块，块在滞后范围内时是否持有取决于之前的移动，需要记录下来
+			std::unordered_set<Int3, Int3Hash> HeldRenderChunks;
+
+			std::unordered_set<Int3, Int3Hash> HeldDataChunks;
+
+			std::unordered_set<Int3, Int3Hash> HeldCollisionChunks;
+
+			ViewerState() : Id(0), ChunkIndex(0, 0, 0), Center(0, 0, 0), bPlaced(false), bRemoved(false) {}
+		};
+
+		//这次UpdateViewers中离开原来所在块的观察者，bHadOldIndex为false时是新加入的
+		struct ViewerMove
+		{
+			ViewerState* Viewer;
+
+			Int3 OldIndex;
+
+			bool bHadOldIndex;
+		};
+
+		std::vector<ViewerState> Viewers;
+
+		int32_t NextViewerId;
+
+		//Update使用的观察者，没有时为-1
+		int32_t DefaultViewerId;
+
+		//观察者加入、离开或移动过，下次UpdateViewers需要处理
+		bool bViewersChanged;
+
+		//细节层级的分界变了，下次UpdateViewers重新选择所有显示块的级别
+		bool bLodParamChanged;
+
+		ViewerState* FindViewer(int32_t viewerId);
+
+		//观察者需要数据的半径
+		int32_t GetDataDistance(const ChunkViewer& viewer) const;
+
+		std::unordered_map<Int3, int32_t, Int3Hash> RenderChunks;
+
+		//显示块的细节层级，在多次Update之间保留，用于细节层级切换的滞后
+		std::unordered_map<Int3, int32_t, Int3Hash> ChunkLods;
+
+		//需要数据的块以及需要它的观察者的数量，比显示的块多一圈，保证显示的块在边界处能读到相邻块
+		std::unordered_map<Int3, int32_t, Int3Hash> DataChunks;
+
+		ChunkGenerationQueue GenerationQueue;
+
+		std::shared_ptr<RegionStore> Store;
+
+		//需要碰撞的块以及需要它的观察者的数量
+		std::unordered_map<Int3, int32_t, Int3Hash> CollisionChunks;
+
+		std::vector<MaterialType> CollisionMaterialTypes;
+
+		ChunkCollisionQueue CollisionQueue;
+
+		//数据已就绪、需要重新构建碰撞的碰撞块，每帧派发一次，同一帧中的多次改动合并
+		std::unordered_set<Int3, Int3Hash> CollisionDirtyChunks;
+
+		//离开碰撞范围、还没有取出的块
+		std::vector<Int3> RemovedCollisionChunks;
+
+		void DispatchCollisionBuilds();
+
+		//正在从存储中读取的块
+		std::unordered_set<Int3, Int3Hash> LoadingChunks;
+
+		//新生成或改动过、还没写入存储的块
+		std::unordered_set<Int3, Int3Hash> DirtyChunks;
+
+		//按到达顺序等待检查相邻块是否就绪的块
+		std::deque<Int3> ArrivedChunks;
+
+		//网格过期的块以及原因
+		std::unordered_map<Int3, uint32_t, Int3Hash> MeshDirtyFlags;
+
+		//按观察者的变化更新显示块的细节层级，级别改变的块以及裙边改变的相邻块标记为需要重建网格
+		void UpdateChunkLods(const std::vector<ViewerMove>& moves, const std::vector<Int3>& enteredChunks);
+
+		//返回可以原地修改的块数据，没有数据时为空。后台的网格、碰撞或存储任务还持有这份数据时先复制一份替换，
+		//持有者读到的仍是修改前的数据。只有主线程会复制指针，引用计数为1时没有其他持有者
+		ChunkData* GetWritableChunkData(const Int3& coord);
+
+		//块中[minOffset, maxOffset]范围内的格子被修改：写入存储，重建碰撞以及自身的网格。相邻块按它的细节层级收集
+		//一圈2^lod个格子，只有改动的范围进入这一圈时才重建它的网格
+		void MarkGridsChanged(const Int3& coord, const Int3& minOffset, const Int3& maxOffset);
+
+		//块离开数据范围：取消生成任务，改动过的块写入存储后释放数据
+		void UnloadChunkData(const Int3& coord);
+
+		//块中心到最近的观察者所在块的中心的水平距离的平方，bRenderViewersOnly时只考虑需要显示的观察者。
+		//存储中没有的块按它计算生成的优先级，显示块按它选择细节层级
+		int64_t GetViewDistanceSquared(const Int3& coord, bool bRenderViewersOnly = false) const;
+	};
+}
+
+#endif
@@ -0,0 +1,119 @@
+// heightcolumn.cpp
+//
+// 与引擎无关的体素核心：同一列(X,Y相同)的块共享的高度场
+//
+
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+#include "noiseutils.h"
+#include "heightcolumn.h"
+
+using namespace voxel;
+
+static void FillHeightColumn(HeightColumn& column, const Int3& columnCoord, const GridParam& param)
+{
+	assert(param.MaxHeight <= INT16_MAX);
+	column.Coordinate = columnCoord;
+	column.Size = Int3(param.GridPerChunk.X, param.GridPerChunk.Y, 1);
+	const Int3& size = column.Size;
+
+	noise::utils::NoiseMap heightMap;
+	noise::module::Perlin myModule;
+	myModule.SetFrequency(param.NoiseFrequency);
+	noise::utils::NoiseMapBuilderPlane heightMapBuilder;
+	heightMapBuilder.SetSourceModule(myModule);
+	heightMapBuilder.SetDestNoiseMap(heightMap);
+	heightMapBuilder.SetDestSize(size.X, size.Y);
+	heightMapBuilder.SetBounds(columnCoord.X, columnCoord.X + size.X, columnCoord.Y, columnCoord.Y + size.Y);
+	heightMapBuilder.Build();
+
+	column.Heights.resize(size.X * size.Y);
+	column.MinHeight = param.MaxHeight;
+	column.MaxHeight = 0;
+	for (int32_t i = 0; i < size.X; ++i)
+	{
+		for (int32_t j = 0; j < size.Y; ++j)
+		{
+			//高度图以列的最小角为原点
+			float fNoise = heightMap.GetValue(i, j);
+			fNoise = fminf(fNoise, 1.0f);
+			fNoise = fmaxf(fNoise, -1.0f);
+			int32_t height = int32_t((fNoise + 1.0f) * 0.5 * param.MaxHeight);
+			column.Heights[i * size.Y + j] = int16_t(height);
+			column.MinHeight = std::min(column.MinHeight, height);
+			column.MaxHeight = std::max(column.MaxHeight, height);
+		}
+	}
+}
+
+HeightColumnPtr voxel::BuildHeightColumn(const Int3& columnCoord, const GridParam& param)
+{
+	std::shared_ptr<HeightColumn> column = std::make_shared<HeightColumn>();
+	FillHeightColumn(*column, columnCoord, param);
+	return column;
+}
+
+HeightColumnCache::HeightColumnCache(const GridParam& param) :
+	Param(param), PruneThreshold(64), NumBuiltColumns(0)
+{
+}
+
+HeightColumnPtr HeightColumnCache::Acquire(const Int3& chunkCoord)
+{
+	const Int3& gridPerChunk = Param.GridPerChunk;
+	Int3 columnCoord(FloorDivide(chunkCoord.X, gridPerChunk.X) * gridPerChunk.X, FloorDivide(chunkCoord.Y, gridPerChunk.Y) * gridPerChunk.Y, 0);
+	std::shared_ptr<HeightColumn> column;
+	std::shared_ptr<std::once_flag> buildOnce;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Entry& entry = *Columns.Emplace(columnCoord).first;
+		column = entry.Column.lock();
+		if (!column)
+		{
+			column = std::make_shared<HeightColumn>();
+			entry.Column = column;
+			entry.BuildOnce = std::make_shared<std::once_flag>();
+		}
+		buildOnce = entry.BuildOnce;
+		if (Columns.Size() >= PruneThreshold)
+			PruneExpired();
+	}
+
+	//计算放在锁外，不同的列可以并行计算
+	std::call_once(*buildOnce, [&]() {
+		FillHeightColumn(*column, columnCoord, Param);
+		std::lock_guard<std::mutex> lock(Mutex);
+		++NumBuiltColumns;
+	});
+	return column;
+}
+
+size_t HeightColumnCache::GetNumResidentColumns() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	size_t numResident = 0;
+	for (ChunkMap<Entry>::ConstIterator it = Columns.begin(); it != Columns.end(); ++it)
+		numResident += it->Value.Column.expired() ? 0 : 1;
+	return numResident;
+}
+
+size_t HeightColumnCache::GetNumBuiltColumns() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return NumBuiltColumns;
+}
+
+void HeightColumnCache::PruneExpired()
+{
+	std::vector<Int3> expiredColumns;
+	for (ChunkMap<Entry>::Iterator it = Columns.begin(); it != Columns.end(); ++it)
+	{
+		if (it->Value.Column.expired())
+			expiredColumns.push_back(it->Key);
+	}
+	for (size_t i = 0; i < expiredColumns.size(); ++i)
+		Columns.Erase(expiredColumns[i]);
+	//清理后仍然很多时放宽阈值，避免每次请求都遍历
+	PruneThreshold = std::max(Columns.Size() * 2, size_t(64));
+}
@@ -0,0 +1,86 @@
+// heightcolumn.h
+//
+// 与引擎无关的体素核心：同一列(X,Y相同)的块共享的高度场
+//
+
+#ifndef VOXEL_HEIGHTCOLUMN_H
+#define VOXEL_HEIGHTCOLUMN_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "chunkmap.h"
+
+namespace voxel
+{
+	//一列块的地表高度，只由X,Y决定，同一列不同高度的块生成时只采样一次噪声
+	struct HeightColumn
+	{
+		//列的最小角，Z总是0
+		Int3 Coordinate;
+
+		//只使用X,Y
+		Int3 Size;
+
+		//地表高度(格子坐标)，下标为x * Size.Y + y，高度以下的格子为实心。列随块常驻内存，用16位存储
+		std::vector<int16_t> Heights;
+
+		//整列的最低、最高地表，块完全在两者之外时不用逐个格子判断
+		int32_t MinHeight;
+
+		int32_t MaxHeight;
+
+		HeightColumn() : MinHeight(0), MaxHeight(0) {}
+
+		inline int32_t GetHeight(int32_t x, int32_t y) const
+		{
+			return Heights[x * Size.Y + y];
+		}
+	};
+
+	typedef std::shared_ptr<const HeightColumn> HeightColumnPtr;
+
+	//按高度噪声计算一列的高度场，可以在任意线程调用
+	HeightColumnPtr BuildHeightColumn(const Int3& columnCoord, const GridParam& param);
+
+	//按列缓存高度场。缓存只持有弱引用，列的生命周期由引用它的块数据决定，列中的块都释放后高度场随之释放
+	class HeightColumnCache
+	{
+	public:
+		explicit HeightColumnCache(const GridParam& param);
+
+		//取得块所在列的高度场，没有时在调用线程计算。可以在多个线程同时调用，同一列只计算一次
+		HeightColumnPtr Acquire(const Int3& chunkCoord);
+
+		//仍被块数据引用的列数
+		size_t GetNumResidentColumns() const;
+
+		//累计计算过的列数
+		size_t GetNumBuiltColumns() const;
+
+	private:
+		//列在放进缓存后才计算，同时请求这一列的其他线程等待计算完成
+		struct Entry
+		{
+			std::weak_ptr<HeightColumn> Column;
+
+			std::shared_ptr<std::once_flag> BuildOnce;
+		};
+
+		//清除已经释放的列
+		void PruneExpired();
+
+		GridParam Param;
+
+		mutable std::mutex Mutex;
+
+		ChunkMap<Entry> Columns;
+
+		//列数达到这个值时清理一次
+		size_t PruneThreshold;
+
+		size_t NumBuiltColumns;
+	};
+}
+
+#endif
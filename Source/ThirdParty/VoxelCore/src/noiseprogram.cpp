@@ -0,0 +1,768 @@
+// noiseprogram.cpp
+//
+// 与引擎无关的体素核心：把libnoise的模块图编译成线性的求值程序
+//
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include "interp.h"
+#include "mathconsts.h"
+#include "misc.h"
+#include "noiseprogram.h"
+
+using namespace voxel;
+using noise::module::MAX_BATCH_SIZE;
+using noise::module::Module;
+
+namespace
+{
+	int32_t GetNumInputs(NoiseOpCode code)
+	{
+		switch (code)
+		{
+		case OP_Input:
+		case OP_Const:
+			return 0;
+		case OP_Abs:
+		case OP_Invert:
+		case OP_Clamp:
+		case OP_ScaleBias:
+		case OP_Exponent:
+		case OP_Curve:
+		case OP_Terrace:
+		case OP_AddConst:
+		case OP_MulConst:
+			return 1;
+		case OP_Add:
+		case OP_Multiply:
+		case OP_Max:
+		case OP_Min:
+		case OP_Power:
+		case OP_AddScaled:
+			return 2;
+		default:
+			return 3;
+		}
+	}
+
+	NoiseOp MakeOp(NoiseOpCode code, int32_t a = 0, int32_t b = 0, int32_t c = 0)
+	{
+		NoiseOp op;
+		memset(&op, 0, sizeof(op));
+		op.Code = code;
+		op.Inputs[0] = a;
+		op.Inputs[1] = b;
+		op.Inputs[2] = c;
+		return op;
+	}
+
+	//用位模式作为键，NaN和正负零都能正确区分
+	void AppendKey(std::vector<uint64_t>& key, double value)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		key.push_back(bits);
+	}
+
+	std::vector<double>& GetRegisterScratch()
+	{
+		static thread_local std::vector<double> scratch;
+		return scratch;
+	}
+
+	//Turbulence内部三个Perlin模块的输入坐标偏移，与Turbulence::GetValue相同
+	const double TurbulenceOffsets[3][3] =
+	{
+		{12414.0 / 65536.0, 65124.0 / 65536.0, 31337.0 / 65536.0},
+		{26519.0 / 65536.0, 18128.0 / 65536.0, 60493.0 / 65536.0},
+		{53820.0 / 65536.0, 11213.0 / 65536.0, 44845.0 / 65536.0},
+	};
+}
+
+namespace voxel
+{
+	//编译期间每个操作的结果是一个值，Inputs为值的下标，最后再分配寄存器
+	class NoiseProgramCompiler
+	{
+	public:
+		explicit NoiseProgramCompiler(NoiseProgram& program) :
+			Program(program)
+		{
+			Program.Ops.clear();
+			Program.Constants.clear();
+			Program.Generators.clear();
+			Program.ExternalModules.clear();
+			for (int32_t axis = 0; axis < 3; ++axis)
+			{
+				NoiseOp op = MakeOp(OP_Input);
+				op.Data = axis;
+				Coordinates[axis] = Emit(op);
+			}
+		}
+
+		int32_t CompileRoot(const Module& source)
+		{
+			return CompileModule(source, Coordinates[0], Coordinates[1], Coordinates[2]);
+		}
+
+		//去掉不再使用的值，按最后一次使用的位置复用寄存器
+		void Finish(int32_t root)
+		{
+			int32_t numValues = int32_t(Values.size());
+			std::vector<bool> live(numValues, false);
+			live[root] = true;
+			for (int32_t i = numValues - 1; i >= 0; --i)
+			{
+				if (!live[i])
+					continue;
+				for (int32_t j = 0; j < GetNumInputs(Values[i].Code); ++j)
+					live[Values[i].Inputs[j]] = true;
+			}
+
+			std::vector<int32_t> lastUse(numValues, -1);
+			for (int32_t i = 0; i < numValues; ++i)
+			{
+				if (!live[i])
+					continue;
+				for (int32_t j = 0; j < GetNumInputs(Values[i].Code); ++j)
+					lastUse[Values[i].Inputs[j]] = i;
+			}
+			lastUse[root] = numValues;
+
+			std::vector<int32_t> value2Register(numValues, -1);
+			std::vector<int32_t> freeRegisters;
+			Program.NumRegisters = 0;
+			for (int32_t i = 0; i < numValues; ++i)
+			{
+				if (!live[i])
+					continue;
+				NoiseOp op = Values[i];
+				int32_t numInputs = GetNumInputs(op.Code);
+				for (int32_t j = 0; j < numInputs; ++j)
+					op.Inputs[j] = value2Register[op.Inputs[j]];
+				//输出不与输入共用寄存器，生成模块不一定支持原地计算
+				if (freeRegisters.empty())
+				{
+					op.Output = Program.NumRegisters++;
+				}
+				else
+				{
+					op.Output = freeRegisters.back();
+					freeRegisters.pop_back();
+				}
+				value2Register[i] = op.Output;
+				for (int32_t j = 0; j < numInputs; ++j)
+				{
+					int32_t input = Values[i].Inputs[j];
+					if (lastUse[input] == i && value2Register[input] >= 0)
+					{
+						freeRegisters.push_back(value2Register[input]);
+						value2Register[input] = -1;
+					}
+				}
+				Program.Ops.push_back(op);
+			}
+			Program.OutputRegister = value2Register[root];
+		}
+
+	private:
+		typedef std::tuple<const Module*, int32_t, int32_t, int32_t> ModuleKey;
+
+		int32_t CompileModule(const Module& module, int32_t x, int32_t y, int32_t z)
+		{
+			//同一个模块在相同的输入坐标下只求值一次
+			ModuleKey key(&module, x, y, z);
+			std::map<ModuleKey, int32_t>::const_iterator it = Module2Value.find(key);
+			if (it != Module2Value.end())
+				return it->second;
+			int32_t value = CompileModuleUncached(module, x, y, z);
+			Module2Value[key] = value;
+			return value;
+		}
+
+		int32_t CompileSource(const Module& module, int32_t index, int32_t x, int32_t y, int32_t z)
+		{
+			return CompileModule(module.GetSourceModule(index), x, y, z);
+		}
+
+		int32_t CompileModuleUncached(const Module& module, int32_t x, int32_t y, int32_t z)
+		{
+			using namespace noise::module;
+
+			//生成模块
+			if (const Const* constModule = dynamic_cast<const Const*>(&module))
+				return EmitConst(constModule->GetConstValue());
+			if (const Perlin* perlin = dynamic_cast<const Perlin*>(&module))
+				return EmitGenerator(AddPerlin(*perlin), x, y, z);
+			if (const Billow* billow = dynamic_cast<const Billow*>(&module))
+			{
+				std::shared_ptr<Billow> generator = std::make_shared<Billow>();
+				generator->SetFrequency(billow->GetFrequency());
+				generator->SetLacunarity(billow->GetLacunarity());
+				generator->SetNoiseQuality(billow->GetNoiseQuality());
+				generator->SetOctaveCount(billow->GetOctaveCount());
+				generator->SetPersistence(billow->GetPersistence());
+				generator->SetSeed(billow->GetSeed());
+				double key[] = {1, billow->GetFrequency(), billow->GetLacunarity(), double(billow->GetNoiseQuality()),
+					double(billow->GetOctaveCount()), billow->GetPersistence(), double(billow->GetSeed())};
+				return EmitGenerator(AddGenerator(generator, key, sizeof(key) / sizeof(key[0])), x, y, z);
+			}
+			if (const RidgedMulti* ridgedMulti = dynamic_cast<const RidgedMulti*>(&module))
+			{
+				//设置间隙度时会重新计算各层的权重
+				std::shared_ptr<RidgedMulti> generator = std::make_shared<RidgedMulti>();
+				generator->SetFrequency(ridgedMulti->GetFrequency());
+				generator->SetLacunarity(ridgedMulti->GetLacunarity());
+				generator->SetNoiseQuality(ridgedMulti->GetNoiseQuality());
+				generator->SetOctaveCount(ridgedMulti->GetOctaveCount());
+				generator->SetSeed(ridgedMulti->GetSeed());
+				double key[] = {2, ridgedMulti->GetFrequency(), ridgedMulti->GetLacunarity(), double(ridgedMulti->GetNoiseQuality()),
+					double(ridgedMulti->GetOctaveCount()), double(ridgedMulti->GetSeed())};
+				return EmitGenerator(AddGenerator(generator, key, sizeof(key) / sizeof(key[0])), x, y, z);
+			}
+			if (const Voronoi* voronoi = dynamic_cast<const Voronoi*>(&module))
+			{
+				std::shared_ptr<Voronoi> generator = std::make_shared<Voronoi>();
+				generator->SetDisplacement(voronoi->GetDisplacement());
+				generator->SetFrequency(voronoi->GetFrequency());
+				generator->SetSeed(voronoi->GetSeed());
+				generator->EnableDistance(voronoi->IsDistanceEnabled());
+				double key[] = {3, voronoi->GetDisplacement(), voronoi->GetFrequency(), double(voronoi->GetSeed()),
+					voronoi->IsDistanceEnabled() ? 1.0 : 0.0};
+				return EmitGenerator(AddGenerator(generator, key, sizeof(key) / sizeof(key[0])), x, y, z);
+			}
+			if (dynamic_cast<const Checkerboard*>(&module))
+			{
+				double key[] = {4};
+				return EmitGenerator(AddGenerator(std::make_shared<Checkerboard>(), key, 1), x, y, z);
+			}
+			if (const Spheres* spheres = dynamic_cast<const Spheres*>(&module))
+			{
+				std::shared_ptr<Spheres> generator = std::make_shared<Spheres>();
+				generator->SetFrequency(spheres->GetFrequency());
+				double key[] = {5, spheres->GetFrequency()};
+				return EmitGenerator(AddGenerator(generator, key, 2), x, y, z);
+			}
+			if (const Cylinders* cylinders = dynamic_cast<const Cylinders*>(&module))
+			{
+				std::shared_ptr<Cylinders> generator = std::make_shared<Cylinders>();
+				generator->SetFrequency(cylinders->GetFrequency());
+				double key[] = {6, cylinders->GetFrequency()};
+				return EmitGenerator(AddGenerator(generator, key, 2), x, y, z);
+			}
+
+			//组合、修改模块
+			if (dynamic_cast<const Add*>(&module))
+				return Emit(MakeOp(OP_Add, CompileSource(module, 0, x, y, z), CompileSource(module, 1, x, y, z)));
+			if (dynamic_cast<const Multiply*>(&module))
+				return Emit(MakeOp(OP_Multiply, CompileSource(module, 0, x, y, z), CompileSource(module, 1, x, y, z)));
+			if (dynamic_cast<const Max*>(&module))
+				return Emit(MakeOp(OP_Max, CompileSource(module, 0, x, y, z), CompileSource(module, 1, x, y, z)));
+			if (dynamic_cast<const Min*>(&module))
+				return Emit(MakeOp(OP_Min, CompileSource(module, 0, x, y, z), CompileSource(module, 1, x, y, z)));
+			if (dynamic_cast<const Power*>(&module))
+				return Emit(MakeOp(OP_Power, CompileSource(module, 0, x, y, z), CompileSource(module, 1, x, y, z)));
+			if (dynamic_cast<const Abs*>(&module))
+				return Emit(MakeOp(OP_Abs, CompileSource(module, 0, x, y, z)));
+			if (dynamic_cast<const Invert*>(&module))
+				return Emit(MakeOp(OP_Invert, CompileSource(module, 0, x, y, z)));
+			if (const Clamp* clamp = dynamic_cast<const Clamp*>(&module))
+			{
+				NoiseOp op = MakeOp(OP_Clamp, CompileSource(module, 0, x, y, z));
+				op.Params[0] = clamp->GetLowerBound();
+				op.Params[1] = clamp->GetUpperBound();
+				return Emit(op);
+			}
+			if (const ScaleBias* scaleBias = dynamic_cast<const ScaleBias*>(&module))
+			{
+				NoiseOp op = MakeOp(OP_ScaleBias, CompileSource(module, 0, x, y, z));
+				op.Params[0] = scaleBias->GetScale();
+				op.Params[1] = scaleBias->GetBias();
+				return Emit(op);
+			}
+			if (const Exponent* exponent = dynamic_cast<const Exponent*>(&module))
+			{
+				NoiseOp op = MakeOp(OP_Exponent, CompileSource(module, 0, x, y, z));
+				op.Params[0] = exponent->GetExponent();
+				return Emit(op);
+			}
+			if (const Curve* curve = dynamic_cast<const Curve*>(&module))
+			{
+				assert(curve->GetControlPointCount() >= 4);
+				std::vector<double> points;
+				for (int32_t i = 0; i < curve->GetControlPointCount(); ++i)
+				{
+					points.push_back(curve->GetControlPointArray()[i].inputValue);
+					points.push_back(curve->GetControlPointArray()[i].outputValue);
+				}
+				NoiseOp op = MakeOp(OP_Curve, CompileSource(module, 0, x, y, z));
+				op.Data = AddConstants(points);
+				op.DataCount = curve->GetControlPointCount();
+				return Emit(op);
+			}
+			if (const Terrace* terrace = dynamic_cast<const Terrace*>(&module))
+			{
+				assert(terrace->GetControlPointCount() >= 2);
+				std::vector<double> points(terrace->GetControlPointArray(), terrace->GetControlPointArray() + terrace->GetControlPointCount());
+				NoiseOp op = MakeOp(OP_Terrace, CompileSource(module, 0, x, y, z));
+				op.Params[0] = terrace->IsTerracesInverted() ? 1.0 : 0.0;
+				op.Data = AddConstants(points);
+				op.DataCount = terrace->GetControlPointCount();
+				return Emit(op);
+			}
+			if (dynamic_cast<const Blend*>(&module))
+			{
+				return Emit(MakeOp(OP_Blend, CompileSource(module, 0, x, y, z), CompileSource(module, 1, x, y, z),
+					CompileSource(module, 2, x, y, z)));
+			}
+			if (const Select* select = dynamic_cast<const Select*>(&module))
+			{
+				NoiseOp op = MakeOp(OP_Select, CompileSource(module, 0, x, y, z), CompileSource(module, 1, x, y, z),
+					CompileSource(module, 2, x, y, z));
+				op.Params[0] = select->GetLowerBound();
+				op.Params[1] = select->GetUpperBound();
+				op.Params[2] = select->GetEdgeFalloff();
+				return Emit(op);
+			}
+			//缓存由合并重复子图代替
+			if (dynamic_cast<const Cache*>(&module))
+				return CompileSource(module, 0, x, y, z);
+
+			//变换输入坐标的模块
+			if (const ScalePoint* scalePoint = dynamic_cast<const ScalePoint*>(&module))
+			{
+				return CompileSource(module, 0, EmitMulConst(x, scalePoint->GetXScale()), EmitMulConst(y, scalePoint->GetYScale()),
+					EmitMulConst(z, scalePoint->GetZScale()));
+			}
+			if (const TranslatePoint* translatePoint = dynamic_cast<const TranslatePoint*>(&module))
+			{
+				return CompileSource(module, 0, EmitAddConst(x, translatePoint->GetXTranslation()),
+					EmitAddConst(y, translatePoint->GetYTranslation()), EmitAddConst(z, translatePoint->GetZTranslation()));
+			}
+			if (const RotatePoint* rotatePoint = dynamic_cast<const RotatePoint*>(&module))
+			{
+				//与RotatePoint::SetAngles的计算相同
+				double xCos = cos(rotatePoint->GetXAngle() * noise::DEG_TO_RAD);
+				double yCos = cos(rotatePoint->GetYAngle() * noise::DEG_TO_RAD);
+				double zCos = cos(rotatePoint->GetZAngle() * noise::DEG_TO_RAD);
+				double xSin = sin(rotatePoint->GetXAngle() * noise::DEG_TO_RAD);
+				double ySin = sin(rotatePoint->GetYAngle() * noise::DEG_TO_RAD);
+				double zSin = sin(rotatePoint->GetZAngle() * noise::DEG_TO_RAD);
+				int32_t nx = EmitDot3(x, y, z, ySin * xSin * zSin + yCos * zCos, xCos * zSin, ySin * zCos - yCos * xSin * zSin);
+				int32_t ny = EmitDot3(x, y, z, ySin * xSin * zCos - yCos * zSin, xCos * zCos, -yCos * xSin * zCos - ySin * zSin);
+				int32_t nz = EmitDot3(x, y, z, -ySin * xCos, xSin, yCos * xCos);
+				return CompileSource(module, 0, nx, ny, nz);
+			}
+			if (dynamic_cast<const Displace*>(&module))
+			{
+				int32_t nx = Emit(MakeOp(OP_Add, x, CompileSource(module, 1, x, y, z)));
+				int32_t ny = Emit(MakeOp(OP_Add, y, CompileSource(module, 2, x, y, z)));
+				int32_t nz = Emit(MakeOp(OP_Add, z, CompileSource(module, 3, x, y, z)));
+				return CompileSource(module, 0, nx, ny, nz);
+			}
+			if (const Turbulence* turbulence = dynamic_cast<const Turbulence*>(&module))
+			{
+				int32_t coordinates[3] = {x, y, z};
+				int32_t distorted[3];
+				for (int32_t axis = 0; axis < 3; ++axis)
+				{
+					Perlin distortModule;
+					distortModule.SetSeed(turbulence->GetSeed() + axis);
+					distortModule.SetFrequency(turbulence->GetFrequency());
+					distortModule.SetOctaveCount(turbulence->GetRoughnessCount());
+					int32_t distortValue = EmitGenerator(AddPerlin(distortModule), EmitAddConst(x, TurbulenceOffsets[axis][0]),
+						EmitAddConst(y, TurbulenceOffsets[axis][1]), EmitAddConst(z, TurbulenceOffsets[axis][2]));
+					NoiseOp op = MakeOp(OP_AddScaled, coordinates[axis], distortValue);
+					op.Params[0] = turbulence->GetPower();
+					distorted[axis] = Emit(op);
+				}
+				return CompileSource(module, 0, distorted[0], distorted[1], distorted[2]);
+			}
+
+			//不认识的模块按原样调用
+			int32_t index = int32_t(Program.ExternalModules.size());
+			Program.ExternalModules.push_back(&module);
+			NoiseOp op = MakeOp(OP_Module, x, y, z);
+			op.Data = index;
+			return Emit(op);
+		}
+
+		int32_t AddPerlin(const noise::module::Perlin& perlin)
+		{
+			std::shared_ptr<noise::module::Perlin> generator = std::make_shared<noise::module::Perlin>();
+			generator->SetFrequency(perlin.GetFrequency());
+			generator->SetLacunarity(perlin.GetLacunarity());
+			generator->SetNoiseQuality(perlin.GetNoiseQuality());
+			generator->SetOctaveCount(perlin.GetOctaveCount());
+			generator->SetPersistence(perlin.GetPersistence());
+			generator->SetSeed(perlin.GetSeed());
+			double key[] = {0, perlin.GetFrequency(), perlin.GetLacunarity(), double(perlin.GetNoiseQuality()),
+				double(perlin.GetOctaveCount()), perlin.GetPersistence(), double(perlin.GetSeed())};
+			return AddGenerator(generator, key, sizeof(key) / sizeof(key[0]));
+		}
+
+		//参数相同的生成模块只保留一个
+		int32_t AddGenerator(const std::shared_ptr<Module>& generator, const double* params, int32_t numParams)
+		{
+			std::vector<uint64_t> key;
+			for (int32_t i = 0; i < numParams; ++i)
+				AppendKey(key, params[i]);
+			std::map<std::vector<uint64_t>, int32_t>::const_iterator it = Generator2Index.find(key);
+			if (it != Generator2Index.end())
+				return it->second;
+			int32_t index = int32_t(Program.Generators.size());
+			Program.Generators.push_back(generator);
+			Generator2Index[key] = index;
+			return index;
+		}
+
+		int32_t AddConstants(const std::vector<double>& values)
+		{
+			std::vector<double>& constants = Program.Constants;
+			for (size_t start = 0; start + values.size() <= constants.size(); ++start)
+			{
+				if (std::equal(values.begin(), values.end(), constants.begin() + start))
+					return int32_t(start);
+			}
+			int32_t start = int32_t(constants.size());
+			constants.insert(constants.end(), values.begin(), values.end());
+			return start;
+		}
+
+		int32_t EmitConst(double value)
+		{
+			NoiseOp op = MakeOp(OP_Const);
+			op.Params[0] = value;
+			return Emit(op);
+		}
+
+		int32_t EmitGenerator(int32_t generator, int32_t x, int32_t y, int32_t z)
+		{
+			NoiseOp op = MakeOp(OP_Generator, x, y, z);
+			op.Data = generator;
+			return Emit(op);
+		}
+
+		int32_t EmitAddConst(int32_t a, double value)
+		{
+			NoiseOp op = MakeOp(OP_AddConst, a);
+			op.Params[0] = value;
+			return Emit(op);
+		}
+
+		int32_t EmitMulConst(int32_t a, double value)
+		{
+			//乘以1结果不变
+			if (value == 1.0)
+				return a;
+			NoiseOp op = MakeOp(OP_MulConst, a);
+			op.Params[0] = value;
+			return Emit(op);
+		}
+
+		int32_t EmitDot3(int32_t a, int32_t b, int32_t c, double p0, double p1, double p2)
+		{
+			NoiseOp op = MakeOp(OP_Dot3, a, b, c);
+			op.Params[0] = p0;
+			op.Params[1] = p1;
+			op.Params[2] = p2;
+			return Emit(op);
+		}
+
+		int32_t Emit(const NoiseOp& op)
+		{
+			int32_t numInputs = GetNumInputs(op.Code);
+
+			//输入全部为常量时在编译期求值，使用与运行时相同的代码保证结果一致
+			bool bFoldable = numInputs > 0 && op.Code != OP_Generator && op.Code != OP_Module;
+			for (int32_t i = 0; i < numInputs && bFoldable; ++i)
+				bFoldable = Values[op.Inputs[i]].Code == OP_Const;
+			if (bFoldable)
+			{
+				std::vector<double> registers(4 * MAX_BATCH_SIZE);
+				NoiseOp foldOp = op;
+				for (int32_t i = 0; i < numInputs; ++i)
+				{
+					registers[i * MAX_BATCH_SIZE] = Values[op.Inputs[i]].Params[0];
+					foldOp.Inputs[i] = i;
+				}
+				foldOp.Output = 3;
+				Program.Execute(foldOp, &registers[0], 1);
+				return EmitConst(registers[3 * MAX_BATCH_SIZE]);
+			}
+
+			//完全相同的操作只保留一个
+			std::vector<uint64_t> key;
+			key.push_back(op.Code);
+			for (int32_t i = 0; i < numInputs; ++i)
+				key.push_back(uint64_t(op.Inputs[i]));
+			for (int32_t i = 0; i < 3; ++i)
+				AppendKey(key, op.Params[i]);
+			key.push_back(uint64_t(op.Data));
+			key.push_back(uint64_t(op.DataCount));
+			std::map<std::vector<uint64_t>, int32_t>::const_iterator it = Op2Value.find(key);
+			if (it != Op2Value.end())
+				return it->second;
+
+			int32_t value = int32_t(Values.size());
+			Values.push_back(op);
+			Values.back().Output = value;
+			Op2Value[key] = value;
+			return value;
+		}
+
+		NoiseProgram& Program;
+
+		std::vector<NoiseOp> Values;
+
+		int32_t Coordinates[3];
+
+		std::map<ModuleKey, int32_t> Module2Value;
+
+		std::map<std::vector<uint64_t>, int32_t> Op2Value;
+
+		std::map<std::vector<uint64_t>, int32_t> Generator2Index;
+	};
+}
+
+NoiseProgram::NoiseProgram() :
+	NumRegisters(0), OutputRegister(0)
+{
+}
+
+void NoiseProgram::Compile(const Module& source)
+{
+	NoiseProgramCompiler compiler(*this);
+	compiler.Finish(compiler.CompileRoot(source));
+}
+
+void NoiseProgram::GetValues(const double* x, const double* y, const double* z, double* out, int32_t count) const
+{
+	assert(NumRegisters > 0);
+	std::vector<double>& registers = GetRegisterScratch();
+	if (registers.size() < size_t(NumRegisters * MAX_BATCH_SIZE))
+		registers.resize(NumRegisters * MAX_BATCH_SIZE);
+	const double* coordinates[3] = {x, y, z};
+	for (int32_t start = 0; start < count; start += MAX_BATCH_SIZE)
+	{
+		int32_t num = std::min(count - start, int32_t(MAX_BATCH_SIZE));
+		for (size_t i = 0; i < Ops.size(); ++i)
+		{
+			const NoiseOp& op = Ops[i];
+			if (op.Code == OP_Input)
+				memcpy(&registers[op.Output * MAX_BATCH_SIZE], coordinates[op.Data] + start, num * sizeof(double));
+			else
+				Execute(op, &registers[0], num);
+		}
+		memcpy(out + start, &registers[OutputRegister * MAX_BATCH_SIZE], num * sizeof(double));
+	}
+}
+
+double NoiseProgram::GetValue(double x, double y, double z) const
+{
+	double value;
+	GetValues(&x, &y, &z, &value, 1);
+	return value;
+}
+
+void NoiseProgram::Execute(const NoiseOp& op, double* registers, int32_t count) const
+{
+	double* out = registers + op.Output * MAX_BATCH_SIZE;
+	const double* a = registers + op.Inputs[0] * MAX_BATCH_SIZE;
+	const double* b = registers + op.Inputs[1] * MAX_BATCH_SIZE;
+	const double* c = registers + op.Inputs[2] * MAX_BATCH_SIZE;
+	const double* params = op.Params;
+
+	//每个操作的计算顺序与对应模块的GetValue相同
+	switch (op.Code)
+	{
+	case OP_Input:
+		assert(false);
+		break;
+	case OP_Const:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = params[0];
+		break;
+	case OP_Generator:
+		Generators[op.Data]->GetValueBatch(a, b, c, out, count);
+		break;
+	case OP_Module:
+		ExternalModules[op.Data]->GetValueBatch(a, b, c, out, count);
+		break;
+	case OP_Add:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = a[i] + b[i];
+		break;
+	case OP_Multiply:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = a[i] * b[i];
+		break;
+	case OP_Max:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = noise::GetMax(a[i], b[i]);
+		break;
+	case OP_Min:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = noise::GetMin(a[i], b[i]);
+		break;
+	case OP_Power:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = pow(a[i], b[i]);
+		break;
+	case OP_Abs:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = fabs(a[i]);
+		break;
+	case OP_Invert:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = -a[i];
+		break;
+	case OP_Clamp:
+		for (int32_t i = 0; i < count; ++i)
+		{
+			if (a[i] < params[0])
+				out[i] = params[0];
+			else if (a[i] > params[1])
+				out[i] = params[1];
+			else
+				out[i] = a[i];
+		}
+		break;
+	case OP_ScaleBias:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = a[i] * params[0] + params[1];
+		break;
+	case OP_Exponent:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = (pow(fabs((a[i] + 1.0) / 2.0), params[0]) * 2.0 - 1.0);
+		break;
+	case OP_Curve:
+	{
+		const double* points = &Constants[op.Data];
+		int32_t last = op.DataCount - 1;
+		for (int32_t i = 0; i < count; ++i)
+		{
+			int32_t indexPos;
+			for (indexPos = 0; indexPos <= last; ++indexPos)
+			{
+				if (a[i] < points[indexPos * 2])
+					break;
+			}
+			int32_t index0 = noise::ClampValue(indexPos - 2, 0, last);
+			int32_t index1 = noise::ClampValue(indexPos - 1, 0, last);
+			int32_t index2 = noise::ClampValue(indexPos, 0, last);
+			int32_t index3 = noise::ClampValue(indexPos + 1, 0, last);
+			if (index1 == index2)
+			{
+				out[i] = points[index1 * 2 + 1];
+				continue;
+			}
+			double input0 = points[index1 * 2];
+			double input1 = points[index2 * 2];
+			double alpha = (a[i] - input0) / (input1 - input0);
+			out[i] = noise::CubicInterp(points[index0 * 2 + 1], points[index1 * 2 + 1], points[index2 * 2 + 1], points[index3 * 2 + 1], alpha);
+		}
+		break;
+	}
+	case OP_Terrace:
+	{
+		const double* points = &Constants[op.Data];
+		int32_t last = op.DataCount - 1;
+		for (int32_t i = 0; i < count; ++i)
+		{
+			int32_t indexPos;
+			for (indexPos = 0; indexPos <= last; ++indexPos)
+			{
+				if (a[i] < points[indexPos])
+					break;
+			}
+			int32_t index0 = noise::ClampValue(indexPos - 1, 0, last);
+			int32_t index1 = noise::ClampValue(indexPos, 0, last);
+			if (index0 == index1)
+			{
+				out[i] = points[index1];
+				continue;
+			}
+			double value0 = points[index0];
+			double value1 = points[index1];
+			double alpha = (a[i] - value0) / (value1 - value0);
+			if (params[0] != 0.0)
+			{
+				alpha = 1.0 - alpha;
+				std::swap(value0, value1);
+			}
+			alpha *= alpha;
+			out[i] = noise::LinearInterp(value0, value1, alpha);
+		}
+		break;
+	}
+	case OP_Blend:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = noise::LinearInterp(a[i], b[i], (c[i] + 1.0) / 2.0);
+		break;
+	case OP_Select:
+	{
+		double lowerBound = params[0];
+		double upperBound = params[1];
+		double edgeFalloff = params[2];
+		for (int32_t i = 0; i < count; ++i)
+		{
+			double controlValue = c[i];
+			if (edgeFalloff > 0.0)
+			{
+				if (controlValue < (lowerBound - edgeFalloff))
+				{
+					out[i] = a[i];
+				}
+				else if (controlValue < (lowerBound + edgeFalloff))
+				{
+					double lowerCurve = (lowerBound - edgeFalloff);
+					double upperCurve = (lowerBound + edgeFalloff);
+					double alpha = noise::SCurve3((controlValue - lowerCurve) / (upperCurve - lowerCurve));
+					out[i] = noise::LinearInterp(a[i], b[i], alpha);
+				}
+				else if (controlValue < (upperBound - edgeFalloff))
+				{
+					out[i] = b[i];
+				}
+				else if (controlValue < (upperBound + edgeFalloff))
+				{
+					double lowerCurve = (upperBound - edgeFalloff);
+					double upperCurve = (upperBound + edgeFalloff);
+					double alpha = noise::SCurve3((controlValue - lowerCurve) / (upperCurve - lowerCurve));
+					out[i] = noise::LinearInterp(b[i], a[i], alpha);
+				}
+				else
+				{
+					out[i] = a[i];
+				}
+			}
+			else
+			{
+				out[i] = (controlValue < lowerBound || controlValue > upperBound) ? a[i] : b[i];
+			}
+		}
+		break;
+	}
+	case OP_AddConst:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = a[i] + params[0];
+		break;
+	case OP_MulConst:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = a[i] * params[0];
+		break;
+	case OP_AddScaled:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = a[i] + (b[i] * params[0]);
+		break;
+	case OP_Dot3:
+		for (int32_t i = 0; i < count; ++i)
+			out[i] = (params[0] * a[i]) + (params[1] * b[i]) + (params[2] * c[i]);
+		break;
+	}
+}
@@ -0,0 +1,120 @@
+// noiseprogram.h
+//
+// 与引擎无关的体素核心：把libnoise的模块图编译成线性的求值程序
+//
+
+#ifndef VOXEL_NOISEPROGRAM_H
+#define VOXEL_NOISEPROGRAM_H
+
+#include <memory>
+#include <vector>
+#include "noise.h"
+#include "voxeltypes.h"
+
+namespace voxel
+{
+	//求值程序中的操作，结果与对应模块的GetValue完全一致
+	enum NoiseOpCode
+	{
+		//把输入坐标的第Data个分量写入寄存器
+		OP_Input,
+		//常量Params[0]
+		OP_Const,
+		//调用程序自己持有的第Data个生成模块(Perlin、Billow、RidgedMulti等)
+		OP_Generator,
+		//不认识的模块，调用原模块的GetValueBatch，线程安全取决于原模块
+		OP_Module,
+		OP_Add,
+		OP_Multiply,
+		OP_Max,
+		OP_Min,
+		OP_Power,
+		OP_Abs,
+		OP_Invert,
+		//Params[0]为下界，Params[1]为上界
+		OP_Clamp,
+		//Params[0]为缩放，Params[1]为偏移
+		OP_ScaleBias,
+		OP_Exponent,
+		//控制点在常量池中从Data开始，每个控制点为输入、输出两个值
+		OP_Curve,
+		//控制点在常量池中从Data开始，Params[0]不为0时反转
+		OP_Terrace,
+		OP_Blend,
+		//Params依次为下界、上界、过渡宽度
+		OP_Select,
+		//坐标变换：a + Params[0]
+		OP_AddConst,
+		//坐标变换：a * Params[0]
+		OP_MulConst,
+		//a + b * Params[0]
+		OP_AddScaled,
+		//Params[0] * a + Params[1] * b + Params[2] * c
+		OP_Dot3,
+	};
+
+	struct NoiseOp
+	{
+		NoiseOpCode Code;
+
+		//结果写入的寄存器
+		int32_t Output;
+
+		//输入的寄存器，个数由Code决定
+		int32_t Inputs[3];
+
+		double Params[3];
+
+		int32_t Data;
+
+		int32_t DataCount;
+	};
+
+	//编译后的程序只读，同一个对象可以在多个线程同时求值
+	class NoiseProgram
+	{
+	public:
+		NoiseProgram();
+
+		//编译以source为根的模块图：合并重复的子图、折叠常量、把参数内联到操作中。
+		//编译后除不认识的模块外不再引用原模块图，缺少源模块时抛出noise::ExceptionNoModule
+		void Compile(const noise::module::Module& source);
+
+		//按noise::module::MAX_BATCH_SIZE分批求值，寄存器使用线程局部的缓冲
+		void GetValues(const double* x, const double* y, const double* z, double* out, int32_t count) const;
+
+		double GetValue(double x, double y, double z) const;
+
+		const std::vector<NoiseOp>& GetOps() const
+		{
+			return Ops;
+		}
+
+		int32_t GetNumRegisters() const
+		{
+			return NumRegisters;
+		}
+
+	private:
+		friend class NoiseProgramCompiler;
+
+		//执行一个操作，registers为寄存器文件的起始位置
+		void Execute(const NoiseOp& op, double* registers, int32_t count) const;
+
+		std::vector<NoiseOp> Ops;
+
+		//曲线、阶梯的控制点
+		std::vector<double> Constants;
+
+		//程序自己创建的生成模块，不依赖源模块图的生命周期
+		std::vector<std::shared_ptr<noise::module::Module> > Generators;
+
+		std::vector<const noise::module::Module*> ExternalModules;
+
+		int32_t NumRegisters;
+
+		int32_t OutputRegister;
+	};
+}
+
+#endif
@@ -0,0 +1,338 @@
+// regionstore.cpp
+//
+// 与引擎无关的体素核心：把块数据按区域文件保存到磁盘并在后台线程读取
+//
+
+#include <string.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+#include "regionstore.h"
+
+using namespace voxel;
+
+static const uint8_t REGION_MAGIC[4] = { 'V', 'X', 'R', 'G' };
+static const uint32_t REGION_VERSION = 1;
+static const int32_t REGION_CHUNK_COUNT = REGION_CHUNKS_X * REGION_CHUNKS_Y * REGION_CHUNKS_Z;
+//文件头：标识、版本、块大小，之后是偏移表
+static const uint32_t REGION_HEADER_SIZE = 4 + 4 + 12;
+static const uint32_t REGION_ENTRY_SIZE = 12;
+static const uint32_t REGION_TABLE_SIZE = REGION_HEADER_SIZE + REGION_ENTRY_SIZE * REGION_CHUNK_COUNT;
+//同时打开的区域文件的上限，超过时全部关闭
+static const size_t MAX_OPEN_REGIONS = 64;
+
+//文件中的整数都按小端序存储
+static void WriteUInt32(uint8_t* dest, uint32_t value)
+{
+	dest[0] = uint8_t(value);
+	dest[1] = uint8_t(value >> 8);
+	dest[2] = uint8_t(value >> 16);
+	dest[3] = uint8_t(value >> 24);
+}
+
+static uint32_t ReadUInt32(const uint8_t* src)
+{
+	return uint32_t(src[0]) | uint32_t(src[1]) << 8 | uint32_t(src[2]) << 16 | uint32_t(src[3]) << 24;
+}
+
+static Int3 GetRegionDimensions()
+{
+	return Int3(REGION_CHUNKS_X, REGION_CHUNKS_Y, REGION_CHUNKS_Z);
+}
+
+void voxel::EncodeChunkPayload(const ChunkData& data, std::vector<uint8_t>& outPayload)
+{
+	outPayload.clear();
+	int32_t numGrids = data.Grids.Num();
+	int32_t index = 0;
+	while (index < numGrids)
+	{
+		uint8_t materialIndex = data.Grids.Get(index);
+		int32_t runEnd = index + 1;
+		while (runEnd < numGrids && data.Grids.Get(runEnd) == materialIndex)
+			++runEnd;
+		uint32_t runLength = uint32_t(runEnd - index);
+		while (runLength >= 0x80)
+		{
+			outPayload.push_back(uint8_t(runLength | 0x80));
+			runLength >>= 7;
+		}
+		outPayload.push_back(uint8_t(runLength));
+		outPayload.push_back(materialIndex);
+		index = runEnd;
+	}
+}
+
+ChunkDataPtr voxel::DecodeChunkPayload(const Int3& coord, const Int3& size, const uint8_t* payload, size_t payloadSize)
+{
+	//先把所有段展开到平铺的数组，最后一次建立压缩存储
+	int32_t numGrids = size.Volume();
+	std::vector<uint8_t> grids(numGrids);
+	int32_t index = 0;
+	size_t pos = 0;
+	while (pos < payloadSize)
+	{
+		uint32_t runLength = 0;
+		for (uint32_t shift = 0; ; shift += 7)
+		{
+			if (pos >= payloadSize || shift > 28)
+				return ChunkDataPtr();
+			uint8_t byte = payload[pos++];
+			runLength |= uint32_t(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				break;
+		}
+		if (pos >= payloadSize || runLength == 0 || runLength > uint32_t(numGrids - index))
+			return ChunkDataPtr();
+		memset(&grids[index], payload[pos++], runLength);
+		index += int32_t(runLength);
+	}
+	if (index != numGrids)
+		return ChunkDataPtr();
+	ChunkDataPtr data = std::make_shared<ChunkData>(coord, size);
+	data->Grids.Assign(grids.data(), numGrids);
+	return data;
+}
+
+RegionStore::RegionStore(const std::string& directory, const Int3& gridPerChunk) :
+	Directory(directory), GridPerChunk(gridPerChunk), NumRunningJobs(0), NumPendingLoads(0), bStopping(false)
+{
+#ifdef _WIN32
+	_mkdir(Directory.c_str());
+#else
+	mkdir(Directory.c_str(), 0755);
+#endif
+	IOThread = std::thread(&RegionStore::IOThreadMain, this);
+}
+
+RegionStore::~RegionStore()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		bStopping = true;
+	}
+	JobAvailable.notify_all();
+	IOThread.join();
+	CloseRegions();
+}
+
+void RegionStore::RequestLoad(const Int3& coord)
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Job job;
+		job.Coordinate = coord;
+		job.bSave = false;
+		Jobs.push_back(job);
+		++NumPendingLoads;
+	}
+	JobAvailable.notify_one();
+}
+
+void RegionStore::PopLoaded(std::vector<ChunkLoadResult>& outResults)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	outResults.insert(outResults.end(), LoadedChunks.begin(), LoadedChunks.end());
+	LoadedChunks.clear();
+}
+
+void RegionStore::Save(const ChunkData& data)
+{
+	Job job;
+	job.Coordinate = data.Coordinate;
+	job.bSave = true;
+	EncodeChunkPayload(data, job.Payload);
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Jobs.push_back(std::move(job));
+	}
+	JobAvailable.notify_one();
+}
+
+void RegionStore::Flush()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	JobsDone.wait(lock, [this]() { return Jobs.empty() && NumRunningJobs == 0; });
+}
+
+size_t RegionStore::GetNumPendingLoads() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return NumPendingLoads;
+}
+
+void RegionStore::IOThreadMain()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			JobAvailable.wait(lock, [this]() { return bStopping || !Jobs.empty(); });
+			if (Jobs.empty())
+				return;
+			job = std::move(Jobs.front());
+			Jobs.pop_front();
+			++NumRunningJobs;
+		}
+
+		ChunkLoadResult result;
+		if (job.bSave)
+			SaveChunk(job.Coordinate, job.Payload);
+		else
+		{
+			result.Coordinate = job.Coordinate;
+			result.Data = LoadChunk(job.Coordinate);
+		}
+
+		bool bIdle;
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			bIdle = Jobs.empty();
+		}
+		//队列空闲时把缓冲的写入刷到文件，Flush返回后数据已经交给系统
+		if (bIdle)
+		{
+			for (std::unordered_map<Int3, std::unique_ptr<Region>, Int3Hash>::iterator it = Regions.begin(); it != Regions.end(); ++it)
+				fflush(it->second->File);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			if (!job.bSave)
+			{
+				LoadedChunks.push_back(result);
+				--NumPendingLoads;
+			}
+			--NumRunningJobs;
+		}
+		JobsDone.notify_all();
+	}
+}
+
+RegionStore::Region* RegionStore::OpenRegion(const Int3& regionIndex, bool bCreate)
+{
+	std::unordered_map<Int3, std::unique_ptr<Region>, Int3Hash>::iterator it = Regions.find(regionIndex);
+	if (it != Regions.end())
+		return it->second.get();
+	if (Regions.size() >= MAX_OPEN_REGIONS)
+		CloseRegions();
+
+	std::string path = GetRegionPath(regionIndex);
+	std::unique_ptr<Region> region(new Region());
+	region->Entries.resize(REGION_CHUNK_COUNT);
+	std::vector<uint8_t> table(REGION_TABLE_SIZE, 0);
+	region->File = fopen(path.c_str(), "r+b");
+	bool bValid = false;
+	if (region->File)
+	{
+		//块大小不同的旧文件无法使用，保存时重新创建
+		bValid = fread(table.data(), 1, table.size(), region->File) == table.size() &&
+			memcmp(table.data(), REGION_MAGIC, 4) == 0 && ReadUInt32(&table[4]) == REGION_VERSION &&
+			int32_t(ReadUInt32(&table[8])) == GridPerChunk.X && int32_t(ReadUInt32(&table[12])) == GridPerChunk.Y &&
+			int32_t(ReadUInt32(&table[16])) == GridPerChunk.Z;
+		if (!bValid && !bCreate)
+		{
+			fclose(region->File);
+			return NULL;
+		}
+	}
+	else if (!bCreate)
+	{
+		return NULL;
+	}
+
+	if (bValid)
+	{
+		fseek(region->File, 0, SEEK_END);
+		region->FileSize = uint32_t(ftell(region->File));
+		for (int32_t i = 0; i < REGION_CHUNK_COUNT; ++i)
+		{
+			const uint8_t* entry = &table[REGION_HEADER_SIZE + i * REGION_ENTRY_SIZE];
+			region->Entries[i].Offset = ReadUInt32(entry);
+			region->Entries[i].Size = ReadUInt32(entry + 4);
+			region->Entries[i].Capacity = ReadUInt32(entry + 8);
+		}
+	}
+	else
+	{
+		if (region->File)
+			fclose(region->File);
+		region->File = fopen(path.c_str(), "w+b");
+		if (!region->File)
+			return NULL;
+		memcpy(table.data(), REGION_MAGIC, 4);
+		WriteUInt32(&table[4], REGION_VERSION);
+		WriteUInt32(&table[8], uint32_t(GridPerChunk.X));
+		WriteUInt32(&table[12], uint32_t(GridPerChunk.Y));
+		WriteUInt32(&table[16], uint32_t(GridPerChunk.Z));
+		fwrite(table.data(), 1, table.size(), region->File);
+		region->FileSize = REGION_TABLE_SIZE;
+		memset(region->Entries.data(), 0, region->Entries.size() * sizeof(RegionEntry));
+	}
+	Region* result = region.get();
+	Regions[regionIndex] = std::move(region);
+	return result;
+}
+
+ChunkDataPtr RegionStore::LoadChunk(const Int3& coord)
+{
+	Int3 chunkIndex = FloorDivide(coord, GridPerChunk);
+	Int3 regionIndex = FloorDivide(chunkIndex, GetRegionDimensions());
+	Region* region = OpenRegion(regionIndex, false);
+	if (!region)
+		return ChunkDataPtr();
+	Int3 local = chunkIndex - regionIndex * GetRegionDimensions();
+	const RegionEntry& entry = region->Entries[(local.X * REGION_CHUNKS_Y + local.Y) * REGION_CHUNKS_Z + local.Z];
+	if (entry.Size == 0)
+		return ChunkDataPtr();
+	std::vector<uint8_t> payload(entry.Size);
+	if (fseek(region->File, long(entry.Offset), SEEK_SET) != 0 || fread(payload.data(), 1, payload.size(), region->File) != payload.size())
+		return ChunkDataPtr();
+	return DecodeChunkPayload(coord, GridPerChunk, payload.data(), payload.size());
+}
+
+void RegionStore::SaveChunk(const Int3& coord, const std::vector<uint8_t>& payload)
+{
+	Int3 chunkIndex = FloorDivide(coord, GridPerChunk);
+	Int3 regionIndex = FloorDivide(chunkIndex, GetRegionDimensions());
+	Region* region = OpenRegion(regionIndex, true);
+	if (!region)
+		return;
+	Int3 local = chunkIndex - regionIndex * GetRegionDimensions();
+	int32_t entryIndex = (local.X * REGION_CHUNKS_Y + local.Y) * REGION_CHUNKS_Z + local.Z;
+	RegionEntry& entry = region->Entries[entryIndex];
+	uint32_t size = uint32_t(payload.size());
+	//放不下时追加到文件末尾，原来的位置成为空洞
+	if (size > entry.Capacity)
+	{
+		entry.Offset = region->FileSize;
+		entry.Capacity = size;
+		region->FileSize += size;
+	}
+	entry.Size = size;
+	fseek(region->File, long(entry.Offset), SEEK_SET);
+	fwrite(payload.data(), 1, payload.size(), region->File);
+
+	uint8_t entryBytes[REGION_ENTRY_SIZE];
+	WriteUInt32(entryBytes, entry.Offset);
+	WriteUInt32(entryBytes + 4, entry.Size);
+	WriteUInt32(entryBytes + 8, entry.Capacity);
+	fseek(region->File, long(REGION_HEADER_SIZE + entryIndex * REGION_ENTRY_SIZE), SEEK_SET);
+	fwrite(entryBytes, 1, REGION_ENTRY_SIZE, region->File);
+}
+
+void RegionStore::CloseRegions()
+{
+	for (std::unordered_map<Int3, std::unique_ptr<Region>, Int3Hash>::iterator it = Regions.begin(); it != Regions.end(); ++it)
+		fclose(it->second->File);
+	Regions.clear();
+}
+
+std::string RegionStore::GetRegionPath(const Int3& regionIndex) const
+{
+	return Directory + "/r." + std::to_string(regionIndex.X) + "." + std::to_string(regionIndex.Y) + "." +
+		std::to_string(regionIndex.Z) + ".vxr";
+}
@@ -0,0 +1,144 @@
+// regionstore.h
+//
+// 与引擎无关的体素核心：把块数据按区域文件保存到磁盘并在后台线程读取
+//
+
+#ifndef VOXEL_REGIONSTORE_H
+#define VOXEL_REGIONSTORE_H
+
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "chunkdata.h"
+
+namespace voxel
+{
+	//每个区域文件在各个轴上包含的块数
+	const int32_t REGION_CHUNKS_X = 16;
+	const int32_t REGION_CHUNKS_Y = 16;
+	const int32_t REGION_CHUNKS_Z = 4;
+
+	//把块的格子材质按存储顺序做游程编码，每段为变长的长度加一个材质下标
+	void EncodeChunkPayload(const ChunkData& data, std::vector<uint8_t>& outPayload);
+
+	//解码失败(长度与块大小不符)时返回空指针
+	ChunkDataPtr DecodeChunkPayload(const Int3& coord, const Int3& size, const uint8_t* payload, size_t payloadSize);
+
+	//后台读取的结果，块不在存储中时Data为空
+	struct ChunkLoadResult
+	{
+		Int3 Coordinate;
+
+		ChunkDataPtr Data;
+	};
+
+	//区域文件开头是偏移表，之后是各个块的压缩数据。重写的块放得下时覆盖原来的位置，否则追加到文件末尾。
+	//读写都在一个后台线程上按提交顺序执行，所以保存之后立刻读取也能读到新数据；除后台线程外都在主线程调用
+	class RegionStore
+	{
+	public:
+		//directory不存在时创建，上一级目录必须存在
+		RegionStore(const std::string& directory, const Int3& gridPerChunk);
+
+		//写完已提交的数据后退出
+		~RegionStore();
+
+		//请求在后台读取一个块，结果由PopLoaded取回
+		void RequestLoad(const Int3& coord);
+
+		void PopLoaded(std::vector<ChunkLoadResult>& outResults);
+
+		//在调用线程编码，之后的修改不会影响写入的内容
+		void Save(const ChunkData& data);
+
+		//等待已提交的读写全部完成，并把数据刷到文件
+		void Flush();
+
+		//等待中以及正在执行的读取请求
+		size_t GetNumPendingLoads() const;
+
+		const std::string& GetDirectory() const
+		{
+			return Directory;
+		}
+
+	private:
+		//偏移表的一项，Size为0表示块不在文件中
+		struct RegionEntry
+		{
+			uint32_t Offset;
+
+			uint32_t Size;
+
+			//这个位置能容纳的最大长度
+			uint32_t Capacity;
+		};
+
+		struct Region
+		{
+			FILE* File;
+
+			uint32_t FileSize;
+
+			std::vector<RegionEntry> Entries;
+
+			Region() : File(NULL), FileSize(0) {}
+		};
+
+		struct Job
+		{
+			Int3 Coordinate;
+
+			bool bSave;
+
+			std::vector<uint8_t> Payload;
+		};
+
+		void IOThreadMain();
+
+		//只在后台线程调用，bCreate为false时文件不存在返回空指针
+		Region* OpenRegion(const Int3& regionIndex, bool bCreate);
+
+		ChunkDataPtr LoadChunk(const Int3& coord);
+
+		void SaveChunk(const Int3& coord, const std::vector<uint8_t>& payload);
+
+		void CloseRegions();
+
+		std::string GetRegionPath(const Int3& regionIndex) const;
+
+		std::string Directory;
+
+		Int3 GridPerChunk;
+
+		mutable std::mutex Mutex;
+
+		std::condition_variable JobAvailable;
+
+		std::condition_variable JobsDone;
+
+		std::deque<Job> Jobs;
+
+		//后台线程正在执行的任务数
+		int32_t NumRunningJobs;
+
+		size_t NumPendingLoads;
+
+		bool bStopping;
+
+		std::vector<ChunkLoadResult> LoadedChunks;
+
+		//已打开的区域文件，只在后台线程访问
+		std::unordered_map<Int3, std::unique_ptr<Region>, Int3Hash> Regions;
+
+		std::thread IOThread;
+	};
+}
+
+#endif
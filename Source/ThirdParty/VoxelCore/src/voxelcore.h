@@ -0,0 +1,25 @@
+// voxelcore.h
+//
+// 与引擎无关的体素核心：生成、存储、区域文件存档、相邻块查询、构建网格、后台重建网格、细节层级、碰撞、射线与重叠查询以及噪声程序
+//
+
+#ifndef VOXEL_VOXELCORE_H
+#define VOXEL_VOXELCORE_H
+
+#include "voxeltypes.h"
+#include "chunkstorage.h"
+#include "chunkdata.h"
+#include "chunkmap.h"
+#include "heightcolumn.h"
+#include "chunkneighbourhood.h"
+#include "chunkmesher.h"
+#include "chunklod.h"
+#include "chunkgenerationqueue.h"
+#include "chunkcollision.h"
+#include "chunkmeshqueue.h"
+#include "regionstore.h"
+#include "chunkworld.h"
+#include "voxelquery.h"
+#include "noiseprogram.h"
+
+#endif
@@ -0,0 +1,192 @@
+// voxelquery.cpp
+//
+// 与引擎无关的体素核心：直接在块数据上的射线检测以及球体、长方体的重叠查询
+//
+
+#include <math.h>
+#include <algorithm>
+#include "voxelquery.h"
+
+using namespace voxel;
+
+VoxelQuery::VoxelQuery(const ChunkWorld& world) :
+	Chunks(world.GetChunkDataMap()), GridPerChunk(world.GetParam().GridPerChunk), NumChunkLookups(0)
+{
+	const std::vector<MaterialType>& materialTypes = world.GetCollisionMaterialTypes();
+	for (int32_t i = 0; i < 256; ++i)
+		SolidMaterials[i] = IsSolidMaterial(materialTypes, i);
+}
+
+const ChunkData* VoxelQuery::FindChunk(const Int3& chunkCoord)
+{
+	CachedChunk& cached = Cache[MixInt3(chunkCoord) & (NumCachedChunks - 1)];
+	if (cached.bValid && cached.Coordinate == chunkCoord)
+		return cached.Data;
+	++NumChunkLookups;
+	const ChunkDataPtr* data = Chunks.Find(chunkCoord);
+	cached.Coordinate = chunkCoord;
+	cached.Data = data ? data->get() : NULL;
+	cached.bValid = true;
+	return cached.Data;
+}
+
+bool VoxelQuery::Raycast(const VoxelRay& ray, RaycastHit& outHit)
+{
+	outHit = RaycastHit();
+	double length = sqrt(ray.Direction[0] * ray.Direction[0] + ray.Direction[1] * ray.Direction[1] + ray.Direction[2] * ray.Direction[2]);
+	if (length == 0)
+		return false;
+
+	//grid为当前格子，local为它在块内的偏移，index为它在块存储中的下标，跨过块的边界时才重新查找块
+	int32_t grid[3];
+	int32_t step[3];
+	//沿射线到达下一个格子边界的距离，以及每跨过一个格子增加的距离
+	double nextBoundary[3];
+	double boundaryDelta[3];
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		double direction = ray.Direction[axis] / length;
+		grid[axis] = int32_t(floor(ray.Origin[axis]));
+		step[axis] = direction > 0 ? 1 : -1;
+		if (direction == 0)
+		{
+			nextBoundary[axis] = HUGE_VAL;
+			boundaryDelta[axis] = HUGE_VAL;
+			continue;
+		}
+		double boundary = direction > 0 ? grid[axis] + 1.0 : double(grid[axis]);
+		nextBoundary[axis] = (boundary - ray.Origin[axis]) / direction;
+		boundaryDelta[axis] = 1.0 / fabs(direction);
+	}
+	const int32_t size[3] = { GridPerChunk.X, GridPerChunk.Y, GridPerChunk.Z };
+	const int32_t stride[3] = { GridPerChunk.Y * GridPerChunk.Z, GridPerChunk.Z, 1 };
+	Int3 chunkCoord = GetChunkCoordinate(Int3(grid[0], grid[1], grid[2]), GridPerChunk);
+	int32_t local[3] = { grid[0] - chunkCoord.X, grid[1] - chunkCoord.Y, grid[2] - chunkCoord.Z };
+	const ChunkData* data = FindChunk(chunkCoord);
+	bool bEmptyChunk = IsChunkEmpty(data);
+	int32_t index = (local[0] * size[1] + local[1]) * size[2] + local[2];
+
+	double distance = 0;
+	int32_t faceIndex = -1;
+	for (;;)
+	{
+		if (!bEmptyChunk && IsSolid(data->Grids.Get(index)))
+		{
+			outHit.bHit = true;
+			outHit.Distance = distance;
+			outHit.GridCoord = Int3(grid[0], grid[1], grid[2]);
+			outHit.FaceIndex = faceIndex;
+			return true;
+		}
+		int32_t axis = nextBoundary[0] < nextBoundary[1] ? (nextBoundary[0] < nextBoundary[2] ? 0 : 2) : (nextBoundary[1] < nextBoundary[2] ? 1 : 2);
+		distance = nextBoundary[axis];
+		if (distance > ray.MaxDistance)
+			return false;
+		nextBoundary[axis] += boundaryDelta[axis];
+		grid[axis] += step[axis];
+		local[axis] += step[axis];
+		index += step[axis] * stride[axis];
+		//从格子背向射线的一侧进入
+		faceIndex = axis * 2 + (step[axis] > 0 ? 1 : 0);
+		if (local[axis] < 0 || local[axis] >= size[axis])
+		{
+			local[axis] -= step[axis] * size[axis];
+			index -= step[axis] * size[axis] * stride[axis];
+			chunkCoord[axis] += step[axis] * size[axis];
+			data = FindChunk(chunkCoord);
+			bEmptyChunk = IsChunkEmpty(data);
+		}
+	}
+}
+
+size_t VoxelQuery::RaycastBatch(const std::vector<VoxelRay>& rays, std::vector<RaycastHit>& outHits)
+{
+	//起点在同一个块的射线连续检测，经过的块大多已经在缓存中
+	std::vector<std::pair<uint64_t, uint32_t> > order(rays.size());
+	for (size_t i = 0; i < rays.size(); ++i)
+	{
+		Int3 grid(int32_t(floor(rays[i].Origin[0])), int32_t(floor(rays[i].Origin[1])), int32_t(floor(rays[i].Origin[2])));
+		order[i] = std::make_pair(MixInt3(GetChunkCoordinate(grid, GridPerChunk)), uint32_t(i));
+	}
+	std::sort(order.begin(), order.end());
+	outHits.resize(rays.size());
+	size_t numHits = 0;
+	for (size_t i = 0; i < order.size(); ++i)
+		numHits += Raycast(rays[order[i].second], outHits[order[i].second]) ? 1 : 0;
+	return numHits;
+}
+
+template <typename Visitor>
+bool VoxelQuery::ForEachSolidGrid(const Int3& minGrid, const Int3& maxGrid, Visitor visit)
+{
+	Int3 minChunk = GetChunkCoordinate(minGrid, GridPerChunk);
+	Int3 maxChunk = GetChunkCoordinate(maxGrid, GridPerChunk);
+	for (int32_t cx = minChunk.X; cx <= maxChunk.X; cx += GridPerChunk.X)
+	{
+		for (int32_t cy = minChunk.Y; cy <= maxChunk.Y; cy += GridPerChunk.Y)
+		{
+			for (int32_t cz = minChunk.Z; cz <= maxChunk.Z; cz += GridPerChunk.Z)
+			{
+				Int3 chunkCoord(cx, cy, cz);
+				const ChunkData* data = FindChunk(chunkCoord);
+				if (IsChunkEmpty(data))
+					continue;
+				//范围与块的交集
+				Int3 minLocal = Int3::Max(minGrid - chunkCoord, Int3::Scalar(0));
+				Int3 maxLocal = Int3::Min(maxGrid - chunkCoord, GridPerChunk - Int3::Scalar(1));
+				for (int32_t x = minLocal.X; x <= maxLocal.X; ++x)
+				{
+					for (int32_t y = minLocal.Y; y <= maxLocal.Y; ++y)
+					{
+						for (int32_t z = minLocal.Z; z <= maxLocal.Z; ++z)
+						{
+							Int3 local(x, y, z);
+							if (IsSolid(data->GetMaterialIndex(local)) && !visit(chunkCoord + local))
+								return true;
+						}
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+bool VoxelQuery::OverlapSphere(const double center[3], double radius, std::vector<Int3>* outGrids)
+{
+	Int3 minGrid(int32_t(floor(center[0] - radius)), int32_t(floor(center[1] - radius)), int32_t(floor(center[2] - radius)));
+	Int3 maxGrid(int32_t(floor(center[0] + radius)), int32_t(floor(center[1] + radius)), int32_t(floor(center[2] + radius)));
+	bool bFound = false;
+	ForEachSolidGrid(minGrid, maxGrid, [&](const Int3& grid) {
+		//格子上离球心最近的点
+		const int32_t gridMin[3] = { grid.X, grid.Y, grid.Z };
+		double distanceSquared = 0;
+		for (int32_t axis = 0; axis < 3; ++axis)
+		{
+			double nearest = std::min(std::max(center[axis], double(gridMin[axis])), gridMin[axis] + 1.0);
+			distanceSquared += (nearest - center[axis]) * (nearest - center[axis]);
+		}
+		if (distanceSquared >= radius * radius)
+			return true;
+		bFound = true;
+		if (outGrids)
+			outGrids->push_back(grid);
+		return outGrids != NULL;
+	});
+	return bFound;
+}
+
+bool VoxelQuery::OverlapBox(const double boxMin[3], const double boxMax[3], std::vector<Int3>* outGrids)
+{
+	//格子[g, g + 1)与(boxMin, boxMax)相交即g < boxMax且g + 1 > boxMin
+	Int3 minGrid(int32_t(floor(boxMin[0])), int32_t(floor(boxMin[1])), int32_t(floor(boxMin[2])));
+	Int3 maxGrid(int32_t(ceil(boxMax[0])) - 1, int32_t(ceil(boxMax[1])) - 1, int32_t(ceil(boxMax[2])) - 1);
+	bool bFound = false;
+	ForEachSolidGrid(minGrid, maxGrid, [&](const Int3& grid) {
+		bFound = true;
+		if (outGrids)
+			outGrids->push_back(grid);
+		return outGrids != NULL;
+	});
+	return bFound;
+}
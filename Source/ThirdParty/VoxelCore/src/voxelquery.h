@@ -0,0 +1,109 @@
+// voxelquery.h
+//
+// 与引擎无关的体素核心：直接在块数据上的射线检测以及球体、长方体的重叠查询
+//
+
+#ifndef VOXEL_VOXELQUERY_H
+#define VOXEL_VOXELQUERY_H
+
+#include <vector>
+#include "chunkworld.h"
+
+namespace voxel
+{
+	//格子坐标系下的射线，Direction不需要归一化，MaxDistance以格子为单位
+	struct VoxelRay
+	{
+		double Origin[3];
+
+		double Direction[3];
+
+		double MaxDistance;
+	};
+
+	struct RaycastHit
+	{
+		bool bHit;
+
+		//从起点到接触点的距离，起点在参与碰撞的格子内时为0
+		double Distance;
+
+		Int3 GridCoord;
+
+		//射线从格子的哪个面进入，与GetFaceNormal的下标一致，起点在格子内时为-1
+		int32_t FaceIndex;
+
+		RaycastHit() : bHit(false), Distance(0), GridCoord(0, 0, 0), FaceIndex(-1) {}
+	};
+
+	//在主线程上查询ChunkWorld中已有的块数据，没有数据的块当作空白，不能与修改世界的调用同时进行。
+	//格子是否参与碰撞由世界的碰撞材质决定。按块查找数据，块内逐个格子只读存储，最近用过的块留在缓存中供后面的查询使用
+	class VoxelQuery
+	{
+	public:
+		explicit VoxelQuery(const ChunkWorld& world);
+
+		//Amanatides-Woo格子遍历，按顺序访问射线经过的每个格子，返回第一个参与碰撞的格子
+		bool Raycast(const VoxelRay& ray, RaycastHit& outHit);
+
+		//按起点所在的块排序后依次检测，相邻的射线复用缓存中的块，outHits与rays一一对应，返回碰到格子的射线数量
+		size_t RaycastBatch(const std::vector<VoxelRay>& rays, std::vector<RaycastHit>& outHits);
+
+		//与球体相交的参与碰撞的格子，outGrids为空时找到一个就返回
+		bool OverlapSphere(const double center[3], double radius, std::vector<Int3>* outGrids = NULL);
+
+		//与长方体(boxMin, boxMax)相交的参与碰撞的格子，只是贴着边界不算相交
+		bool OverlapBox(const double boxMin[3], const double boxMax[3], std::vector<Int3>* outGrids = NULL);
+
+		//按块查找数据的次数，用于比较批量检测的效果
+		size_t GetNumChunkLookups() const
+		{
+			return NumChunkLookups;
+		}
+
+	private:
+		//没有数据的块为空
+		const ChunkData* FindChunk(const Int3& chunkCoord);
+
+		bool IsSolid(uint8_t materialIndex) const
+		{
+			return SolidMaterials[materialIndex];
+		}
+
+		//块是否整个都是空白，或者整个都参与碰撞，此时不用逐个读取格子
+		bool IsChunkEmpty(const ChunkData* data) const
+		{
+			return !data || (data->Grids.IsUniform() && !IsSolid(data->Grids.Get(0)));
+		}
+
+		//对[minGrid, maxGrid]范围内参与碰撞的格子按块调用visit，visit返回false时停止，返回是否停止
+		template <typename Visitor>
+		bool ForEachSolidGrid(const Int3& minGrid, const Int3& maxGrid, Visitor visit);
+
+		const ChunkMap<ChunkDataPtr>& Chunks;
+
+		Int3 GridPerChunk;
+
+		bool SolidMaterials[256];
+
+		//按块坐标直接映射的缓存，块坐标的哈希取低位
+		struct CachedChunk
+		{
+			Int3 Coordinate;
+
+			const ChunkData* Data;
+
+			bool bValid;
+
+			CachedChunk() : Coordinate(0, 0, 0), Data(NULL), bValid(false) {}
+		};
+
+		static const int32_t NumCachedChunks = 64;
+
+		CachedChunk Cache[NumCachedChunks];
+
+		size_t NumChunkLookups;
+	};
+}
+
+#endif
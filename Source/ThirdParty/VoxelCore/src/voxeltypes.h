@@ -0,0 +1,147 @@
+// voxeltypes.h
+//
+// 与引擎无关的体素核心：基础类型与参数
+//
+
+#ifndef VOXEL_VOXELTYPES_H
+#define VOXEL_VOXELTYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace voxel
+{
+	//三维整数向量
+	struct Int3
+	{
+		int32_t X;
+		int32_t Y;
+		int32_t Z;
+
+		Int3() : X(0), Y(0), Z(0) {}
+		Int3(int32_t x, int32_t y, int32_t z) : X(x), Y(y), Z(z) {}
+
+		static Int3 Scalar(int32_t i)
+		{
+			return Int3(i, i, i);
+		}
+
+		int32_t& operator[](int32_t axis) { return (&X)[axis]; }
+		const int32_t& operator[](int32_t axis) const { return (&X)[axis]; }
+
+		int32_t Volume() const { return X * Y * Z; }
+
+		static Int3 Min(const Int3& a, const Int3& b)
+		{
+			return Int3(a.X < b.X ? a.X : b.X, a.Y < b.Y ? a.Y : b.Y, a.Z < b.Z ? a.Z : b.Z);
+		}
+
+		static Int3 Max(const Int3& a, const Int3& b)
+		{
+			return Int3(a.X > b.X ? a.X : b.X, a.Y > b.Y ? a.Y : b.Y, a.Z > b.Z ? a.Z : b.Z);
+		}
+
+#define VOXEL_DEFINE_INT3_OPERATOR(symbol) \
+		friend Int3 operator symbol(const Int3& a, const Int3& b) \
+		{ \
+			return Int3(a.X symbol b.X, a.Y symbol b.Y, a.Z symbol b.Z); \
+		}
+		VOXEL_DEFINE_INT3_OPERATOR(+)
+		VOXEL_DEFINE_INT3_OPERATOR(-)
+		VOXEL_DEFINE_INT3_OPERATOR(*)
+		VOXEL_DEFINE_INT3_OPERATOR(/)
+		VOXEL_DEFINE_INT3_OPERATOR(&)
+		VOXEL_DEFINE_INT3_OPERATOR(>>)
+#undef VOXEL_DEFINE_INT3_OPERATOR
+
+		friend bool operator==(const Int3& a, const Int3& b)
+		{
+			return a.X == b.X && a.Y == b.Y && a.Z == b.Z;
+		}
+		friend bool operator!=(const Int3& a, const Int3& b)
+		{
+			return !(a == b);
+		}
+	};
+
+	//供unordered_map使用的坐标哈希
+	struct Int3Hash
+	{
+		size_t operator()(const Int3& v) const
+		{
+			return size_t(uint32_t(v.X) * 73856093u ^ uint32_t(v.Y) * 19349663u ^ uint32_t(v.Z) * 83492791u);
+		}
+	};
+
+	//向下取整的除法，负坐标的格子也落在正确的块里
+	inline int32_t FloorDivide(int32_t a, int32_t b)
+	{
+		return a >= 0 ? a / b : (a - b + 1) / b;
+	}
+
+	inline Int3 FloorDivide(const Int3& a, const Int3& b)
+	{
+		return Int3(FloorDivide(a.X, b.X), FloorDivide(a.Y, b.Y), FloorDivide(a.Z, b.Z));
+	}
+
+	//获取格子所在块的坐标（块的最小角）
+	inline Int3 GetChunkCoordinate(const Int3& gridCoord, const Int3& gridPerChunk)
+	{
+		return FloorDivide(gridCoord, gridPerChunk) * gridPerChunk;
+	}
+
+	//按透明程度排序，构建网格时更不透明的格子向更透明的格子露出面
+	enum MaterialType
+	{
+		MT_Empty,
+		MT_Translucent,
+		MT_Opaque,
+		MT_Count,
+	};
+
+	//远处的块构建网格时最多降采样的级数，第i级把2^i个格子合并为一个
+	const int32_t MaxChunkLod = 3;
+
+	//生成与流式加载参数，UE中由FGridParam转换而来
+	struct GridParam
+	{
+		Int3 GridPerChunk;
+
+		Int3 MinCoordinate;
+
+		Int3 MaxCoordinate;
+
+		int32_t MaxHeight;
+
+		int32_t MaxRenderDistance;
+
+		//Update的默认观察者需要数据用于碰撞的半径
+		int32_t MaxCollisionDistance;
+
+		//块在距离小于MaxRenderDistance时显示，超过MaxRenderDistance + StreamingHysteresis时才隐藏，数据的范围同理。
+		//观察点在边界附近来回移动时块不会反复加载和卸载
+		int32_t StreamingHysteresis;
+
+		//后台生成线程数
+		int32_t MaxGenerationTasks;
+
+		//高度噪声的频率，1.0时每个格子恰好落在噪声的整数格点上
+		double NoiseFrequency;
+
+		//与观察点的水平距离不小于LodDistances[i]的块按第i+1级构建网格，需要递增，为0时不使用这一级以及之后的级别
+		int32_t LodDistances[MaxChunkLod];
+
+		//细节层级切换的滞后距离，观察点在分界附近来回移动时块不会反复重建网格
+		int32_t LodHysteresis;
+
+		GridParam() :
+			GridPerChunk(16, 16, 16), MinCoordinate(-1000000, -1000000, -1000000), MaxCoordinate(1000000, 1000000, 1000000),
+			MaxHeight(64), MaxRenderDistance(0), MaxCollisionDistance(0), StreamingHysteresis(0), MaxGenerationTasks(4), NoiseFrequency(1.0), LodHysteresis(0)
+		{
+			for (int32_t i = 0; i < MaxChunkLod; ++i)
+				LodDistances[i] = 0;
+		}
+	};
+}
+
+#endif